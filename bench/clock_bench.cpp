@@ -0,0 +1,46 @@
+/*
+    Cost of a clock read, per call, for the Time functions the network loops use and the raw
+    clocks under them. The per-item paths read cachedMS() after one tick() per pass, this shows
+    what that saves over reading steadyMS()/nowMS() for every packet.
+
+    clock_bench [calls=20000000]
+*/
+
+#include "srv/Time.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+
+using namespace CGameEngine;
+
+template <class Read>
+static void measure(const char* name, uint64_t calls, Read read)
+{
+    volatile uint64_t sink = 0; // keeps the reads from being folded away
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(uint64_t i = 0; i < calls; i++) { sink = sink + read(); }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-34s %8.2f ns/call\n", name, secs * 1e9 / calls);
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t calls = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 20000000;
+    if(calls == 0) { fprintf(stderr, "usage: %s [calls]\n", argv[0]); return 1; }
+    Time& t = Time::getInstance();
+    t.tick();
+
+    measure("Time::nowMS() (system_clock)", calls, [&t]() { return t.nowMS(); });
+    measure("Time::steadyMS() (steady_clock)", calls, [&t]() { return t.steadyMS(); });
+    measure("Time::steadyNS()", calls, [&t]() { return t.steadyNS(); });
+    measure("Time::tick()", calls, [&t]() { return t.tick(); });
+    measure("Time::cachedMS() (thread local)", calls, [&t]() { return t.cachedMS(); });
+    measure("Time::cachedNS()", calls, [&t]() { return t.cachedNS(); });
+    measure("std::chrono::steady_clock::now()", calls, []() { return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count(); });
+    measure("std::chrono::system_clock::now()", calls, []() { return (uint64_t)std::chrono::system_clock::now().time_since_epoch().count(); });
+    #ifdef CLOCK_MONOTONIC_COARSE
+    measure("clock_gettime(MONOTONIC_COARSE)", calls, []() { timespec ts; clock_gettime(CLOCK_MONOTONIC_COARSE, &ts); return (uint64_t)ts.tv_nsec; });
+    #endif
+    return 0;
+}
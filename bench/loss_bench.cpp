@@ -0,0 +1,139 @@
+/*
+    Retransmission requests under loss, selective ACK against one retry request per fragment (NACK).
+    For each loss rate a fresh NetworkSimulator carries one client sending 'count' reliable messages
+    of 'size' bytes to a server, once with setSelectiveAck(true) on both ends and once with false.
+    Reports delivery, virtual completion time, fragments resent and the control packets it took.
+
+    loss_bench [size=4000] [count=100] [speed=1.0]
+*/
+
+#include "net/NetworkServer.h"
+#include "net/NetworkClient.h"
+#include "net/NetworkSimulator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace CGameEngine;
+
+#define BENCH_SERVER_PORT 7000
+#define BENCH_CLIENT_PORT 7001
+#define BENCH_OP 0x200
+#define BENCH_CONNECT_TRIES 20
+#define BENCH_CONNECT_WAIT_US 200000
+#define BENCH_DEADLINE_US (30ULL * 1000 * 1000) // virtual
+
+struct LossResult
+{
+    uint32_t delivered = 0;
+    uint32_t expected = 0;
+    uint64_t elapsedUS = 0;
+    uint64_t resent = 0; // fragments, sender side
+    uint64_t requests = 0; // SACKs or retry requests, receiver side
+    uint64_t wirePackets = 0;
+};
+
+static uint32_t drain(SafeQueue<Datagram*>& q, uint16_t op)
+{
+    uint32_t got = 0;
+    while(!q.empty())
+    {
+        Datagram* d = q.front();
+        q.pop();
+        if(d->op_code == op) { got++; }
+        delete d;
+    }
+    return got;
+}
+
+static LossResult runOnce(double loss, bool selective, uint32_t size, uint32_t count, double speed)
+{
+    LossResult r;
+    SoftwareVersion swv(1, 0, 0);
+    NetworkSimulator sim(42);
+    LinkConditions c;
+    c.latencyUS = 20000;
+    c.jitterUS = 4000;
+    c.loss = loss;
+    c.bandwidth = 10 * 1000 * 1000;
+    sim.setConditions(c);
+    sim.install();
+
+    SafeQueue<Datagram*> serverQueue, clientQueue;
+    NetworkServer* server = new NetworkServer(&swv, BENCH_SERVER_PORT, &serverQueue);
+    NetworkClient* client = new NetworkClient(&swv, BENCH_CLIENT_PORT, &clientQueue, "127.0.0.1", BENCH_SERVER_PORT);
+    server->setSelectiveAck(selective);
+    client->setSelectiveAck(selective);
+    server->setAccepting(true);
+    client->setAccepting(true);
+
+    bool connected = false;
+    for(int attempt = 0; attempt < BENCH_CONNECT_TRIES && !connected; attempt++)
+    {
+        client->sendSimple(OP_ConnectionRequest);
+        sim.run(BENCH_CONNECT_WAIT_US, speed);
+        connected = (drain(clientQueue, OP_ConnectionAccepted) > 0);
+        drain(serverQueue, OP_ConnectionRequest);
+    }
+
+    if(connected)
+    {
+        SimulatorStats before = sim.getStats();
+        uint64_t start = sim.nowUS();
+        for(uint32_t n = 0; n < count; n++)
+        {
+            unsigned char* buf = new unsigned char[size];
+            memset(buf, n & 0xFF, size);
+            client->send(BENCH_OP, &buf, size, DeliveryMode::ReliableUnordered);
+        }
+        r.expected = count;
+        while(r.delivered < r.expected && sim.nowUS() - start < BENCH_DEADLINE_US)
+        {
+            sim.run(1000, speed);
+            r.delivered += drain(serverQueue, BENCH_OP);
+        }
+        r.elapsedUS = sim.nowUS() - start;
+        r.wirePackets = sim.getStats().sent - before.sent;
+
+        NetStatsSnapshot cs = client->getStatsSnapshot();
+        NetStatsSnapshot ss = server->getStatsSnapshot();
+        r.resent = cs.counters[NetCounter::FragmentsResent];
+        r.requests = (selective) ? ss.counters[NetCounter::SelectiveAcksSent] : ss.counters[NetCounter::RetryRequestsSent];
+    }
+
+    client->stop();
+    server->stop();
+    sim.run(100000, speed); // let the threads see the stop
+    delete client;
+    delete server;
+    drain(clientQueue, 0);
+    drain(serverQueue, 0);
+    sim.uninstall();
+    return r;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t size = (argc > 1) ? atoi(argv[1]) : 4000;
+    uint32_t count = (argc > 2) ? atoi(argv[2]) : 100;
+    double speed = (argc > 3) ? atof(argv[3]) : 1.0;
+    if(size == 0 || speed <= 0.0) { fprintf(stderr, "usage: %s [size] [count] [speed]\n", argv[0]); return 1; }
+
+    const double losses[] = { 0.0, 0.01, 0.02, 0.05, 0.10 };
+    int incomplete = 0;
+    printf("%u messages of %u bytes, 20ms +/- 4ms one way, 10 MB/s\n", count, size);
+    printf("%-6s %-5s %10s %12s %10s %10s %10s\n", "loss", "mode", "delivered", "virtual ms", "resent", "requests", "wire pkts");
+    for(size_t i = 0; i < sizeof(losses) / sizeof(losses[0]); i++)
+    {
+        for(int mode = 0; mode < 2; mode++)
+        {
+            bool selective = (mode == 0);
+            LossResult r = runOnce(losses[i], selective, size, count, speed);
+            printf("%-6.2f %-5s %5u/%-4u %12.1f %10llu %10llu %10llu\n", losses[i], (selective) ? "SACK" : "NACK", r.delivered, r.expected, r.elapsedUS / 1000.0,
+                (unsigned long long)r.resent, (unsigned long long)r.requests, (unsigned long long)r.wirePackets);
+            fflush(stdout);
+            if(r.expected == 0 || r.delivered < r.expected) { incomplete++; }
+        }
+    }
+    return (incomplete == 0) ? 0 : 2;
+}
@@ -0,0 +1,160 @@
+/*
+    One NetworkServer and N NetworkClients over the NetworkSimulator. Each client connects, sends
+    'count' reliable messages of 'size' bytes, and the server's queue is drained until every one
+    arrives or the virtual deadline passes. Prints delivery, completion time, goodput and the
+    client/server counters.
+
+    sim_bench [clients=4] [size=4000] [count=200] [loss=0.02] [speed=1.0] [duplicate=0.01]
+    REACTOR=<threads> runs the sockets on a shared Reactor instead of listen threads.
+*/
+
+#include "net/NetworkServer.h"
+#include "net/NetworkClient.h"
+#include "net/NetworkSimulator.h"
+#include "net/Reactor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace CGameEngine;
+
+#define BENCH_SERVER_PORT 7000
+#define BENCH_CLIENT_PORT 7001 // first client, the rest count up
+#define BENCH_OP 0x200
+#define BENCH_CONNECT_TRIES 20 // the client does not repeat a lost request (or a request whose reply was lost) on its own
+#define BENCH_CONNECT_WAIT_US 200000
+#define BENCH_DEADLINE_US (30ULL * 1000 * 1000) // virtual, stragglers past it are reported as lost
+
+static uint32_t drain(SafeQueue<Datagram*>& q, uint16_t op, uint64_t* bytes = nullptr)
+{
+    uint32_t got = 0;
+    while(!q.empty())
+    {
+        Datagram* d = q.front();
+        q.pop();
+        if(d->op_code == op)
+        {
+            got++;
+            if(bytes) { *bytes += d->dataLength; }
+        }
+        delete d;
+    }
+    return got;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t clients = (argc > 1) ? atoi(argv[1]) : 4;
+    uint32_t size = (argc > 2) ? atoi(argv[2]) : 4000;
+    uint32_t count = (argc > 3) ? atoi(argv[3]) : 200;
+    double loss = (argc > 4) ? atof(argv[4]) : 0.02;
+    double speed = (argc > 5) ? atof(argv[5]) : 1.0;
+    double duplicate = (argc > 6) ? atof(argv[6]) : 0.01;
+    if(clients == 0 || size == 0 || speed <= 0.0) { fprintf(stderr, "usage: %s [clients] [size] [count] [loss] [speed] [duplicate]\n", argv[0]); return 1; }
+
+    SoftwareVersion swv(1, 0, 0);
+    NetworkSimulator sim(42);
+    LinkConditions c;
+    c.latencyUS = 20000;
+    c.jitterUS = 4000;
+    c.loss = loss;
+    c.duplicate = duplicate;
+    c.reorder = duplicate;
+    c.bandwidth = 10 * 1000 * 1000;
+    sim.setConditions(c);
+    sim.install();
+
+    Reactor* reactor = getenv("REACTOR") ? new Reactor(atoi(getenv("REACTOR"))) : nullptr;
+    Reactor::setShared(reactor);
+
+    SafeQueue<Datagram*> serverQueue;
+    NetworkServer server(&swv, BENCH_SERVER_PORT, &serverQueue);
+    server.setAccepting(true);
+
+    std::vector<SafeQueue<Datagram*>*> queues;
+    std::vector<NetworkClient*> nodes;
+    for(uint32_t i = 0; i < clients; i++)
+    {
+        queues.push_back(new SafeQueue<Datagram*>());
+        nodes.push_back(new NetworkClient(&swv, BENCH_CLIENT_PORT + i, queues[i], "127.0.0.1", BENCH_SERVER_PORT));
+        nodes[i]->setAccepting(true);
+    }
+
+    // connect, asking again whoever has not been accepted yet
+    std::vector<bool> connected(clients, false);
+    uint32_t connectedCount = 0;
+    for(int attempt = 0; attempt < BENCH_CONNECT_TRIES && connectedCount < clients; attempt++)
+    {
+        for(uint32_t i = 0; i < clients; i++) { if(!connected[i]) { nodes[i]->sendSimple(OP_ConnectionRequest); } }
+        sim.run(BENCH_CONNECT_WAIT_US, speed);
+        for(uint32_t i = 0; i < clients; i++)
+        {
+            if(!connected[i] && drain(*queues[i], OP_ConnectionAccepted) > 0) { connected[i] = true; connectedCount++; }
+        }
+        drain(serverQueue, OP_ConnectionRequest);
+    }
+    printf("connected %u/%u clients, server holds %u connections\n", connectedCount, clients, server.getConnectionCount());
+
+    uint64_t start = sim.nowUS();
+    uint32_t expected = 0;
+    for(uint32_t i = 0; i < clients; i++)
+    {
+        if(!connected[i]) { continue; }
+        for(uint32_t n = 0; n < count; n++)
+        {
+            unsigned char* buf = new unsigned char[size];
+            memset(buf, (i + n) & 0xFF, size);
+            nodes[i]->send(BENCH_OP, &buf, size, DeliveryMode::ReliableUnordered);
+            expected++;
+        }
+    }
+
+    uint32_t got = 0;
+    uint64_t bytes = 0;
+    while(got < expected && sim.nowUS() - start < BENCH_DEADLINE_US)
+    {
+        sim.run(1000, speed);
+        got += drain(serverQueue, BENCH_OP, &bytes);
+    }
+    uint64_t doneUS = sim.nowUS() - start;
+
+    SimulatorStats s = sim.getStats();
+    NetStatsSnapshot ss = server.getStatsSnapshot();
+    NetStatsSnapshot cs; // clients summed
+    for(uint32_t i = 0; i < clients; i++)
+    {
+        NetStatsSnapshot one = nodes[i]->getStatsSnapshot();
+        for(int k = 0; k < NetCounter::END; k++) { cs.counters[k] += one.counters[k]; }
+    }
+
+    printf("clients %u size %u loss %.3f: delivered %u/%u in %.1f ms virtual%s, goodput %.2f MB/s\n",
+        clients, size, loss, got, expected, doneUS / 1000.0, (got < expected) ? " (deadline)" : "", doneUS ? bytes / (doneUS / 1e6) / 1e6 : 0.0);
+    printf("wire sent %llu lost %llu dup %llu reord %llu, resent %llu / sent %llu = %.3f\n",
+        (unsigned long long)s.sent, (unsigned long long)s.lost, (unsigned long long)s.duplicated, (unsigned long long)s.reordered,
+        (unsigned long long)cs.counters[NetCounter::FragmentsResent], (unsigned long long)cs.counters[NetCounter::PacketsSent],
+        cs.counters[NetCounter::PacketsSent] ? (double)cs.counters[NetCounter::FragmentsResent] / cs.counters[NetCounter::PacketsSent] : 0.0);
+    printf("%-24s %10s %10s\n", "counter", "clients", "server");
+    for(int k = 0; k < NetCounter::END; k++) { printf("%-24s %10llu %10llu\n", NetStatsSnapshot::counterName(k), (unsigned long long)cs.counters[k], (unsigned long long)ss.counters[k]); }
+    if(reactor)
+    {
+        ReactorStats rs = reactor->snapshot();
+        printf("reactor threads %u registered %u wakeups %llu dispatched %llu\n", rs.threads, rs.registered, (unsigned long long)rs.wakeups, (unsigned long long)rs.dispatched);
+    }
+    fflush(stdout);
+
+    for(uint32_t i = 0; i < clients; i++) { nodes[i]->stop(); }
+    server.stop();
+    sim.run(100000, speed); // let the threads see the stop
+    for(uint32_t i = 0; i < clients; i++)
+    {
+        delete nodes[i];
+        drain(*queues[i], 0);
+        delete queues[i];
+    }
+    drain(serverQueue, 0);
+    Reactor::setShared(nullptr);
+    delete reactor;
+    sim.uninstall();
+    return (got == expected && connectedCount == clients) ? 0 : 2;
+}
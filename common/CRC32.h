@@ -2,10 +2,41 @@
 #define CRC32_H_INCLUDED
 
 #include <assert.h>
+#include <atomic>
 #include <memory.h>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define CRC32_HAS_PCLMUL 1
+    #include <wmmintrin.h> // _mm_clmulepi64_si128
+    #include <smmintrin.h> // _mm_extract_epi32
+#else
+    #define CRC32_HAS_PCLMUL 0
+#endif
 
     // Ref : https://stackoverflow.com/a/27950866/6845246
 
+/*
+    Reflected CRC-32 (IEEE 802.3, 0xEDB88320), three engines producing identical results:
+        Bytewise    - the original table walk, one byte per lookup
+        Slicing8    - eight tables, eight bytes per step (little-endian hosts)
+        PCLMUL      - carry-less multiply folding of 64 byte blocks, Barrett reduced to 32 bits,
+                      slicing-by-8 for anything under 64 bytes and for the sub-16 byte tail
+    The fastest the CPU supports is picked on first use, setEngine() overrides it (falling back if unsupported).
+
+    Ref:
+        https://static.aminer.org/pdf/PDF/000/432/446/a_systematic_approach_to_building_high_performance_software_based_crc.pdf
+            Kounavis & Berry, slicing-by-8
+        https://www.intel.com/content/dam/www/public/us/en/documents/white-papers/fast-crc-computation-generic-polynomials-pclmulqdq-paper.pdf
+            Fast CRC Computation for Generic Polynomials Using PCLMULQDQ (folding and reflected domain constants)
+        https://chromium.googlesource.com/chromium/src/third_party/zlib/+/master/crc32_simd.c
+            zlib's PCLMUL implementation of the same
+*/
+
+#define CRC32_PCLMUL_MIN 64 // smallest input folded, one 4x128 bit block
+
+namespace CRC32Engine { enum FORMS { Bytewise, Slicing8, PCLMUL, END }; }
+
 static uint32_t CRC32Table[256] =
 {
     0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA,
@@ -88,34 +119,195 @@ class CRC32
             return retVal;
         }
 
-        static uint32_t create(const char* buffer, uint32_t len)
+        static uint32_t create(const char* buffer, uint32_t len) { return create(reinterpret_cast<const unsigned char*>(buffer), len); }
+
+        /// raw register, 'crc' continues an earlier parse() over preceding data
+        static uint32_t	parse(const unsigned char* buffer, uint32_t len, uint32_t crc = 0xFFFFFFFF)
         {
-            uint32_t retVal = 0;
-            unsigned char* tmp = new unsigned char[len];
-            memcpy(tmp, buffer, len); // copy into unsigned array
-            try { retVal = cleanup( parse(tmp, len) ); }
-            catch (...) { retVal = -1; }
-            safeDeleteArray(tmp); // cleanup
-            return retVal;
+            switch(engine().load(std::memory_order_relaxed))
+            {
+                #if CRC32_HAS_PCLMUL
+                case CRC32Engine::PCLMUL: { return parsePCLMUL(buffer, len, crc); }
+                #endif
+                case CRC32Engine::Slicing8: { return parseSlicing8(buffer, len, crc); }
+                default: { return parseBytewise(buffer, len, crc); }
+            }
+        }
+
+        static inline uint32_t cleanup(uint32_t crc) { return ~crc; }
+
+        static const uint8_t getEngine() { return engine().load(std::memory_order_relaxed); }
+        static bool isSupported(uint8_t e)
+        {
+            if(e == CRC32Engine::Bytewise) { return true; }
+            else if(e == CRC32Engine::Slicing8) { return isLittleEndian(); }
+            #if CRC32_HAS_PCLMUL
+            else if(e == CRC32Engine::PCLMUL) { return (isLittleEndian() && __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")); }
+            #endif
+            return false;
         }
+        static void setEngine(uint8_t e) { engine().store((isSupported(e)) ? e : detect(), std::memory_order_relaxed); }
 
-        static uint32_t	parse(const unsigned char* buffer, uint32_t len)
+        // engines, exposed for benchmarks and comparisons
+        static uint32_t parseBytewise(const unsigned char* buffer, uint32_t len, uint32_t crc)
         {
-            uint32_t retVal = 0xFFFFFFFF;
             for(uint32_t i = 0; i < len; i++)
             {
-                calculate(buffer[i], retVal);
+                calculate(buffer[i], crc);
             }
-            return retVal;
+            return crc;
         }
 
-        static inline uint32_t cleanup(uint32_t crc) { return ~crc; }
+        static uint32_t parseSlicing8(const unsigned char* buffer, uint32_t len, uint32_t crc)
+        {
+            const uint32_t (*t)[256] = slicingTables();
+            while(len >= 8)
+            {
+                uint32_t lo = 0, hi = 0;
+                memcpy(&lo, buffer, 4);
+                memcpy(&hi, buffer + 4, 4);
+                lo ^= crc;
+                crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                      t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+                buffer += 8;
+                len -= 8;
+            }
+            return parseBytewise(buffer, len, crc);
+        }
+
+        #if CRC32_HAS_PCLMUL
+        __attribute__((target("pclmul,sse4.1")))
+        static uint32_t parsePCLMUL(const unsigned char* buffer, uint32_t len, uint32_t crc)
+        {
+            if(len < CRC32_PCLMUL_MIN) { return parseSlicing8(buffer, len, crc); }
+
+            // reflected domain constants, x^(4*128+64) mod P ... from the Intel paper, then Barrett mu and P
+            alignas(16) static const uint64_t k1k2[2] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+            alignas(16) static const uint64_t k3k4[2] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+            alignas(16) static const uint64_t k5k0[2] = { 0x0163cd6124ULL, 0x0000000000ULL };
+            alignas(16) static const uint64_t poly[2] = { 0x01db710641ULL, 0x01f7011641ULL };
+            uint32_t tail = len & 15;
+            len -= tail;
+
+            __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+            x1 = _mm_loadu_si128((const __m128i*)(buffer + 0x00));
+            x2 = _mm_loadu_si128((const __m128i*)(buffer + 0x10));
+            x3 = _mm_loadu_si128((const __m128i*)(buffer + 0x20));
+            x4 = _mm_loadu_si128((const __m128i*)(buffer + 0x30));
+            x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+            x0 = _mm_load_si128((const __m128i*)k1k2);
+            buffer += 64;
+            len -= 64;
+
+            // fold four 128 bit lanes in parallel
+            while(len >= 64)
+            {
+                x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+                x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+                x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+                x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+                x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+                x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+                x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+                x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+                y5 = _mm_loadu_si128((const __m128i*)(buffer + 0x00));
+                y6 = _mm_loadu_si128((const __m128i*)(buffer + 0x10));
+                y7 = _mm_loadu_si128((const __m128i*)(buffer + 0x20));
+                y8 = _mm_loadu_si128((const __m128i*)(buffer + 0x30));
+                x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+                x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+                x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+                x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+                buffer += 64;
+                len -= 64;
+            }
+
+            // fold the lanes into one
+            x0 = _mm_load_si128((const __m128i*)k3k4);
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+            // remaining 16 byte blocks
+            while(len >= 16)
+            {
+                x2 = _mm_loadu_si128((const __m128i*)buffer);
+                x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+                x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+                x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+                buffer += 16;
+                len -= 16;
+            }
+
+            // 128 -> 64 bits
+            x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+            x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+            x1 = _mm_srli_si128(x1, 8);
+            x1 = _mm_xor_si128(x1, x2);
+            x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+            x2 = _mm_srli_si128(x1, 4);
+            x1 = _mm_and_si128(x1, x3);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+
+            // Barrett reduction to 32 bits
+            x0 = _mm_load_si128((const __m128i*)poly);
+            x2 = _mm_and_si128(x1, x3);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+            x2 = _mm_and_si128(x2, x3);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+            crc = (uint32_t)_mm_extract_epi32(x1, 1);
+
+            return parseSlicing8(buffer, tail, crc);
+        }
+        #endif
 
     private:
         static inline void calculate(const unsigned char byte, uint32_t& crc)
         {
             crc = ((crc) >> 8) ^ CRC32Table[(byte) ^ ((crc) & 0x000000FF)];
         }
+
+        static bool isLittleEndian()
+        {
+            const uint16_t probe = 1;
+            return (*reinterpret_cast<const unsigned char*>(&probe) == 1);
+        }
+
+        static uint8_t detect()
+        {
+            if(isSupported(CRC32Engine::PCLMUL)) { return CRC32Engine::PCLMUL; }
+            else if(isSupported(CRC32Engine::Slicing8)) { return CRC32Engine::Slicing8; }
+            return CRC32Engine::Bytewise;
+        }
+
+        static std::atomic<uint8_t>& engine() { static std::atomic<uint8_t> e(detect()); return e; } // thread-safe first use (C++11 statics)
+
+        /// table k advances a byte k more positions than CRC32Table (table 0)
+        static const uint32_t (*slicingTables())[256]
+        {
+            struct Tables
+            {
+                uint32_t t[8][256];
+                Tables()
+                {
+                    for(int i = 0; i < 256; i++) { t[0][i] = CRC32Table[i]; }
+                    for(int k = 1; k < 8; k++)
+                    {
+                        for(int i = 0; i < 256; i++) { t[k][i] = (t[k-1][i] >> 8) ^ CRC32Table[t[k-1][i] & 0xFF]; }
+                    }
+                }
+            };
+            static const Tables tables;
+            return tables.t;
+        }
 };
 
 #endif // CRC32_H_INCLUDED
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+/*
+    Log-linear buckets: values 0-7 get their own bucket, above that every power of two is split
+    into 8 equal sub-buckets, so any reported percentile is within ~12% of the true value while
+    the whole uint64_t range fits in HISTOGRAM_BUCKETS counters.
+
+    Ref:
+        http://hdrhistogram.org/
+*/
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+/**
+ * @file Histogram.h
+ * @brief plain copy of a Histogram's counters, safe to inspect from any thread
+ */
+struct HistogramSnapshot
+{
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+    uint64_t buckets[HISTOGRAM_BUCKETS] = { 0 };
+
+    const double mean() const { return (count > 0) ? ((double)sum / count) : 0.0; }
+
+    /// upper bound of the bucket holding the p-th percentile (0.0 - 100.0), clamped to the observed max
+    const uint64_t percentile(double p) const
+    {
+        if(count == 0) { return 0; }
+        uint64_t target = (uint64_t)((p / 100.0) * count);
+        if(target >= count) { target = count - 1; }
+
+        uint64_t seen = 0;
+        for(uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        {
+            seen += buckets[i];
+            if(seen > target)
+            {
+                uint64_t upper = bucketUpper(i);
+                return (upper < max) ? upper : max;
+            }
+        }
+        return max;
+    }
+
+    static uint64_t bucketUpper(uint32_t idx)
+    {
+        if(idx < HISTOGRAM_SUB_COUNT) { return idx; }
+        uint32_t exponent = (idx / HISTOGRAM_SUB_COUNT) + (HISTOGRAM_SUB_BITS - 1);
+        uint64_t mantissa = HISTOGRAM_SUB_COUNT + (idx % HISTOGRAM_SUB_COUNT);
+        uint32_t shift = exponent - HISTOGRAM_SUB_BITS;
+        return (mantissa << shift) + ((uint64_t)1 << shift) - 1;
+    }
+};
+
+/**
+ * @file Histogram.h
+ * @brief Histogram records uint64_t samples (latencies, sizes, ...) with relaxed atomics, so any
+ *        number of threads may record() while another takes a snapshot()
+ */
+class Histogram
+{
+    public:
+        Histogram() { reset(); }
+        Histogram(const Histogram& h) = delete;
+        Histogram& operator=(const Histogram& h) = delete;
+
+        void record(uint64_t value)
+        {
+            m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            m_sum.fetch_add(value, std::memory_order_relaxed);
+
+            uint64_t prev = m_min.load(std::memory_order_relaxed);
+            while(value < prev && !m_min.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+            prev = m_max.load(std::memory_order_relaxed);
+            while(value > prev && !m_max.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+        }
+
+        HistogramSnapshot snapshot() const
+        {
+            HistogramSnapshot retVal;
+            retVal.count = m_count.load(std::memory_order_relaxed);
+            retVal.sum = m_sum.load(std::memory_order_relaxed);
+            retVal.min = (retVal.count > 0) ? m_min.load(std::memory_order_relaxed) : 0;
+            retVal.max = m_max.load(std::memory_order_relaxed);
+            for(uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) { retVal.buckets[i] = m_buckets[i].load(std::memory_order_relaxed); }
+            return retVal;
+        }
+
+        /// not atomic as a whole, samples recorded during a reset() may be partially kept
+        void reset()
+        {
+            for(uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) { m_buckets[i].store(0, std::memory_order_relaxed); }
+            m_count.store(0, std::memory_order_relaxed);
+            m_sum.store(0, std::memory_order_relaxed);
+            m_min.store(UINT64_MAX, std::memory_order_relaxed);
+            m_max.store(0, std::memory_order_relaxed);
+        }
+
+        static uint32_t bucketIndex(uint64_t value)
+        {
+            if(value < HISTOGRAM_SUB_COUNT) { return (uint32_t)value; }
+            uint32_t exponent = 63 - __builtin_clzll(value);
+            uint32_t mantissa = (uint32_t)(value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_COUNT - 1);
+            return ((exponent - (HISTOGRAM_SUB_BITS - 1)) * HISTOGRAM_SUB_COUNT) + mantissa;
+        }
+
+    private:
+        std::atomic<uint64_t> m_buckets[HISTOGRAM_BUCKETS];
+        std::atomic<uint64_t> m_count;
+        std::atomic<uint64_t> m_sum;
+        std::atomic<uint64_t> m_min;
+        std::atomic<uint64_t> m_max;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "common/SPSCRing.h" // RING_CACHE_LINE
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+/*
+    Bounded many producer, single consumer ring (Vyukov's bounded queue with the consumer side
+    simplified). Every cell carries a sequence number: a cell at position p is free when its
+    sequence equals p and holds data when it equals p+1. Producers claim positions with a CAS on
+    the tail; the consumer frees cells strictly in order, so a free cell at p+n-1 means the whole
+    run [p, p+n) is free and pushBatch() can claim it with a single CAS.
+
+    Ref:
+        https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+*/
+
+/**
+ * @file MPSCRing.h
+ * @brief MPSCRing is a lock-free hand-off from any number of producer threads to exactly one
+ *        consumer thread. T must be default constructible and movable. push() fails rather than blocks when full.
+ */
+template <typename T>
+class MPSCRing
+{
+    public:
+        MPSCRing(size_t capacity) : m_cells(roundCapacity(capacity)), m_mask(m_cells.size() - 1)
+        {
+            for(size_t i = 0; i < m_cells.size(); i++) { m_cells[i].sequence.store(i, std::memory_order_relaxed); }
+        }
+        MPSCRing(const MPSCRing& r) = delete;
+        MPSCRing& operator=(const MPSCRing& r) = delete;
+
+        /// any thread
+        bool push(const T& item)
+        {
+            Cell* cell = nullptr;
+            size_t pos = m_tail.load(std::memory_order_relaxed);
+            while(true)
+            {
+                cell = &m_cells[pos & m_mask];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if(diff == 0) { if(m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; } }
+                else if(diff < 0) { return false; } // full
+                else { pos = m_tail.load(std::memory_order_relaxed); } // another producer got it
+            }
+            cell->data = item;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// any thread, claims one contiguous run for all of 'items' or falls back to single pushes, returns count pushed
+        size_t pushBatch(T* items, size_t count)
+        {
+            if(count == 0) { return 0; }
+            if(count <= m_mask + 1)
+            {
+                size_t pos = m_tail.load(std::memory_order_relaxed);
+                size_t last = pos + count - 1;
+                if(m_cells[last & m_mask].sequence.load(std::memory_order_acquire) == last &&
+                   m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) == pos &&
+                   m_tail.compare_exchange_strong(pos, pos + count, std::memory_order_relaxed))
+                {
+                    for(size_t i = 0; i < count; i++)
+                    {
+                        Cell& cell = m_cells[(pos + i) & m_mask];
+                        cell.data = std::move(items[i]);
+                        cell.sequence.store(pos + i + 1, std::memory_order_release);
+                    }
+                    return count;
+                }
+            }
+
+            // contended or nearly full
+            size_t pushed = 0;
+            while(pushed < count && push(items[pushed])) { pushed++; }
+            return pushed;
+        }
+
+        /// consumer only
+        bool pop(T& out)
+        {
+            Cell& cell = m_cells[m_head & m_mask];
+            if(cell.sequence.load(std::memory_order_acquire) != m_head + 1) { return false; } // empty, or producer still writing
+            out = std::move(cell.data);
+            cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+            m_head++;
+            m_headPublished.store(m_head, std::memory_order_release);
+            return true;
+        }
+
+        /// consumer only, moves up to 'max' ready items into 'out', returns count popped
+        size_t popBatch(T* out, size_t max)
+        {
+            size_t count = 0;
+            while(count < max)
+            {
+                Cell& cell = m_cells[m_head & m_mask];
+                if(cell.sequence.load(std::memory_order_acquire) != m_head + 1) { break; }
+                out[count++] = std::move(cell.data);
+                cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+                m_head++;
+            }
+            if(count > 0) { m_headPublished.store(m_head, std::memory_order_release); }
+            return count;
+        }
+
+        /// approximate, includes cells claimed by producers that are still being written
+        size_t size() const
+        {
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            size_t head = m_headPublished.load(std::memory_order_acquire);
+            return (tail > head) ? (tail - head) : 0;
+        }
+        bool empty() const { return (size() == 0); }
+        size_t capacity() const { return m_mask + 1; }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence { 0 };
+            T data;
+        };
+
+        static size_t roundCapacity(size_t capacity)
+        {
+            size_t cap = 2;
+            while(cap < capacity) { cap <<= 1; }
+            return cap;
+        }
+
+        std::vector<Cell> m_cells;
+        size_t m_mask = 0;
+        char m_pad0[RING_CACHE_LINE];
+        std::atomic<size_t> m_tail { 0 }; // next position to claim, shared by producers
+        char m_pad1[RING_CACHE_LINE];
+        size_t m_head = 0; // consumer's private position
+        std::atomic<size_t> m_headPublished { 0 }; // m_head as seen by size()
+        char m_pad2[RING_CACHE_LINE];
+};
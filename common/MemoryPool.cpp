@@ -0,0 +1,256 @@
+#include "common/MemoryPool.h"
+#include "common/types.h"
+#include <stdlib.h>
+
+#define POOL_MAGIC 0x504F4F4C // 'POOL'
+#define POOL_OVERSIZE 0xFF
+#define POOL_SLAB_SIZE 65536 // classes below this are carved out of 64KB slabs
+#define POOL_BATCH 32 // blocks traded between a thread cache and the shared list at once
+#define POOL_PUBLISH_EVERY 1024 // local hits before counters are pushed regardless
+
+const uint32_t MemoryPool::BLOCK_SIZES[PoolClass::END] = { 64, 256, 1024, 65536 };
+const uint32_t MemoryPool::CACHE_LIMITS[PoolClass::END] = { 256, 256, 128, 4 };
+
+namespace
+{
+    /// lives in front of every block handed out, keeps the pointer returned 16 byte aligned
+    struct BlockHeader
+    {
+        uint32_t magic;
+        uint32_t sizeClass;
+        uint64_t size; // only meaningful for oversize allocations
+    };
+    static_assert(sizeof(BlockHeader) == POOL_HEADER_SIZE, "BlockHeader must match POOL_HEADER_SIZE");
+
+    /// per-thread free lists, flushed back to the shared lists when the thread exits
+    struct ThreadCache
+    {
+        MemoryPool::FreeBlock* heads[PoolClass::END] = { nullptr };
+        uint32_t counts[PoolClass::END] = { 0 };
+        uint64_t hits[PoolClass::END] = { 0 }; // not yet published
+        int64_t inUse[PoolClass::END] = { 0 }; // not yet published, may go negative (freed on another thread)
+
+        ~ThreadCache()
+        {
+            for(uint8_t c = 0; c < PoolClass::END; c++) { flush(c, counts[c]); publish(c); }
+        }
+
+        // counters are kept locally and pushed whenever blocks are traded, keeping the hot path free of shared writes
+        void publish(uint8_t c)
+        {
+            MemoryPool::getInstance().publishCounters(c, hits[c], inUse[c]);
+            hits[c] = 0;
+            inUse[c] = 0;
+        }
+
+        // hand 'count' blocks back to the shared list
+        void flush(uint8_t c, uint32_t count)
+        {
+            if(count == 0 || !heads[c]) { return; }
+            MemoryPool::FreeBlock* head = heads[c];
+            MemoryPool::FreeBlock* tail = head;
+            for(uint32_t i = 1; i < count && tail->next; i++) { tail = tail->next; }
+            heads[c] = tail->next;
+            tail->next = nullptr;
+            counts[c] -= count;
+            MemoryPool::getInstance().giveBatch(c, head, tail, count);
+            publish(c);
+        }
+    };
+
+    thread_local ThreadCache t_cache;
+
+    inline uint8_t classFor(size_t size)
+    {
+        size_t total = size + POOL_HEADER_SIZE;
+        for(uint8_t c = 0; c < PoolClass::END; c++) { if(total <= MemoryPool::BLOCK_SIZES[c]) { return c; } }
+        return POOL_OVERSIZE;
+    }
+}
+
+/**
+ * Acquire a block able to hold 'size' bytes, served from this thread's cache when possible
+ *
+ * @param size number of usable bytes needed
+ */
+void* MemoryPool::acquire(size_t size)
+{
+    uint8_t c = classFor(size);
+
+    // too big for any class, straight to the system allocator
+    if(c == POOL_OVERSIZE)
+    {
+        BlockHeader* hdr = static_cast<BlockHeader*>(malloc(size + POOL_HEADER_SIZE));
+        if(!hdr) { Logger::getInstance().Log(Logs::FATAL, Logs::Core, "MemoryPool::acquire()", "malloc() of [{}] bytes failed!", size); return nullptr; }
+        hdr->magic = POOL_MAGIC;
+        hdr->sizeClass = POOL_OVERSIZE;
+        hdr->size = size;
+        m_oversize.fetch_add(1, std::memory_order_relaxed);
+        return reinterpret_cast<unsigned char*>(hdr) + POOL_HEADER_SIZE;
+    }
+
+    // refill the thread cache in one batch if it ran dry
+    bool hit = true;
+    if(!t_cache.heads[c])
+    {
+        uint32_t taken = 0;
+        bool carved = false;
+        t_cache.publish(c);
+        t_cache.heads[c] = takeBatch(c, POOL_BATCH, taken, carved);
+        t_cache.counts[c] = taken;
+        hit = !carved;
+    }
+
+    FreeBlock* block = t_cache.heads[c];
+    if(!block) { Logger::getInstance().Log(Logs::FATAL, Logs::Core, "MemoryPool::acquire()", "Unable to carve block for class [{}]!", c); return nullptr; }
+    t_cache.heads[c] = block->next;
+    t_cache.counts[c]--;
+
+    t_cache.inUse[c]++;
+    if(!hit) { m_classes[c].misses.fetch_add(1, std::memory_order_relaxed); }
+    else if(++t_cache.hits[c] >= POOL_PUBLISH_EVERY) { t_cache.publish(c); } // keep stats fresh on threads that never trade
+
+    BlockHeader* hdr = reinterpret_cast<BlockHeader*>(block);
+    hdr->magic = POOL_MAGIC;
+    hdr->sizeClass = c;
+    hdr->size = size;
+    return reinterpret_cast<unsigned char*>(hdr) + POOL_HEADER_SIZE;
+}
+
+/**
+ * Return a block to this thread's cache, spilling half of it to the shared list when full
+ *
+ * @param ptr pointer previously returned by acquire() (nullptr is ignored)
+ */
+void MemoryPool::release(void* ptr)
+{
+    if(!ptr) { return; }
+
+    BlockHeader* hdr = reinterpret_cast<BlockHeader*>(static_cast<unsigned char*>(ptr) - POOL_HEADER_SIZE);
+    if(hdr->magic != POOL_MAGIC) { Logger::getInstance().Log(Logs::CRIT, Logs::Core, "MemoryPool::release()", "Pointer was not acquired from MemoryPool (or was released twice)!"); return; }
+    hdr->magic = 0;
+
+    if(hdr->sizeClass == POOL_OVERSIZE) { free(hdr); return; }
+
+    uint8_t c = static_cast<uint8_t>(hdr->sizeClass);
+    t_cache.inUse[c]--;
+
+    FreeBlock* block = reinterpret_cast<FreeBlock*>(hdr);
+    block->next = t_cache.heads[c];
+    t_cache.heads[c] = block;
+    t_cache.counts[c]++;
+
+    if(t_cache.counts[c] > CACHE_LIMITS[c]) { t_cache.flush(c, t_cache.counts[c] / 2); }
+}
+
+/**
+ * Pre-carve blocks so the first wave of traffic does not pay for slab allocation
+ *
+ * @param sizeClass PoolClass to grow
+ * @param blocks number of additional free blocks wanted
+ */
+void MemoryPool::reserve(uint8_t sizeClass, uint32_t blocks)
+{
+    if(sizeClass >= PoolClass::END || blocks == 0) { return; }
+    std::lock_guard<std::mutex> lock(m_classes[sizeClass].lock);
+    carve(sizeClass, blocks);
+}
+
+void MemoryPool::logStats() const
+{
+    const char* names[PoolClass::END] = { "Small", "Medium", "Packet", "Large" };
+    for(uint8_t c = 0; c < PoolClass::END; c++)
+    {
+        PoolStats ps = getStats(c);
+        Logger::getInstance().Log(Logs::INFO, Logs::Core, "MemoryPool::logStats()", "{} ({}B): hits [{}], misses [{}], inUse [{}], highWater [{}], reserved [{}]",
+            names[c], ps.blockSize, ps.hits, ps.misses, ps.inUse, ps.highWater, ps.reserved);
+    }
+    Logger::getInstance().Log(Logs::INFO, Logs::Core, "MemoryPool::logStats()", "Oversize allocations [{}]", getOversizeCount());
+}
+
+PoolStats MemoryPool::getStats(uint8_t sizeClass) const
+{
+    PoolStats retVal;
+    if(sizeClass >= PoolClass::END) { return retVal; }
+
+    const SizeClass& sc = m_classes[sizeClass];
+    retVal.blockSize = BLOCK_SIZES[sizeClass];
+    retVal.hits = sc.hits.load(std::memory_order_relaxed);
+    retVal.misses = sc.misses.load(std::memory_order_relaxed);
+    int64_t inUse = sc.inUse.load(std::memory_order_relaxed);
+    retVal.inUse = (inUse > 0) ? inUse : 0;
+    retVal.highWater = sc.highWater.load(std::memory_order_relaxed);
+    retVal.reserved = sc.reserved.load(std::memory_order_relaxed);
+    return retVal;
+}
+
+/**
+ * Pull up to maxBlocks from the shared list, carving new ones if it is empty
+ */
+MemoryPool::FreeBlock* MemoryPool::takeBatch(uint8_t sizeClass, uint32_t maxBlocks, uint32_t& taken, bool& carved)
+{
+    SizeClass& sc = m_classes[sizeClass];
+    std::lock_guard<std::mutex> lock(sc.lock);
+
+    taken = 0;
+    carved = false;
+    if(!sc.head)
+    {
+        uint32_t blocks = (BLOCK_SIZES[sizeClass] < POOL_SLAB_SIZE) ? (POOL_SLAB_SIZE / BLOCK_SIZES[sizeClass]) : 1;
+        carve(sizeClass, blocks);
+        carved = true;
+    }
+
+    FreeBlock* head = sc.head;
+    FreeBlock* tail = head;
+    taken = (head) ? 1 : 0;
+    while(tail && tail->next && taken < maxBlocks) { tail = tail->next; taken++; }
+
+    if(tail) { sc.head = tail->next; tail->next = nullptr; }
+    sc.freeCount -= taken;
+    return head;
+}
+
+/**
+ * Hand a linked run of blocks back to the shared list
+ */
+void MemoryPool::giveBatch(uint8_t sizeClass, FreeBlock* head, FreeBlock* tail, uint32_t count)
+{
+    if(!head || !tail) { return; }
+    SizeClass& sc = m_classes[sizeClass];
+    std::lock_guard<std::mutex> lock(sc.lock);
+    tail->next = sc.head;
+    sc.head = head;
+    sc.freeCount += count;
+}
+
+/// MemoryPool private functions below ///////////////////////////////////////
+
+void MemoryPool::carve(uint8_t sizeClass, uint32_t blocks)
+{
+    SizeClass& sc = m_classes[sizeClass];
+    uint32_t blockSize = BLOCK_SIZES[sizeClass];
+    unsigned char* slab = static_cast<unsigned char*>(malloc((size_t)blockSize * blocks));
+    if(!slab) { Logger::getInstance().Log(Logs::FATAL, Logs::Core, "MemoryPool::carve()", "malloc() of [{}] blocks of [{}] bytes failed!", blocks, blockSize); return; }
+    sc.slabs.push_back(slab);
+
+    // thread blocks onto the free list, back to front so they are handed out in address order
+    for(uint32_t i = blocks; i > 0; i--)
+    {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + ((size_t)(i-1) * blockSize));
+        block->next = sc.head;
+        sc.head = block;
+    }
+    sc.freeCount += blocks;
+    sc.reserved.fetch_add(blocks, std::memory_order_relaxed);
+}
+
+void MemoryPool::publishCounters(uint8_t sizeClass, uint64_t hits, int64_t inUseDelta)
+{
+    SizeClass& sc = m_classes[sizeClass];
+    if(hits > 0) { sc.hits.fetch_add(hits, std::memory_order_relaxed); }
+    if(inUseDelta == 0) { return; }
+    int64_t now = sc.inUse.fetch_add(inUseDelta, std::memory_order_relaxed) + inUseDelta;
+    int64_t prev = sc.highWater.load(std::memory_order_relaxed);
+    while(now > prev && !sc.highWater.compare_exchange_weak(prev, now, std::memory_order_relaxed)) {}
+}
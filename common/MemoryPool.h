@@ -0,0 +1,118 @@
+#ifndef MEMORYPOOL_H
+#define MEMORYPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    Size classes (usable bytes = class size - POOL_HEADER_SIZE):
+        Small   64B     small builtin payloads, identifiers
+        Medium  256B    Packet / Datagram / UnixPacket objects
+        Packet  1KB     PACKET_MAX_SIZE buffers
+        Large   64KB    UNIX_PACKET_MAX_SIZE buffers and reassembled payloads
+    Anything bigger is passed through to malloc() and counted as oversize.
+
+    Ref:
+        https://en.wikipedia.org/wiki/Slab_allocation
+        http://www.boost.org/doc/libs/1_66_0/libs/pool/doc/html/boost_pool/pool/pooling.html
+*/
+
+#define POOL_HEADER_SIZE 16
+
+namespace PoolClass { enum FORMS { Small, Medium, Packet, Large, END }; }
+
+/**
+ * @file MemoryPool.h
+ * @brief plain snapshot of a single size class' counters
+ */
+struct PoolStats
+{
+    uint32_t blockSize = 0; /**< bytes per block, header included */
+    uint64_t hits = 0; /**< served from a free list */
+    uint64_t misses = 0; /**< required carving a fresh block */
+    uint64_t inUse = 0; /**< blocks currently handed out (lags by up to a thread cache's worth) */
+    uint64_t highWater = 0; /**< most blocks handed out at once, as last published */
+    uint64_t reserved = 0; /**< blocks carved in total (in use + free) */
+};
+
+/**
+ * @file MemoryPool.h
+ * @brief MemoryPool hands out fixed size blocks from a handful of size classes. Each thread
+ *        keeps a small cache per class and trades blocks with the shared free lists in batches,
+ *        so steady state acquire()/release() never touch a mutex or the system allocator.
+ */
+class MemoryPool
+{
+    public:
+        static MemoryPool& getInstance()
+        {
+            static MemoryPool instance;
+            return instance;
+        }
+
+        MemoryPool(MemoryPool const&) = delete;
+        void operator=(MemoryPool const&) = delete;
+
+        void* acquire(size_t size);
+        void release(void* ptr);
+        void reserve(uint8_t sizeClass, uint32_t blocks); // pre-carve blocks, e.g. sized for expected connection count
+        void logStats() const;
+        PoolStats getStats(uint8_t sizeClass) const; // counters are published per thread in batches, so they may lag slightly
+        const uint64_t getOversizeCount() const { return m_oversize.load(std::memory_order_relaxed); }
+        static const uint32_t getBlockSize(uint8_t sizeClass) { return (sizeClass < PoolClass::END) ? BLOCK_SIZES[sizeClass] : 0; }
+
+        // used by the per-thread caches
+        struct FreeBlock { FreeBlock* next; };
+        FreeBlock* takeBatch(uint8_t sizeClass, uint32_t maxBlocks, uint32_t& taken, bool& carved);
+        void giveBatch(uint8_t sizeClass, FreeBlock* head, FreeBlock* tail, uint32_t count);
+        void publishCounters(uint8_t sizeClass, uint64_t hits, int64_t inUseDelta);
+
+        static const uint32_t BLOCK_SIZES[PoolClass::END];
+        static const uint32_t CACHE_LIMITS[PoolClass::END]; // blocks kept per thread, per class
+
+    private:
+        MemoryPool() {}
+        ~MemoryPool() {} // slabs live for the life of the process
+        void carve(uint8_t sizeClass, uint32_t blocks); // expects class lock held
+
+        struct alignas(64) SizeClass
+        {
+            std::mutex lock;
+            FreeBlock* head = nullptr;
+            uint64_t freeCount = 0;
+            std::vector<unsigned char*> slabs;
+            std::atomic<uint64_t> hits { 0 };
+            std::atomic<uint64_t> misses { 0 };
+            std::atomic<int64_t> inUse { 0 };
+            std::atomic<int64_t> highWater { 0 };
+            std::atomic<uint64_t> reserved { 0 };
+        };
+
+        SizeClass m_classes[PoolClass::END];
+        std::atomic<uint64_t> m_oversize { 0 };
+};
+
+/**
+ * mixin routing a class' operator new/delete through MemoryPool
+ */
+struct PoolAllocated
+{
+    static void* operator new(size_t size) { return MemoryPool::getInstance().acquire(size); }
+    static void operator delete(void* ptr) { MemoryPool::getInstance().release(ptr); }
+};
+
+/**
+ * Acquire a buffer of 'size' bytes from MemoryPool (release with poolRelease, never delete[])
+ */
+inline unsigned char* poolBuffer(size_t size) { return static_cast<unsigned char*>(MemoryPool::getInstance().acquire(size)); }
+
+/**
+ * Return a MemoryPool buffer after 'safely' checking existence
+ */
+template <typename T>
+void poolRelease(T*& ptr) { if(ptr && ptr != nullptr) { MemoryPool::getInstance().release((void*)ptr); ptr = nullptr; } }
+
+#endif // MEMORYPOOL_H
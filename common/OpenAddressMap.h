@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <functional> // std::hash
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    Flat hash map: every entry lives in one contiguous slot array, collisions probe linearly to
+    the next slot and erase() shifts the following run back instead of leaving tombstones, so
+    lookups never walk past deleted entries. Each slot keeps its full hash, which makes probing
+    mostly integer compares and lets the table grow without rehashing keys.
+
+    Ref:
+        https://en.wikipedia.org/wiki/Linear_probing
+        http://codecapsule.com/2013/11/17/robin-hood-hashing-backward-shift-deletion/
+*/
+
+#define OPEN_MAP_MIN_CAPACITY 16
+#define OPEN_MAP_LOAD_PERCENT 70 // grow beyond this load factor
+
+/**
+ * @file OpenAddressMap.h
+ * @brief OpenAddressMap is a std::unordered_map style container for small, cheaply copied keys
+ *        and values. Not thread-safe, except size() which may be read from any thread. Iterators
+ *        and pointers are invalidated by insert() and erase().
+ */
+template <class Key, class T, class Hash = std::hash<Key> >
+class OpenAddressMap
+{
+    public:
+        struct Entry
+        {
+            Key first;
+            T second;
+        };
+
+    private:
+        struct Slot
+        {
+            Entry entry;
+            size_t hash = 0;
+            bool used = false;
+        };
+
+    public:
+        class iterator
+        {
+            friend class OpenAddressMap;
+
+            public:
+                iterator(std::vector<Slot>* slots, size_t idx) : m_slots(slots), m_idx(idx) { skip(); }
+                Entry& operator*() const { return (*m_slots)[m_idx].entry; }
+                Entry* operator->() const { return &(*m_slots)[m_idx].entry; }
+                iterator& operator++() { m_idx++; skip(); return *this; }
+                bool operator==(const iterator& it) const { return (m_idx == it.m_idx); }
+                bool operator!=(const iterator& it) const { return (m_idx != it.m_idx); }
+
+            private:
+                void skip() { while(m_idx < m_slots->size() && !(*m_slots)[m_idx].used) { m_idx++; } }
+                std::vector<Slot>* m_slots = nullptr;
+                size_t m_idx = 0;
+        };
+
+        OpenAddressMap(size_t capacity = OPEN_MAP_MIN_CAPACITY) { m_slots.resize(roundCapacity(capacity)); m_mask = m_slots.size() - 1; }
+        OpenAddressMap(const OpenAddressMap& m) = delete;
+        OpenAddressMap& operator=(const OpenAddressMap& m) = delete;
+
+        iterator begin() { return iterator(&m_slots, 0); }
+        iterator end() { return iterator(&m_slots, m_slots.size()); }
+
+        iterator find(const Key& key)
+        {
+            size_t hash = m_hasher(key);
+            for(size_t i = hash & m_mask; m_slots[i].used; i = (i + 1) & m_mask)
+            {
+                if(m_slots[i].hash == hash && m_slots[i].entry.first == key) { return iterator(&m_slots, i); }
+            }
+            return end();
+        }
+
+        /// returns false (leaving the existing value alone) if key is already present
+        bool insert(const Key& key, const T& value)
+        {
+            if((size() + 1) * 100 > m_slots.size() * OPEN_MAP_LOAD_PERCENT) { rehash(m_slots.size() * 2); }
+
+            size_t hash = m_hasher(key);
+            size_t i = hash & m_mask;
+            for(; m_slots[i].used; i = (i + 1) & m_mask)
+            {
+                if(m_slots[i].hash == hash && m_slots[i].entry.first == key) { return false; }
+            }
+
+            m_slots[i].entry.first = key;
+            m_slots[i].entry.second = value;
+            m_slots[i].hash = hash;
+            m_slots[i].used = true;
+            m_size.store(size() + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        bool erase(const Key& key)
+        {
+            iterator it = find(key);
+            if(it == end()) { return false; }
+            erase(it);
+            return true;
+        }
+
+        /// pull the rest of the probe run back over the hole, so no tombstone is needed
+        void erase(iterator it)
+        {
+            size_t hole = it.m_idx;
+            size_t i = hole;
+            while(true)
+            {
+                i = (i + 1) & m_mask;
+                if(!m_slots[i].used) { break; }
+
+                // leave entries whose home slot lies between the hole and themselves
+                size_t home = m_slots[i].hash & m_mask;
+                bool stays = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+                if(stays) { continue; }
+
+                m_slots[hole] = m_slots[i];
+                hole = i;
+            }
+
+            m_slots[hole] = Slot();
+            m_size.store(size() - 1, std::memory_order_relaxed);
+        }
+
+        void clear()
+        {
+            for(size_t i = 0; i < m_slots.size(); i++) { m_slots[i] = Slot(); }
+            m_size.store(0, std::memory_order_relaxed);
+        }
+
+        /// make room for 'count' entries without growing
+        void reserve(size_t count) { size_t wanted = roundCapacity((count * 100) / OPEN_MAP_LOAD_PERCENT + 1); if(wanted > m_slots.size()) { rehash(wanted); } }
+
+        size_t size() const { return m_size.load(std::memory_order_relaxed); }
+        bool empty() const { return (size() == 0); }
+        size_t capacity() const { return m_slots.size(); }
+
+    private:
+        static size_t roundCapacity(size_t capacity)
+        {
+            size_t cap = OPEN_MAP_MIN_CAPACITY;
+            while(cap < capacity) { cap <<= 1; }
+            return cap;
+        }
+
+        void rehash(size_t capacity)
+        {
+            std::vector<Slot> old;
+            old.swap(m_slots);
+            m_slots.resize(roundCapacity(capacity));
+            m_mask = m_slots.size() - 1;
+
+            for(size_t o = 0; o < old.size(); o++)
+            {
+                if(!old[o].used) { continue; }
+                size_t i = old[o].hash & m_mask;
+                while(m_slots[i].used) { i = (i + 1) & m_mask; }
+                m_slots[i] = old[o];
+            }
+        }
+
+        std::vector<Slot> m_slots;
+        size_t m_mask = 0;
+        std::atomic<size_t> m_size { 0 };
+        Hash m_hasher;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+/*
+    Bounded single producer, single consumer ring. Capacity is rounded up to a power of two.
+    Head and tail live on their own cache lines and each side keeps a cached copy of the
+    other's index, so a push or pop only touches shared state when the cache runs out.
+
+    Ref:
+        https://www.1024cores.net/home/lock-free-algorithms/queues
+        https://rigtorp.se/ringbuffer/
+*/
+
+#define RING_CACHE_LINE 64
+
+/**
+ * @file SPSCRing.h
+ * @brief SPSCRing is a lock-free hand-off between exactly one producer thread and one consumer
+ *        thread. T must be default constructible and movable. push() fails rather than blocks when full.
+ */
+template <typename T>
+class SPSCRing
+{
+    public:
+        SPSCRing(size_t capacity)
+        {
+            size_t cap = 2;
+            while(cap < capacity) { cap <<= 1; }
+            m_mask = cap - 1;
+            m_items.resize(cap);
+        }
+        SPSCRing(const SPSCRing& r) = delete;
+        SPSCRing& operator=(const SPSCRing& r) = delete;
+
+        /// producer only
+        bool push(const T& item)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if(tail - m_headCache > m_mask)
+            {
+                m_headCache = m_head.load(std::memory_order_acquire);
+                if(tail - m_headCache > m_mask) { return false; } // full
+            }
+            m_items[tail & m_mask] = item;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// producer only, moves as many of 'items' as fit, returns count pushed
+        size_t pushBatch(T* items, size_t count)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t space = (m_mask + 1) - (tail - m_headCache);
+            if(space < count)
+            {
+                m_headCache = m_head.load(std::memory_order_acquire);
+                space = (m_mask + 1) - (tail - m_headCache);
+            }
+            if(count > space) { count = space; }
+
+            for(size_t i = 0; i < count; i++) { m_items[(tail + i) & m_mask] = std::move(items[i]); }
+            if(count > 0) { m_tail.store(tail + count, std::memory_order_release); }
+            return count;
+        }
+
+        /// consumer only
+        bool pop(T& out)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if(head == m_tailCache)
+            {
+                m_tailCache = m_tail.load(std::memory_order_acquire);
+                if(head == m_tailCache) { return false; } // empty
+            }
+            out = std::move(m_items[head & m_mask]);
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// consumer only, moves up to 'max' items into 'out', returns count popped
+        size_t popBatch(T* out, size_t max)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            size_t available = m_tailCache - head;
+            if(available < max)
+            {
+                m_tailCache = m_tail.load(std::memory_order_acquire);
+                available = m_tailCache - head;
+            }
+            if(max > available) { max = available; }
+
+            for(size_t i = 0; i < max; i++) { out[i] = std::move(m_items[(head + i) & m_mask]); }
+            if(max > 0) { m_head.store(head + max, std::memory_order_release); }
+            return max;
+        }
+
+        /// approximate unless called from the producer or consumer thread
+        size_t size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+        bool empty() const { return (size() == 0); }
+        size_t capacity() const { return m_mask + 1; }
+
+    private:
+        std::vector<T> m_items;
+        size_t m_mask = 0;
+        char m_pad0[RING_CACHE_LINE];
+        std::atomic<size_t> m_head { 0 }; // next slot to pop, written by consumer
+        size_t m_tailCache = 0; // consumer's view of m_tail
+        char m_pad1[RING_CACHE_LINE];
+        std::atomic<size_t> m_tail { 0 }; // next slot to push, written by producer
+        size_t m_headCache = 0; // producer's view of m_head
+        char m_pad2[RING_CACHE_LINE];
+};
@@ -93,6 +93,28 @@ class SafeUnorderedMap
             return m_uomap.find(keyVal);
         }
 
+        /// copies the value out while locked, the only lookup that is safe against a concurrent erase()
+        bool get(const Key& keyVal, T& out) const
+        {
+            std::unique_lock<std::mutex> ulock(m_mutex);
+            const_iterator it = m_uomap.find(keyVal);
+            if(it == m_uomap.end()) { return false; }
+            out = it->second;
+            return true;
+        }
+
+        /// true if pred(key, value) holds for any entry, the map stays locked throughout
+        template <class Test>
+        bool any(Test pred) const
+        {
+            std::unique_lock<std::mutex> ulock(m_mutex);
+            for(const_iterator it = m_uomap.begin(); it != m_uomap.end(); ++it)
+            {
+                if(pred(it->first, it->second)) { return true; }
+            }
+            return false;
+        }
+
         bool empty() const
         {
             std::unique_lock<std::mutex> ulock(m_mutex);
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    Hierarchical timing wheel: TIMER_WHEEL_LEVELS wheels of TIMER_WHEEL_SLOTS slots, each level
+    covering SLOTS times the range of the one below. Level 0 slots are single ticks, so a timer
+    lands in the slot of its deadline tick; further out timers sit in coarser slots and are
+    cascaded down as the wheel turns. schedule(), cancel() and firing are O(1), advancing is
+    O(ticks elapsed + timers due), no matter how many timers are pending.
+
+    Ref:
+        http://www.cs.columbia.edu/~nahum/w6998/papers/sosp87-timing-wheels.pdf
+        https://lwn.net/Articles/646950/
+*/
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4 // at 10ms ticks: 640ms, 41s, 44m, 46h
+#define TIMER_WHEEL_LISTS (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS + 1) // + the expired list
+#define TIMER_WHEEL_NIL 0xFFFFFFFF
+
+/// identifies a scheduled timer, 0 is never handed out
+typedef uint64_t TimerID;
+
+/**
+ * @file TimerWheel.h
+ * @brief TimerWheel holds deadlines (MS timestamps) carrying a payload of type T. advance() moves
+ *        everything due onto an expired list that is drained with popExpired(), timers may still
+ *        be cancelled until they are popped. Not thread-safe, T must be default constructible.
+ */
+template <typename T>
+class TimerWheel
+{
+    public:
+        TimerWheel(uint32_t tickMS, uint64_t startMS = 0) : m_tickMS((tickMS > 0) ? tickMS : 1)
+        {
+            m_currentTick = startMS / m_tickMS;
+            for(uint32_t i = 0; i < TIMER_WHEEL_LISTS; i++) { m_heads[i] = TIMER_WHEEL_NIL; m_tails[i] = TIMER_WHEEL_NIL; }
+            for(uint32_t l = 0; l < TIMER_WHEEL_LEVELS; l++) { m_occupied[l] = 0; }
+        }
+        TimerWheel(const TimerWheel& tw) = delete;
+        TimerWheel& operator=(const TimerWheel& tw) = delete;
+
+        /// deadlines are rounded up to the next tick, so a timer never fires early
+        TimerID schedule(uint64_t deadlineMS, const T& payload)
+        {
+            uint32_t idx = allocNode();
+            Node& n = m_nodes[idx];
+            n.payload = payload;
+            n.deadlineTick = (deadlineMS + m_tickMS - 1) / m_tickMS;
+            place(idx);
+            return ((uint64_t)n.generation << 32) | idx;
+        }
+
+        /// returns false if the timer already fired (or was popped), zeroes 'id' either way
+        bool cancel(TimerID& id)
+        {
+            uint32_t idx = (uint32_t)(id & 0xFFFFFFFF);
+            uint32_t generation = (uint32_t)(id >> 32);
+            id = 0;
+            if(idx >= m_nodes.size() || m_nodes[idx].generation != generation || m_nodes[idx].list == TIMER_WHEEL_NIL) { return false; }
+            unlink(idx);
+            freeNode(idx);
+            return true;
+        }
+
+        /// turn the wheel up to 'nowMS', returns the number of timers waiting in the expired list
+        size_t advance(uint64_t nowMS)
+        {
+            uint64_t target = nowMS / m_tickMS;
+            if(m_pending == 0) { if(target >= m_currentTick) { m_currentTick = target + 1; } return m_expired; }
+
+            while(m_currentTick <= target)
+            {
+                uint32_t index = (uint32_t)(m_currentTick & TIMER_WHEEL_MASK);
+
+                // level 0 wrapped, pull the next slot of each coarser level down
+                if(index == 0)
+                {
+                    for(uint32_t l = 1; l < TIMER_WHEEL_LEVELS; l++)
+                    {
+                        uint32_t slot = (uint32_t)((m_currentTick >> (TIMER_WHEEL_BITS * l)) & TIMER_WHEEL_MASK);
+                        cascade(l, slot);
+                        if(slot != 0) { break; }
+                    }
+                }
+
+                // everything in this tick's slot is due
+                uint32_t list = index;
+                while(m_heads[list] != TIMER_WHEEL_NIL)
+                {
+                    uint32_t idx = m_heads[list];
+                    unlink(idx);
+                    link(idx, TIMER_WHEEL_LISTS - 1);
+                }
+                m_currentTick++;
+
+                if(m_pending == 0) { if(target >= m_currentTick) { m_currentTick = target + 1; } break; }
+            }
+            return m_expired;
+        }
+
+        /// hand over the next due payload, false once the expired list is empty
+        bool popExpired(T& out)
+        {
+            uint32_t idx = m_heads[TIMER_WHEEL_LISTS - 1];
+            if(idx == TIMER_WHEEL_NIL) { return false; }
+            unlink(idx);
+            out = m_nodes[idx].payload;
+            freeNode(idx);
+            return true;
+        }
+
+        /// MS until advance() may have work to do: exact within the level 0 range, otherwise the next cascade
+        uint64_t msUntilNext(uint64_t nowMS) const
+        {
+            if(m_expired > 0) { return 0; }
+            if(m_pending == 0) { return UINT64_MAX; }
+
+            uint32_t index = (uint32_t)(m_currentTick & TIMER_WHEEL_MASK);
+            uint64_t ahead = m_occupied[0] >> index;
+            uint64_t ticks = (ahead != 0) ? (uint64_t)__builtin_ctzll(ahead) : (uint64_t)(TIMER_WHEEL_SLOTS - index);
+            if(index == 0) { ticks = 0; } // the next tick cascades the coarser levels
+            uint64_t dueMS = (m_currentTick + ticks) * m_tickMS;
+            return (dueMS > nowMS) ? (dueMS - nowMS) : 0;
+        }
+
+        const size_t size() const { return m_pending + m_expired; }
+        const bool empty() const { return (size() == 0); }
+        const uint32_t& getTickMS() const { return m_tickMS; }
+
+    private:
+        struct Node
+        {
+            T payload;
+            uint64_t deadlineTick = 0;
+            uint32_t generation = 1;
+            uint32_t prev = TIMER_WHEEL_NIL;
+            uint32_t next = TIMER_WHEEL_NIL;
+            uint32_t list = TIMER_WHEEL_NIL; // NIL when free
+        };
+
+        uint32_t allocNode()
+        {
+            if(m_freeHead == TIMER_WHEEL_NIL) { m_nodes.push_back(Node()); return (uint32_t)(m_nodes.size() - 1); }
+            uint32_t idx = m_freeHead;
+            m_freeHead = m_nodes[idx].next;
+            m_nodes[idx].next = TIMER_WHEEL_NIL;
+            return idx;
+        }
+
+        void freeNode(uint32_t idx)
+        {
+            Node& n = m_nodes[idx];
+            n.payload = T();
+            n.generation = (n.generation == 0xFFFFFFFF) ? 1 : n.generation + 1; // stale ids stop matching
+            n.next = m_freeHead;
+            m_freeHead = idx;
+        }
+
+        // pick the list for a node based on how far away its deadline is
+        void place(uint32_t idx)
+        {
+            uint64_t deadline = m_nodes[idx].deadlineTick;
+            if(deadline < m_currentTick) { link(idx, TIMER_WHEEL_LISTS - 1); return; }
+
+            uint64_t delta = deadline - m_currentTick;
+            uint32_t level = 0;
+            while(level < TIMER_WHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1)))) { level++; }
+
+            // beyond the top level, park it in the furthest slot and let it cascade again
+            uint64_t range = (uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+            if(delta >= range) { deadline = m_currentTick + range - 1; }
+
+            uint32_t slot = (uint32_t)((deadline >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+            link(idx, (level * TIMER_WHEEL_SLOTS) + slot);
+        }
+
+        void cascade(uint32_t level, uint32_t slot)
+        {
+            uint32_t list = (level * TIMER_WHEEL_SLOTS) + slot;
+            uint32_t idx = m_heads[list];
+            m_heads[list] = TIMER_WHEEL_NIL;
+            m_tails[list] = TIMER_WHEEL_NIL;
+            m_occupied[level] &= ~((uint64_t)1 << slot);
+
+            while(idx != TIMER_WHEEL_NIL)
+            {
+                uint32_t next = m_nodes[idx].next;
+                m_nodes[idx].list = TIMER_WHEEL_NIL;
+                m_pending--;
+                place(idx);
+                idx = next;
+            }
+        }
+
+        void link(uint32_t idx, uint32_t list)
+        {
+            Node& n = m_nodes[idx];
+            n.list = list;
+            n.next = TIMER_WHEEL_NIL;
+            n.prev = m_tails[list];
+            if(m_tails[list] != TIMER_WHEEL_NIL) { m_nodes[m_tails[list]].next = idx; }
+            else { m_heads[list] = idx; }
+            m_tails[list] = idx;
+
+            if(list == TIMER_WHEEL_LISTS - 1) { m_expired++; }
+            else { m_occupied[list / TIMER_WHEEL_SLOTS] |= ((uint64_t)1 << (list % TIMER_WHEEL_SLOTS)); m_pending++; }
+        }
+
+        void unlink(uint32_t idx)
+        {
+            Node& n = m_nodes[idx];
+            uint32_t list = n.list;
+            if(n.prev != TIMER_WHEEL_NIL) { m_nodes[n.prev].next = n.next; }
+            else { m_heads[list] = n.next; }
+            if(n.next != TIMER_WHEEL_NIL) { m_nodes[n.next].prev = n.prev; }
+            else { m_tails[list] = n.prev; }
+            n.prev = TIMER_WHEEL_NIL;
+            n.next = TIMER_WHEEL_NIL;
+            n.list = TIMER_WHEEL_NIL;
+
+            if(list == TIMER_WHEEL_LISTS - 1) { m_expired--; }
+            else
+            {
+                if(m_heads[list] == TIMER_WHEEL_NIL) { m_occupied[list / TIMER_WHEEL_SLOTS] &= ~((uint64_t)1 << (list % TIMER_WHEEL_SLOTS)); }
+                m_pending--;
+            }
+        }
+
+        uint32_t m_tickMS = 1;
+        uint64_t m_currentTick = 0; // next tick advance() will process
+        size_t m_pending = 0; // timers in the wheel
+        size_t m_expired = 0; // timers waiting in the expired list
+        uint32_t m_freeHead = TIMER_WHEEL_NIL;
+        uint32_t m_heads[TIMER_WHEEL_LISTS];
+        uint32_t m_tails[TIMER_WHEEL_LISTS];
+        uint64_t m_occupied[TIMER_WHEEL_LEVELS]; // bit per non-empty slot
+        std::vector<Node> m_nodes;
+};
@@ -20,6 +20,11 @@ static const uint16_t OP_RetransmissionRequest = 0x0B;
 static const uint16_t OP_RetransmissionReply = 0x0C;
 static const uint16_t OP_RetransmissionAck = 0x0D;
 static const uint16_t OP_RetransmissionImpossible = 0x0E;
+static const uint16_t OP_SelectiveAck = 0x0F;                // received-fragment bitmap, holes are resent in one burst
+static const uint16_t OP_TimestampEcho = 0x10;               // answers a timestamped OP_KeepAlive, for RTT samples
+static const uint16_t OP_Coalesced = 0x11;                   // several small messages for one destination in a single datagram
+static const uint16_t OP_WindowUpdate = 0x12;                // receiver's free Datagram queue space, see ReceiveWindow
+static const uint16_t OP_ConnectionHandoff = 0x13;           // NetworkIPC only, a client's connected socket moving to a child process (SCM_RIGHTS)
 
 static const uint16_t OP_IPCData = 0x30;                     // 48 - Sharing data between IPC peers
 
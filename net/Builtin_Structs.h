@@ -30,6 +30,55 @@ struct RetryRequest_Struct
     }
 };
 
+#define SACK_HEADER_SIZE 8 // base + count
+#define SACK_BITMAP_SIZE 948 // PACKET_DATA_SIZE - SACK_HEADER_SIZE, one SACK always fits a single packet
+#define SACK_MAX_FRAGMENTS (SACK_BITMAP_SIZE * 8)
+
+/// fragments [base, base+count) of a sequence, bit set = arrived (or already asked for), everything before base likewise
+struct SelectiveAck_Struct
+{
+    uint32_t base = 0;
+    uint32_t count = 0;
+    unsigned char bitmap[SACK_BITMAP_SIZE] = {0};
+
+    const bool has(uint32_t i) const { return (i < count) && (bitmap[i >> 3] & (1 << (i & 7))); }
+    void set(uint32_t i) { if(i < SACK_MAX_FRAGMENTS) { bitmap[i >> 3] |= (1 << (i & 7)); } }
+    const uint16_t wireSize() const { return SACK_HEADER_SIZE + ((count + 7) / 8); } // only the used part of the bitmap is sent
+};
+
+/// OP_KeepAlive payload, echoed back unchanged in OP_TimestampEcho with holdUS filled in by the peer
+struct TimestampEcho_Struct
+{
+    uint64_t sentUS = 0; // prober's Time::steadyUS(), only ever compared against the prober's own clock
+    uint32_t holdUS = 0; // time the echo spent at the peer between arrival and reply
+};
+
+/// OP_Coalesced payload is a run of entries, each a single packet message minus what it shares with the datagram
+/// (identifier, version, timestamp) or can be derived (pktTotal 1, totalLength = dataLength):
+///     op_code 2 | seqIdent 4 | pktNum 4 | totalCRC 4 | dataLength 2 | delivery 1 | channelSeq 4 | data[dataLength]
+#define COALESCED_ENTRY_HEADER 21
+
+/// leads every SnapshotChannel payload, baseline 0 = full state follows
+struct SnapshotHeader_Struct
+{
+    uint32_t id = 0;
+    uint32_t baseline = 0;
+};
+
+/// OP_Ack payload acknowledging a snapshot, a plain OP_Ack (sequence completed) carries no data
+struct SnapshotAck_Struct
+{
+    uint32_t snapshotID = 0;
+    uint16_t opCode = 0; // channel
+    uint16_t reserved = 0;
+};
+
+/// OP_WindowUpdate payload, sent when the receiver's window closes, reopens or halves/doubles
+struct ReceiveWindow_Struct
+{
+    uint32_t windowBytes = 0; // clamped, 0 = stop sending (but probe)
+};
+
 /*struct NewConnection_Struct
 {
     NetConnection* netCon = nullptr;
@@ -37,4 +86,16 @@ struct RetryRequest_Struct
 
 };*/
 
+/// OP_ConnectionHandoff payload (NetworkIPC), the client's connected socket travels alongside it as SCM_RIGHTS
+struct ConnectionHandoff_Struct
+{
+    char identifier[8] = {0}; // handing server's m_identifier, null terminated
+    uint32_t clientID = 0; // client's uniqID
+    uint32_t serverID = 0; // handing server's uniqueID, the client already knows it
+    uint32_t nextSeqID = 0; // handing server's m_seqID, the client has seen the IDs below it
+    uint32_t nextOrdered = 1; // receive side, Connection's reliable-ordered position
+    uint32_t lastSequenced = 0; // receive side, Connection's newest unreliable-sequenced
+    uint32_t channelLast[4] = {0}; // send side, ChannelSequences::last per DeliveryMode
+};
+
 #endif // BUILTIN_STRUCTS_INCLUDED
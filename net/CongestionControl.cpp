@@ -0,0 +1,135 @@
+#include "net/CongestionControl.h"
+#include <algorithm> // min, max
+
+namespace CGameEngine
+{
+    /// CongestionControl /////////////////////////////////////////////////////
+
+    void CongestionControl::onAck(uint32_t packets)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.packetsAcked += packets;
+
+        // an app-limited sender never tested the larger window, leave it alone
+        if(!m_isLimited) { return; }
+        m_isLimited = false;
+
+        if(m_cwnd < m_ssthresh) { m_cwnd += packets; } // slow start, doubles per window
+        else { m_cwnd += (double)packets / m_cwnd; } // congestion avoidance, +1 per window
+        m_cwnd = std::min(m_cwnd, CC_MAX_CWND);
+    }
+
+    void CongestionControl::onLoss(uint32_t packets, const uint64_t& nowUS)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.packetsLost += packets;
+
+        // holes reported within one RTT of the last cut belong to the same loss event
+        uint64_t srtt = (m_srttUS > 0) ? m_srttUS : CC_INITIAL_RTT_US;
+        if(m_lastDecreaseUS != 0 && nowUS - m_lastDecreaseUS < srtt) { return; }
+
+        m_ssthresh = std::max(m_cwnd * 0.5, CC_MIN_CWND);
+        m_cwnd = m_ssthresh;
+        m_lastDecreaseUS = nowUS;
+        m_stats.lossEvents++;
+    }
+
+    void CongestionControl::onRTTSample(const uint64_t& rttUS)
+    {
+        if(rttUS == 0) { return; }
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // RFC 6298 smoothing
+        if(m_srttUS == 0) { m_srttUS = rttUS; m_rttVarUS = rttUS / 2; }
+        else
+        {
+            uint64_t diff = (m_srttUS > rttUS) ? (m_srttUS - rttUS) : (rttUS - m_srttUS);
+            m_rttVarUS = (3 * m_rttVarUS + diff) / 4;
+            m_srttUS = (7 * m_srttUS + rttUS) / 8;
+        }
+        if(m_minRttUS == 0 || rttUS < m_minRttUS) { m_minRttUS = rttUS; }
+    }
+
+    void CongestionControl::onPeerWindow(uint64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.windowUpdates++;
+        if(bytes == 0 && m_peerWindow != 0) { m_nextProbeUS = 0; } // the first probe waits a full interval from the next send attempt
+        m_peerWindow = bytes;
+    }
+
+    bool CongestionControl::tryConsume(uint32_t bytes, const uint64_t& nowUS)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // peer can't take anything, but the update reopening it may have been lost
+        if(m_peerWindow == 0)
+        {
+            if(m_nextProbeUS == 0) { m_nextProbeUS = nowUS + CC_WINDOW_PROBE_US; }
+            if(nowUS < m_nextProbeUS) { return false; }
+            m_nextProbeUS = nowUS + CC_WINDOW_PROBE_US;
+            m_stats.windowProbes++;
+            m_stats.packetsSent++;
+            m_stats.bytesSent += bytes;
+            return true;
+        }
+
+        refill(nowUS);
+        if(m_tokens < bytes)
+        {
+            if(!m_isLimited) { m_stats.packetsPaced++; }
+            m_isLimited = true;
+            return false;
+        }
+
+        m_tokens -= bytes;
+        m_stats.packetsSent++;
+        m_stats.bytesSent += bytes;
+        return true;
+    }
+
+    uint64_t CongestionControl::usUntilSend(uint32_t bytes, const uint64_t& nowUS)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_peerWindow == 0) { return (m_nextProbeUS > nowUS) ? m_nextProbeUS - nowUS : 0; }
+        refill(nowUS);
+        if(m_tokens >= bytes) { return 0; }
+        return (uint64_t)(((bytes - m_tokens) * 1000000.0) / pacingRate()) + 1;
+    }
+
+    CongestionStats CongestionControl::snapshot() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        CongestionStats retVal = m_stats;
+        retVal.cwnd = m_cwnd;
+        retVal.ssthresh = m_ssthresh;
+        retVal.pacingRate = (uint64_t)pacingRate();
+        retVal.srttUS = m_srttUS;
+        retVal.minRttUS = m_minRttUS;
+        retVal.peerWindow = m_peerWindow;
+        return retVal;
+    }
+
+    /// CongestionControl private functions ///////////////////////////////////
+
+    double CongestionControl::pacingRate() const
+    {
+        uint64_t srtt = (m_srttUS > 0) ? m_srttUS : CC_INITIAL_RTT_US;
+        double gain = (m_cwnd < m_ssthresh) ? CC_SLOW_START_GAIN : CC_PACING_GAIN;
+        double rate = (gain * m_cwnd * CC_MSS * 1000000.0) / srtt;
+
+        // no more than the peer's free space per RTT, but never so slow a full packet can't get through
+        if(m_peerWindow != CC_WINDOW_OPEN) { rate = std::min(rate, std::max((double)m_peerWindow, (double)CC_MSS) * 1000000.0 / srtt); }
+        return rate;
+    }
+
+    void CongestionControl::refill(const uint64_t& nowUS)
+    {
+        if(m_lastRefillUS == 0 || nowUS <= m_lastRefillUS) { m_lastRefillUS = std::max(m_lastRefillUS, nowUS); return; }
+
+        double rate = pacingRate();
+        double depth = std::max((double)(CC_BURST_PACKETS * CC_MSS), (rate * CC_BURST_US) / 1000000.0);
+        m_tokens = std::min(depth, m_tokens + (rate * (nowUS - m_lastRefillUS)) / 1000000.0);
+        m_lastRefillUS = nowUS;
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef CONGESTIONCONTROL_H_INCLUDED
+#define CONGESTIONCONTROL_H_INCLUDED
+
+#include "common/types.h"
+#include <mutex>
+
+/*
+    AIMD congestion window (in packets) turned into a pacing rate of gain * cwnd * MSS / srtt,
+    which a token bucket enforces in Network::sendLoop(). Fragments carry no per-packet ACK, so
+    the window does not gate packets in flight, it only sets the rate:
+        - a sequence's OP_Ack grows the window (slow start below ssthresh, +1 per window after)
+        - holes reported by OP_SelectiveAck / OP_RetransmissionRequest halve it, once per RTT
+        - the window only grows while pacing is actually holding packets back (not app-limited)
+    RTT comes from Connection's echoed timestamp samples (OP_KeepAlive / OP_TimestampEcho).
+    The peer's advertised receive window (OP_WindowUpdate) caps the rate at one window per RTT, a
+    closed window lets a single probe packet through every CC_WINDOW_PROBE_US.
+
+    Ref:
+        https://tools.ietf.org/html/rfc5681
+            TCP Congestion Control (slow start, congestion avoidance, AIMD)
+        https://tools.ietf.org/html/rfc7661
+            Updating TCP to Support Rate-Limited Traffic (no growth while app-limited)
+        https://tools.ietf.org/html/draft-cardwell-iccrg-bbr-congestion-control-00
+            BBR, pacing at a gain over the estimated rate
+*/
+
+#define CC_MSS 1000 // PACKET_MAX_SIZE, bytes a window packet stands for
+#define CC_INITIAL_CWND 10.0 // packets
+#define CC_MIN_CWND 2.0
+#define CC_MAX_CWND 20000.0
+#define CC_INITIAL_RTT_US 100000 // until the first sample
+#define CC_PACING_GAIN 1.25 // pace slightly above cwnd/srtt so the window can fill
+#define CC_SLOW_START_GAIN 2.0
+#define CC_BURST_PACKETS 4 // bucket depth, at least this many full packets
+#define CC_BURST_US 2000 // or this long at the pacing rate, whichever is larger
+#define CC_WINDOW_PROBE_US 200000 // closed peer window, one packet this often
+#define CC_WINDOW_OPEN UINT64_MAX // peer has not advertised a window
+
+namespace CGameEngine
+{
+    /// plain snapshot of a connection's congestion state, safe to hand out to other threads
+    struct CongestionStats
+    {
+        double cwnd = 0.0; // packets
+        double ssthresh = 0.0; // packets
+        uint64_t pacingRate = 0; // bytes per second
+        uint64_t srttUS = 0;
+        uint64_t minRttUS = 0;
+        uint64_t packetsSent = 0;
+        uint64_t bytesSent = 0;
+        uint64_t packetsAcked = 0;
+        uint64_t packetsLost = 0;
+        uint64_t lossEvents = 0; // window reductions
+        uint64_t packetsPaced = 0; // held back by the token bucket at least once
+        uint64_t peerWindow = 0; // bytes, CC_WINDOW_OPEN until the peer advertises one
+        uint64_t windowUpdates = 0;
+        uint64_t windowProbes = 0; // packets sent into a closed peer window
+        const float lossRate() const { return (packetsSent > 0) ? (float)packetsLost / (float)packetsSent : 0.0f; }
+    };
+
+    /// one per connection, fed by the listen/update threads and consumed by the send thread
+    class CongestionControl
+    {
+        public:
+            CongestionControl() {}
+            CongestionControl(const CongestionControl& cc) = delete;
+            CongestionControl& operator=(const CongestionControl& cc) = delete;
+
+            void onAck(uint32_t packets); // peer confirmed delivery of 'packets'
+            void onLoss(uint32_t packets, const uint64_t& nowUS); // peer reported 'packets' missing
+            void onRTTSample(const uint64_t& rttUS);
+            void onPeerWindow(uint64_t bytes); // OP_WindowUpdate
+            bool tryConsume(uint32_t bytes, const uint64_t& nowUS); // true if 'bytes' may be sent now
+            uint64_t usUntilSend(uint32_t bytes, const uint64_t& nowUS); // 0 if it could go now
+            void setClosed() { std::lock_guard<std::mutex> lock(m_mutex); m_isClosed = true; }
+            const bool isClosed() const { std::lock_guard<std::mutex> lock(m_mutex); return m_isClosed; }
+            CongestionStats snapshot() const;
+
+        private:
+            double pacingRate() const; // bytes per second, m_mutex held
+            void refill(const uint64_t& nowUS); // m_mutex held
+
+            mutable std::mutex m_mutex;
+            bool m_isClosed = false; // connection gone, anything still paced for it is dropped
+            bool m_isLimited = false; // pacing held a packet back since the last growth
+            double m_cwnd = CC_INITIAL_CWND;
+            double m_ssthresh = CC_MAX_CWND;
+            double m_tokens = CC_BURST_PACKETS * CC_MSS; // bytes
+            uint64_t m_lastRefillUS = 0;
+            uint64_t m_lastDecreaseUS = 0;
+            uint64_t m_srttUS = 0;
+            uint64_t m_rttVarUS = 0;
+            uint64_t m_minRttUS = 0;
+            uint64_t m_peerWindow = CC_WINDOW_OPEN;
+            uint64_t m_nextProbeUS = 0; // closed peer window only
+            CongestionStats m_stats; // counters only, the rest is filled in by snapshot()
+    };
+}
+
+#endif // CONGESTIONCONTROL_H_INCLUDED
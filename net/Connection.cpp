@@ -8,193 +8,191 @@ namespace CGameEngine
 {
     /// Connection ////////////////////////////////////////////////////////////
 
-    bool Connection::update(uint64_t timestamp)
+    /// handle one of this connection's timers, only the deadline that fired is looked at
+    bool Connection::onTimer(const NetTimer& t, const uint64_t& timestamp)
     {
-        // if retry timeout is 10+ seconds, the connection should be assumed lost
-        // same applies to last received packet
-        if(m_isClosing)
+        if(!m_buffer)
         {
-           Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::update()", "Received disconnect packet, m_isClosing is [{}].", m_isClosing);
-            simpleDatagram(OP_ConnectionDisconnect);
-            return true;
-        }
-        else if(m_retryTimeout > 10000)
-        {
-           Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::update()", "Lagging too hard and timed out, m_retryTimeout is [{}].", m_retryTimeout);
-            simpleDatagram(OP_ConnectionTimedOut);
-            return true;
-        }
-        else if(timestamp > m_lastArrival && (timestamp - m_lastArrival) > 15000)
-        {
-           Logger::getInstance().Log(Logs::INFO, Logs::Network, "Connection::update()", "Connection lost, lastArrival was [{}] seconds ago (limit is 15s).", (float)(timestamp - m_lastArrival));
-            simpleDatagram(OP_ConnectionLost);
-            return true;
-        }
-        else if(!m_buffer)
-        {
-           Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Connection::update()", "No Datagram buffer set!", m_isClosing);
-            simpleDatagram(OP_ConnectionDisconnect);
+           Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Connection::onTimer()", "No Datagram buffer set!");
             return true;
         }
 
-        // snapshotting packet queue size to prevent out of range errors
-        int queueSize = m_packets.size();
-
-        // iterate over packets in "my" queue
-        for(unsigned int i = 0; i < queueSize; i++)
+        switch(t.type)
         {
-            Packet* p = m_packets.front();
-            bool destroy = true;
-
-            // is packet damaged? If so, request new one
-            if(p->isDamaged())
+            case NetTimerType::ConnectionClose:
             {
-                RetryRequest_Struct* rr = new RetryRequest_Struct(p->seqIdent, p->pktNum, timestamp);
-                m_retryRequests.insert( std::make_pair(p->seqIdent, rr) );
-                rr = nullptr; // let Connection "own" it
+                m_closeTimer = 0;
+                if(!m_isClosing) { break; }
+               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::onTimer()", "Received disconnect packet, m_isClosing is [{}].", m_isClosing);
+                simpleDatagram(OP_ConnectionDisconnect);
+                return true;
             }
-            // check for existing sequence or existing expired sequence
-            else if(!doesExist(p->seqIdent))
+            case NetTimerType::ConnectionIdle:
             {
-                // build a sequence
-               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::update()", "Creating PacketSequence for seqID [{}], with [{}] packets", p->seqIdent, p->pktTotal);
-                m_sequences.insert(std::make_pair(p->seqIdent, PacketSequence(p->seqIdent, p->pktTotal, timestamp, this)));
-                m_sequences.at(p->seqIdent).addPacket(&p, timestamp);
+                // same applies to last received packet, pushed back rather than rescheduled on every arrival
+                m_idleTimer = 0;
+                if(timestamp > m_lastArrival && (timestamp - m_lastArrival) > NET_CONNECTION_IDLE_MS)
+                {
+                   Logger::getInstance().Log(Logs::INFO, Logs::Network, "Connection::onTimer()", "Connection lost, lastArrival was [{}] seconds ago (limit is 15s).", (float)(timestamp - m_lastArrival) / 1000.0f);
+                    simpleDatagram(OP_ConnectionLost);
+                    return true;
+                }
+                m_idleTimer = m_network->scheduleTimer(m_lastArrival + NET_CONNECTION_IDLE_MS + 1, NetTimer(NetTimerType::ConnectionIdle, 0, this));
+                break;
             }
-            else // sequence does exist, handle normally
+            case NetTimerType::SequenceDeadline:
             {
-                if(p->op_code == OP_RetransmissionImpossible)
+                // kill or request retransmission
+                std::map<uint32_t, PacketSequence>::iterator it = m_sequences.find(t.seqID);
+                if(it == m_sequences.end()) { break; }
+                it->second.getTimer() = 0;
+                if(it->second.update(timestamp))
                 {
-                   Logger::getInstance().Log(Logs::WARN, Logs::Network, "Connection::update()", "Retry Impossible received for seqID [{}], destroying.", p->seqIdent);
-                    m_sequences.erase(p->seqIdent);
-                    m_expiredSequences.insert(std::make_pair(p->seqIdent, timestamp+5000));
+                   Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::onTimer()", "Destroying PacketSequence [{}]", t.seqID);
+                    if(it->second.isReliable() && !it->second.isComplete())
+                    {
+                        // never delivered, so not retired either, the sender's retransmissions start it again rather than being acknowledged
+                        clearRetryRequests(t.seqID);
+                        eraseSequence(t.seqID);
+                    }
+                    else { retireSequence(t.seqID, timestamp); }
                 }
-                else { m_sequences.at(p->seqIdent).addPacket(&p, timestamp); }
-            }
+                else { scheduleSequence(it->second, timestamp); }
 
-            // cleanup
-            safeDelete(p);
-            m_packets.pop();
-        }
-
-        // iterate over sequences to kill or request retransmission
-        std::queue<uint32_t> toBeRemoved;
-        for(std::map<uint32_t, PacketSequence>::iterator it = m_sequences.begin(); it != m_sequences.end(); ++it)
-        {
-            bool destroy = it->second.update(timestamp);
-            if(destroy) { toBeRemoved.push(it->first); }
-        }
-
-        // remove expired/completed sequences
-        while(toBeRemoved.size() > 0)
-        {
-           Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::update()", "Destroying PacketSequence [{}]", toBeRemoved.front());
-            m_sequences.erase(toBeRemoved.front());
-            m_retryRequests.erase(toBeRemoved.front());
-            m_expiredSequences.insert(std::make_pair(toBeRemoved.front(), timestamp+5000));
-            toBeRemoved.pop();
-        }
-
-        /// \NOTE: toBeRemoved is size = 0 now
-
-        // find expired, expired-sequences
-        for(std::map<uint32_t, uint32_t>::iterator eit = m_expiredSequences.begin(); eit != m_expiredSequences.end(); ++eit)
-        {
-            if(eit->second < timestamp) { toBeRemoved.push(eit->first); }
-        }
-
-        // remove expired, expired-sequences
-        while(toBeRemoved.size() > 0)
-        {
-            m_expiredSequences.erase(toBeRemoved.front());
-            toBeRemoved.pop();
-        }
-
-        // request retransmissions
-        if(m_retryRequests.size() > 0)
-        {
-            bool lagging = false;
-            for(std::map<uint32_t, RetryRequest_Struct*>::iterator rit = m_retryRequests.begin(); rit != m_retryRequests.end(); ++rit)
+                // SACKs back off through the sequence deadline rather than the retry timer
+                if(m_retryTimeout > 10000)
+                {
+                   Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::onTimer()", "Lagging too hard and timed out, m_retryTimeout is [{}].", m_retryTimeout);
+                    simpleDatagram(OP_ConnectionTimedOut);
+                    return true;
+                }
+                armRetryTimer(timestamp);
+                break;
+            }
+            case NetTimerType::SequenceRetired:
+            {
+                m_expiredSequences.erase(t.seqID);
+                break;
+            }
+            case NetTimerType::RetryRequest:
             {
-                RetryRequest_Struct* rr = rit->second; // get handle on request
-                if(rr->nextRequestTime < timestamp)
+                // if retry timeout is 10+ seconds, the connection should be assumed lost
+                m_retryTimer = 0;
+                if(m_retryTimeout > 10000)
                 {
-                    // if second pass, assume lagging
-                    if(rr->nextRequestTime != 0) { lagging = true; }
-                    else { rr->nextRequestTime = timestamp + m_retryTimeout; }
-
-                    // send actual request
-                   Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::update()", "Sending retry request for seq [{}], pktNum [{}]", rr->seqID, rr->pktNum);
-                    m_network->sendBuiltin(&m_source, OP_RetransmissionRequest, rr->seqID, rr->pktNum);
+                   Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::onTimer()", "Lagging too hard and timed out, m_retryTimeout is [{}].", m_retryTimeout);
+                    simpleDatagram(OP_ConnectionTimedOut);
+                    return true;
                 }
+                sendRetryRequests(timestamp);
+                break;
             }
-
-            // update connection to lengthen retry wait times
-            if(lagging)
+            case NetTimerType::OrderedGap:
+            {
+                // the missing message is not coming back, stop holding everything behind it
+                m_orderTimer = 0;
+                if(m_heldOrdered.empty()) { break; }
+               Logger::getInstance().Log(Logs::WARN, Logs::Network, "Connection::onTimer()", "Reliable-ordered messages [{} - {}) never arrived, skipping them.", m_nextOrdered, m_heldOrdered.begin()->first);
+                m_nextOrdered = m_heldOrdered.begin()->first;
+                releaseOrdered();
+                break;
+            }
+            case NetTimerType::WindowUpdate:
+            {
+                m_windowTimer = 0;
+                if(m_isClosing) { break; }
+                advertiseWindow(timestamp);
+                break;
+            }
+            case NetTimerType::RttProbe:
             {
-               Logger::getInstance().Log(Logs::INFO, Logs::Network, "Connection::update()", "Marking connection [{}] as lagging! m_retryTimeout [{}], m_lastRetry [{}], m_prevLatency [{}]", getIPString(&m_source), m_retryTimeout, m_lastRetry, m_prevLatency);
-                //m_retryTimeout *= m_retryTimeout;
-                m_retryTimeout *= 2;
-                m_isLagging = true;
-                m_lastRetry = timestamp;
+                m_probeTimer = 0;
+                if(m_isClosing) { break; }
+                sendProbe();
+                m_probeTimer = m_network->scheduleTimer(timestamp + NET_RTT_PROBE_MS, NetTimer(NetTimerType::RttProbe, 0, this));
+                break;
+            }
+            default:
+            {
+               Logger::getInstance().Log(Logs::WARN, Logs::Network, "Connection::onTimer()", "Unexpected timer type [{}]", t.type);
+                break;
             }
         }
 
         return false;
     }
 
-    void Connection::addPacket(Packet** p)
+    void Connection::addPacket(PacketPair& pp)
     {
-        // dead pointer catch
-        if((*p) == nullptr) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Connection::addPacket()", "Passed ptr->nullptr->? instead of ptr->ptr->obj!"); return; }
+        // dead buffer catch
+        if(!pp.buffer || !pp.view.isDecoded()) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Connection::addPacket()", "Passed PacketPair without a decoded buffer!"); return; }
+        const PacketView& p = pp.view;
 
         // used to determine usefulness of packet
         bool keepPacket = false;
 
-        // do NOT update estimators on a retransmission reply
-        switch((*p)->op_code)
+        // RTT only comes from echoed timestamps, everything else just proves the peer is alive
+        m_lastArrival = p.arrivalTime;
+        m_counters.add(NetCounter::PacketsReceived);
+        m_counters.add(NetCounter::BytesReceived, pp.length);
+        switch(p.op_code)
         {
             case OP_RetransmissionReply:
             {
-                calculateLatency((*p)->timestamp, Time::getInstance().nowMS(), false);
                 keepPacket = true;
                 break;
             }
             case OP_RetransmissionAck:
             {
-               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::addPacket()", "OP_RetransmissionAck seqIdent [{}], pktNum [{}]", (*p)->seqIdent, (*p)->pktNum);
-                std::multimap<uint32_t, RetryRequest_Struct*>::iterator rit = m_retryRequests.find((*p)->seqIdent);
-                if(rit != m_retryRequests.end() && rit->second->pktNum == (*p)->pktNum) { safeDelete(rit->second); m_retryRequests.erase(rit); }
+               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::addPacket()", "OP_RetransmissionAck seqIdent [{}], pktNum [{}]", p.seqIdent, p.pktNum);
+                std::multimap<uint32_t, RetryRequest_Struct*>::iterator rit = m_retryRequests.find(p.seqIdent);
+                if(rit != m_retryRequests.end() && rit->second->pktNum == p.pktNum) { safeDelete(rit->second); m_retryRequests.erase(rit); }
                 break;
             }
             case OP_RetransmissionImpossible:
             case OP_Ack:
             {
-               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::addPacket()", "OP_Ack/OP_RetransmissionsImpossible seqIdent [{}], pktNum [{}]", (*p)->seqIdent, (*p)->pktNum);
+               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::addPacket()", "OP_Ack/OP_RetransmissionsImpossible seqIdent [{}], pktNum [{}]", p.seqIdent, p.pktNum);
 
                 // erase all retry requests
-                std::multimap<uint32_t, RetryRequest_Struct*>::iterator rit = m_retryRequests.find((*p)->seqIdent);
-                while(rit != m_retryRequests.end()) { safeDelete(rit->second); m_retryRequests.erase((*p)->seqIdent); rit = m_retryRequests.find((*p)->seqIdent); }
+                clearRetryRequests(p.seqIdent);
 
                 // kill off sequence (though this shouldn't be necessary)
-                m_sequences.erase((*p)->seqIdent);
+                eraseSequence(p.seqIdent);
                 break;
             }
             case OP_KeepAlive:
             {
                Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::addPacket()", "OP_KeepAlive");
-                calculateLatency((*p)->timestamp, (*p)->arrivalTime);
+                if(p.dataLength >= sizeof(TimestampEcho_Struct) && m_network)
+                {
+                    // echo the probe, subtracting the time it waited here (ring, update thread) from the peer's sample
+                    TimestampEcho_Struct echo;
+                    memcpy(&echo, p.data, sizeof(TimestampEcho_Struct));
+                    uint64_t now = Time::getInstance().steadyUS();
+                    echo.holdUS = (now > p.arrivalUS) ? (uint32_t)std::min(now - p.arrivalUS, (uint64_t)UINT32_MAX) : 0;
+                    m_network->sendBuiltinData(&m_source, OP_TimestampEcho, &echo, sizeof(TimestampEcho_Struct));
+                }
+                break;
+            }
+            case OP_TimestampEcho:
+            {
+                if(p.dataLength < sizeof(TimestampEcho_Struct)) { break; }
+                TimestampEcho_Struct echo;
+                memcpy(&echo, p.data, sizeof(TimestampEcho_Struct));
+
+                // both ends of the sample were taken on this machine's clock
+                if(p.arrivalUS > echo.sentUS + echo.holdUS) { onRTTSample(p.arrivalUS - echo.sentUS - echo.holdUS); }
                 break;
             }
             case OP_ConnectionDisconnect:
             {
                Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::addPacket()", "OP_ConnectionDisconnect");
-                m_isClosing = true;
+                setClosed(true);
             }
             default:
             {
                 // normal packets
-                calculateLatency((*p)->timestamp, (*p)->arrivalTime);
                 keepPacket = true;
                 break;
             }
@@ -202,80 +200,255 @@ namespace CGameEngine
 
         if(keepPacket)
         {
+            // reliable single packets are acknowledged every time, the sender resends until it hears back
+            if(p.pktTotal == 1 && p.isReliable() && m_network)
+            {
+                m_network->sendBuiltin(&m_source, OP_Ack, p.seqIdent, 0);
+                if(doesExist(p.seqIdent)) { return; } // our earlier OP_Ack was lost
+                retireSequence(p.seqIdent, p.arrivalTime);
+            }
+
             // hand-off or datagram creation
-            if((*p)->pktTotal == 1) { directHandOff(*p); } // account for single packets
-            else { m_packets.push(*p); } // regular packets
+            if(p.pktTotal == 1) { directHandOff(p); } // account for single packets, payload copied out of the receive buffer
+            else { addFragment(pp, p.arrivalTime); } // regular packets, the sequence takes ownership of the receive buffer
+        }
+    }
 
-            // setting passed pointer of pointer to nullptr (take ownership)
-            *p = nullptr;
+    RTTStats Connection::getRTTStats() const
+    {
+        HistogramSnapshot hs = m_rttHistogram.snapshot();
+        RTTStats retVal;
+        retVal.samples = hs.count;
+        retVal.minUS = hs.min;
+        retVal.avgUS = (uint64_t)hs.mean();
+        retVal.p99US = hs.percentile(99.0);
+        retVal.srttUS = m_srttUS.load(std::memory_order_relaxed);
+        retVal.rttVarUS = m_rttVarUS.load(std::memory_order_relaxed);
+        return retVal;
+    }
+
+    ConnectionStats Connection::getStats() const
+    {
+        ConnectionStats retVal;
+        retVal.rtt = getRTTStats();
+        retVal.congestion = getCongestionStats();
+        retVal.window = getReceiveWindowStats();
+        for(uint8_t i = 0; i < NetCounter::END; i++) { retVal.counters[i] = m_counters.get(i); }
+        return retVal;
+    }
+
+    void Connection::keepalive() { m_lastArrival = Time::getInstance().cachedMS(); }
+
+    void Connection::setClosed(bool val /*= true*/)
+    {
+        m_isClosing = val;
+        if(m_isClosing && m_closeTimer == 0 && m_network) { m_closeTimer = m_network->scheduleTimer(Time::getInstance().steadyMS(), NetTimer(NetTimerType::ConnectionClose, 0, this)); }
+    }
+
+    /// Connection protected functions ////////////////////////////////////////
+
+    /// file a fragment of a multi-packet sequence, assembling the sequence as soon as it is complete
+    void Connection::addFragment(PacketPair& pp, const uint64_t& timestamp)
+    {
+        const PacketView& p = pp.view;
+
+        // is packet damaged? If so, request new one (unreliable sequences just expire)
+        if(p.isDamaged())
+        {
+            count(NetCounter::PacketsDamaged);
+            if(p.isReliable())
+            {
+                RetryRequest_Struct* rr = new RetryRequest_Struct(p.seqIdent, p.pktNum, timestamp);
+                m_retryRequests.insert( std::make_pair(p.seqIdent, rr) );
+                rr = nullptr; // let Connection "own" it
+                armRetryTimer(timestamp);
+            }
         }
-        else
+        // check for existing sequence or existing expired sequence
+        else if(!doesExist(p.seqIdent))
         {
-            safeDelete((*p));
-            //safeDelete(p);
-            p = nullptr;
+            // build a sequence
+           Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::addFragment()", "Creating PacketSequence for seqID [{}], with [{}] packets", p.seqIdent, p.pktTotal);
+            std::map<uint32_t, PacketSequence>::iterator it = m_sequences.insert(std::make_pair(p.seqIdent, PacketSequence(p.seqIdent, p.pktTotal, timestamp, this))).first;
+            it->second.addPacket(pp, timestamp);
+            scheduleSequence(it->second, timestamp);
+        }
+        else // sequence does exist, handle normally
+        {
+            std::map<uint32_t, PacketSequence>::iterator it = m_sequences.find(p.seqIdent);
+            if(p.op_code == OP_RetransmissionImpossible)
+            {
+               Logger::getInstance().Log(Logs::WARN, Logs::Network, "Connection::addFragment()", "Retry Impossible received for seqID [{}], destroying.", p.seqIdent);
+                retireSequence(p.seqIdent, timestamp);
+            }
+            else if(it == m_sequences.end())
+            {
+                // retired (delivered), the sender is probing because our OP_Ack was lost
+                if(p.isReliable() && p.pktNum == 0 && m_network) { m_network->sendBuiltin(&m_source, OP_Ack, p.seqIdent, 0); }
+            }
+            else
+            {
+                it->second.addPacket(pp, timestamp);
+                if(it->second.isComplete() && it->second.update(timestamp))
+                {
+                   Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::addFragment()", "Destroying PacketSequence [{}]", p.seqIdent);
+                    retireSequence(p.seqIdent, timestamp);
+                }
+            }
         }
+
+        // cleanup, the sequence copied what it needed
+        pp.destroy();
     }
 
-    void Connection::calculateLatency(const uint64_t& pktTime, const uint64_t& arrivalTime, bool updateEstimators /*= true*/)
+    void Connection::deliver(Datagram* d, uint8_t delivery, uint32_t channelSeq, const uint64_t& arrivalUS)
     {
-        // set initial latency
-        if(m_latency == -1)
+        if(!d) { return; }
+        switch(delivery)
         {
-            m_latency = arrivalTime - pktTime;
-            for(int i=0;i<10;i++) { m_latencyArray[i] = m_latency; }
-            //Logger::getInstance().Log(Logs::DEBUG, "Connection::calculateLatency()", "m_latency first set to {}.", m_latency);
-            return;
+            case DeliveryMode::UnreliableSequenced:
+            {
+                // anything older than what the user already has is stale
+                if(channelSeq <= m_lastSequenced) { safeDelete(d); return; }
+                m_lastSequenced = channelSeq;
+                break;
+            }
+            case DeliveryMode::ReliableOrdered:
+            {
+                if(channelSeq < m_nextOrdered) { safeDelete(d); return; } // duplicate
+                else if(channelSeq > m_nextOrdered)
+                {
+                    // hold until the gap is filled, or given up on
+                    if(!m_heldOrdered.insert(std::make_pair(channelSeq, d)).second) { safeDelete(d); return; }
+                    if(m_orderTimer == 0 && m_network) { m_orderTimer = m_network->scheduleTimer(Time::getInstance().cachedMS() + NET_ORDERED_GAP_MS, NetTimer(NetTimerType::OrderedGap, 0, this)); }
+                    return;
+                }
+                m_nextOrdered++;
+                break;
+            }
+            default: { break; }
         }
 
-        // update last arrival
-        m_lastArrival = arrivalTime;
+        if(handOver(d, delivery) && m_network) { m_network->recordDeliveryLatency(arrivalUS); }
+        if(delivery == DeliveryMode::ReliableOrdered && !m_heldOrdered.empty()) { releaseOrdered(); }
+        advertiseWindow(Time::getInstance().cachedMS());
+    }
 
-        // update estimators, such as latency
-        if(updateEstimators)
+    void Connection::releaseOrdered()
+    {
+        std::map<uint32_t, Datagram*>::iterator it = m_heldOrdered.begin();
+        while(it != m_heldOrdered.end() && it->first <= m_nextOrdered)
         {
-            m_latencyArray[m_LA] = arrivalTime - pktTime;
+            if(it->first == m_nextOrdered) { handOver(it->second, DeliveryMode::ReliableOrdered); m_nextOrdered++; }
+            else { safeDelete(it->second); }
+            it = m_heldOrdered.erase(it);
+        }
 
-            // slot 0
-            m_latency = m_latencyArray[0];
-            m_latencyStdDev = 0;
+        // the gap timer only covers the oldest hole
+        if(m_network) { m_network->cancelTimer(m_orderTimer); }
+        if(!m_heldOrdered.empty() && m_network) { m_orderTimer = m_network->scheduleTimer(Time::getInstance().cachedMS() + NET_ORDERED_GAP_MS, NetTimer(NetTimerType::OrderedGap, 0, this)); }
+    }
 
-            // slots 1-9
-            for(int i = 1; i < 10; i++)
+    bool Connection::handOver(Datagram* d, uint8_t delivery)
+    {
+        if(m_window)
+        {
+            // reliable messages can't be dropped here, their sender has forgotten them
+            uint32_t bytes = d->dataLength + sizeof(Datagram);
+            bool droppable = (delivery == DeliveryMode::Unreliable || delivery == DeliveryMode::UnreliableSequenced) && m_network && m_network->isDroppingUnreliable();
+            if(!m_window->admit(bytes, droppable))
             {
-                m_latency+=m_latencyArray[i];
-                m_latencyStdDev+=(m_latencyArray[i-1] - m_latencyArray[i]);
+                count(NetCounter::MessagesDropped);
+                if(m_network) { m_network->getNetStats().trace(NetTrace::Dropped, d->op_code, 0, 0, d->dataLength); }
+                safeDelete(d);
+                return false;
             }
-            m_latency /= 10;
-            m_latencyStdDev /= 10;
+            d->window = m_window;
+            d->windowBytes = bytes;
+        }
+        count(NetCounter::MessagesDelivered);
+        if(m_network)
+        {
+            m_network->getNetStats().record(NetHistogram::MessageBytes, d->dataLength);
+            m_network->getNetStats().trace(NetTrace::Delivered, d->op_code, 0, 0, d->dataLength);
+        }
+        m_buffer->push(d);
+        return true;
+    }
 
-            /// \TODO: TEST THIS! Review it, then test it again!
-            if(m_isLagging)
-            {
-                if(m_latency <= (m_prevLatency * 0.75f))
-                {
-                   Logger::getInstance().Log(Logs::INFO, Logs::Network, "Connection::calculateLatency()", "m_latency [{}] is within 25% of m_prevLatency [{}]! ({})", m_latency, m_prevLatency, (int)(m_prevLatency * 0.75f));
-                    m_isLagging = false;
-                    m_prevLatency = 0;
-                    m_lastRetry = 0;
-                }
-            }
+    /// tell the peer how much room is left once it matters: closing, reopening, halving or doubling
+    void Connection::advertiseWindow(const uint64_t& timestamp)
+    {
+        if(!m_window || !m_network || m_isClosing) { return; }
+        uint64_t available = m_window->available();
+        uint64_t half = m_window->getLimit() / 2;
+
+        // peers assume an open window until told otherwise
+        bool send = false;
+        if(m_advertisedWindow == NET_WINDOW_UNADVERTISED) { send = (available < half); }
+        else if(available == 0 || m_advertisedWindow == 0) { send = (available != m_advertisedWindow); }
+        else { send = (available < m_advertisedWindow / 2 || available / 2 > m_advertisedWindow); }
+
+        // shrunk, and the last update may have been lost
+        bool shrunk = (m_advertisedWindow != NET_WINDOW_UNADVERTISED && m_advertisedWindow < half);
+        if(shrunk && timestamp - m_lastWindowUpdate >= NET_WINDOW_REFRESH_MS) { send = true; }
 
-            m_retryTimeout = m_latency + (4 * m_latencyStdDev);
-            if(m_retryTimeout < 50) { m_retryTimeout = 50; } // minimum value
-            m_LA = (m_LA == 9) ? 0 : m_LA+1;
-            /*Logger::getInstance().Log(Logs::DEBUG, "Connection::calculateLatency()", "actualLatency [{} - {} = {}], latency [{}], latencyStdDev [{}], retryTimeout [{}]", arrivalTime, pktTime, (arrivalTime - pktTime), m_latency, m_latencyStdDev, m_retryTimeout);
-			Logger::getInstance().Log(Logs::DEBUG, "Connection::calculateLatency()", "latencyArray : {} {} {} {} {} {} {} {} {} {}", m_latencyArray[0], m_latencyArray[1], m_latencyArray[2], m_latencyArray[3],
-                                        m_latencyArray[4], m_latencyArray[5], m_latencyArray[6], m_latencyArray[7], m_latencyArray[8], m_latencyArray[9]);*/
+        if(send)
+        {
+            ReceiveWindow_Struct rw;
+            rw.windowBytes = (uint32_t)std::min(available, (uint64_t)UINT32_MAX);
+            m_network->sendBuiltinData(&m_source, OP_WindowUpdate, &rw, sizeof(ReceiveWindow_Struct));
+            count(NetCounter::WindowUpdatesSent);
+            m_advertisedWindow = available;
+            m_lastWindowUpdate = timestamp;
+            shrunk = (available < half);
+           Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::advertiseWindow()", "Advertised [{}] bytes to [{}].", available, getIPString(&m_source));
         }
+
+        // credit comes back from the user's thread without a word, keep looking until the peer is off the brake
+        if(shrunk && m_windowTimer == 0) { m_windowTimer = m_network->scheduleTimer(timestamp + NET_WINDOW_UPDATE_MS, NetTimer(NetTimerType::WindowUpdate, 0, this)); }
     }
 
-    void Connection::keepalive() { m_lastArrival = Time::getInstance().nowMS(); }
+    /// make sure pending retry requests go out, the first pass is immediate
+    void Connection::armRetryTimer(const uint64_t& timestamp)
+    {
+        if(m_retryTimer != 0 || m_retryRequests.empty() || !m_network) { return; }
+        m_retryTimer = m_network->scheduleTimer(timestamp, NetTimer(NetTimerType::RetryRequest, 0, this));
+    }
 
-    /// Connection protected functions ////////////////////////////////////////
+    void Connection::count(uint8_t counter, uint64_t n /*= 1*/)
+    {
+        m_counters.add(counter, n);
+        if(m_network) { m_network->getNetStats().add(counter, n); }
+    }
+
+    void Connection::clearRetryRequests(uint32_t seqID)
+    {
+        std::multimap<uint32_t, RetryRequest_Struct*>::iterator rit = m_retryRequests.find(seqID);
+        while(rit != m_retryRequests.end() && rit->first == seqID) { safeDelete(rit->second); rit = m_retryRequests.erase(rit); }
+    }
 
     void Connection::closeConnection()
     {
+        // drop every timer still pointing at this connection
+        if(m_network)
+        {
+            m_network->cancelTimer(m_idleTimer);
+            m_network->cancelTimer(m_retryTimer);
+            m_network->cancelTimer(m_closeTimer);
+            m_network->cancelTimer(m_probeTimer);
+            m_network->cancelTimer(m_orderTimer);
+            m_network->cancelTimer(m_windowTimer);
+            for(std::map<uint32_t, PacketSequence>::iterator it = m_sequences.begin(); it != m_sequences.end(); ++it) { m_network->cancelTimer(it->second.getTimer()); }
+            for(std::map<uint32_t, TimerID>::iterator eit = m_expiredSequences.begin(); eit != m_expiredSequences.end(); ++eit) { m_network->cancelTimer(eit->second); }
+            if(m_congestion) { m_network->removeCongestion(ConnectionKey(&m_source)); m_network->resetChannels(ConnectionKey(&m_source)); }
+        }
+        m_congestion.reset();
+
+        // never handed over
+        for(std::map<uint32_t, Datagram*>::iterator hit = m_heldOrdered.begin(); hit != m_heldOrdered.end(); ++hit) { safeDelete(hit->second); }
+        m_heldOrdered.clear();
+
         // clear retry requests
         for(std::map<uint32_t, RetryRequest_Struct*>::iterator rit = m_retryRequests.begin(); rit != m_retryRequests.end(); ++rit)
         {
@@ -283,9 +456,6 @@ namespace CGameEngine
         }
         m_retryRequests.clear();
 
-        // clear all packets
-        while(!m_packets.empty()) { safeDelete(m_packets.front()); m_packets.pop(); }
-
         //safeDelete(m_source);
         m_sequences.clear();
         m_expiredSequences.clear();
@@ -301,6 +471,116 @@ namespace CGameEngine
         else { return false; }
     }
 
+    void Connection::eraseSequence(uint32_t seqID)
+    {
+        std::map<uint32_t, PacketSequence>::iterator it = m_sequences.find(seqID);
+        if(it == m_sequences.end()) { return; }
+        if(m_network) { m_network->cancelTimer(it->second.getTimer()); }
+        m_sequences.erase(it);
+    }
+
+    /// destroy a finished (or failed) sequence, remembering its ID for a while so late fragments do not restart it
+    void Connection::retireSequence(uint32_t seqID, const uint64_t& timestamp)
+    {
+        eraseSequence(seqID);
+        clearRetryRequests(seqID);
+        if(!m_network) { return; }
+
+        std::map<uint32_t, TimerID>::iterator eit = m_expiredSequences.find(seqID);
+        if(eit != m_expiredSequences.end()) { m_network->cancelTimer(eit->second); }
+        m_expiredSequences[seqID] = m_network->scheduleTimer(timestamp + NET_RETIRED_SEQUENCE_MS, NetTimer(NetTimerType::SequenceRetired, seqID, this));
+    }
+
+    /// retransmissions are being asked for a second time, lengthen retry wait times
+    void Connection::markLagging(const uint64_t& timestamp)
+    {
+        // once per RTO, every sequence asking again within it is the same loss event (RFC 6298 5.5 backs off per timeout)
+        if(m_isLagging && timestamp < m_lastRetry + m_retryTimeout) { return; }
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "Connection::markLagging()", "Marking connection [{}] as lagging! m_retryTimeout [{}], m_lastRetry [{}], srtt [{}]us", getIPString(&m_source), m_retryTimeout, m_lastRetry, m_srttUS.load(std::memory_order_relaxed));
+        //m_retryTimeout *= m_retryTimeout;
+        m_retryTimeout *= 2;
+        m_isLagging = true;
+        m_lastRetry = timestamp;
+    }
+
+    /// RFC 6298 section 2, the backed off RTO is kept until a fresh sample arrives (section 5.7)
+    void Connection::onRTTSample(const uint64_t& rttUS)
+    {
+        if(rttUS == 0) { return; }
+        m_rttHistogram.record(rttUS);
+        if(m_network) { m_network->getNetStats().record(NetHistogram::RttUS, rttUS); }
+
+        uint64_t srtt = m_srttUS.load(std::memory_order_relaxed);
+        uint64_t rttVar = m_rttVarUS.load(std::memory_order_relaxed);
+        if(srtt == 0) { srtt = rttUS; rttVar = rttUS / 2; }
+        else
+        {
+            uint64_t diff = (srtt > rttUS) ? (srtt - rttUS) : (rttUS - srtt);
+            rttVar = (3 * rttVar + diff) / 4; // beta = 1/4
+            srtt = (7 * srtt + rttUS) / 8; // alpha = 1/8
+        }
+        m_srttUS.store(srtt, std::memory_order_relaxed);
+        m_rttVarUS.store(rttVar, std::memory_order_relaxed);
+
+        uint64_t rtoUS = srtt + std::max((uint64_t)NET_RTO_GRANULARITY_US, 4 * rttVar);
+        m_retryTimeout = std::max((int)((rtoUS + 999) / 1000), NET_RTO_MIN_MS);
+        if(m_isLagging)
+        {
+           Logger::getInstance().Log(Logs::INFO, Logs::Network, "Connection::onRTTSample()", "Connection [{}] no longer lagging, srtt [{}]us, m_retryTimeout [{}].", getIPString(&m_source), srtt, m_retryTimeout);
+            m_isLagging = false;
+        }
+
+        if(m_congestion) { m_congestion->onRTTSample(rttUS); }
+    }
+
+    /// timestamped OP_KeepAlive, the peer answers with OP_TimestampEcho
+    void Connection::sendProbe()
+    {
+        if(!m_network) { return; }
+        TimestampEcho_Struct probe;
+        probe.sentUS = Time::getInstance().steadyUS();
+        m_network->sendBuiltinData(&m_source, OP_KeepAlive, &probe, sizeof(TimestampEcho_Struct));
+    }
+
+    /// (re)arm a sequence's deadline, never in the past so a lagging sequence is not spun on
+    void Connection::scheduleSequence(PacketSequence& ps, const uint64_t& timestamp)
+    {
+        if(!m_network) { return; }
+        uint64_t deadline = ps.getNextDeadline();
+        if(deadline <= timestamp) { deadline = timestamp + std::max(m_retryTimeout, 50); }
+        m_network->cancelTimer(ps.getTimer());
+        ps.getTimer() = m_network->scheduleTimer(deadline, NetTimer(NetTimerType::SequenceDeadline, ps.getSeqID(), this));
+    }
+
+    /// request retransmissions, then come back after m_retryTimeout while any are outstanding
+    void Connection::sendRetryRequests(const uint64_t& timestamp)
+    {
+        if(m_retryRequests.empty()) { return; }
+
+        bool lagging = false;
+        for(std::map<uint32_t, RetryRequest_Struct*>::iterator rit = m_retryRequests.begin(); rit != m_retryRequests.end(); ++rit)
+        {
+            RetryRequest_Struct* rr = rit->second; // get handle on request
+            if(rr->nextRequestTime < timestamp)
+            {
+                // if second pass, assume lagging
+                if(rr->nextRequestTime != 0) { lagging = true; }
+                else { rr->nextRequestTime = timestamp + m_retryTimeout; }
+
+                // send actual request
+               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Connection::sendRetryRequests()", "Sending retry request for seq [{}], pktNum [{}]", rr->seqID, rr->pktNum);
+                m_network->sendBuiltin(&m_source, OP_RetransmissionRequest, rr->seqID, rr->pktNum);
+                count(NetCounter::RetryRequestsSent);
+                m_network->getNetStats().trace(NetTrace::RetryRequested, OP_RetransmissionRequest, rr->seqID, rr->pktNum);
+            }
+        }
+
+        // update connection to lengthen retry wait times
+        if(lagging) { markLagging(timestamp); }
+
+        m_retryTimer = m_network->scheduleTimer(timestamp + std::max(m_retryTimeout, 50), NetTimer(NetTimerType::RetryRequest, 0, this));
+    }
+
     /// NetConnection public functions ////////////////////////////////////////
 
     void copy(NetConnection& dst, const NetConnection& src)
@@ -310,12 +590,18 @@ namespace CGameEngine
             //dst.m_source = src.m_source;
             memcpy(&dst.m_source, &src.m_source, sizeof(struct sockaddr_storage));
             dst.m_ipAddr = src.m_ipAddr;
+            dst.m_key = src.m_key;
             dst.m_isClosing = src.m_isClosing;
             dst.m_lastArrival = src.m_lastArrival;
             dst.m_network = src.m_network;
+            dst.m_congestion = src.m_congestion;
+            dst.m_retryTimeout = src.m_retryTimeout;
+            dst.m_lastSequenced = src.m_lastSequenced;
+            dst.m_nextOrdered = src.m_nextOrdered;
+            dst.m_srttUS.store(src.m_srttUS.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            dst.m_rttVarUS.store(src.m_rttVarUS.load(std::memory_order_relaxed), std::memory_order_relaxed);
             if(src.m_buffer) { dst.m_buffer = src.m_buffer; }
             dst.m_retryRequests = src.m_retryRequests;
-            dst.m_packets = src.m_packets;
             dst.m_sequences = src.m_sequences;
             dst.m_expiredSequences = src.m_expiredSequences;
         }
@@ -327,10 +613,15 @@ namespace CGameEngine
         m_source = (*source);
         m_buffer = buffer;
         m_ipAddr = getIPString(source);
+        m_key = ConnectionKey(source);
         m_connType = ConnectionType::NET;
         m_network = net;
-        m_lastArrival = Time::getInstance().nowMS();
+        m_lastArrival = Time::getInstance().steadyMS();
         m_ipAddr = ipStr;
+        m_idleTimer = m_network->scheduleTimer(m_lastArrival + NET_CONNECTION_IDLE_MS + 1, NetTimer(NetTimerType::ConnectionIdle, 0, this));
+        m_congestion = m_network->addCongestion(m_key);
+        m_window = m_network->makeReceiveWindow();
+        m_probeTimer = m_network->scheduleTimer(m_lastArrival, NetTimer(NetTimerType::RttProbe, 0, this)); // first sample right away
 
         // take ownership
         source = nullptr;
@@ -344,11 +635,10 @@ namespace CGameEngine
 
     /// NetConnection private functions ///////////////////////////////////////
 
-    void NetConnection::directHandOff(Packet* p)
+    void NetConnection::directHandOff(const PacketView& p)
     {
-        Datagram* d = new Datagram(p->op_code, m_uniqueID, p->data, p->dataLength, p->timestamp, this);
-        if(d) { m_buffer->push(d); }
-        safeDelete(p);
+        Datagram* d = new Datagram(p.op_code, m_uniqueID, (unsigned char*)p.data, p.dataLength, p.timestamp, this);
+        deliver(d, p.delivery, p.channelSeq, p.arrivalUS);
     }
 
     void NetConnection::sendACK(uint32_t seqID)
@@ -358,7 +648,7 @@ namespace CGameEngine
 
     void NetConnection::simpleDatagram(uint16_t OpCode)
     {
-        Datagram* d = new Datagram(OpCode, m_uniqueID, nullptr, 0, 0, this);
-        if(d) { m_buffer->push(d); }
+        Datagram* d = new Datagram(OpCode, m_uniqueID);
+        if(d) { d->netCon = this; m_buffer->push(d); }
     }
 }
@@ -4,24 +4,58 @@
 #include "common/types.h"
 #include "net/Socket.h"
 #include "net/Network.h"
+#include "net/NetTimer.h"
+#include "net/ConnectionKey.h"
+#include "common/Histogram.h"
 #include "common/SafeQueue.h"
+#include <atomic>
 #include <map>
 #include <string>
 
 /*
     Assuming minimum connection speed of 30kbps, which is 40 FULL packets per second
 
+    RTT is measured on one clock: every NET_RTT_PROBE_MS a connection sends an OP_KeepAlive carrying
+    its own Time::steadyUS(), the peer echoes it back in OP_TimestampEcho along with how long it held
+    it, so neither side ever compares its clock with the other's. Samples feed an RFC 6298 estimator
+    (SRTT / RTTVAR) which sets the retransmission timeout, m_retryTimeout.
+
     ref:
         http://www.masterraghu.com/subjects/np/introduction/unix_network_programming_v1.3/ch22lev1sec5.html
+        https://tools.ietf.org/html/rfc6298
+            Computing TCP's Retransmission Timer
 */
 
+#define NET_RTO_INITIAL_MS 1000 // until the first RTT sample
+#define NET_RTO_MIN_MS 50
+#define NET_RTO_GRANULARITY_US 1000 // G, floor for the 4 * RTTVAR term
+
 /// \TODO: Review passing netcon/unixcon on datagrams to correctly indicate the source!
-/// \TODO: Review better way to get timestamped comparisons (ntp) from src send time to dst arrival time
 
 namespace ConnectionType { enum FORMS { BASE, NET }; }
 
 namespace CGameEngine
 {
+    /// plain snapshot of a connection's RTT, safe to hand out to other threads
+    struct RTTStats
+    {
+        uint64_t samples = 0;
+        uint64_t minUS = 0;
+        uint64_t avgUS = 0;
+        uint64_t p99US = 0;
+        uint64_t srttUS = 0; // smoothed, what the retransmission timeout is built on
+        uint64_t rttVarUS = 0;
+    };
+
+    /// everything known about one connection, safe to hand out to other threads
+    struct ConnectionStats
+    {
+        RTTStats rtt;
+        CongestionStats congestion; // sending side: rate, loss, bytes paced out
+        ReceiveWindowStats window; // receiving side: what the user has not taken yet
+        uint64_t counters[NetCounter::END] = { 0 }; // this connection's share of Network's NetCounters, receive side
+    };
+
     class Network;
     class Connection
     {
@@ -30,44 +64,76 @@ namespace CGameEngine
         public:
             Connection() {}
             virtual ~Connection() { closeConnection(); }
-            bool update(uint64_t timestamp);
+            bool onTimer(const NetTimer& t, const uint64_t& timestamp); // true when the connection should be destroyed
             const bool& isClosed() const { return m_isClosed; }
             const int& getConnectionType() const { return m_connType; }
             const uint32_t& getUniqueID() const { return m_uniqueID; }
-            void addPacket(Packet** p);
-            void calculateLatency(const uint64_t& pktTime, const uint64_t& arrivalTime, bool updateEstimators = true);
+            void addPacket(PacketPair& pp);
             void keepalive();
             void setDatagramBuffer(SafeQueue<Datagram*>* buffer) { m_buffer = buffer; }
-            void setClosed(bool val = true) { m_isClosing = val; }
+            void setClosed(bool val = true);
             void setUniqueID(uint32_t& id) { m_uniqueID = id; }
             sockaddr_storage* getSource() { return &m_source; }
+            CongestionStats getCongestionStats() const { return (m_congestion) ? m_congestion->snapshot() : CongestionStats(); } // any thread
+            RTTStats getRTTStats() const; // any thread
+            ConnectionStats getStats() const; // any thread
+            ReceiveWindowStats getReceiveWindowStats() const { return (m_window) ? m_window->snapshot() : ReceiveWindowStats(); } // any thread
+            const uint32_t& getNextOrdered() const { return m_nextOrdered; }
+            const uint32_t& getLastSequenced() const { return m_lastSequenced; }
+            void resumeChannels(uint32_t nextOrdered, uint32_t lastSequenced) { m_nextOrdered = nextOrdered; m_lastSequenced = lastSequenced; } // connection handed over from another process
 
         protected:
+            void addFragment(PacketPair& pp, const uint64_t& timestamp);
+            void deliver(Datagram* d, uint8_t delivery, uint32_t channelSeq, const uint64_t& arrivalUS); // applies the delivery mode, takes d
+            void releaseOrdered(); // push held reliable-ordered messages that are next in line
+            bool handOver(Datagram* d, uint8_t delivery); // charge the receive window and push, false (d deleted) if it was dropped
+            void advertiseWindow(const uint64_t& timestamp); // OP_WindowUpdate if the peer should know, keeps checking while shrunk
+            void armRetryTimer(const uint64_t& timestamp);
+            void clearRetryRequests(uint32_t seqID);
+            void count(uint8_t counter, uint64_t n = 1); // this connection's and Network's NetStats
             void closeConnection();
             bool doesExist(uint32_t seq);
+            void eraseSequence(uint32_t seqID);
+            void markLagging(const uint64_t& timestamp);
+            void onRTTSample(const uint64_t& rttUS);
+            void sendProbe();
+            void retireSequence(uint32_t seqID, const uint64_t& timestamp);
+            void scheduleSequence(PacketSequence& ps, const uint64_t& timestamp);
+            void sendRetryRequests(const uint64_t& timestamp);
             virtual void simpleDatagram(uint16_t OpCode) = 0;
-            virtual void directHandOff(Packet* p) = 0;
+            virtual void directHandOff(const PacketView& p) = 0;
 
             bool m_isClosed = false;
             bool m_isClosing = false; // open for all types of packets
             bool m_isLagging = false;
             int m_connType = ConnectionType::BASE; // base
-            int m_prevLatency = 0; // 'snapshot' of m_latency
-            int m_latency = -1; // MS
-            int m_latencyStdDev = 0; // MS
-            int m_retryTimeout = 0; // MS
-            int m_latencyArray[10] = {0};
-            uint8_t m_LA = 0;
+            int m_retryTimeout = NET_RTO_INITIAL_MS; // MS, RFC 6298 RTO, doubled while lagging
             uint32_t m_uniqueID = 0; // sender's uniqID
             uint64_t m_lastArrival = 0; // MS timestamp
             uint64_t m_lastRetry = 0; // MS timestamp
+            std::atomic<uint64_t> m_srttUS { 0 }; // 0 until the first sample
+            std::atomic<uint64_t> m_rttVarUS { 0 };
+            Histogram m_rttHistogram; // microseconds, every sample
+            NetCounters m_counters; // written by the update thread, read by anyone
+            TimerID m_idleTimer = 0;
+            TimerID m_retryTimer = 0;
+            TimerID m_closeTimer = 0;
+            TimerID m_probeTimer = 0;
+            TimerID m_orderTimer = 0; // OrderedGap, while reliable-ordered messages are held
+            TimerID m_windowTimer = 0; // WindowUpdate, while the advertised window is below half
+            uint64_t m_advertisedWindow = NET_WINDOW_UNADVERTISED; // bytes, last OP_WindowUpdate
+            uint64_t m_lastWindowUpdate = 0; // MS timestamp
+            uint32_t m_lastSequenced = 0; // newest unreliable-sequenced message handed over
+            uint32_t m_nextOrdered = 1; // reliable-ordered message the user gets next
+            std::map<uint32_t, Datagram*> m_heldOrdered; // arrived ahead of m_nextOrdered
             sockaddr_storage m_source;
             Network* m_network = nullptr;
             SafeQueue<Datagram*>* m_buffer = nullptr;
+            std::shared_ptr<CongestionControl> m_congestion; // shared with Network's send path
+            std::shared_ptr<ReceiveWindow> m_window; // shared with every Datagram handed over, outlives the connection if the user holds on to them
             std::multimap<uint32_t, RetryRequest_Struct*> m_retryRequests;
-            SafeQueue<Packet*> m_packets;
             std::map<uint32_t, PacketSequence> m_sequences;
-            std::map<uint32_t, uint32_t> m_expiredSequences;
+            std::map<uint32_t, TimerID> m_expiredSequences; // retired seqIDs and the timer forgetting them
     };
 
     /// \TODO: Add getaddrinfo to store "complete" inet info
@@ -82,10 +148,12 @@ namespace CGameEngine
             NetConnection(const NetConnection& ps) { copy(*this, ps); }
             NetConnection& operator=(const NetConnection& ps) { copy(*this, ps); return *this; }
             const std::string& getIPAddr() const { return m_ipAddr; }
+            const ConnectionKey& getKey() const { return m_key; }
 
         private:
             std::string m_ipAddr = "";
-            void directHandOff(Packet* p) override;
+            ConnectionKey m_key;
+            void directHandOff(const PacketView& p) override;
             void sendACK(uint32_t seqID);
             void simpleDatagram(uint16_t OpCode) override;
     };
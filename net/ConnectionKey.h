@@ -0,0 +1,58 @@
+#ifndef CONNECTIONKEY_H_INCLUDED
+#define CONNECTIONKEY_H_INCLUDED
+
+#include "common/types.h"
+#include <netinet/in.h> // sockaddr_in, sockaddr_in6
+#include <sys/socket.h> // sockaddr_storage
+#include <string.h> // memcpy
+
+namespace CGameEngine
+{
+    /// binary source address + port, IPv4 is stored IPv4-mapped (::ffff:a.b.c.d) so both families compare alike
+    struct ConnectionKey
+    {
+        ConnectionKey() {}
+        explicit ConnectionKey(const sockaddr_storage* ss)
+        {
+            if(!ss) { return; }
+            if(ss->ss_family == AF_INET)
+            {
+                const sockaddr_in* sai = (const sockaddr_in*)ss;
+                unsigned char mapped[16] = { 0,0,0,0, 0,0,0,0, 0,0,0xFF,0xFF, 0,0,0,0 };
+                memcpy(&mapped[12], &sai->sin_addr, 4);
+                memcpy(addr, mapped, 16);
+                port = sai->sin_port;
+            }
+            else if(ss->ss_family == AF_INET6)
+            {
+                const sockaddr_in6* sai6 = (const sockaddr_in6*)ss;
+                memcpy(addr, &sai6->sin6_addr, 16);
+                port = sai6->sin6_port;
+            }
+        }
+
+        bool operator==(const ConnectionKey& k) const { return (addr[0] == k.addr[0] && addr[1] == k.addr[1] && port == k.port); }
+        bool operator!=(const ConnectionKey& k) const { return !(*this == k); }
+        const bool isValid() const { return (addr[0] != 0 || addr[1] != 0 || port != 0); }
+
+        uint64_t addr[2] = { 0, 0 }; // network byte order
+        uint16_t port = 0; // network byte order
+    };
+
+    /// multiply-xorshift mix of the 144 key bits (MurmurHash3's 64 bit finalizer)
+    struct ConnectionKeyHash
+    {
+        size_t operator()(const ConnectionKey& k) const
+        {
+            uint64_t h = k.addr[0] ^ (k.addr[1] * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)k.port * 0xC2B2AE3D27D4EB4FULL);
+            h ^= h >> 33;
+            h *= 0xFF51AFD7ED558CCDULL;
+            h ^= h >> 33;
+            h *= 0xC4CEB9FE1A85EC53ULL;
+            h ^= h >> 33;
+            return (size_t)h;
+        }
+    };
+}
+
+#endif // CONNECTIONKEY_H_INCLUDED
@@ -2,34 +2,47 @@
 #define DATAGRAM_H_INCLUDED
 
 #include "common/types.h"
+#include "common/MemoryPool.h"
+#include "net/ReceiveWindow.h"
+#include <memory>
 #include <stdio.h>
 
 namespace CGameEngine
 {
     class NetConnection;
 
-    struct Datagram
+    /// \NOTE: data is MemoryPool owned, never delete[] it (use poolBuffer()/poolRelease() if replacing it)
+    struct Datagram : public PoolAllocated
     {
         uint16_t op_code = 0;
         uint32_t senderUniqID = 0;
-        uint64_t timestamp = 0;
+        uint64_t timestamp = 0; // sender's Time::nowMS() (wall clock) from the packet header, for a sequence its first fragment to arrive
         int dataLength = 0;
         unsigned char* data = nullptr;
         NetConnection* netCon = nullptr; // save the network connection source (if applicable)
+        std::shared_ptr<ReceiveWindow> window; // charged by the connection that handed it over, credited on destruction
+        uint32_t windowBytes = 0;
 
         Datagram() {}
-        Datagram(uint16_t opCode, int bufferSize) : op_code(opCode), dataLength(bufferSize), data(new unsigned char[dataLength]) {}
+        Datagram(uint16_t opCode, int bufferSize) : op_code(opCode), dataLength(bufferSize), data(poolBuffer(dataLength)) {}
         Datagram(uint16_t opCode, uint32_t uniqID, uint64_t arrival = 0) : op_code(opCode), senderUniqID(uniqID), timestamp(arrival) {}
         Datagram(uint16_t opCode, uint32_t uniqID, unsigned char* d, int len, uint64_t arrival = 0, NetConnection* nc = nullptr) :
             op_code(opCode), senderUniqID(uniqID), dataLength(len)
         {
-            safeDeleteArray(data);
-            data = new unsigned char[len];
+            data = poolBuffer(len);
             memcpy(data, d, len);
             timestamp = arrival;
             netCon = nc;
         }
 
+        Datagram(uint16_t opCode, uint32_t uniqID, unsigned char** d, int len, uint64_t arrival = 0, NetConnection* nc = nullptr) :
+            op_code(opCode), senderUniqID(uniqID), timestamp(arrival), dataLength(len), netCon(nc)
+        {
+            // take ownership, must be a poolBuffer()
+            data = *d;
+            *d = nullptr;
+        }
+
         Datagram(const Datagram& dg) : Datagram(dg.op_code, dg.dataLength) { copy(*this, dg); } // copy constructor
         Datagram(Datagram&& dg) noexcept : Datagram(dg.op_code, dg.dataLength) { swap(*this, dg); } // move constructor
         Datagram& operator=(const Datagram& dg) { copy(*this, dg); return *this; } // copy assignment
@@ -55,12 +68,15 @@ namespace CGameEngine
                 swap(dst.dataLength, src.dataLength);
                 swap(dst.data, src.data); //src.data = nullptr;
                 swap(dst.netCon, src.netCon); //src.netCon = nullptr;
+                swap(dst.window, src.window);
+                swap(dst.windowBytes, src.windowBytes);
             }
         }
 
         ~Datagram() noexcept
         {
-            safeDeleteArray(data);
+            poolRelease(data);
+            if(window) { window->credit(windowBytes); }
             netCon = nullptr;
             op_code = 0;
             timestamp = 0;
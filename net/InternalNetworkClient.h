@@ -12,7 +12,7 @@ namespace CGameEngine
             InternalNetworkClient(SoftwareVersion* swv, uint16_t srcPort, std::string srcHostname, SafeQueue<Datagram*>* dgbuff, uint16_t dstPort, std::string dstHostname = "");
             ~InternalNetworkClient() {}
 
-            bool isPacketValid(Packet* p, sockaddr_storage* sender = nullptr) override { /*return (!p->isDamaged());*/ return true; }
+            bool isPacketValid(const PacketView& p, sockaddr_storage* sender = nullptr) override { /*return (!p.isDamaged());*/ return true; }
     };
 }
 
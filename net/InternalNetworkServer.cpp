@@ -26,7 +26,7 @@ namespace CGameEngine
 
         // start thread loops
         m_sendThread = new std::thread(startSendLoop, this); // send processing
-        m_listenThread = new std::thread(NetworkServer::startListenLoop, this); // network (tcp/udp) listen thread
+        startListening(); // listen thread, or the shared Reactor
         m_updateThread = new std::thread(NetworkServer::startUpdateLoop, this); // all network traffic update loop
 
        Logger::getInstance().Log(Logs::INFO, Logs::Network, "InternalNetworkServer::InternalNetworkServer()", "Started threads with srcAddress \033[1m{}", getIPString((struct sockaddr_storage*)m_srcAddress->ai_addr));
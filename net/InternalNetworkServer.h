@@ -11,7 +11,7 @@ namespace CGameEngine
             InternalNetworkServer(SoftwareVersion* swv, uint16_t srcPort, SafeQueue<Datagram*>* dgbuff, std::string hostname = "");
             ~InternalNetworkServer() {}
 
-            bool isPacketValid(Packet* p, sockaddr_storage* sender = nullptr) override { /*return (!p->isDamaged());*/ return true; }
+            bool isPacketValid(const PacketView& p, sockaddr_storage* sender = nullptr) override { /*return (!p.isDamaged());*/ return true; }
     };
 }
 
@@ -4,6 +4,102 @@
 
 namespace CGameEngine
 {
+    /// ReceiveRing ///////////////////////////////////////////////////////////
+
+    ReceiveRing::ReceiveRing(uint16_t slots, uint32_t slotSize) : size(slots), slotSize(slotSize)
+    {
+        if(size == 0) { size = 1; }
+        buffers = new unsigned char*[size];
+        lengths = new int[size];
+        senders = new struct sockaddr_storage[size];
+        for(uint16_t i = 0; i < size; i++) { buffers[i] = poolBuffer(slotSize); lengths[i] = 0; }
+
+        #if PLATFORM == PLATFORM_LINUX
+            iovecs = new struct iovec[size];
+            headers = new struct mmsghdr[size];
+            memset(headers, 0, sizeof(struct mmsghdr) * size);
+            for(uint16_t i = 0; i < size; i++)
+            {
+                iovecs[i].iov_base = buffers[i];
+                iovecs[i].iov_len = slotSize;
+                headers[i].msg_hdr.msg_iov = &iovecs[i];
+                headers[i].msg_hdr.msg_iovlen = 1;
+                headers[i].msg_hdr.msg_name = &senders[i];
+            }
+        #endif
+    }
+
+    ReceiveRing::~ReceiveRing()
+    {
+        for(uint16_t i = 0; i < size; i++) { poolRelease(buffers[i]); }
+        safeDeleteArray(buffers);
+        safeDeleteArray(lengths);
+        safeDeleteArray(senders);
+        #if PLATFORM == PLATFORM_LINUX
+            safeDeleteArray(iovecs);
+            safeDeleteArray(headers);
+        #endif
+    }
+
+    unsigned char* ReceiveRing::release(uint16_t slot)
+    {
+        if(slot >= size) { return nullptr; }
+        unsigned char* retVal = buffers[slot];
+        buffers[slot] = poolBuffer(slotSize);
+        #if PLATFORM == PLATFORM_LINUX
+            iovecs[slot].iov_base = buffers[slot];
+        #endif
+        return retVal;
+    }
+
+    /// SendBatch /////////////////////////////////////////////////////////////
+
+    SendBatch::SendBatch(uint16_t slots) : size(slots)
+    {
+        if(size == 0) { size = 1; }
+        destinations = new const sockaddr_storage*[size];
+        data = new unsigned char*[size];
+        lengths = new uint32_t[size];
+        for(uint16_t i = 0; i < size; i++) { destinations[i] = nullptr; data[i] = nullptr; lengths[i] = 0; }
+
+        #if PLATFORM == PLATFORM_LINUX
+            iovecs = new struct iovec[size];
+            headers = new struct mmsghdr[size];
+            memset(headers, 0, sizeof(struct mmsghdr) * size);
+            for(uint16_t i = 0; i < size; i++)
+            {
+                headers[i].msg_hdr.msg_iov = &iovecs[i];
+                headers[i].msg_hdr.msg_iovlen = 1;
+            }
+        #endif
+    }
+
+    SendBatch::~SendBatch()
+    {
+        safeDeleteArray(destinations);
+        safeDeleteArray(data);
+        safeDeleteArray(lengths);
+        #if PLATFORM == PLATFORM_LINUX
+            safeDeleteArray(iovecs);
+            safeDeleteArray(headers);
+        #endif
+    }
+
+    void SendBatch::set(uint16_t slot, const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size)
+    {
+        if(slot >= size) { return; }
+        destinations[slot] = destination;
+        data[slot] = packet_data;
+        lengths[slot] = packet_size;
+
+        #if PLATFORM == PLATFORM_LINUX
+            iovecs[slot].iov_base = packet_data;
+            iovecs[slot].iov_len = packet_size;
+            headers[slot].msg_hdr.msg_name = (void*)destination;
+            headers[slot].msg_hdr.msg_namelen = (destination && destination->ss_family == AF_INET6) ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+        #endif
+    }
+
     /// NetSocket ////////////////////////////////////////////////////////////////
 
     /// START TCP ONLY! /////
@@ -84,6 +180,30 @@ namespace CGameEngine
         return true;
     }
 
+    // sends slots [offset, offset+count) with as few syscalls as possible, returns the number accepted by the kernel (-1 on error)
+    int NetSocket::sendBatch(SendBatch& batch, uint16_t count, uint16_t offset /*= 0*/)
+    {
+        if(m_fd <= 0 || count == 0 || offset+count > batch.size) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::sendBatch()" ,"Generic error"); return -1; }
+
+        #if PLATFORM == PLATFORM_LINUX
+            if(!m_isTCP)
+            {
+                int sent = sendmmsg(m_fd, &batch.headers[offset], count, MSG_DONTWAIT);
+                if(sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetSocket::sendBatch()", "sendmmsg() failed, errno [{}].", errno); }
+                return sent;
+            }
+        #endif
+
+        // no sendmmsg(), fall back to one send per slot
+        int sent = 0;
+        for(uint16_t i = offset; i < offset+count; i++)
+        {
+            if(!sendData(batch.destinations[i], batch.data[i], batch.lengths[i])) { break; }
+            sent++;
+        }
+        return (sent > 0) ? sent : -1;
+    }
+
     bool NetSocket::broadcastSend(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size)
     {
         // enable broadcast
@@ -146,6 +266,32 @@ namespace CGameEngine
         return bytes;
     }
 
+    // drains up to ring.size datagrams in a single syscall, returns the number received (-1 on error)
+    int NetSocket::receiveBatch(ReceiveRing& ring, int fd /*= -1*/)
+    {
+        if(fd <= 0) { fd = m_fd; }
+        if(m_isTCP) { ring.lengths[0] = receive(&ring.senders[0], ring.buffers[0], fd); return (ring.lengths[0] > 0) ? 1 : ring.lengths[0]; }
+
+        #if PLATFORM == PLATFORM_LINUX
+            // kernel overwrites msg_namelen per call, so reset before each pickup
+            for(uint16_t i = 0; i < ring.size; i++) { ring.headers[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage); }
+
+            int count = recvmmsg(fd, ring.headers, ring.size, MSG_DONTWAIT, nullptr);
+            for(int i = 0; i < count; i++) { ring.lengths[i] = ring.headers[i].msg_len; }
+            return count;
+        #else
+            // no recvmmsg(), fall back to one recvfrom() per slot until the socket runs dry
+            int count = 0;
+            while(count < ring.size)
+            {
+                ring.lengths[count] = receive(&ring.senders[count], ring.buffers[count], fd);
+                if(ring.lengths[count] <= 0) { break; }
+                count++;
+            }
+            return (count > 0) ? count : -1;
+        #endif
+    }
+
     void NetSocket::closeSocket()
     {
         //flush errors, pre closing
@@ -170,9 +316,55 @@ namespace CGameEngine
         m_hasAccepted = false;
     }
 
+    bool NetSocket::adopt(int fd)
+    {
+        if(fd < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::adopt()", "Passed an invalid fd!"); return false; }
+        if(m_fd != -1) { closeSocket(); }
+
+        #if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_LINUX
+            int flags = fcntl(fd, F_GETFL, 0);
+            if(flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+            {
+               Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::adopt()", "[Linux] Failed to set non-blocking on fd [{}]!", fd);
+                return false;
+            }
+        #endif
+
+        m_fd = fd;
+        m_isTCP = false;
+        m_type = SocketType::NetSocket;
+        return true;
+    }
+
+    int NetSocket::openConnected(addrinfo* local, const sockaddr_storage* peer)
+    {
+        if(!local || !peer) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::openConnected()", "Passed nullptr for local or peer!"); return -1; }
+
+        #if PLATFORM == PLATFORM_LINUX
+            int fd = socket(local->ai_family, local->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, local->ai_protocol);
+            if(fd < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::openConnected()", "Failed to create socket, errno [{}].", errno); return -1; }
+
+            // same port as the listener, which has to have SO_REUSEPORT set as well
+            int opt = 1;
+            socklen_t peerLength = (peer->ss_family == AF_INET6) ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+            if(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1
+                || bind(fd, local->ai_addr, local->ai_addrlen) == -1
+                || connect(fd, (const struct sockaddr*)peer, peerLength) == -1)
+            {
+               Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::openConnected()", "Failed to bind / connect next to the listener, errno [{}].", errno);
+                close(fd);
+                return -1;
+            }
+            return fd;
+        #else
+            Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::openConnected()", "Connected UDP sockets on a shared port are Linux only!");
+            return -1;
+        #endif
+    }
+
     /// NetSocket private functions ///////////////////////////////////////////
 
-    bool NetSocket::open(addrinfo* addr, bool noBind /*= false*/)
+    bool NetSocket::open(addrinfo* addr, bool noBind /*= false*/, bool reusePort /*= false*/)
     {
 		Logger::getInstance().Log(Logs::DEBUG, "NetSocket::open()", "Starting NetSocket open");
 
@@ -192,6 +384,14 @@ namespace CGameEngine
         // if UDP or TCP-server
         if(!m_isTCP || (m_isTCP && !noBind))
         {
+            // share the port with sibling sockets, must be set before bind()
+            if(reusePort && !setReusePort(true))
+            {
+                closeSocket();
+                m_fd = -1; // failed
+                return false;
+            }
+
             if(bindVal = bind(m_fd, addr->ai_addr, addr->ai_addrlen) < 0)
             {
                Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::open()", "Failed to bind socket, returned [{}]", bindVal);
@@ -242,4 +442,17 @@ namespace CGameEngine
         if(err == -1) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::setBroadcast()", "Setting SO_BROADCAST to NetSocket handle [{}] failed!", m_fd); return false; }
         else { return true; }
     }
+
+    bool NetSocket::setReusePort(bool val)
+    {
+        #if defined(SO_REUSEPORT)
+            int opt = (val) ? 1 : 0; socklen_t len = sizeof(opt);
+            int err = setsockopt(m_fd, SOL_SOCKET, SO_REUSEPORT, &opt, len);
+            if(err == -1) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::setReusePort()", "Setting SO_REUSEPORT to NetSocket handle [{}] failed!", m_fd); return false; }
+            else { return true; }
+        #else
+            Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetSocket::setReusePort()", "SO_REUSEPORT is not supported on this platform!");
+            return false;
+        #endif
+    }
 }
@@ -2,27 +2,137 @@
 #define NETSOCKET_H
 
 #include "net/Socket.h"
+#include <atomic>
+
+#if PLATFORM == PLATFORM_LINUX
+    #include <sys/socket.h> // recvmmsg(), mmsghdr
+    #include <sys/uio.h> // iovec
+    #include <cerrno>
+#endif
+
+#define BATCH_STAT_BUCKETS 8 // 1, 2-3, 4-7, 8-15, 16-31, 32-63, 64-127, 128+
+
+/*
+    Ref:
+        http://man7.org/linux/man-pages/man2/recvmmsg.2.html
+            recvmmsg : receive multiple datagrams with a single syscall
+        http://man7.org/linux/man-pages/man2/sendmmsg.2.html
+            sendmmsg : send multiple datagrams with a single syscall
+        http://man7.org/linux/man-pages/man7/socket.7.html
+            SO_REUSEPORT : several sockets share one port, the kernel spreads datagrams by 4-tuple hash
+        http://man7.org/linux/man-pages/man7/udp.7.html
+            connect() : a connected UDP socket only receives from its peer, and takes that peer's
+                        datagrams from a wildcard socket on the same port (Linux 5.2+ with SO_REUSEPORT)
+*/
 
 namespace CGameEngine
 {
+    /// plain snapshot of the batch counters, safe to hand out to other threads
+    struct BatchStats
+    {
+        uint64_t calls = 0; // syscalls issued
+        uint64_t packets = 0; // datagrams moved across all calls
+        uint32_t largest = 0; // most datagrams moved by a single call
+        uint64_t buckets[BATCH_STAT_BUCKETS] = {0}; // calls bucketed by datagrams moved (powers of 2)
+        const float average() const { return (calls > 0) ? (float)packets / (float)calls : 0.0f; }
+    };
+
+    /// counters recording how many datagrams each batched syscall moved
+    struct BatchCounters
+    {
+        void record(uint32_t count)
+        {
+            if(count == 0) { return; }
+            calls.fetch_add(1, std::memory_order_relaxed);
+            packets.fetch_add(count, std::memory_order_relaxed);
+
+            uint8_t bucket = 0;
+            while((count >> (bucket+1)) > 0 && bucket < BATCH_STAT_BUCKETS-1) { bucket++; }
+            buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+            uint32_t prev = largest.load(std::memory_order_relaxed);
+            while(count > prev && !largest.compare_exchange_weak(prev, count, std::memory_order_relaxed)) {}
+        }
+
+        BatchStats snapshot() const
+        {
+            BatchStats retVal;
+            retVal.calls = calls.load(std::memory_order_relaxed);
+            retVal.packets = packets.load(std::memory_order_relaxed);
+            retVal.largest = largest.load(std::memory_order_relaxed);
+            for(int i = 0; i < BATCH_STAT_BUCKETS; i++) { retVal.buckets[i] = buckets[i].load(std::memory_order_relaxed); }
+            return retVal;
+        }
+
+        std::atomic<uint64_t> calls { 0 };
+        std::atomic<uint64_t> packets { 0 };
+        std::atomic<uint32_t> largest { 0 };
+        std::atomic<uint64_t> buckets[BATCH_STAT_BUCKETS] = {};
+    };
+
+    /// preallocated receive slots handed to NetSocket::receiveBatch(), reused every call
+    struct ReceiveRing
+    {
+        ReceiveRing(uint16_t slots, uint32_t slotSize);
+        ~ReceiveRing();
+        ReceiveRing(const ReceiveRing& r) = delete;
+        ReceiveRing& operator=(const ReceiveRing& r) = delete;
+        unsigned char* release(uint16_t slot); // hand off a slot's buffer, the slot gets a fresh one
+
+        uint16_t size = 0; // number of slots
+        uint32_t slotSize = 0; // bytes per slot
+        unsigned char** buffers = nullptr; // one PACKET_MAX_SIZE buffer per slot
+        int* lengths = nullptr; // bytes received per slot, valid for [0, count) after receiveBatch()
+        struct sockaddr_storage* senders = nullptr;
+        #if PLATFORM == PLATFORM_LINUX
+            struct iovec* iovecs = nullptr;
+            struct mmsghdr* headers = nullptr;
+        #endif
+    };
+
+    /// preallocated send slots for NetSocket::sendBatch(), filled via set() then flushed together
+    struct SendBatch
+    {
+        SendBatch(uint16_t slots);
+        ~SendBatch();
+        SendBatch(const SendBatch& r) = delete;
+        SendBatch& operator=(const SendBatch& r) = delete;
+        void set(uint16_t slot, const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size);
+
+        uint16_t size = 0; // number of slots
+        const sockaddr_storage** destinations = nullptr;
+        unsigned char** data = nullptr;
+        uint32_t* lengths = nullptr;
+        #if PLATFORM == PLATFORM_LINUX
+            struct iovec* iovecs = nullptr;
+            struct mmsghdr* headers = nullptr;
+        #endif
+    };
+
     class NetSocket : public Socket
     {
         /// \TODO: Break TCP out into it's own setup
         public:
             NetSocket() {}
-            NetSocket(addrinfo* addr, bool tcp = false, bool noBind = false) : m_isTCP(tcp) { open(addr, noBind); }
-            ~NetSocket() { closeSocket(); }
-            void closeSocket();
+            NetSocket(addrinfo* addr, bool tcp = false, bool noBind = false, bool reusePort = false) : m_isTCP(tcp) { open(addr, noBind, reusePort); }
+            virtual ~NetSocket() { closeSocket(); }
+            /// \NOTE: Virtual so NetworkSimulator can stand in for the kernel (SimSocket)
+            virtual void closeSocket();
             //bool isConnected();
             //bool tryAcceptConnection();
             //bool tryConnect(const sockaddr_storage* dest);
-            bool sendData(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size);
-            bool broadcastSend(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size);
-            int receive(struct sockaddr_storage* sender, unsigned char* buffer, int fd = -1);
+            virtual bool sendData(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size);
+            virtual int sendBatch(SendBatch& batch, uint16_t count, uint16_t offset = 0);
+            virtual bool broadcastSend(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size);
+            virtual int receive(struct sockaddr_storage* sender, unsigned char* buffer, int fd = -1);
+            virtual int receiveBatch(ReceiveRing& ring, int fd = -1);
             const int& getRemoteFD() const { return m_remoteFD; }
+            bool adopt(int fd); // take over an open UDP socket (see openConnected()), closed with this NetSocket
+            static int openConnected(addrinfo* local, const sockaddr_storage* peer); // bound next to a SO_REUSEPORT listener, -1 on failure, the caller owns the fd
 
         private:
-            bool open(addrinfo* addr, bool noBind = false);
+            bool open(addrinfo* addr, bool noBind = false, bool reusePort = false);
+            bool setReusePort(bool val);
             bool setBroadcast(bool val);
 
             // TCP SPECIFIC
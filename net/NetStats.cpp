@@ -0,0 +1,135 @@
+#include "net/NetStats.h"
+#include "srv/Time.h"
+#include <algorithm> // sort
+#include <utility> // pair
+
+namespace CGameEngine
+{
+    /// NetStatsSnapshot //////////////////////////////////////////////////////
+
+    const double NetStatsSnapshot::rate(uint8_t counter, const NetStatsSnapshot& earlier) const
+    {
+        if(counter >= NetCounter::END || timeUS <= earlier.timeUS || counters[counter] < earlier.counters[counter]) { return 0.0; }
+        return (double)(counters[counter] - earlier.counters[counter]) * 1000000.0 / (double)(timeUS - earlier.timeUS);
+    }
+
+    std::string NetStatsSnapshot::toString(const NetStatsSnapshot* earlier /*= nullptr*/) const
+    {
+        std::string retVal;
+        for(uint8_t i = 0; i < NetCounter::END; i++)
+        {
+            retVal += fmt::format("{:<24}{:>14}", counterName(i), counters[i]);
+            if(earlier) { retVal += fmt::format("{:>14.1f}/s", rate(i, *earlier)); }
+            retVal += "\n";
+        }
+        for(uint8_t i = 0; i < NetGauge::END; i++) { retVal += fmt::format("{:<24}{:>14}\n", gaugeName(i), gauges[i]); }
+        for(uint8_t i = 0; i < NetHistogram::END; i++)
+        {
+            const HistogramSnapshot& h = histograms[i];
+            retVal += fmt::format("{:<24}{:>14} samples, min {} / mean {:.1f} / p50 {} / p99 {} / max {}\n", histogramName(i), h.count, h.min, h.mean(), h.percentile(50.0), h.percentile(99.0), h.max);
+        }
+        return retVal;
+    }
+
+    const char* NetStatsSnapshot::counterName(uint8_t counter)
+    {
+        static const char* names[NetCounter::END] = {
+            "PacketsReceived", "BytesReceived", "PacketsSent", "BytesSent",
+            "PacketsInvalid", "PacketsDamaged",
+            "FragmentsResent", "RetryRequestsSent", "RetryRequestsReceived", "SelectiveAcksSent", "SelectiveAcksReceived",
+            "SequencesCompleted", "SequencesFailed", "SequencesExpired",
+            "MessagesDelivered", "MessagesDropped",
+            "WindowUpdatesSent",
+            "ReceiveQueueDrops", "SendQueueStalls" };
+        return (counter < NetCounter::END) ? names[counter] : "?";
+    }
+
+    const char* NetStatsSnapshot::gaugeName(uint8_t gauge)
+    {
+        static const char* names[NetGauge::END] = { "Connections", "ReceiveQueue", "SendQueue", "StoredSequences", "UndeliveredMessages", "UndeliveredBytes" };
+        return (gauge < NetGauge::END) ? names[gauge] : "?";
+    }
+
+    const char* NetStatsSnapshot::histogramName(uint8_t histogram)
+    {
+        static const char* names[NetHistogram::END] = { "DeliveryLatencyUS", "RttUS", "MessageBytes", "SequenceAssemblyMS" };
+        return (histogram < NetHistogram::END) ? names[histogram] : "?";
+    }
+
+    /// NetStats //////////////////////////////////////////////////////////////
+
+    std::vector<NetTraceEvent> NetStats::getTrace() const
+    {
+        std::vector<std::pair<uint64_t, NetTraceEvent>> events;
+        events.reserve(m_trace.size());
+        for(size_t i = 0; i < m_trace.size(); i++)
+        {
+            const TraceSlot& slot = m_trace[i];
+            uint64_t before = slot.version.load(std::memory_order_acquire);
+            if(before == 0 || (before & 1)) { continue; } // empty, or a writer is in it
+            NetTraceEvent e = slot.event;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(slot.version.load(std::memory_order_relaxed) != before) { continue; }
+            events.push_back(std::make_pair(before, e));
+        }
+
+        // versions grow with every event written, whatever slot it landed in
+        std::sort(events.begin(), events.end(), [](const std::pair<uint64_t, NetTraceEvent>& a, const std::pair<uint64_t, NetTraceEvent>& b) { return a.first < b.first; });
+        std::vector<NetTraceEvent> retVal;
+        retVal.reserve(events.size());
+        for(size_t i = 0; i < events.size(); i++) { retVal.push_back(events[i].second); }
+        return retVal;
+    }
+
+    NetStatsSnapshot NetStats::snapshot() const
+    {
+        NetStatsSnapshot retVal;
+        retVal.timeUS = Time::getInstance().steadyUS();
+        for(uint32_t s = 0; s < NET_STATS_SHARDS; s++)
+        {
+            for(uint8_t i = 0; i < NetCounter::END; i++) { retVal.counters[i] += m_shards[s].counters.get(i); }
+        }
+        for(uint8_t i = 0; i < NetHistogram::END; i++) { retVal.histograms[i] = m_histograms[i].snapshot(); }
+        return retVal;
+    }
+
+    void NetStats::reset()
+    {
+        for(uint32_t s = 0; s < NET_STATS_SHARDS; s++)
+        {
+            for(uint8_t i = 0; i < NetCounter::END; i++) { m_shards[s].counters.values[i].store(0, std::memory_order_relaxed); }
+        }
+        for(uint8_t i = 0; i < NetHistogram::END; i++) { m_histograms[i].reset(); }
+    }
+
+    const char* NetStats::traceName(uint8_t type)
+    {
+        static const char* names[NetTrace::END] = { "None", "Received", "Sent", "Resent", "RetryRequested", "SequenceCompleted", "SequenceFailed", "SequenceExpired", "Delivered", "Dropped" };
+        return (type < NetTrace::END) ? names[type] : "?";
+    }
+
+    /// NetStats private functions ////////////////////////////////////////////
+
+    uint32_t NetStats::shardIndex()
+    {
+        // handed out once per thread, threads beyond NET_STATS_SHARDS share
+        static std::atomic<uint32_t> next { 0 };
+        static thread_local uint32_t index = next.fetch_add(1, std::memory_order_relaxed) & (NET_STATS_SHARDS - 1);
+        return index;
+    }
+
+    void NetStats::traceEvent(uint8_t type, uint16_t opCode, uint32_t seqID, uint32_t pktNum, uint32_t bytes)
+    {
+        uint64_t ticket = m_traceHead.fetch_add(1, std::memory_order_relaxed);
+        TraceSlot& slot = m_trace[ticket & (NET_TRACE_EVENTS - 1)];
+        slot.version.store(ticket * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.event.timeUS = Time::getInstance().steadyUS();
+        slot.event.seqID = seqID;
+        slot.event.pktNum = pktNum;
+        slot.event.bytes = bytes;
+        slot.event.opCode = opCode;
+        slot.event.type = type;
+        slot.version.store(ticket * 2 + 2, std::memory_order_release);
+    }
+}
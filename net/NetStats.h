@@ -0,0 +1,129 @@
+#ifndef NETSTATS_H_INCLUDED
+#define NETSTATS_H_INCLUDED
+
+#include "common/types.h"
+#include "common/Histogram.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+/*
+    Counters, histograms and a trace ring for one Network, recorded from its listen, send and
+    update threads and whichever user threads call send():
+        - counters are spread over NET_STATS_SHARDS copies, each thread adds to its own (picked
+          once per thread), so recording is a relaxed fetch_add on a line no other thread writes
+        - histograms are the lock-free common/Histogram
+        - tracing is off by default, when on every event is also written to a ring of the last
+          NET_TRACE_EVENTS, a flight recorder to dump after something went wrong
+    snapshot() sums the shards, gauges (queue depths) are filled in by Network::getStatsSnapshot().
+    Two snapshots give rates, NetStatsSnapshot::toString() formats one for the log.
+*/
+
+#define NET_STATS_SHARDS 8 // power of two
+#define NET_TRACE_EVENTS 4096 // power of two
+
+namespace NetCounter
+{
+    enum FORMS
+    {
+        PacketsReceived, BytesReceived, PacketsSent, BytesSent,
+        PacketsInvalid, // wrong identifier / version, or too short
+        PacketsDamaged, // fragment payload failed its header's checks
+        FragmentsResent, RetryRequestsSent, RetryRequestsReceived, SelectiveAcksSent, SelectiveAcksReceived,
+        SequencesCompleted, SequencesFailed, SequencesExpired, // failed = assembled but the CRC did not match
+        MessagesDelivered, MessagesDropped, // handed to the user, or dropped by a full receive window
+        WindowUpdatesSent,
+        ReceiveQueueDrops, SendQueueStalls, // kept by Network, copied in by getStatsSnapshot()
+        END
+    };
+}
+
+namespace NetGauge { enum FORMS { Connections, ReceiveQueue, SendQueue, StoredSequences, UndeliveredMessages, UndeliveredBytes, END }; }
+namespace NetHistogram { enum FORMS { DeliveryLatencyUS, RttUS, MessageBytes, SequenceAssemblyMS, END }; }
+namespace NetTrace { enum FORMS { NONE, Received, Sent, Resent, RetryRequested, SequenceCompleted, SequenceFailed, SequenceExpired, Delivered, Dropped, END }; }
+
+namespace CGameEngine
+{
+    /// one counter per NetCounter, single writer or shared
+    struct NetCounters
+    {
+        std::atomic<uint64_t> values[NetCounter::END];
+        NetCounters() { for(uint8_t i = 0; i < NetCounter::END; i++) { values[i].store(0, std::memory_order_relaxed); } }
+        void add(uint8_t counter, uint64_t n = 1) { values[counter].fetch_add(n, std::memory_order_relaxed); }
+        const uint64_t get(uint8_t counter) const { return values[counter].load(std::memory_order_relaxed); }
+    };
+
+    struct NetTraceEvent
+    {
+        uint64_t timeUS = 0; // Time::steadyUS()
+        uint32_t seqID = 0;
+        uint32_t pktNum = 0;
+        uint32_t bytes = 0;
+        uint16_t opCode = 0;
+        uint8_t type = NetTrace::NONE;
+    };
+
+    /// plain copy of a NetStats, safe to keep and compare
+    struct NetStatsSnapshot
+    {
+        uint64_t timeUS = 0;
+        uint64_t counters[NetCounter::END] = { 0 };
+        uint64_t gauges[NetGauge::END] = { 0 };
+        HistogramSnapshot histograms[NetHistogram::END];
+
+        const double rate(uint8_t counter, const NetStatsSnapshot& earlier) const; // per second since 'earlier'
+        std::string toString(const NetStatsSnapshot* earlier = nullptr) const; // multi-line, with rates if 'earlier' is given
+        static const char* counterName(uint8_t counter);
+        static const char* gaugeName(uint8_t gauge);
+        static const char* histogramName(uint8_t histogram);
+    };
+
+    class NetStats
+    {
+        public:
+            NetStats() : m_trace(NET_TRACE_EVENTS) {}
+            NetStats(const NetStats& ns) = delete;
+            NetStats& operator=(const NetStats& ns) = delete;
+
+            void add(uint8_t counter, uint64_t n = 1) { m_shards[shardIndex()].counters.add(counter, n); }
+            void record(uint8_t histogram, uint64_t value) { m_histograms[histogram].record(value); }
+            void trace(uint8_t type, uint16_t opCode, uint32_t seqID = 0, uint32_t pktNum = 0, uint32_t bytes = 0)
+            {
+                if(m_tracing.load(std::memory_order_relaxed)) { traceEvent(type, opCode, seqID, pktNum, bytes); }
+            }
+
+            void setTracing(bool val = true) { m_tracing.store(val, std::memory_order_relaxed); }
+            const bool isTracing() const { return m_tracing.load(std::memory_order_relaxed); }
+            std::vector<NetTraceEvent> getTrace() const; // oldest first, events being written right now are skipped
+            NetStatsSnapshot snapshot() const; // counters and histograms, gauges are left at 0
+            void reset(); // not atomic as a whole
+
+            static const char* traceName(uint8_t type);
+
+        private:
+            /// one thread's counters, padded so no two shards share a cache line
+            struct Shard
+            {
+                NetCounters counters;
+                char padding[64];
+            };
+
+            /// seqlock slot, odd while being written
+            struct TraceSlot
+            {
+                std::atomic<uint64_t> version { 0 };
+                NetTraceEvent event;
+            };
+
+            static uint32_t shardIndex();
+            void traceEvent(uint8_t type, uint16_t opCode, uint32_t seqID, uint32_t pktNum, uint32_t bytes);
+
+            Shard m_shards[NET_STATS_SHARDS];
+            Histogram m_histograms[NetHistogram::END];
+            std::atomic<bool> m_tracing { false };
+            std::atomic<uint64_t> m_traceHead { 0 };
+            std::vector<TraceSlot> m_trace;
+    };
+}
+
+#endif // NETSTATS_H_INCLUDED
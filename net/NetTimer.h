@@ -0,0 +1,35 @@
+#ifndef NETTIMER_H_INCLUDED
+#define NETTIMER_H_INCLUDED
+
+#include "common/types.h"
+#include "common/TimerWheel.h"
+
+#define NET_TIMER_TICK_MS 10 // resolution of Network's timer wheel
+#define NET_CONNECTION_IDLE_MS 15000 // connection is lost after this long without traffic
+#define NET_RETIRED_SEQUENCE_MS 5000 // finished sequence IDs are remembered this long, so late fragments are dropped
+#define NET_CLOSED_CONNECTION_MS 6000 // 'recently closed' entries live 5-6s (stored in seconds)
+#define NET_STORED_SEQUENCE_MS 3000 // reliable sends are kept for retransmission this long after they last left
+#define NET_STORED_SEQUENCE_MAX_MS 30000 // and never longer than this after send(), however long they sat queued or paced
+#define NET_ORDERED_GAP_MS (NET_STORED_SEQUENCE_MAX_MS + NET_STORED_SEQUENCE_MS) // a reliable-ordered message missing this long is skipped, its sender has given up on it and its last copy had time to land
+#define NET_RTT_PROBE_MS 1000 // timestamped keepalive interval, keeps the RTT estimate fresh on quiet connections
+#define NET_HANDOFF_RETRY_MS 50 // a handoff waiting on unacked reliable sends looks again this often
+#define NET_HANDOFF_MAX_WAIT_MS 5000 // and gives up after this, the connection stays where it is
+
+namespace NetTimerType { enum FORMS { NONE, ConnectionIdle, ConnectionClose, SequenceDeadline, SequenceRetired, RetryRequest, StoredSequence, StoredResend, ClosedConnections, RttProbe, OrderedGap, WindowUpdate, HandoffRetry, END }; }
+
+namespace CGameEngine
+{
+    class Connection;
+
+    /// payload of Network's timer wheel, conn is null for network wide timers
+    struct NetTimer
+    {
+        NetTimer() {} // wheel slot
+        NetTimer(uint8_t timerType, uint32_t seq_ID = 0, Connection* connection = nullptr) : type(timerType), seqID(seq_ID), conn(connection) {}
+        uint8_t type = NetTimerType::NONE;
+        uint32_t seqID = 0;
+        Connection* conn = nullptr;
+    };
+}
+
+#endif // NETTIMER_H_INCLUDED
@@ -1,4 +1,6 @@
 #include "net/Network.h"
+#include "net/SnapshotChannel.h"
+#include "net/NetworkSimulator.h"
 #include "srv/Security.h"
 
 #include <iostream>
@@ -7,8 +9,8 @@ namespace CGameEngine
 {
     /// Network ///////////////////////////////////////////////////////////////
 
-    Network::Network(SoftwareVersion* swv, uint16_t port, SafeQueue<Datagram*>* dgbuff, std::string hostname /*= ""*/)
-        : m_version(swv), m_srcPort(port), m_datagramBuffer(dgbuff)
+    Network::Network(SoftwareVersion* swv, uint16_t port, SafeQueue<Datagram*>* dgbuff, std::string hostname /*= ""*/, bool reusePort /*= false*/)
+        : m_reusePort(reusePort), m_srcPort(port), m_datagramBuffer(dgbuff), m_version(swv)
     {
         if(!initSockets()) { Logger::getInstance().Log(Logs::FATAL, Logs::Network, "Network::Network()", "[Windows] Networking could NOT be started!"); }
         else
@@ -16,14 +18,17 @@ namespace CGameEngine
             /// \NOTE: Passing port '0' is "use ephemeral ports"
             /// \TODO: Add support for multiple interfaces (bonding?)
             /// \TODO: Add config option to specify interface(s)
-            if(port != 0) { if(!isPortOpen(m_srcPort)) { Logger::getInstance().Log(Logs::FATAL, Logs::Network, "Network::Network()", "Port {} is in use!", m_srcPort); } }
+            /// \NOTE: Shared (SO_REUSEPORT) ports are expected to be bound already, bind() still fails if the owner did not share it
+            NetworkSimulator* sim = NetworkSimulator::getActive();
+            if(port != 0 && !m_reusePort && !sim) { if(!isPortOpen(m_srcPort)) { Logger::getInstance().Log(Logs::FATAL, Logs::Network, "Network::Network()", "Port {} is in use!", m_srcPort); } }
 
             // generate address
             generateAddress(hostname, m_srcPort, &m_srcAddress);
 			Logger::getInstance().Log(Logs::DEBUG, "Network::Network()", "IP: {}", getIPString((struct sockaddr_storage*)m_srcAddress->ai_addr));
 
-            // open socket
-            m_socket = new NetSocket(m_srcAddress);
+            // open socket, an installed simulator stands in for the kernel
+            if(sim) { m_socket = sim->createSocket(m_srcPort); }
+            else { m_socket = new NetSocket(m_srcAddress, false, false, m_reusePort); }
             if(!m_socket->isOpen()) { Logger::getInstance().Log(Logs::FATAL, Logs::Network, "Network::Network()", "Port {} could not be opened!", m_srcPort); }
             m_socketPairs[m_socket->getFD()] = std::make_pair(m_socket, m_datagramBuffer);
 
@@ -45,29 +50,18 @@ namespace CGameEngine
         m_isActive = false;
         m_netListening = false;
         m_isTCP = false;
-        for(SafeUnorderedMap<uint32_t, StoredSequence*>::iterator it = m_storedSequences.begin(); it != m_storedSequences.end(); ++it)
-        {
-            safeDelete(it->second);
-        }
         m_storedSequences.clear();
 
-        if(m_listenThread)
-        {
-            while(!m_listenThread->joinable()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::shutdownSockets()", "Listen (Net) Thread is not joinable."); } // waiting...
-            m_listenThread->join();
-            safeDelete(m_listenThread);
-        }
-        if(m_updateThread)
-        {
-            while(!m_updateThread->joinable()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::shutdownSockets()", "Update Thread is not joinable."); } // waiting...
-            m_updateThread->join();
-            safeDelete(m_updateThread);
-        }
-        if(m_sendThread)
+        joinThreads();
+        safeDelete(m_reactorRing);
+
+        // messages that never got their datagram
         {
-            while(!m_sendThread->joinable()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::shutdownSockets()", "Send Thread is not joinable."); } // waiting...
-            m_sendThread->join();
-            safeDelete(m_sendThread);
+            std::lock_guard<std::mutex> lock(m_coalesceMutex);
+            for(std::unordered_map<ConnectionKey, CoalesceBuffer, ConnectionKeyHash>::iterator cit = m_coalesce.begin(); cit != m_coalesce.end(); ++cit) { poolRelease(cit->second.data); }
+            for(size_t i = 0; i < m_coalesceFull.size(); i++) { poolRelease(m_coalesceFull[i].data); }
+            m_coalesce.clear();
+            m_coalesceFull.clear();
         }
 
         #if PLATFORM == PLATFORM_WINDOWS
@@ -87,10 +81,35 @@ namespace CGameEngine
         m_isActive = false;
         m_netListening = false;
         m_pollTimeout = 0;
+        detachReactor();
         m_sendCV.notify_one();
         m_updateCV.notify_one();
     }
 
+    /// safe to call more than once, each shutdownSockets() calls it before touching the queues and connections
+    void Network::joinThreads()
+    {
+        stop();
+        if(m_listenThread)
+        {
+            while(!m_listenThread->joinable()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::joinThreads()", "Listen (Net) Thread is not joinable."); } // waiting...
+            m_listenThread->join();
+            safeDelete(m_listenThread);
+        }
+        if(m_updateThread)
+        {
+            while(!m_updateThread->joinable()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::joinThreads()", "Update Thread is not joinable."); } // waiting...
+            m_updateThread->join();
+            safeDelete(m_updateThread);
+        }
+        if(m_sendThread)
+        {
+            while(!m_sendThread->joinable()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::joinThreads()", "Send Thread is not joinable."); } // waiting...
+            m_sendThread->join();
+            safeDelete(m_sendThread);
+        }
+    }
+
     void Network::generateAddress(const std::string addr, uint16_t port, addrinfo** dst)
     {
         struct addrinfo hints;
@@ -217,9 +236,7 @@ namespace CGameEngine
 
     void Network::listenLoop()
     {
-        unsigned char* buffer = new unsigned char[PACKET_MAX_SIZE];
-        struct sockaddr_storage sender;
-        int bytes_read = 0;
+        ReceiveRing* ring = nullptr;
         int retVal = 0;
 
         // poll()
@@ -232,71 +249,186 @@ namespace CGameEngine
             // if not accepting connections yet, keep skipping
             if(!m_netListening) { continue; }
 
-            // clear buffer and bytes_read, setup sender variable
-            memset(buffer, 0, PACKET_MAX_SIZE);
-            memset(&sender, 0, sizeof(struct sockaddr_storage));
-            bytes_read = 0;
-            retVal = 0;
-
             // actually poll for data
             retVal = poll(ufds, 1, m_pollTimeout); // parse all sockets, all 1 of them, never timeout
 
             if(retVal < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Network::listenLoop()", "poll() returned [{}], this is likely fatal. Stopping loop", retVal); m_isActive = false; }
             //else if(retVal == 0) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::listenLoop()", "poll() timed out without data. This may be bad."); } /// \TODO: Is this important or even accurate?
-            else if(retVal > 0 && ufds[0].revents & POLLIN)
-            {
-                bytes_read = m_socket->receive(&sender, buffer); // read in data
-                if(bytes_read <= PACKET_MIN_RCV_SIZE) { continue; } // catch too small data and abandon
+            else if(retVal > 0 && ufds[0].revents & POLLIN) { drainSocket(ring); }
+        }
 
-                //Logger::getInstance().Log(Logs::DEBUG, "Network::listenLoop()", "--- Network::listenLoop: Bytes Read [{}] ---", bytes_read);
-                Packet* p = new Packet(buffer, bytes_read, Time::getInstance().nowMS());
+        safeDelete(ring);
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "Network::listenLoop()", "Exiting listenLoop().");
+        m_netListening = false;
+        m_isActive = false;
+        m_socket->closeSocket();
+    }
 
-                if(isPacketValid(p, &sender))
-                {
-                    // immediate reply of retry requests
-                    if(p->op_code == OP_RetransmissionRequest)
-                    {
-                        bool found = false;
-                        auto seq = m_storedSequences.find(p->seqIdent);
-
-                        if(seq != m_storedSequences.end())
-                        {
-                            Packet* pkt = seq->second->getPacketByNumber(p->pktNum);
-                            if(pkt)
-                            {
-								Logger::getInstance().Log(Logs::DEBUG, "Network::listenLoop()", "Sending retransmission of seqID [{}], pkt# [{}]", pkt->seqIdent, pkt->pktNum);
-                                sendRetryResponse(&sender, pkt);
-                                found = true;
-                            }
-                        }
-                        else { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::listenLoop()", "Retransmission request from invalid source! seqID [{}], pkt# [{}]", p->seqIdent, p->pktNum); }
-
-                        // packet sequence already destroyed
-                        if(!found) { Logger::getInstance().Log(Logs::DEBUG, "Network::listenLoop()", "Sending retry impossible for seqID [{}]!", p->seqIdent); sendBuiltin(&sender, OP_RetransmissionImpossible, p->seqIdent, p->pktNum); }
-                    }
-                    else // store packet for processing within updateLoop
-                    {
-                        //Logger::getInstance().Log(Logs::DEBUG, "Network::listenLoop()", "\033[97mReceived Packet with OP Code '{}'\033[0m", p->op_code);
-                        PacketPair pp(&p, sender);
-                        m_packetBuffer.push(pp);
-                        m_updateCV.notify_one();
-                    }
-                }
-                else
+    void Network::startListening()
+    {
+        m_reactor = Reactor::getShared();
+        if(!m_reactor) { m_listenThread = new std::thread(startListenLoop, this); } // network (tcp/udp) listen thread
+        else if(m_netListening) { attachReactor(); } // otherwise setAccepting() attaches
+    }
+
+    void Network::attachReactor()
+    {
+        std::lock_guard<std::mutex> lock(m_reactorMutex);
+        if(!m_reactor || m_reactorAttached || !m_isActive) { return; }
+
+        // edge triggered, the handler has to leave the socket dry
+        Network* self = this;
+        m_reactorAttached = m_reactor->add(m_socket->getFD(), ReactorEvent::Readable, [self](uint32_t /*events*/)
+        {
+            if(self->m_isActive && self->m_netListening) { self->drainSocket(self->m_reactorRing); }
+        });
+        if(!m_reactorAttached) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Network::attachReactor()", "Could not register fd [{}], nothing will be received.", m_socket->getFD()); }
+    }
+
+    void Network::detachReactor()
+    {
+        std::lock_guard<std::mutex> lock(m_reactorMutex);
+        if(!m_reactorAttached) { return; }
+        m_reactor->remove(m_socket->getFD());
+        m_reactorAttached = false;
+    }
+
+    void Network::drainSocket(ReceiveRing*& ring)
+    {
+        // (re)build receive ring if the batch size was changed
+        uint16_t batchSize = m_rxBatchSize.load(std::memory_order_relaxed);
+        if(!ring || ring->size != batchSize) { safeDelete(ring); ring = new ReceiveRing(batchSize, PACKET_MAX_SIZE); }
+
+        // one batch per syscall, a short batch means the socket is dry
+        int count = 0;
+        do
+        {
+            count = m_socket->receiveBatch(*ring);
+            if(count <= 0) { break; }
+            m_rxBatchStats.record(count);
+            Time::getInstance().tick(); // one clock read stamps the whole batch
+
+            for(int i = 0; i < count; i++) { processDatagram(*ring, i); }
+        } while(count == ring->size && m_isActive);
+    }
+
+    void Network::processDatagram(ReceiveRing& ring, uint16_t slot)
+    {
+        int bytes_read = ring.lengths[slot];
+        struct sockaddr_storage& sender = ring.senders[slot];
+        if(bytes_read <= PACKET_MIN_RCV_SIZE) { m_stats.add(NetCounter::PacketsInvalid); return; } // catch too small data and abandon
+        m_stats.add(NetCounter::PacketsReceived);
+        m_stats.add(NetCounter::BytesReceived, bytes_read);
+
+        // decode header in place, nothing is copied until the packet is kept
+        //Logger::getInstance().Log(Logs::DEBUG, "Network::processDatagram()", "--- Network::processDatagram: Bytes Read [{}] ---", bytes_read);
+        uint64_t arrival = Time::getInstance().cachedMS();
+        uint64_t arrivalUS = Time::getInstance().cachedUS();
+        PacketView view(ring.buffers[slot], bytes_read, arrival);
+
+        if(isPacketValid(view, &sender))
+        {
+            m_stats.trace(NetTrace::Received, view.op_code, view.seqIdent, view.pktNum, bytes_read);
+            if(view.op_code == OP_Coalesced) { unpackCoalesced(sender, view, arrival, arrivalUS); } // entries are copied out, the ring slot keeps its buffer
+            else if(dispatchPacket(&sender, view, arrivalUS)) { handOff(sender, ring.release(slot), bytes_read, arrival, arrivalUS); } // the ring slot gets a fresh buffer
+        }
+        else
+        {
+            m_stats.add(NetCounter::PacketsInvalid);
+           Logger::getInstance().Log(Logs::DEBUG, "Network::processDatagram()", "Packet was damaged or had incorrect SoftwareVersion ({})", !view.matchesVersion(m_version));
+        }
+    }
+
+    /// answer what the listen thread can answer itself, true if the packet belongs to updateLoop()
+    bool Network::dispatchPacket(sockaddr_storage* sender, const PacketView& p, const uint64_t& arrivalUS)
+    {
+        // immediate reply of retry requests
+        if(p.op_code == OP_RetransmissionRequest)
+        {
+            m_stats.add(NetCounter::RetryRequestsReceived);
+            std::shared_ptr<CongestionControl> cc = getCongestion(ConnectionKey(sender));
+            if(cc) { cc->onLoss(1, arrivalUS); }
+            bool found = false;
+            std::shared_ptr<StoredSequence> ss;
+
+            if(m_storedSequences.get(p.seqIdent, ss))
+            {
+                const StoredFragment* f = ss->getFragment(p.pktNum);
+                if(f)
                 {
-                   Logger::getInstance().Log(Logs::DEBUG, "Network::listenLoop()", "Packet was damaged or had incorrect SoftwareVersion ({})", !p->matchesVersion(m_version));
+                    Logger::getInstance().Log(Logs::DEBUG, "Network::dispatchPacket()", "Sending retransmission of seqID [{}], pkt# [{}]", p.seqIdent, p.pktNum);
+                    sendRetryResponse(sender, f);
+                    found = true;
                 }
+            }
+            else { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::dispatchPacket()", "Retransmission request from invalid source! seqID [{}], pkt# [{}]", p.seqIdent, p.pktNum); }
 
-                // cleanup, if not handed off
-                safeDelete(p);
+            // packet sequence already destroyed
+            if(!found) { Logger::getInstance().Log(Logs::DEBUG, "Network::dispatchPacket()", "Sending retry impossible for seqID [{}]!", p.seqIdent); sendBuiltin(sender, OP_RetransmissionImpossible, p.seqIdent, p.pktNum); }
+            return false;
+        }
+        else if(p.op_code == OP_SelectiveAck) { m_stats.add(NetCounter::SelectiveAcksReceived); resendSelective(sender, p, arrivalUS); return false; }
+        else if(p.op_code == OP_Ack && p.dataLength == sizeof(SnapshotAck_Struct)) { snapshotAck(sender, p); return false; } // plain OP_Acks carry no data
+        else if(p.op_code == OP_WindowUpdate)
+        {
+            // the peer's user is falling behind (or caught up), sendLoop() paces to it
+            std::shared_ptr<CongestionControl> cc = getCongestion(ConnectionKey(sender));
+            if(cc && p.dataLength >= sizeof(ReceiveWindow_Struct))
+            {
+                ReceiveWindow_Struct rw;
+                memcpy(&rw, p.data, sizeof(ReceiveWindow_Struct));
+                cc->onPeerWindow(rw.windowBytes);
             }
+            return false;
         }
 
-        safeDeleteArray(buffer);
-       Logger::getInstance().Log(Logs::INFO, Logs::Network, "Network::listenLoop()", "Exiting listenLoop().");
-        m_netListening = false;
-        m_isActive = false;
-        m_socket->closeSocket();
+        // the whole sequence arrived, let the sender's window grow
+        if(p.op_code == OP_Ack)
+        {
+            std::shared_ptr<StoredSequence> ss;
+            if(m_storedSequences.get(p.seqIdent, ss))
+            {
+                if(ConnectionKey(sender) != ConnectionKey(ss->getDestination())) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::dispatchPacket()", "OP_Ack from invalid source [{}]! seqID [{}]", getIPString(sender), p.seqIdent); return false; }
+                std::shared_ptr<CongestionControl> cc = getCongestion(ConnectionKey(sender));
+                ss->setAcked(); // stops the resend timer, updateLoop() frees it
+                if(cc) { cc->onAck(ss->getNumberPackets()); }
+            }
+        }
+        return true;
+    }
+
+    void Network::handOff(sockaddr_storage& sender, unsigned char* buffer, uint32_t length, const uint64_t& arrival, const uint64_t& arrivalUS)
+    {
+        PacketPair pp(&buffer, length, arrival, sender);
+        //Logger::getInstance().Log(Logs::DEBUG, "Network::handOff()", "\033[97mReceived Packet with OP Code '{}'\033[0m", pp.view.op_code);
+        pp.view.arrivalUS = arrivalUS;
+        if(m_packetBuffer.push(pp)) { m_updateCV.notify_one(); }
+        else
+        {
+            // updateLoop has fallen behind, the reliability layer will recover what matters
+            if(m_rxQueueDrops.fetch_add(1, std::memory_order_relaxed) % 1000 == 0) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::handOff()", "Receive queue full, dropping datagrams ({} so far).", m_rxQueueDrops.load()); }
+            m_updateCV.notify_one();
+            pp.destroy();
+        }
+    }
+
+    /// split an OP_Coalesced datagram back into the packets it carries, each handled as if it had arrived alone
+    void Network::unpackCoalesced(sockaddr_storage& sender, const PacketView& p, const uint64_t& arrival, const uint64_t& arrivalUS)
+    {
+        uint32_t pos = 0;
+        while(pos < p.dataLength)
+        {
+            unsigned char* packet = poolBuffer(PACKET_MAX_SIZE);
+            uint32_t packetLength = 0;
+            uint32_t used = readCoalescedEntry(p.data + pos, p.dataLength - pos, p.identifier, p.softwareVersion, p.timestamp, packet, packetLength);
+            if(used == 0) { poolRelease(packet); Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::unpackCoalesced()", "Malformed entry at [{}] of [{}] bytes from [{}], dropping the rest.", pos, p.dataLength, getIPString(&sender)); return; }
+            pos += used;
+
+            // same sender and version as the datagram that carried it, no need to validate again
+            PacketView view(packet, packetLength, arrival);
+            if(dispatchPacket(&sender, view, arrivalUS)) { handOff(sender, packet, packetLength, arrival, arrivalUS); }
+            else { poolRelease(packet); }
+        }
     }
 
     void Network::sendLoop()
@@ -304,27 +436,59 @@ namespace CGameEngine
         struct pollfd ufds[1];
         ufds[0].fd = m_socket->getFD();
         ufds[0].events = POLLOUT;
-        int retVal = 0;
+        SendBatch* batch = nullptr;
+        std::vector<OutboundPacket> pending;
+        std::vector<OutboundPacket> ready; // cleared by the pacing buckets, flushed every pass
+        std::vector<CoalesceBuffer> coalesced; // due coalesce buffers, emptied every pass
 
         std::mutex slmutex;
         std::unique_lock<std::mutex> sendLock(slmutex);
     	while (m_isActive)
         {
-            if(m_sendQueue.empty()) { m_sendCV.wait(sendLock); }
-
-            while(!m_sendQueue.empty())
+            // producers push without a lock, so never wait indefinitely on a notify that may have been missed
+            uint64_t now = Time::getInstance().tick() / 1000;
+            uint64_t pacedUS = releasePaced(now, ready);
+            uint64_t coalesceUS = takeCoalesced(now, coalesced);
+            if(m_sendQueue.empty() && ready.empty() && coalesced.empty())
             {
-                retVal = poll(ufds, 1, m_pollTimeout);
-                if(retVal < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkClient::sendLoop()", "poll() returned [{}], this is likely fatal. Stopping loop", retVal); m_isActive = false; }
-                else if(retVal > 0 && ufds[0].revents & POLLOUT)
-                {
-                    //Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::sendLoop()", "Packet Data:\n", dumpPacket(m_sendQueue.front().data, m_sendQueue.front().pSize));
-                    m_socket->sendData(m_sendQueue.front().addr, m_sendQueue.front().data, m_sendQueue.front().pSize);
-                    m_sendQueue.pop();
-                }
+                uint64_t heartbeatUS = std::chrono::duration_cast<std::chrono::microseconds>(HEARTBEAT_INTERVAL).count();
+                m_sendCV.wait_for(sendLock, std::chrono::microseconds(std::min(std::min(pacedUS, coalesceUS), heartbeatUS)));
+                now = Time::getInstance().tick() / 1000;
+                releasePaced(now, ready);
+                takeCoalesced(now, coalesced);
             }
+            admitCoalesced(coalesced, now, ready);
+            coalesced.clear();
+
+            // give a partial batch a moment to fill up
+            uint16_t batchSize = std::max(m_txBatchSize.load(std::memory_order_relaxed), (uint16_t)1);
+            uint64_t lingerUS = m_txLingerUS.load(std::memory_order_relaxed);
+            if(batchSize > 1 && lingerUS > 0 && m_sendQueue.size() < batchSize) { std::this_thread::sleep_for(std::chrono::microseconds(lingerUS)); }
+
+            // drain the queue one batch worth at a time, holding back what a destination's pacing does not allow yet
+            do
+            {
+                pending.resize(batchSize);
+                pending.resize(m_sendQueue.popBatch(pending.data(), pending.size()));
+                uint64_t now = Time::getInstance().tick() / 1000;
+                for(size_t i = 0; i < pending.size(); i++) { admitOutbound(pending[i], now, ready); }
+                flushOutbound(ready, batch, ufds);
+            } while(!pending.empty() && m_isActive);
+
+            prunePaced();
         }
         sendLock.unlock();
+        safeDelete(batch);
+
+        // stopped, nothing left here will be sent
+        for(size_t i = 0; i < ready.size(); i++) { SendBuffer::release(ready[i].data); }
+        for(std::unordered_map<ConnectionKey, PacedBacklog, ConnectionKeyHash>::iterator it = m_paced.begin(); it != m_paced.end(); ++it)
+        {
+            for(size_t i = 0; i < it->second.packets.size(); i++) { SendBuffer::release(it->second.packets[i].data); }
+        }
+        m_paced.clear();
+        OutboundPacket op;
+        while(m_sendQueue.pop(op)) { SendBuffer::release(op.data); }
     }
 
     void Network::broadcast(uint16_t port, uint16_t opCode, unsigned char** data, uint32_t dataLength)
@@ -383,109 +547,73 @@ namespace CGameEngine
     }*/
 
     /// \TODO: Review this for efficiency improvements
-    void Network::send(sockaddr_storage* addr, uint16_t opCode, unsigned char** data, uint32_t dataLength)
+    void Network::send(sockaddr_storage* addr, uint16_t opCode, unsigned char** data, uint32_t dataLength, uint8_t delivery /*= DeliveryMode::ReliableUnordered*/)
     {
         if(!addr && !m_isTCP) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "No address. Ignoring send() call."); return; }
         //else if(!m_SERVER && !m_isConnectionAccepted) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "Connection not yet accepted by server, ignoring send() call!"); }
         else if(!data || *data == nullptr) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Network::send()", "data is nullptr! Ignoring send() call."); return; }
         else if(dataLength == 0) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "Passed length is 0! Ignoring send() call."); return; }
+        else if(dataLength > NET_MAX_MESSAGE) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "Passed length [{}] is over NET_MAX_MESSAGE [{}]! Ignoring send() call.", dataLength, NET_MAX_MESSAGE); return; }
         else if(m_isTCP && !m_isConnected) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "TCP connection not accepted! Ignoring send() call."); return; }
+        else if(delivery >= DeliveryMode::END) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "Unknown delivery mode [{}], sending reliably.", delivery); delivery = DeliveryMode::ReliableUnordered; }
 
         // take ownership
         unsigned char* d = *data;
         *data = nullptr;
 
-        // vector for packets, if necessary
-        std::queue<Packet*> packets;
-
         // get sequence ID
         uint32_t seq_ID = getSequenceID();
+        uint32_t channelSeq = nextChannelSeq(addr, delivery);
+        bool reliable = (delivery == DeliveryMode::ReliableUnordered || delivery == DeliveryMode::ReliableOrdered);
 
-        // blanks/misc
-        int payloads = 1;
-        uint16_t leftoverSlice = 0;
-        int position = 0; // position in passed data buffer
-
-        // get number of packets
-        if(dataLength+PACKET_HEADER_SIZE > PACKET_MAX_SIZE)
-        {
-            payloads = static_cast<int>(dataLength / PACKET_DATA_SIZE);
-            leftoverSlice = dataLength - (PACKET_DATA_SIZE * payloads); // invert the remaining the value
-            payloads++; // to account for remainder
-        }
-
-        // define slice size per payload
-        int sliceLength = (payloads == 1) ? dataLength : PACKET_DATA_SIZE;
-        unsigned char* slice = new unsigned char[sliceLength];
+        // get number of packets, every one but the last carries a full PACKET_DATA_SIZE
+        uint32_t payloads = (dataLength + PACKET_DATA_SIZE - 1) / PACKET_DATA_SIZE;
 
         // generate CRC value for whole of data
         uint32_t totalCRC = CRC32::create(d, dataLength);
-        uint64_t timestamp = Time::getInstance().nowMS();
-
-        //Logger::getInstance().Log(Logs::DEBUG, "Network::send()", "payloads [{}], sliceLength [{}], leftoverSlice [{}], dataLength [{}], m_identifier [{}], seq_ID [{}], crc [{}]", payloads, sliceLength, leftoverSlice, dataLength, m_identifier, seq_ID, totalCRC);
-
-        for(int p = 0; p < payloads; p++)
+        uint64_t timestamp = Time::getInstance().nowMS(); // goes out in the header
+        uint64_t sentMS = Time::getInstance().steadyMS(); // resend and expiration deadlines
+        unsigned char ident[IDENT_SIZE] = { 0 };
+        memcpy(ident, m_identifier.c_str(), std::min(m_identifier.length(), (size_t)IDENT_SIZE));
+        uint8_t swver[3] = { m_version->sw_major, m_version->sw_minor, m_version->sw_patch };
+
+        //Logger::getInstance().Log(Logs::DEBUG, "Network::send()", "payloads [{}], dataLength [{}], m_identifier [{}], seq_ID [{}], crc [{}]", payloads, dataLength, m_identifier, seq_ID, totalCRC);
+
+        // header and slice written straight into each fragment's send buffer, the only copy made of the payload
+        std::vector<StoredFragment> fragments(payloads);
+        uint32_t position = 0; // position in passed data buffer
+        for(uint32_t p = 0; p < payloads; p++)
         {
-            // account for last slice and potential variable length
-            if(payloads > 1 && p+1 == payloads)
-            {
-                sliceLength = leftoverSlice;
-                safeDeleteArray(slice);
-                slice = new unsigned char[sliceLength];
-            }
-
-            // reset our "slice"
-            memset(slice, 0, sliceLength);
-
-            // load the slice
-            if(position+sliceLength > dataLength) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "Misaligned slice length! sliceLength [{}], dataLength [{}], position [{}]", sliceLength, dataLength, position); }
-            memcpy(slice, d+position, sliceLength);
-
-            // create crc
-            uint32_t crc = CRC32::create(slice, sliceLength);
-
-            // create a packet
-            Packet* pkt = new Packet(m_identifier, m_version, opCode, timestamp, seq_ID, p, payloads, totalCRC, sliceLength, dataLength, slice);
-
-            // denote next position in the data buffer
+            uint16_t sliceLength = (uint16_t)std::min(dataLength - position, (uint32_t)PACKET_DATA_SIZE);
+            fragments[p].size = PACKET_HEADER_SIZE + sliceLength;
+            fragments[p].buffer = SendBuffer::acquire(fragments[p].size);
+            Packet::writeHeader(fragments[p].buffer, ident, swver, opCode, timestamp, seq_ID, p, payloads, totalCRC, sliceLength, dataLength, delivery, channelSeq);
+            memcpy(fragments[p].buffer + PACKET_HEADER_SIZE, d + position, sliceLength);
             position += sliceLength;
-
-            // store it
-            packets.push(pkt);
         }
+        safeDeleteArray(d);
 
-        /// \TODO: Build system to push the entire vector back for recalling with 5s lifetime
-        if(opCode != OP_RetransmissionReply && payloads > 1)
+        /// \NOTE: kept for retransmission requests until it expires, runTimers() frees it. Unreliable sends keep nothing.
+        if(opCode != OP_RetransmissionReply && reliable)
         {
-            StoredSequence* ss = new StoredSequence(seq_ID, payloads, timestamp, packets);
-            if(ss) { m_storedSequences.insert(std::make_pair(seq_ID, ss)); }
-            ss = nullptr;
+            // single packets are resent until acknowledged, sequences until the peer has a fragment to NACK from
+            std::shared_ptr<CongestionControl> cc = getCongestion(ConnectionKey(addr));
+            uint64_t srttUS = (cc) ? cc->snapshot().srttUS : 0;
+            std::shared_ptr<StoredSequence> ss(new StoredSequence(seq_ID, payloads, sentMS, addr));
+            for(uint32_t p = 0; p < payloads; p++) { ss->addFragment(SendBuffer::retain(fragments[p].buffer), fragments[p].size); }
+            ss->getResendInterval() = (srttUS > 0) ? std::max((uint32_t)(srttUS / 500), (uint32_t)NET_RTO_MIN_MS) : NET_RTO_INITIAL_MS; // 2 * srtt
+            m_storedSequences.insert(std::make_pair(seq_ID, ss));
+            scheduleTimer(ss->getExpiration(), NetTimer(NetTimerType::StoredSequence, seq_ID));
+            scheduleTimer(sentMS + ss->getResendInterval(), NetTimer(NetTimerType::StoredResend, seq_ID));
         }
 
-        // generate unsigned char* per packet to send
-        int pSize = sliceLength+PACKET_HEADER_SIZE;
-        while(packets.size() > 0)
+        // our references go to the send queue
+        for(uint32_t p = 0; p < payloads; p++)
         {
-            Packet* p = packets.front();
-            // account for final "slice" of variable length
-            if(leftoverSlice != 0 && packets.size() == 1)
-            {
-                pSize = leftoverSlice+PACKET_HEADER_SIZE;
-                if(pSize > PACKET_MAX_SIZE) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "pSize for leftover packet is LARGER than max_length allowed!"); }
-            }
-
-            // dump data to uchar* arrays for transmission
-            p->serializeOut();
-            //m_socket->sendData(addr, p->buffer, p->pSize);
-            m_sendQueue.emplace(addr, p->buffer, p->pSize);
-
-            // next packet
-            packets.front() = nullptr;
-            packets.pop();
+            if(payloads == 1 && coalesce(addr, fragments[p].buffer, fragments[p].size, true)) { SendBuffer::release(fragments[p].buffer); } // copied into the destination's coalesce buffer
+            else { queueOutbound(addr, fragments[p].buffer, fragments[p].size); }
         }
         m_sendCV.notify_one(); // tell sendQueue to process packets
-        safeDeleteArray(slice);
-        safeDeleteArray(d);
     }
 
     void Network::sendBuiltin(sockaddr_storage* addr, uint16_t opCode, uint32_t seqID /*= 0*/, uint32_t pktNum /*= 0*/)
@@ -566,8 +694,7 @@ namespace CGameEngine
                 }
 
                 // create payload
-                data = new unsigned char[dataLength];
-                memset(data, 0, dataLength);
+                data = poolBuffer(dataLength);
                 memcpy(data, &cr, dataLength);
 
                 //Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Network::sendBuiltin(no data)", "[Dst: {}] Sending ConnectionRequest, title [{}], uniqID [{}]", getIPString(addr), cr.title, cr.uniqID);
@@ -576,7 +703,7 @@ namespace CGameEngine
         }
 
         // if no data, falsify some
-        if(!data || dataLength == 0) { dataLength = sizeof(m_uniqueID); data = new unsigned char[dataLength]; memcpy(data, &m_uniqueID, dataLength); } // junk data
+        if(!data || dataLength == 0) { dataLength = sizeof(m_uniqueID); data = poolBuffer(dataLength); memcpy(data, &m_uniqueID, dataLength); } // junk data
 
         // generate CRC
         uint32_t totalCRC = CRC32::create(data, dataLength);
@@ -585,26 +712,50 @@ namespace CGameEngine
         Packet pkt(m_identifier, m_version, opCode, Time::getInstance().nowMS(), seqID, pktNum, pktTotal, totalCRC, dataLength, dataLength, data);
         pkt.serializeOut();
 
-        // send and cleanup
-        m_socket->sendData(addr, pkt.buffer, pkt.pSize);
-        safeDeleteArray(data);
+        // send (or let it share a datagram) and cleanup
+        if(!coalesce(addr, pkt.buffer, pkt.pSize, false)) { sendDirect(addr, pkt.buffer, pkt.pSize); }
+        poolRelease(data);
     }
 
-    void Network::sendRetryResponse(sockaddr_storage* addr, Packet* p)
+    void Network::sendRetryResponse(sockaddr_storage* addr, const StoredFragment* f)
     {
          if(!addr && !m_isTCP) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::sendRetryResponse()", "No address!"); return; }
-         else if(!p) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::sendRetryResponse()", "No packet passed!"); return; }
+         else if(!f || !f->buffer) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::sendRetryResponse()", "No packet passed!"); return; }
          else if(m_isTCP && !m_isConnected) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::send()", "TCP connection not accepted! Ignoring send() call."); return; }
 
-        // create actual payload
-        p->serializeOut();
-
-       Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "Network::sendRetryResponse()", "Sending retry response for seq [{}], pktNum [{}]", p->seqIdent, p->pktNum);
-        //m_socket->sendData(addr, p->buffer, p->pSize);
-        m_sendQueue.emplace(addr, p->buffer, p->pSize);
+        // the stored fragment goes out as is, the queue takes its own reference
+        //m_socket->sendData(addr, f->buffer, f->size);
+        queueOutbound(addr, SendBuffer::retain(f->buffer), f->size);
+        m_stats.add(NetCounter::FragmentsResent);
         m_sendCV.notify_one(); // tell sendQueue to process packets
     }
 
+    void Network::sendSelectiveAck(sockaddr_storage* addr, uint32_t seqID, const SelectiveAck_Struct& sack)
+    {
+        sendBuiltinData(addr, OP_SelectiveAck, &sack, sack.wireSize(), seqID); // header and the used part of the bitmap
+    }
+
+    void Network::sendBuiltinData(sockaddr_storage* addr, uint16_t opCode, const void* payload, uint16_t dataLength, uint32_t seqID /*= 0*/)
+    {
+        if(!addr && !m_isTCP) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::sendBuiltinData()", "No address passed. Ignoring send() call."); return; }
+        else if(m_isTCP && !m_isConnected) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::sendBuiltinData()", "TCP connection not accepted! Ignoring send() call."); return; }
+        else if(!payload || dataLength == 0 || dataLength > PACKET_DATA_SIZE) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::sendBuiltinData()", "Bad payload of [{}] bytes for OPCode [{}]. Ignoring send() call.", dataLength, opCode); return; }
+
+        unsigned char* data = poolBuffer(dataLength);
+        memcpy(data, payload, dataLength);
+
+        // generate CRC
+        uint32_t totalCRC = CRC32::create(data, dataLength);
+
+        // create packet
+        Packet pkt(m_identifier, m_version, opCode, Time::getInstance().nowMS(), seqID, 0, 1, totalCRC, dataLength, dataLength, data);
+        pkt.serializeOut();
+
+        // send (or let it share a datagram) and cleanup
+        if(!coalesce(addr, pkt.buffer, pkt.pSize, false)) { sendDirect(addr, pkt.buffer, pkt.pSize); }
+        poolRelease(data);
+    }
+
     void Network::sendSimple(sockaddr_storage* addr,  uint16_t opCode)
     {
         if(!addr && !m_isTCP) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::sendSimple(no data)", "No address. Ignoring send() call."); return; }
@@ -612,7 +763,7 @@ namespace CGameEngine
 
         // junk data
         uint16_t dataLength = sizeof(m_uniqueID);
-        unsigned char* data = new unsigned char[dataLength];
+        unsigned char* data = poolBuffer(dataLength);
         memcpy(data, &m_uniqueID, dataLength);
         uint32_t pktTotal = 1;
 
@@ -623,18 +774,599 @@ namespace CGameEngine
         Packet pkt(m_identifier, m_version, opCode, Time::getInstance().nowMS(), 0, 0, pktTotal, totalCRC, dataLength, dataLength, data);
         pkt.serializeOut();
 
-        // send and cleanup
-        m_socket->sendData(addr, pkt.buffer, pkt.pSize);
-        safeDeleteArray(data);
+        // send (or let it share a datagram) and cleanup
+        if(!coalesce(addr, pkt.buffer, pkt.pSize, false)) { sendDirect(addr, pkt.buffer, pkt.pSize); }
+        poolRelease(data);
+    }
+
+    /// hand a serialized packet to sendLoop(), waiting (not dropping) if the send queue is full
+    void Network::queueOutbound(const sockaddr_storage* addr, unsigned char* data, uint32_t pSize)
+    {
+        OutboundPacket op(addr, data, pSize);
+        if(m_sendQueue.push(op)) { return; }
+
+        m_txQueueStalls.fetch_add(1, std::memory_order_relaxed);
+        while(!m_sendQueue.push(op))
+        {
+            if(!m_isActive) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::queueOutbound()", "Network stopped with the send queue full, dropping packet."); SendBuffer::release(data); return; }
+            m_sendCV.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+    /// pack a serialized single packet message into its destination's coalesce buffer, sendLoop() flushes it when full or due
+    bool Network::coalesce(sockaddr_storage* addr, const unsigned char* packet, uint32_t pSize, bool paced)
+    {
+        if(!addr || !packet || !m_isActive || m_coalesceDelayUS.load(std::memory_order_relaxed) == 0) { return false; }
+
+        PacketView view(packet, pSize, 0);
+        if(!view.isDecoded() || view.pktTotal != 1 || view.dataLength > NET_COALESCE_MAX_MESSAGE) { return false; }
+
+        uint32_t entrySize = COALESCED_ENTRY_HEADER + view.dataLength;
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(m_coalesceMutex);
+            ConnectionKey key(addr);
+            std::unordered_map<ConnectionKey, CoalesceBuffer, ConnectionKeyHash>::iterator it = m_coalesce.find(key);
+
+            // no room left, it goes out as is and this message starts the next one
+            if(it != m_coalesce.end() && it->second.length + entrySize > PACKET_DATA_SIZE)
+            {
+                m_coalesceFull.push_back(it->second);
+                m_coalesce.erase(it);
+                it = m_coalesce.end();
+                wake = true;
+            }
+
+            if(it == m_coalesce.end())
+            {
+                CoalesceBuffer cb;
+                copyAddress(&cb.addr, addr);
+                cb.data = poolBuffer(PACKET_DATA_SIZE);
+                cb.firstUS = Time::getInstance().steadyUS();
+                it = m_coalesce.insert(std::make_pair(key, cb)).first;
+                wake = true; // sendLoop() may be asleep past this buffer's deadline
+            }
+
+            CoalesceBuffer& cb = it->second;
+            cb.length += writeCoalescedEntry(cb.data + cb.length, view);
+            cb.count++;
+            cb.paced = (cb.paced || paced);
+        }
+
+        if(wake) { m_sendCV.notify_one(); }
+        return true;
+    }
+
+    uint64_t Network::takeCoalesced(const uint64_t& nowUS, std::vector<CoalesceBuffer>& out)
+    {
+        uint64_t retVal = UINT64_MAX;
+        uint64_t delay = m_coalesceDelayUS.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(m_coalesceMutex);
+        out.insert(out.end(), m_coalesceFull.begin(), m_coalesceFull.end());
+        m_coalesceFull.clear();
+
+        std::unordered_map<ConnectionKey, CoalesceBuffer, ConnectionKeyHash>::iterator it = m_coalesce.begin();
+        while(it != m_coalesce.end())
+        {
+            uint64_t waited = (nowUS > it->second.firstUS) ? (nowUS - it->second.firstUS) : 0;
+            if(waited >= delay) { out.push_back(it->second); it = m_coalesce.erase(it); }
+            else { retVal = std::min(retVal, delay - waited); ++it; }
+        }
+        return retVal;
+    }
+
+    /// one datagram per taken buffer, a lone message goes out as the plain packet it was
+    void Network::admitCoalesced(std::vector<CoalesceBuffer>& coalesced, const uint64_t& nowUS, std::vector<OutboundPacket>& ready)
+    {
+        if(coalesced.empty()) { return; }
+
+        uint64_t timestamp = Time::getInstance().nowMS();
+        unsigned char ident[IDENT_SIZE] = { 0 };
+        memcpy(ident, m_identifier.c_str(), std::min(m_identifier.length(), (size_t)IDENT_SIZE));
+        uint8_t swver[3] = { m_version->sw_major, m_version->sw_minor, m_version->sw_patch };
+
+        for(size_t i = 0; i < coalesced.size(); i++)
+        {
+            CoalesceBuffer& cb = coalesced[i];
+            unsigned char* buffer = nullptr;
+            uint32_t pSize = 0;
+            if(cb.count == 1)
+            {
+                buffer = SendBuffer::acquire(PACKET_MAX_SIZE);
+                if(readCoalescedEntry(cb.data, cb.length, ident, swver, timestamp, buffer, pSize) == 0) { SendBuffer::release(buffer); }
+            }
+            else
+            {
+                pSize = PACKET_HEADER_SIZE + cb.length;
+                buffer = SendBuffer::acquire(pSize);
+                Packet::writeHeader(buffer, ident, swver, OP_Coalesced, timestamp, 0, 0, 1, CRC32::create(cb.data, cb.length), cb.length, cb.length, DeliveryMode::Unreliable, 0);
+                memcpy(buffer + PACKET_HEADER_SIZE, cb.data, cb.length);
+            }
+            poolRelease(cb.data);
+            m_coalesceStats.record(cb.count);
+            if(!buffer) { continue; }
+
+            OutboundPacket op(&cb.addr, buffer, pSize);
+            if(cb.paced) { admitOutbound(op, nowUS, ready); }
+            else { ready.push_back(op); } // builtins only, never held back by pacing
+        }
+    }
+
+    /// the fields of a single packet message that the OP_Coalesced datagram carrying it does not already hold
+    uint16_t Network::writeCoalescedEntry(unsigned char* out, const PacketView& p)
+    {
+        unsigned char* pos = out;
+        memcpy(pos, &p.op_code, sizeof(p.op_code)); pos += sizeof(p.op_code);
+        memcpy(pos, &p.seqIdent, sizeof(p.seqIdent)); pos += sizeof(p.seqIdent);
+        memcpy(pos, &p.pktNum, sizeof(p.pktNum)); pos += sizeof(p.pktNum);
+        memcpy(pos, &p.totalCRC, sizeof(p.totalCRC)); pos += sizeof(p.totalCRC);
+        memcpy(pos, &p.dataLength, sizeof(p.dataLength)); pos += sizeof(p.dataLength);
+        memcpy(pos, &p.delivery, sizeof(p.delivery)); pos += sizeof(p.delivery);
+        memcpy(pos, &p.channelSeq, sizeof(p.channelSeq)); pos += sizeof(p.channelSeq);
+        memcpy(pos, p.data, p.dataLength); pos += p.dataLength;
+        return (uint16_t)(pos - out);
+    }
+
+    /// rebuild the full packet an entry was packed from, returns the entry's size
+    uint32_t Network::readCoalescedEntry(const unsigned char* entry, uint32_t available, const unsigned char* ident, const uint8_t* swver, const uint64_t& timestamp, unsigned char* packet, uint32_t& packetLength)
+    {
+        packetLength = 0;
+        if(!entry || !packet || available < COALESCED_ENTRY_HEADER) { return 0; }
+
+        uint16_t op_code = 0;
+        uint32_t seqIdent = 0;
+        uint32_t pktNum = 0;
+        uint32_t totalCRC = 0;
+        uint16_t dataLength = 0;
+        uint8_t delivery = 0;
+        uint32_t channelSeq = 0;
+        const unsigned char* pos = entry;
+        memcpy(&op_code, pos, sizeof(op_code)); pos += sizeof(op_code);
+        memcpy(&seqIdent, pos, sizeof(seqIdent)); pos += sizeof(seqIdent);
+        memcpy(&pktNum, pos, sizeof(pktNum)); pos += sizeof(pktNum);
+        memcpy(&totalCRC, pos, sizeof(totalCRC)); pos += sizeof(totalCRC);
+        memcpy(&dataLength, pos, sizeof(dataLength)); pos += sizeof(dataLength);
+        memcpy(&delivery, pos, sizeof(delivery)); pos += sizeof(delivery);
+        memcpy(&channelSeq, pos, sizeof(channelSeq)); pos += sizeof(channelSeq);
+        if(dataLength > available - COALESCED_ENTRY_HEADER || dataLength > PACKET_DATA_SIZE) { return 0; }
+
+        // only single packet messages are coalesced, pktTotal 1 and totalLength = dataLength
+        packetLength = PACKET_HEADER_SIZE + dataLength;
+        Packet::writeHeader(packet, ident, swver, op_code, timestamp, seqIdent, pktNum, 1, totalCRC, dataLength, dataLength, delivery, channelSeq);
+        memcpy(packet + PACKET_HEADER_SIZE, pos, dataLength);
+        return COALESCED_ENTRY_HEADER + dataLength;
+    }
+
+    /// every delivery mode numbers its messages separately per destination, starting at 1
+    uint32_t Network::nextChannelSeq(const sockaddr_storage* addr, uint8_t delivery)
+    {
+        if(!addr) { return 0; }
+        std::lock_guard<std::mutex> lock(m_channelMutex);
+        return ++m_channels[ConnectionKey(addr)].last[delivery];
+    }
+
+    /// no OP_Ack for a reliable send yet, resend it (or, for a sequence, its first fragment so the peer can NACK the rest)
+    /// kept NET_STORED_SEQUENCE_MS past its last transmission, one still queued or paced has not had its chance yet
+    void Network::expireStored(uint32_t seqID, const uint64_t& timestamp)
+    {
+        std::shared_ptr<StoredSequence> ss;
+        if(!m_storedSequences.get(seqID, ss)) { return; }
+        if(timestamp < ss->getExpiration()) { return; } // pushed back, a later timer ends it
+
+        uint64_t sentMS = 0;
+        uint64_t until = (ss->lastTransmit(timestamp, sentMS)) ? sentMS + NET_STORED_SEQUENCE_MS : timestamp + NET_STORED_SEQUENCE_MS;
+        until = std::min(until, ss->getOriginTimestamp() + NET_STORED_SEQUENCE_MAX_MS);
+        if(!ss->isAcked() && until > timestamp)
+        {
+            ss->setExpiration(until);
+            scheduleTimer(until, NetTimer(NetTimerType::StoredSequence, seqID));
+            return;
+        }
+        m_storedSequences.erase(seqID); // freed with the last reference
+    }
+
+    void Network::resendStored(uint32_t seqID, const uint64_t& timestamp)
+    {
+        std::shared_ptr<StoredSequence> ss;
+        if(!m_storedSequences.get(seqID, ss)) { return; }
+
+        // acknowledged, no need to wait for the expiration
+        if(ss->isAcked())
+        {
+            m_storedSequences.erase(seqID);
+            return;
+        }
+
+        // still queued or held back by pacing, nothing was lost yet, the wait runs from when it leaves
+        uint64_t sentMS = 0;
+        if(!ss->lastTransmit(timestamp, sentMS)) { sentMS = timestamp; }
+        if(sentMS + ss->getResendInterval() > timestamp)
+        {
+            scheduleTimer(sentMS + ss->getResendInterval(), NetTimer(NetTimerType::StoredResend, seqID));
+            return;
+        }
+
+        const StoredFragment* f = ss->getFragment(0);
+        if(!f) { return; }
+        queueOutbound(ss->getDestination(), SendBuffer::retain(f->buffer), f->size);
+        m_stats.add(NetCounter::FragmentsResent);
+        m_stats.trace(NetTrace::Resent, 0, seqID, 0, f->size);
+        m_sendCV.notify_one();
+
+        std::shared_ptr<CongestionControl> cc = getCongestion(ConnectionKey(ss->getDestination()));
+        if(cc) { cc->onLoss(1, Time::getInstance().cachedUS()); }
+
+        // back off, expireStored() ends it
+        ss->getResendInterval() *= 2;
+        scheduleTimer(timestamp + ss->getResendInterval(), NetTimer(NetTimerType::StoredResend, seqID));
+       Logger::getInstance().Log(Logs::DEBUG, "Network::resendStored()", "No OP_Ack for seqID [{}], resent pkt# 0 of [{}].", seqID, ss->getNumberPackets());
+    }
+
+    /// a peer's SnapshotChannel confirmed a snapshot, it becomes the baseline for the next delta
+    void Network::snapshotAck(sockaddr_storage* sender, const PacketView& p)
+    {
+        SnapshotAck_Struct ack;
+        memcpy(&ack, p.data, sizeof(SnapshotAck_Struct));
+
+        std::shared_ptr<CongestionControl> cc = getCongestion(ConnectionKey(sender));
+        if(cc) { cc->onAck(1); }
+
+        // held while delivering, so a channel cannot be destroyed under us
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        for(unsigned int i = 0; i < m_snapshotChannels.size(); i++)
+        {
+            if(m_snapshotChannels[i]->getOPCode() == ack.opCode) { m_snapshotChannels[i]->onAck(sender, ack.snapshotID); return; }
+        }
+    }
+
+    /// queue every fragment a SACK reports missing, then wake the send loop once for the whole burst
+    void Network::resendSelective(sockaddr_storage* sender, const PacketView& p, const uint64_t& arrivalUS)
+    {
+        if(p.dataLength < SACK_HEADER_SIZE) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::resendSelective()", "SACK too short ({} bytes) for seqID [{}]", p.dataLength, p.seqIdent); return; }
+
+        // only trust as much bitmap as was actually sent
+        SelectiveAck_Struct sack;
+        memcpy(&sack, p.data, std::min((size_t)p.dataLength, sizeof(sack)));
+        uint32_t covered = (p.dataLength - SACK_HEADER_SIZE) * 8;
+        if(sack.count > covered) { sack.count = covered; }
+
+        std::shared_ptr<StoredSequence> ss;
+        if(!m_storedSequences.get(p.seqIdent, ss))
+        {
+            Logger::getInstance().Log(Logs::DEBUG, "Network::resendSelective()", "Sending retry impossible for seqID [{}]!", p.seqIdent);
+            sendBuiltin(sender, OP_RetransmissionImpossible, p.seqIdent, 0);
+            return;
+        }
+
+        if(ConnectionKey(sender) != ConnectionKey(ss->getDestination())) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::resendSelective()", "SACK from invalid source [{}]! seqID [{}]", getIPString(sender), p.seqIdent); return; }
+
+        // every queued copy holds its own reference to the stored fragment
+        uint32_t resent = 0;
+        for(uint32_t i = 0; i < sack.count; i++)
+        {
+            if(sack.has(i)) { continue; }
+            const StoredFragment* f = ss->getFragment(sack.base + i);
+            if(!f) { break; }
+            queueOutbound(ss->getDestination(), SendBuffer::retain(f->buffer), f->size);
+            m_stats.trace(NetTrace::Resent, 0, p.seqIdent, sack.base + i, f->size);
+            resent++;
+        }
+
+        // every hole is a lost packet as far as the window is concerned
+        std::shared_ptr<CongestionControl> cc = getCongestion(ConnectionKey(sender));
+        if(cc && resent > 0) { cc->onLoss(resent, arrivalUS); }
+        m_stats.add(NetCounter::FragmentsResent, resent);
+
+        Logger::getInstance().Log(Logs::DEBUG, "Network::resendSelective()", "Resending [{}] fragments of seqID [{}] (base [{}], count [{}])", resent, p.seqIdent, sack.base, sack.count);
+        if(resent > 0) { m_sendCV.notify_one(); }
+    }
+
+    /// send now if the destination's bucket allows it, otherwise queue behind its earlier packets
+    void Network::admitOutbound(OutboundPacket& op, const uint64_t& nowUS, std::vector<OutboundPacket>& ready)
+    {
+        if(!m_pacing) { ready.push_back(op); return; }
+
+        ConnectionKey key(&op.addr);
+        std::unordered_map<ConnectionKey, PacedBacklog, ConnectionKeyHash>::iterator it = m_paced.find(key);
+        if(it != m_paced.end() && !it->second.packets.empty()) { it->second.packets.push_back(op); return; }
+
+        std::shared_ptr<CongestionControl> cc = getCongestion(key);
+        if(!cc || cc->tryConsume(op.pSize, nowUS)) { ready.push_back(op); return; } // not connected (yet), e.g. connection requests
+
+        PacedBacklog& backlog = m_paced[key];
+        backlog.cc = cc;
+        backlog.packets.push_back(op);
+    }
+
+    uint64_t Network::releasePaced(const uint64_t& nowUS, std::vector<OutboundPacket>& ready)
+    {
+        uint64_t retVal = UINT64_MAX;
+        for(std::unordered_map<ConnectionKey, PacedBacklog, ConnectionKeyHash>::iterator it = m_paced.begin(); it != m_paced.end(); ++it)
+        {
+            std::deque<OutboundPacket>& packets = it->second.packets;
+            if(packets.empty() || it->second.cc->isClosed()) { continue; }
+
+            while(!packets.empty() && it->second.cc->tryConsume(packets.front().pSize, nowUS)) { ready.push_back(packets.front()); packets.pop_front(); }
+            if(!packets.empty()) { retVal = std::min(retVal, it->second.cc->usUntilSend(packets.front().pSize, nowUS)); }
+        }
+        return retVal;
+    }
+
+    void Network::prunePaced()
+    {
+        std::unordered_map<ConnectionKey, PacedBacklog, ConnectionKeyHash>::iterator it = m_paced.begin();
+        while(it != m_paced.end())
+        {
+            // connection closed with packets still held back, they have nowhere to go
+            if(it->second.cc->isClosed() && !it->second.packets.empty())
+            {
+               Logger::getInstance().Log(Logs::DEBUG, "Network::prunePaced()", "Dropping [{}] paced packets for closed connection [{}]", it->second.packets.size(), getIPString(&it->second.packets.front().addr));
+                for(size_t i = 0; i < it->second.packets.size(); i++) { SendBuffer::release(it->second.packets[i].data); }
+                it->second.packets.clear();
+            }
+
+            if(it->second.packets.empty()) { it = m_paced.erase(it); }
+            else { ++it; }
+        }
+    }
+
+    void Network::flushOutbound(std::vector<OutboundPacket>& ready, SendBatch*& batch, pollfd* ufds)
+    {
+        int retVal = 0;
+        uint16_t batchSize = m_txBatchSize.load(std::memory_order_relaxed);
+
+        // unbatched, one poll() and one sendto() per packet
+        if(batchSize <= 1)
+        {
+            for(size_t i = 0; i < ready.size() && m_isActive; i++)
+            {
+                retVal = 0;
+                while(m_isActive && retVal == 0)
+                {
+                    retVal = poll(ufds, 1, m_pollTimeout);
+                    if(retVal < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Network::sendLoop()", "poll() returned [{}], this is likely fatal. Stopping loop", retVal); m_isActive = false; }
+                    else if(retVal > 0 && ufds[0].revents & POLLOUT)
+                    {
+                        //Logger::getInstance().Log(Logs::DEBUG, "Network::sendLoop()", "Packet Data:\n", dumpPacket(ready[i].data, ready[i].pSize));
+                        if(m_socket->sendData(&ready[i].addr, ready[i].data, ready[i].pSize)) { m_stats.add(NetCounter::PacketsSent); m_stats.add(NetCounter::BytesSent, ready[i].pSize); }
+                    }
+                }
+            }
+            uint32_t sentMS = (uint32_t)Time::getInstance().cachedMS();
+            for(size_t i = 0; i < ready.size(); i++) { SendBuffer::stampSent(ready[i].data, sentMS); SendBuffer::release(ready[i].data); }
+            ready.clear();
+            return;
+        }
+
+        // (re)build send batch if the batch size was changed
+        if(!batch || batch->size != batchSize) { safeDelete(batch); batch = new SendBatch(batchSize); }
+
+        size_t start = 0;
+        while(start < ready.size() && m_isActive)
+        {
+            // group by destination, keeping each destination's packets in order
+            size_t count = std::min(ready.size() - start, (size_t)batch->size);
+            std::stable_sort(ready.begin() + start, ready.begin() + start + count, [](const OutboundPacket& a, const OutboundPacket& b) { return compareAddress(&a.addr, &b.addr) < 0; });
+            for(uint16_t i = 0; i < count; i++) { batch->set(i, &ready[start+i].addr, ready[start+i].data, ready[start+i].pSize); }
+
+            // flush, only poll()ing when the socket pushes back
+            uint16_t offset = 0;
+            while(offset < count && m_isActive)
+            {
+                int sent = m_socket->sendBatch(*batch, count - offset, offset);
+                if(sent > 0)
+                {
+                    uint64_t bytes = 0;
+                    for(int i = 0; i < sent; i++) { bytes += ready[start+offset+i].pSize; }
+                    m_stats.add(NetCounter::PacketsSent, sent);
+                    m_stats.add(NetCounter::BytesSent, bytes);
+                    m_txBatchStats.record(sent);
+                    offset += sent;
+                }
+                else if(errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    retVal = poll(ufds, 1, m_pollTimeout);
+                    if(retVal < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Network::sendLoop()", "poll() returned [{}], this is likely fatal. Stopping loop", retVal); m_isActive = false; }
+                }
+                else
+                {
+                    // hard failure on the head packet, drop it so the rest can go out
+                    Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::sendLoop()", "Dropping packet of [{}] bytes to [{}].", ready[start+offset].pSize, getIPString(&ready[start+offset].addr));
+                    offset++;
+                }
+            }
+            start += count;
+        }
+
+        // sent, or dropped because the loop stopped, either way the resend timer may run from here
+        uint32_t sentMS = (uint32_t)Time::getInstance().cachedMS();
+        for(size_t i = 0; i < ready.size(); i++) { SendBuffer::stampSent(ready[i].data, sentMS); SendBuffer::release(ready[i].data); }
+        ready.clear();
+    }
+
+    NetStatsSnapshot Network::getStatsSnapshot() const
+    {
+        NetStatsSnapshot retVal = m_stats.snapshot();
+        retVal.counters[NetCounter::ReceiveQueueDrops] = getReceiveQueueDrops();
+        retVal.counters[NetCounter::SendQueueStalls] = getSendQueueStalls();
+
+        ReceiveWindowStats window = m_receiveWindow->snapshot();
+        retVal.gauges[NetGauge::Connections] = getConnectionCount();
+        retVal.gauges[NetGauge::ReceiveQueue] = m_packetBuffer.size();
+        retVal.gauges[NetGauge::SendQueue] = m_sendQueue.size();
+        retVal.gauges[NetGauge::StoredSequences] = m_storedSequences.size();
+        retVal.gauges[NetGauge::UndeliveredMessages] = window.queued;
+        retVal.gauges[NetGauge::UndeliveredBytes] = window.bytes;
+        return retVal;
+    }
+
+    std::shared_ptr<CongestionControl> Network::addCongestion(const ConnectionKey& key)
+    {
+        std::lock_guard<std::mutex> lock(m_congestionMutex);
+        OpenAddressMap<ConnectionKey, std::shared_ptr<CongestionControl>, ConnectionKeyHash>::iterator it = m_congestion.find(key);
+        if(it != m_congestion.end()) { return it->second; }
+
+        std::shared_ptr<CongestionControl> cc = std::make_shared<CongestionControl>();
+        m_congestion.insert(key, cc);
+        return cc;
+    }
+
+    std::shared_ptr<CongestionControl> Network::getCongestion(const ConnectionKey& key)
+    {
+        std::lock_guard<std::mutex> lock(m_congestionMutex);
+        OpenAddressMap<ConnectionKey, std::shared_ptr<CongestionControl>, ConnectionKeyHash>::iterator it = m_congestion.find(key);
+        return (it != m_congestion.end()) ? it->second : nullptr;
+    }
+
+    void Network::removeCongestion(const ConnectionKey& key)
+    {
+        std::lock_guard<std::mutex> lock(m_congestionMutex);
+        OpenAddressMap<ConnectionKey, std::shared_ptr<CongestionControl>, ConnectionKeyHash>::iterator it = m_congestion.find(key);
+        if(it == m_congestion.end()) { return; }
+        it->second->setClosed(); // sendLoop() drops whatever it still holds back
+        m_congestion.erase(it);
+    }
+
+    void Network::resetChannels(const ConnectionKey& key)
+    {
+        std::lock_guard<std::mutex> lock(m_channelMutex);
+        m_channels.erase(key);
+    }
+
+    ChannelSequences Network::getChannels(const ConnectionKey& key)
+    {
+        std::lock_guard<std::mutex> lock(m_channelMutex);
+        std::unordered_map<ConnectionKey, ChannelSequences, ConnectionKeyHash>::iterator it = m_channels.find(key);
+        return (it != m_channels.end()) ? it->second : ChannelSequences();
+    }
+
+    void Network::setChannels(const ConnectionKey& key, const ChannelSequences& seq)
+    {
+        std::lock_guard<std::mutex> lock(m_channelMutex);
+        m_channels[key] = seq;
+    }
+
+    void Network::addSnapshotChannel(SnapshotChannel* channel)
+    {
+        if(!channel) { return; }
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        for(unsigned int i = 0; i < m_snapshotChannels.size(); i++)
+        {
+            if(m_snapshotChannels[i]->getOPCode() == channel->getOPCode()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::addSnapshotChannel()", "OPCode [{}] already has a snapshot channel, acks go to the first one.", channel->getOPCode()); }
+        }
+        m_snapshotChannels.push_back(channel);
+    }
+
+    void Network::removeSnapshotChannel(SnapshotChannel* channel)
+    {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        m_snapshotChannels.erase(std::remove(m_snapshotChannels.begin(), m_snapshotChannels.end(), channel), m_snapshotChannels.end());
+    }
+
+    CongestionStats Network::getCongestionStats(const sockaddr_storage* addr)
+    {
+        std::shared_ptr<CongestionControl> cc = getCongestion(ConnectionKey(addr));
+        return (cc) ? cc->snapshot() : CongestionStats();
+    }
+
+    void Network::recordDeliveryLatency(const uint64_t& arrivalUS)
+    {
+        if(arrivalUS == 0) { return; }
+        uint64_t now = Time::getInstance().steadyUS();
+        m_stats.record(NetHistogram::DeliveryLatencyUS, (now > arrivalUS) ? (now - arrivalUS) : 0);
+    }
+
+    TimerID Network::scheduleTimer(const uint64_t& deadline, const NetTimer& t)
+    {
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+        return m_timers.schedule(deadline, t);
+    }
+
+    void Network::cancelTimer(TimerID& id)
+    {
+        if(id == 0) { return; }
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+        m_timers.cancel(id);
+    }
+
+    /// fire every timer due by 'timestamp', handlers may schedule or cancel timers (including ones already due)
+    void Network::runTimers(const uint64_t& timestamp)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_timerMutex);
+            if(m_timers.advance(timestamp) == 0) { return; }
+        }
+
+        NetTimer t;
+        while(true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_timerMutex);
+                if(!m_timers.popExpired(t)) { break; }
+            }
+
+            if(t.type == NetTimerType::StoredSequence) { expireStored(t.seqID, timestamp); }
+            else if(t.type == NetTimerType::StoredResend) { resendStored(t.seqID, timestamp); }
+            else if(t.conn)
+            {
+                if(t.conn->onTimer(t, timestamp)) { connectionExpired(t.conn); }
+            }
+            else { networkTimer(t, timestamp); }
+        }
+    }
+
+    std::chrono::milliseconds Network::timeUntilTimers(const uint64_t& timestamp)
+    {
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+        uint64_t ms = m_timers.msUntilNext(timestamp);
+        return (ms < (uint64_t)HEARTBEAT_INTERVAL.count()) ? std::chrono::milliseconds(ms) : HEARTBEAT_INTERVAL;
     }
 
     void Network::setAccepting(bool val /*= true*/)
     {
         m_netListening = val;
+        if(m_reactor) { if(val) { attachReactor(); } else { detachReactor(); } }
         m_updateCV.notify_one();
         m_sendCV.notify_one();
     }
 
+    void Network::setReceiveBatchSize(uint16_t val)
+    {
+        if(val == 0) { val = 1; }
+        else if(val > MAX_RECEIVE_BATCH) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::setReceiveBatchSize()", "Batch size [{}] clamped to [{}].", val, MAX_RECEIVE_BATCH); val = MAX_RECEIVE_BATCH; }
+        m_rxBatchSize.store(val, std::memory_order_relaxed); // the listen thread rebuilds its ring on the next drain
+    }
+
+    void Network::setSendBatching(uint16_t batchSize, std::chrono::microseconds linger /*= std::chrono::microseconds(0)*/)
+    {
+        if(batchSize == 0) { batchSize = 1; }
+        else if(batchSize > MAX_SEND_BATCH) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Network::setSendBatching()", "Batch size [{}] clamped to [{}].", batchSize, MAX_SEND_BATCH); batchSize = MAX_SEND_BATCH; }
+        m_txBatchSize.store(batchSize, std::memory_order_relaxed);
+        m_txLingerUS.store((linger.count() > 0) ? linger.count() : 0, std::memory_order_relaxed);
+        m_sendCV.notify_one();
+    }
+
+    void Network::setCoalescing(std::chrono::microseconds delay)
+    {
+        m_coalesceDelayUS = (delay.count() > 0) ? delay.count() : 0; // anything still waiting is flushed on the next pass
+        m_sendCV.notify_one();
+    }
+
+    void Network::sendDirect(const sockaddr_storage* addr, unsigned char* data, uint32_t pSize)
+    {
+        if(!m_socket->sendData(addr, data, pSize)) { return; }
+        m_stats.add(NetCounter::PacketsSent);
+        m_stats.add(NetCounter::BytesSent, pSize);
+    }
+
+    void Network::setReceiveWindow(uint64_t connectionBytes, uint64_t globalBytes, bool dropUnreliable /*= true*/)
+    {
+        m_connectionWindow = connectionBytes;
+        m_receiveWindow->setLimit(globalBytes); // every connection checks this one as well, so it applies right away
+        m_dropUnreliable = dropUnreliable;
+    }
+
     void Network::setTitle(std::string str)
     {
         m_title = str;
@@ -654,10 +1386,18 @@ namespace CGameEngine
         #endif
     }
 
-    /// \TODO: Should this be mutex'ed to prevent multiple seqIDs being reused at once?
-    uint32_t& Network::getSequenceID()
+    /// send() runs on any thread, every caller gets its own ID
+    uint32_t Network::getSequenceID()
+    {
+        uint32_t current = m_seqID.load(std::memory_order_relaxed);
+        uint32_t next = 0;
+        do { next = (current >= MAX_SEQ_ID) ? MIN_SEQ_ID : current + 1; }
+        while(!m_seqID.compare_exchange_weak(current, next, std::memory_order_relaxed));
+        return next;
+    }
+
+    bool Network::hasUnacked(const ConnectionKey& key) const
     {
-        if(m_seqID >= MAX_SEQ_ID) { m_seqID = MIN_SEQ_ID; } else { m_seqID++; }
-        return m_seqID;
+        return m_storedSequences.any([&key](const uint32_t&, const std::shared_ptr<StoredSequence>& ss) { return (!ss->isAcked() && ConnectionKey(ss->getDestination()) == key); });
     }
 }
@@ -3,17 +3,29 @@
 
 #include "common/types.h"
 #include "common/SafeQueue.h"
+#include "common/SPSCRing.h"
+#include "common/MPSCRing.h"
+#include "common/Histogram.h"
+#include "common/OpenAddressMap.h"
 #include "common/SafeUnorderedMap.h"
 #include "common/CRC32.h"
 #include "common/util.h"
 #include "net/Builtin_OP_Codes.h"
 #include "net/Builtin_Structs.h"
 #include "net/PacketPair.h"
+#include "net/PacketView.h"
 #include "net/PacketSequence.h"
+#include "net/SendBuffer.h"
 #include "net/Datagram.h"
+#include "net/NetTimer.h"
+#include "net/ConnectionKey.h"
+#include "net/CongestionControl.h"
+#include "net/ReceiveWindow.h"
+#include "net/NetStats.h"
 #include "net/NetSocket.h" // Socket
 #include "net/Connection.h" // NetConnection
 #include "net/net_util.h"
+#include "net/Reactor.h"
 #include "srv/Time.h"
 //#include <event2/event.h> // libevent 2.1.8
 #include <sys/poll.h> // poll()
@@ -22,6 +34,11 @@
 #include <mutex>
 #include <condition_variable>
 #include <cmath>
+#include <vector>
+#include <deque>
+#include <memory> // shared_ptr
+#include <unordered_map>
+#include <algorithm>
 
 
 /*
@@ -103,22 +120,56 @@
 /// \TODO: Re-evaluate poll() with or without spin locking
 /// \TODO: Remove/cleanup/something with TCP remnants
 
+#define NET_RECEIVE_QUEUE_SIZE 4096 // listen -> update hand-off, datagrams are dropped when full
+#define NET_SEND_QUEUE_SIZE 8192 // any thread -> send hand-off, producers wait when full
+#define NET_UPDATE_BATCH 64 // datagrams pulled from the receive queue at once
+#define NET_COALESCE_DELAY_US 1000 // longest a small message waits for company in its destination's coalesce buffer
+#define NET_COALESCE_MAX_MESSAGE 256 // larger payloads are sent on their own
+
 namespace NetworkType { enum FORMS { NONE, Base, Server, Client, InternalServer, InternalClient, CustomServer, CustomClient, Peer, END }; }
 
 namespace CGameEngine
 {
+    class SnapshotChannel;
+
+    /// a packet on its way out, it owns a copy of the destination and one SendBuffer reference to data
     struct OutboundPacket
     {
-    	OutboundPacket(sockaddr_storage* destination, unsigned char* packetData, uint32_t packetSize)
-    		: addr(destination), data(packetData), pSize(packetSize) { }
-    	~OutboundPacket() { addr = nullptr; data = nullptr; }
-    	sockaddr_storage* addr = nullptr;
+        OutboundPacket() {} // ring slot
+    	OutboundPacket(const sockaddr_storage* destination, unsigned char* packetData, uint32_t packetSize)
+    		: data(packetData), pSize(packetSize) { copyAddress(&addr, destination); }
+    	~OutboundPacket() { data = nullptr; }
+    	sockaddr_storage addr; // copied, receive slots and expired sequences are reused long before sendLoop() gets here
 
     	int fd = -1;
-    	unsigned char* data = nullptr;
+    	unsigned char* data = nullptr; // released by sendLoop() once sent or dropped
         uint32_t pSize = 0;
     };
 
+    /// last message number handed out per DeliveryMode, for one destination
+    struct ChannelSequences
+    {
+        uint32_t last[DeliveryMode::END] = { 0 };
+    };
+
+    /// small messages for one destination waiting to go out as a single OP_Coalesced datagram
+    struct CoalesceBuffer
+    {
+        sockaddr_storage addr;
+        unsigned char* data = nullptr; // PACKET_DATA_SIZE pool buffer of entries
+        uint16_t length = 0;
+        uint16_t count = 0; // messages
+        uint64_t firstUS = 0; // first message packed, the delay runs from here
+        bool paced = false; // holds a user message, builtins alone skip the pacing bucket as they always have
+    };
+
+    /// packets for one destination waiting on its pacing bucket, sendLoop() only
+    struct PacedBacklog
+    {
+        std::shared_ptr<CongestionControl> cc;
+        std::deque<OutboundPacket> packets;
+    };
+
     // A = 10.0.0.0/8
     // B = 172.16.0.0/16
     // C = 192.168.1.0/24
@@ -128,11 +179,11 @@ namespace CGameEngine
     {
         public:
             Network() {}
-            Network(SoftwareVersion* swv, uint16_t port, SafeQueue<Datagram*>* dgbuff, std::string hostname = "");
+            Network(SoftwareVersion* swv, uint16_t port, SafeQueue<Datagram*>* dgbuff, std::string hostname = "", bool reusePort = false);
             virtual ~Network();
             virtual void updateLoop() = 0;
             virtual bool shutdownSockets() = 0;
-            virtual bool isPacketValid(Packet* p, sockaddr_storage* sender = nullptr) = 0;
+            virtual bool isPacketValid(const PacketView& p, sockaddr_storage* sender = nullptr) = 0;
             virtual void listenLoop();
             virtual void sendLoop();
             void stop();
@@ -140,14 +191,22 @@ namespace CGameEngine
             void generateInternalAddress(uint16_t port, addrinfo** dst, std::string hostname = "");
             const bool& isAccepting() const { return m_netListening; } // is network accepting outside connections
             const bool& isActive() const { return m_isActive; } // is network object functioning
+            const bool usesReactor() const { return m_reactor != nullptr; } // receive side runs on a shared Reactor rather than m_listenThread
             bool isPortOpen(uint16_t port); // network
 
             void broadcast(uint16_t port, uint16_t opCode, unsigned char** data, uint32_t dataLength);
-            void send(sockaddr_storage* addr, uint16_t opCode, unsigned char** data, uint32_t dataLength);
+            void send(sockaddr_storage* addr, uint16_t opCode, unsigned char** data, uint32_t dataLength, uint8_t delivery = DeliveryMode::ReliableUnordered);
             void sendBuiltin(sockaddr_storage* addr, uint16_t opCode, uint32_t seqID = 0, uint32_t pktNum = 0);
-            void sendRetryResponse(sockaddr_storage* addr, Packet* p);
+            void sendBuiltinData(sockaddr_storage* addr, uint16_t opCode, const void* payload, uint16_t dataLength, uint32_t seqID = 0); // single packet builtin with a small struct as payload, sent immediately unless small enough to coalesce
+            void sendRetryResponse(sockaddr_storage* addr, const StoredFragment* f);
+            void sendSelectiveAck(sockaddr_storage* addr, uint32_t seqID, const SelectiveAck_Struct& sack);
             void sendSimple(sockaddr_storage* addr, uint16_t opCode);
             void setAccepting(bool val = true);
+            void setSelectiveAck(bool val = true) { m_selectiveAck = val; } // request retransmissions with one SACK bitmap, or a request per fragment
+            void setReceiveBatchSize(uint16_t val); // datagrams pulled per recvmmsg(), 1 disables batching
+            void setSendBatching(uint16_t batchSize, std::chrono::microseconds linger = std::chrono::microseconds(0)); // datagrams per sendmmsg(), 1 disables batching
+            void setCoalescing(std::chrono::microseconds delay); // how long small messages wait to share a datagram, 0 disables coalescing
+            void setReceiveWindow(uint64_t connectionBytes, uint64_t globalBytes, bool dropUnreliable = true); // bound Datagrams the user has not deleted yet, per connection limit applies to new connections
             void setTitle(std::string str);
             void setUniqueID(uint32_t& id) { m_uniqueID = id; }
             //void setEventConditionVariable(std::condition_variable* cv) { m_userCV = cv; }
@@ -156,6 +215,38 @@ namespace CGameEngine
             const uint8_t& getNetworkType() const { return m_networkType; }
             const uint32_t& getUniqueID() const { return m_uniqueID; }
             const std::string getIPAddress() const { return getIPString(m_srcAddress); }
+            const bool& isSelectiveAck() const { return m_selectiveAck; }
+            const uint16_t getReceiveBatchSize() const { return m_rxBatchSize.load(std::memory_order_relaxed); }
+            BatchStats getReceiveBatchStats() const { return m_rxBatchStats.snapshot(); }
+            const uint16_t getSendBatchSize() const { return m_txBatchSize.load(std::memory_order_relaxed); }
+            BatchStats getSendBatchStats() const { return m_txBatchStats.snapshot(); }
+            const uint64_t getCoalescingDelay() const { return m_coalesceDelayUS.load(std::memory_order_relaxed); } // microseconds, 0 = disabled
+            BatchStats getCoalesceStats() const { return m_coalesceStats.snapshot(); } // messages per coalesced datagram, see average()
+            const uint64_t getReceiveQueueDrops() const { return m_rxQueueDrops.load(std::memory_order_relaxed); } // receive queue was full
+            const uint64_t getSendQueueStalls() const { return m_txQueueStalls.load(std::memory_order_relaxed); } // a producer had to wait on a full send queue
+            ReceiveWindowStats getReceiveWindowStats() const { return m_receiveWindow->snapshot(); } // every connection together, see Connection::getReceiveWindowStats()
+            const bool isDroppingUnreliable() const { return m_dropUnreliable.load(std::memory_order_relaxed); }
+            std::shared_ptr<ReceiveWindow> makeReceiveWindow() { return std::make_shared<ReceiveWindow>(m_connectionWindow.load(std::memory_order_relaxed), m_receiveWindow); } // a new connection's
+            HistogramSnapshot getDeliveryLatency() const { return m_stats.snapshot().histograms[NetHistogram::DeliveryLatencyUS]; } // microseconds, datagram arrival to Datagram push
+            NetStats& getNetStats() { return m_stats; } // recording, Connection and PacketSequence
+            NetStatsSnapshot getStatsSnapshot() const; // counters, histograms and current queue depths, any thread
+            void setTracing(bool val = true) { m_stats.setTracing(val); } // keep the last NET_TRACE_EVENTS packet/sequence events
+            std::vector<NetTraceEvent> getTrace() const { return m_stats.getTrace(); }
+            virtual const unsigned int getConnectionCount() const { return 0; }
+            void recordDeliveryLatency(const uint64_t& arrivalUS); // called by Connection as each Datagram is handed to the user
+            std::shared_ptr<CongestionControl> addCongestion(const ConnectionKey& key); // one per connection, existing one if already added
+            std::shared_ptr<CongestionControl> getCongestion(const ConnectionKey& key); // nullptr if the destination has no connection
+            void removeCongestion(const ConnectionKey& key);
+            CongestionStats getCongestionStats(const sockaddr_storage* addr); // empty if the destination has no connection
+            void resetChannels(const ConnectionKey& key); // connection gone, its delivery modes start over at 1
+            ChannelSequences getChannels(const ConnectionKey& key); // all zero if nothing was sent there yet
+            void setChannels(const ConnectionKey& key, const ChannelSequences& seq); // connection handed over from another process
+            void addSnapshotChannel(SnapshotChannel* channel); // receives the snapshot acks for its OPCode
+            void removeSnapshotChannel(SnapshotChannel* channel);
+            void setPacing(bool val = true) { m_pacing = val; } // pace sends to connected destinations
+            const bool isPacing() const { return m_pacing; }
+            TimerID scheduleTimer(const uint64_t& deadline, const NetTimer& t); // MS timestamp, fired from updateLoop()
+            void cancelTimer(TimerID& id); // no-op if already fired, zeroes id
 
             // thread starters
             static void startListenLoop(Network* n) { n->listenLoop(); }
@@ -164,15 +255,49 @@ namespace CGameEngine
 
         protected:
             virtual bool initSockets();
-            virtual uint32_t& getSequenceID();
+            virtual uint32_t getSequenceID(); // any thread
+            bool hasUnacked(const ConnectionKey& key) const; // a reliable send to key is still waiting for its OP_Ack
+            void startListening(); // listenLoop() thread, or a handler on the shared Reactor while accepting
+            void attachReactor();
+            void detachReactor(); // no handler runs once this returns
+            void joinThreads(); // stop() and wait for the listen, update and send threads, the queues have no consumer after this
+            void drainSocket(ReceiveRing*& ring); // until the socket is dry, (re)builds ring for m_rxBatchSize
+            void processDatagram(ReceiveRing& ring, uint16_t slot);
+            bool dispatchPacket(sockaddr_storage* sender, const PacketView& p, const uint64_t& arrivalUS); // listenLoop() only, true if updateLoop() should have it
+            void handOff(sockaddr_storage& sender, unsigned char* buffer, uint32_t length, const uint64_t& arrival, const uint64_t& arrivalUS); // takes the buffer
+            void unpackCoalesced(sockaddr_storage& sender, const PacketView& p, const uint64_t& arrival, const uint64_t& arrivalUS); // listenLoop() only
+            bool coalesce(sockaddr_storage* addr, const unsigned char* packet, uint32_t pSize, bool paced); // false if the packet has to be sent on its own
+            uint64_t takeCoalesced(const uint64_t& nowUS, std::vector<CoalesceBuffer>& out); // sendLoop() only, US until the next buffer is due
+            void sendDirect(const sockaddr_storage* addr, unsigned char* data, uint32_t pSize); // bypassing sendLoop(), counted
+            void admitCoalesced(std::vector<CoalesceBuffer>& coalesced, const uint64_t& nowUS, std::vector<OutboundPacket>& ready); // sendLoop() only
+            static uint16_t writeCoalescedEntry(unsigned char* out, const PacketView& p);
+            static uint32_t readCoalescedEntry(const unsigned char* entry, uint32_t available, const unsigned char* ident, const uint8_t* swver, const uint64_t& timestamp, unsigned char* packet, uint32_t& packetLength); // packet holds PACKET_MAX_SIZE, 0 if malformed
+            void queueOutbound(const sockaddr_storage* addr, unsigned char* data, uint32_t pSize); // takes a SendBuffer reference
+            void admitOutbound(OutboundPacket& op, const uint64_t& nowUS, std::vector<OutboundPacket>& ready); // sendLoop() only
+            uint64_t releasePaced(const uint64_t& nowUS, std::vector<OutboundPacket>& ready); // sendLoop() only, US until the next paced packet
+            void prunePaced(); // sendLoop() only, nothing in flight may point at a backlog
+            void flushOutbound(std::vector<OutboundPacket>& ready, SendBatch*& batch, pollfd* ufds); // sendLoop() only
+            void resendSelective(sockaddr_storage* sender, const PacketView& p, const uint64_t& arrivalUS); // listenLoop() only
+            void snapshotAck(sockaddr_storage* sender, const PacketView& p); // listenLoop() only
+            uint32_t nextChannelSeq(const sockaddr_storage* addr, uint8_t delivery);
+            void expireStored(uint32_t seqID, const uint64_t& timestamp); // updateLoop() only
+            void resendStored(uint32_t seqID, const uint64_t& timestamp); // updateLoop() only
+            void runTimers(const uint64_t& timestamp); // updateLoop() only
+            std::chrono::milliseconds timeUntilTimers(const uint64_t& timestamp); // capped at HEARTBEAT_INTERVAL
+            virtual void connectionExpired(Connection* /*conn*/) {} // a connection's timer asked for it to be destroyed
+            virtual void networkTimer(const NetTimer& /*t*/, const uint64_t& /*timestamp*/) {} // timers without a connection, not handled by Network
             bool m_isConnected = false; // TCP ONLY
             bool m_isActive = false; // used to signify a working network object
             bool m_isTCP = false; // TCP ONLY
             bool m_netListening = false; // used to delay connections during server boot
+            bool m_selectiveAck = false; // receiving side asks for missing fragments with OP_SelectiveAck, not OP_RetransmissionRequest (off until loss_bench shows it ahead)
+            bool m_reusePort = false; // socket shares its port (SO_REUSEPORT) with sibling shards
             int m_pollTimeout = 3000;
             uint8_t m_networkType = NetworkType::Base;
             uint16_t m_srcPort = 0; // listening port
-            uint32_t m_seqID = 1; // 0 - 1bil for srv, 1bil - 4bil for client (1k IDs per client)
+            std::atomic<uint16_t> m_rxBatchSize { 32 }; // datagrams pulled per listen syscall, set from any thread
+            std::atomic<uint16_t> m_txBatchSize { 32 }; // datagrams flushed per send syscall, set from any thread
+            std::atomic<uint32_t> m_seqID { 1 }; // 0 - 1bil for srv, 1bil - 4bil for client (1k IDs per client)
             uint32_t m_uniqueID = 0;
             std::string m_identifier = "";
             std::string m_title = "";
@@ -181,22 +306,52 @@ namespace CGameEngine
             addrinfo* m_srcAddress = nullptr; // this device's address
             NetSocket* m_socket = nullptr; // this device's default socket (0.0.0.0 equivalent)
             SafeQueue<Datagram*>* m_datagramBuffer = nullptr; // default datagram buffer
-            SafeQueue<OutboundPacket> m_sendQueue;
-            SafeQueue<PacketPair> m_packetBuffer;
+            MPSCRing<OutboundPacket> m_sendQueue { NET_SEND_QUEUE_SIZE }; // consumed by sendLoop() only
+            SPSCRing<PacketPair> m_packetBuffer { NET_RECEIVE_QUEUE_SIZE }; // produced by listenLoop(), consumed by updateLoop()
             SoftwareVersion* m_version = nullptr;
             std::condition_variable m_sendCV;
             std::condition_variable m_updateCV;
             //std::condition_variable* m_userCV = nullptr;
             std::thread* m_listenThread = nullptr; // active thread
+            Reactor* m_reactor = nullptr; // replaces m_listenThread when set
+            ReceiveRing* m_reactorRing = nullptr; // only touched by the reactor handler
+            bool m_reactorAttached = false;
+            std::mutex m_reactorMutex; // m_reactorAttached
             std::thread* m_sendThread = nullptr; // idle thread
             std::thread* m_updateThread = nullptr; // semi-active thread
-            SafeUnorderedMap<uint32_t, StoredSequence*> m_storedSequences;
+            SafeUnorderedMap<uint32_t, std::shared_ptr<StoredSequence>> m_storedSequences; // shared, the listen thread may hold one while updateLoop() drops it
             SafeUnorderedMap<int, std::pair<NetSocket*, SafeQueue<Datagram*>*>> m_socketPairs; // FD and its associated datagram buffer
+            BatchCounters m_rxBatchStats; // datagrams returned per recvmmsg()
+            BatchCounters m_txBatchStats; // datagrams accepted per sendmmsg()
+            std::atomic<uint64_t> m_txLingerUS { 0 }; // wait for a partial batch to fill, set from any thread
+            std::atomic<uint64_t> m_rxQueueDrops { 0 };
+            std::atomic<uint64_t> m_txQueueStalls { 0 };
+            NetStats m_stats;
+            std::shared_ptr<ReceiveWindow> m_receiveWindow = std::make_shared<ReceiveWindow>(NET_RECV_WINDOW_GLOBAL); // parent of every connection's
+            std::atomic<uint64_t> m_connectionWindow { NET_RECV_WINDOW_CONNECTION };
+            std::atomic<bool> m_dropUnreliable { true };
+            std::atomic<bool> m_pacing { true };
+            std::mutex m_congestionMutex;
+            OpenAddressMap<ConnectionKey, std::shared_ptr<CongestionControl>, ConnectionKeyHash> m_congestion; // per connection, any thread under m_congestionMutex
+            std::unordered_map<ConnectionKey, PacedBacklog, ConnectionKeyHash> m_paced; // destinations with packets held back, sendLoop() only
+            std::mutex m_channelMutex;
+            std::unordered_map<ConnectionKey, ChannelSequences, ConnectionKeyHash> m_channels; // per destination, under m_channelMutex
+            std::mutex m_coalesceMutex;
+            std::unordered_map<ConnectionKey, CoalesceBuffer, ConnectionKeyHash> m_coalesce; // destinations with messages waiting, under m_coalesceMutex
+            std::vector<CoalesceBuffer> m_coalesceFull; // filled before their delay ran out, under m_coalesceMutex
+            std::atomic<uint64_t> m_coalesceDelayUS { NET_COALESCE_DELAY_US };
+            BatchCounters m_coalesceStats; // messages per flushed coalesce buffer
+            std::mutex m_snapshotMutex;
+            std::vector<SnapshotChannel*> m_snapshotChannels; // not owned, under m_snapshotMutex
+            std::mutex m_timerMutex; // send() schedules from user threads
+            TimerWheel<NetTimer> m_timers { NET_TIMER_TICK_MS, Time::getInstance().steadyMS() }; // connection, sequence and retry deadlines
 
             // near static values for sequence ID generation
             uint32_t MIN_SEQ_ID = 1;
             uint32_t MAX_SEQ_ID = 2000000000;
             std::chrono::milliseconds HEARTBEAT_INTERVAL = std::chrono::milliseconds(250);
+            const uint16_t MAX_RECEIVE_BATCH = 1024;
+            const uint16_t MAX_SEND_BATCH = 1024;
     };
 }
 
@@ -14,7 +14,7 @@ namespace CGameEngine
             m_dstPort = dstPort;
             generateAddress(dstHostname, m_dstPort, &m_dstAddress);
             m_sendThread = new std::thread(startSendLoop, this); // send processing
-            m_listenThread = new std::thread(startListenLoop, this); // network (tcp/udp) listen thread
+            startListening(); // listen thread, or the shared Reactor
             m_updateThread = new std::thread(startUpdateLoop, this); // all network traffic update loop
             m_networkType = NetworkType::Client;
 
@@ -38,11 +38,11 @@ namespace CGameEngine
 
     bool NetworkClient::shutdownSockets()
     {
-        m_isActive = false;
-        m_netListening = false;
-        m_sendQueue.clear();
-        m_packetBuffer.clear();
-        while(!m_packetBuffer.empty()) { m_packetBuffer.front().destroy(); m_packetBuffer.pop(); }
+        joinThreads(); // the queues are single consumer and the update thread runs the connections' timers
+        OutboundPacket op;
+        while(m_sendQueue.pop(op)) { SendBuffer::release(op.data); }
+        PacketPair pp;
+        while(m_packetBuffer.pop(pp)) { pp.destroy(); }
         if(m_dstAddress) { /*delete m_dstAddress;*/ freeaddrinfo(m_dstAddress); m_dstAddress = nullptr; }
         m_dstPort = -1;
         m_dstHostname = "";
@@ -51,123 +51,140 @@ namespace CGameEngine
         return true;
     }
 
-    bool NetworkClient::isPacketValid(Packet* p, sockaddr_storage* sender /*= nullptr*/)
+    /// server connection timed out or was closed, a new OP_ConnectionAccepted is needed before traffic flows again
+    void NetworkClient::connectionExpired(Connection* conn)
     {
-        bool retVal = (p->matchesVersion(m_version) && sender);// && isSameSource(sender, m_dstAddress));
+        if(conn != m_serverConnection) { return; }
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkClient::connectionExpired()", "Server connection closed.");
+        safeDelete(m_serverConnection);
+        m_isConnectionAccepted = false;
+    }
+
+    bool NetworkClient::isPacketValid(const PacketView& p, sockaddr_storage* sender /*= nullptr*/)
+    {
+        bool retVal = (p.matchesVersion(m_version) && sender);// && isSameSource(sender, m_dstAddress));
         return retVal;
     }
 
     void NetworkClient::updateLoop()
     {
         std::queue<std::string> toBeClosed;
+        std::vector<PacketPair> batch(NET_UPDATE_BATCH);
         std::mutex ulmutex;
         std::unique_lock<std::mutex> updateLock(ulmutex);
 
         while(m_isActive)
         {
-            if(m_packetBuffer.empty()) { m_updateCV.wait(updateLock); }
-
-            int pkts = m_packetBuffer.size();
-            while(pkts > 0)
+            // listenLoop pushes without a lock, so never wait indefinitely on a notify that may have been missed
+            if(m_packetBuffer.empty())
             {
-                PacketPair* pp = &m_packetBuffer.front();
-                Packet* p = pp->pkt;
-                sockaddr_storage* sender = &pp->sas;
-                uint32_t pktCRC = 0;
+                std::chrono::milliseconds wait = timeUntilTimers(Time::getInstance().steadyMS());
+                if(wait.count() > 0) { m_updateCV.wait_for(updateLock, wait); }
+            }
+            Time::getInstance().tick(); // connections read cachedMS() for this pass
 
-                // catch line
-                if(!p || !sender) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkClient::updateLoop()", "Broken PacketPair!"); /*p = nullptr; sender = nullptr;*/}
-                else
+            // drain the receive queue, one batch at a time
+            size_t pkts = 0;
+            while((pkts = m_packetBuffer.popBatch(batch.data(), batch.size())) > 0)
+            {
+                for(size_t i = 0; i < pkts; i++)
                 {
-                    bool broken = true;
+                    PacketPair* pp = &batch[i];
+                    const PacketView& p = pp->view;
+                    sockaddr_storage* sender = &pp->sas;
 
-                    // check identifier
-                    try { broken = memcmp(p->identifier, m_identifier.c_str(), IDENT_SIZE); }
-                    catch (...) { broken = true; }
-
-                    if(broken)
-                    {
-                       Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkClient::updateLoop()", "Packet did NOT meet identifier! [{}] ({} remaining)", m_identifier, pkts);
-                    }
+                    // catch line
+                    if(!pp->buffer || !p.isDecoded()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkClient::updateLoop()", "Broken PacketPair!"); }
                     else
                     {
-                        // if connection has not been "accepted" yet
-                        if(!m_isConnectionAccepted)
+                        // check identifier
+                        bool broken = !p.matchesIdentifier(m_identifier);
+
+                        if(broken)
                         {
-                            if(p->op_code == OP_ConnectionAccepted)
-                            {
-                               Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkClient::updateLoop()", "Connection accepted by server.");
-                                m_isConnectionAccepted = true;
-                                std::string ipStr = getIPString(sender);
-                                m_serverConnection = new NetConnection(this, sender, ipStr, 1, m_datagramBuffer);
-                                m_serverConnection->addPacket(&p);
-                            }
-                            else
-                            {
-                               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkClient::updateLoop()", "Connection is not accepted, yet packet with OP Code [{}] arrived and was discarded. Packet Validity [{}], sender [{}]", p->op_code, false, getIPString(sender));
-                            }
+                           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkClient::updateLoop()", "Packet did NOT meet identifier! [{}] ({} remaining)", m_identifier, pkts-i);
                         }
-                        else // normal packet activity
+                        else
                         {
-                            /// \TODO: FLESH THIS OUT
-                            switch(p->op_code)
+                            // if connection has not been "accepted" yet
+                            if(!m_isConnectionAccepted)
                             {
-                                case OP_RetransmissionAck:
-                                {
-                                    /// \TODO: Destroy sequence within connection
-                                   Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "Received retransmissions ACK! seqID [{}], pktNum [{}]", p->seqIdent, p->pktNum);
-                                    m_serverConnection->addPacket(&p);
-                                    break;
-                                }
-                                case OP_RetransmissionImpossible:
+                                if(p.op_code == OP_ConnectionAccepted)
                                 {
-                                    /// \TODO: Destroy sequence within connection
-                                   Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "Received retransmissions impossible! seqID [{}], pktNum [{}]", p->seqIdent, p->pktNum);
-                                    m_serverConnection->addPacket(&p);
-                                    break;
+                                   Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkClient::updateLoop()", "Connection accepted by server.");
+                                    m_isConnectionAccepted = true;
+                                    std::string ipStr = getIPString(sender);
+                                    m_serverConnection = new NetConnection(this, sender, ipStr, 1, m_datagramBuffer);
+                                    m_serverConnection->addPacket(*pp);
                                 }
-                                case OP_ConnectionDisconnect:
+                                else
                                 {
-                                    /// \TODO: Create way to handle server disconnecting this client
-                                   Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkClient::updateLoop()", "Closing connection to server!");
-                                    m_serverConnection->setClosed(true);
-                                    break;
+                                   Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkClient::updateLoop()", "Connection is not accepted, yet packet with OP Code [{}] arrived and was discarded. Packet Validity [{}], sender [{}]", p.op_code, false, getIPString(sender));
                                 }
-                                case OP_Ack: // sequence has completed or destroyed, let sender know
-                                {
-                                   Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "Received ACK for seqID [{}].", p->seqIdent);
-                                    m_serverConnection->addPacket(&p);
-                                    break;
-                                }
-                                case OP_ConnectionAccepted: // clients may need multiple accepted replies
+                            }
+                            else // normal packet activity
+                            {
+                                /// \TODO: FLESH THIS OUT
+                                switch(p.op_code)
                                 {
-                                    if(sender != getDstSock())
+                                    case OP_RetransmissionAck:
                                     {
-                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "Additional OP_ConnectionAccepted.");
-                                        m_serverConnection->addPacket(&p);
+                                        /// \TODO: Destroy sequence within connection
+                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "Received retransmissions ACK! seqID [{}], pktNum [{}]", p.seqIdent, p.pktNum);
+                                        m_serverConnection->addPacket(*pp);
+                                        break;
                                     }
-                                    else
+                                    case OP_RetransmissionImpossible:
                                     {
-                                       Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkClient::updateLoop()", "Additional OP_ConnectionAccepted from base connection!");
+                                        /// \TODO: Destroy sequence within connection
+                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "Received retransmissions impossible! seqID [{}], pktNum [{}]", p.seqIdent, p.pktNum);
+                                        m_serverConnection->addPacket(*pp);
+                                        break;
+                                    }
+                                    case OP_ConnectionDisconnect:
+                                    {
+                                        /// \TODO: Create way to handle server disconnecting this client
+                                       Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkClient::updateLoop()", "Closing connection to server!");
+                                        m_serverConnection->setClosed(true);
+                                        break;
+                                    }
+                                    case OP_Ack: // sequence has completed or destroyed, let sender know
+                                    {
+                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "Received ACK for seqID [{}].", p.seqIdent);
+                                        m_serverConnection->addPacket(*pp);
+                                        break;
+                                    }
+                                    case OP_ConnectionAccepted: // clients may need multiple accepted replies
+                                    {
+                                        if(sender != getDstSock())
+                                        {
+                                           Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "Additional OP_ConnectionAccepted.");
+                                            m_serverConnection->addPacket(*pp);
+                                        }
+                                        else
+                                        {
+                                           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkClient::updateLoop()", "Additional OP_ConnectionAccepted from base connection!");
+                                        }
+                                        break;
+                                    }
+                                    default: // normal packets
+                                    {
+                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "'default' case hit, OP [{}]", p.op_code);
+                                        m_serverConnection->addPacket(*pp); // add packet to connection
+                                        break;
                                     }
-                                    break;
-                                }
-                                default: // normal packets
-                                {
-                                   Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::updateLoop()", "'default' case hit, OP [{}]", p->op_code);
-                                    m_serverConnection->addPacket(&p); // add packet to connection
-                                    break;
                                 }
                             }
                         }
                     }
-                }
 
-                // remove packet
-                safeDelete(p);
-                m_packetBuffer.pop();
-                pkts--;
+                    // release the receive buffer, unless a connection kept it
+                    pp->destroy();
+                }
             }
+
+            // server connection and stored sequence deadlines
+            runTimers(Time::getInstance().tick() / 1000000);
         }
 
         // release lock
@@ -175,93 +192,4 @@ namespace CGameEngine
 
        Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkClient::updateLoop()", "Exiting updateLoop().");
     }
-
-    /*void NetworkClient::listenLoop()
-    {
-        unsigned char* buffer = new unsigned char[PACKET_MAX_SIZE];
-        struct sockaddr_storage sender;
-        int bytes_read = 0;
-        int retVal = 0;
-
-        // poll()
-        struct pollfd ufds[1]; // only listening port (for now...)
-        ufds[0].fd = m_socket->getFD();
-        ufds[0].events = POLLIN | POLLPRI;
-        //ufds[0].revents = POLLERR | POLLHUP;
-
-        while(m_isActive)
-        {
-            // if not accepting connections yet, keep skipping
-            if(!m_netListening) { continue; }
-            //std::unique_lock<std::mutex> loopLock(llmutex);
-
-            // clear buffer and bytes_read, setup sender variable
-            memset(buffer, 0, PACKET_MAX_SIZE);
-            memset(&sender, 0, sizeof(struct sockaddr_storage));
-            bytes_read = 0;
-            retVal = 0;
-
-            // actually poll for data
-            retVal = poll(ufds, 1, m_pollTimeout); // parse all sockets, all 1 of them, never timeout
-
-            if(retVal < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkClient::listenLoop()", "poll() returned [{}], this is likely fatal. Stopping loop", retVal); m_isActive = false; }
-            //else if(retVal == 0) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkClient::listenLoop()", "poll() timed out without data. This may be bad."); } /// \TODO: Is this important or even accurate?
-            else if(retVal > 0 && ufds[0].revents & POLLIN)
-            {
-                bytes_read = m_socket->receive(&sender, buffer); // read in data
-                if(bytes_read <= PACKET_MIN_RCV_SIZE) // catch spurious wake-ups or bad data
-                {
-                   Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkClient::listenLoop()", "bytes_read [{}] <= PACKET_MIN_RCV_SIZE [{}]", bytes_read, PACKET_MIN_RCV_SIZE);
-                    continue;
-                }
-
-               Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkClient::listenLoop()", "--- NetworkClient::listenLoop: Bytes Read [{}] ---", bytes_read);
-                Packet* p = new Packet(buffer, bytes_read, Time::getInstance().nowMS());
-
-                // packet arrived from expected source and isn't broken
-                if(isPacketValid(p) && isSameSource(&sender, m_dstAddress))
-                {
-                    // immediate reply of retry requests
-                    if(p->op_code == OP_RetransmissionRequest)
-                    {
-                        bool found = false;
-                        auto seq = m_storedSequences.find(p->seqIdent);
-
-                        if(seq != m_storedSequences.end())
-                        {
-                            Packet* pkt = seq->second->getPacketByNumber(p->pktNum);
-                            if(pkt)
-                            {
-                               Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::listenLoop()", "Sending retransmission of seqID [{}], pkt# [{}]", pkt->seqIdent, pkt->pktNum);
-                                sendRetryResponse(pkt);
-                                found = true;
-                            }
-                        }
-
-                        // packet sequence already destroyed
-                        if(!found) { Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::listenLoop()", "Sending retry impossible for seqID [{}]!", p->seqIdent); sendBuiltin(OP_RetransmissionImpossible, p->seqIdent, p->pktNum); }
-                    }
-                    else
-                    {
-                        PacketPair pp(&p, sender);
-                        m_packetBuffer.push(pp);
-                        m_updateCV.notify_one();
-                    }
-                }
-                else
-                {
-                   Logger::getInstance().Log(Logs::DEBUG, "NetworkClient::listenLoop()", "Packet damaged or from unknown source [{}].", getIPString(&sender));
-                }
-
-                // cleanup, if not handed off
-                safeDelete(p);
-            }
-        }
-
-        safeDeleteArray(buffer);
-       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkClient::updateLoop()", "Exiting listenLoop().");
-        m_netListening = false;
-        m_isActive = false;
-        m_socket->closeSocket();
-    }*/
 }
@@ -17,18 +17,19 @@ namespace CGameEngine
             //void listenLoop() override;
             void updateLoop() override;
             bool shutdownSockets() override;
-            bool isPacketValid(Packet* p, sockaddr_storage* sender = nullptr) override;
+            bool isPacketValid(const PacketView& p, sockaddr_storage* sender = nullptr) override;
             //void setDestination(std::string host, uint16_t port) { m_dstPort = port; generateAddress(host, m_dstPort, &m_dstAddress); }
-            void send(uint16_t opCode, unsigned char** data, uint32_t dataLength) { Network::send((struct sockaddr_storage*)m_dstAddress->ai_addr, opCode, data, dataLength); }
+            void send(uint16_t opCode, unsigned char** data, uint32_t dataLength, uint8_t delivery = DeliveryMode::ReliableUnordered) { Network::send((struct sockaddr_storage*)m_dstAddress->ai_addr, opCode, data, dataLength, delivery); }
             void sendBuiltin(uint16_t opCode, uint32_t seqID = 0, uint32_t pktNum = 0) { Network::sendBuiltin((struct sockaddr_storage*)m_dstAddress->ai_addr, opCode, seqID, pktNum); }
             void sendSimple(uint16_t opCode) { Network::sendSimple((struct sockaddr_storage*)m_dstAddress->ai_addr, opCode); }
-            void sendRetryResponse(Packet* p) { Network::sendRetryResponse((struct sockaddr_storage*)m_dstAddress->ai_addr, p); }
+            void sendRetryResponse(const StoredFragment* f) { Network::sendRetryResponse((struct sockaddr_storage*)m_dstAddress->ai_addr, f); }
             static void startUpdateLoop(NetworkClient* n) { n->updateLoop(); }
             static void startNetListen(NetworkClient* n) { n->listenLoop(); }
             addrinfo* getDstAddress() { return m_dstAddress; }
             sockaddr_storage* getDstSock() { return (struct sockaddr_storage*)m_dstAddress->ai_addr; }
 
         protected:
+            void connectionExpired(Connection* conn) override;
             bool m_isConnectionAccepted = false; // client only, signify server accepted
             uint16_t m_dstPort = -1; // needed?
             std::string m_dstHostname = "";
@@ -15,7 +15,7 @@ namespace CGameEngine
             m_isActive = true;
             generateID();
            Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkIPC::NetworkIPC(str)", "Unix Socket opened [id {}, fd {}]", m_uniqueID, m_readSocket->getFD());
-            m_thread = new std::thread(startLoop, this);
+            startReading();
         }
         else { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkIPC::NetworkIPC(string, Network, SafeQueue)", "readSocket failed to open!"); }
     }
@@ -48,6 +48,7 @@ namespace CGameEngine
             m_thread->join();
             safeDelete(m_thread);
         }
+        safeDeleteArray(m_reactorBuffer);
 
         if(m_readSocket)
         {
@@ -68,6 +69,7 @@ namespace CGameEngine
     {
         m_isActive = false;
         m_isConnected = false;
+        detachReactor(); // a running handler may still push
         while(!m_unixPackets->empty()) { safeDelete(m_unixPackets->front()); m_unixPackets->pop(); }
        Logger::getInstance().Log(Logs::DEBUG, "NetworkIPC::shutdownSockets()", "Completed Successfully!");
         return true;
@@ -80,7 +82,6 @@ namespace CGameEngine
         ufds[0].fd = m_readSocket->getFD();
         ufds[0].events = POLLIN;
         int retVal = 0;
-        bool destroyPacket = true;
 
         // data variables
         unsigned char* buffer = new unsigned char[UNIX_PACKET_MAX_SIZE];
@@ -92,7 +93,6 @@ namespace CGameEngine
             memset(buffer, 0, PACKET_MAX_SIZE);
             bytes_read = 0;
             retVal = 0;
-            destroyPacket = true;
 
             // actually poll for data
             retVal = poll(ufds, 1, m_pollTimeout);
@@ -100,47 +100,10 @@ namespace CGameEngine
             if(retVal < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkIPC::mainLoop()", "poll() returned [{}], this is likely fatal. Stopping loop", retVal); m_isActive = false; }
             else if(retVal > 0 && ufds[0].revents & POLLIN) // normal data
             {
-                bytes_read = m_readSocket->receive(buffer);
+                int passedFD = -1;
+                bytes_read = m_readSocket->receive(buffer, &passedFD);
                 if(bytes_read <= 0) { continue; } // too small or empty
-
-                // build packet and process it
-                UnixPacket* up = new UnixPacket(buffer, bytes_read);
-                if(!m_isConnected && up->op_code == OP_KeepAlive)
-                {
-                   Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkIPC::mainLoop()", "Initial OP_KeepAlive, setting connected to true.");
-                    m_isConnected = true;
-                    m_unixPackets->push(up);
-                    destroyPacket = false;
-                }
-                else if(m_isConnected)
-                {
-                    switch(up->op_code)
-                    {
-                        case OP_KeepAlive:
-                        {
-                            // primary (left) sends it in, secondary (right) replies
-                            if(!m_isPrimary) { sendSimple(OP_KeepAlive, 0); }
-                            else { m_unixPackets->push(up); destroyPacket = false; }
-                            break;
-                        }
-                        case OP_IPCData:
-                        {
-                            if(m_uniqueID == 0) { m_uniqueID = up->senderID; }
-                            else { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkIPC::mainLoop()", "OP_IPCData received, but unique ID ({}) already set!", m_uniqueID); }
-                            break;
-                        }
-                        default:
-                        {
-                            m_unixPackets->push(up);
-                            if(m_cv) { m_cv->notify_one(); }
-                            destroyPacket = false;
-                            break;
-                        }
-                    }
-                }
-
-                // cleanup
-                if(destroyPacket) { safeDelete(up); }
+                processPacket(buffer, bytes_read, passedFD);
             }
             else if(retVal > 0)
             {
@@ -154,6 +117,78 @@ namespace CGameEngine
         m_readSocket->closeSocket();
     }
 
+    void NetworkIPC::startReading()
+    {
+        m_reactor = Reactor::getShared();
+        if(!m_reactor) { m_thread = new std::thread(startLoop, this); return; }
+
+        // edge triggered, the handler has to leave the socket dry
+        NetworkIPC* self = this;
+        m_reactorBuffer = new unsigned char[UNIX_PACKET_MAX_SIZE];
+        m_reactorAttached = m_reactor->add(m_readSocket->getFD(), ReactorEvent::Readable, [self](uint32_t /*events*/) { if(self->m_isActive) { self->drainSocket(); } });
+        if(!m_reactorAttached) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkIPC::startReading()", "Could not register fd [{}], nothing will be received.", m_readSocket->getFD()); }
+    }
+
+    void NetworkIPC::detachReactor()
+    {
+        if(!m_reactorAttached) { return; }
+        m_reactor->remove(m_readSocket->getFD());
+        m_reactorAttached = false;
+    }
+
+    void NetworkIPC::drainSocket()
+    {
+        int bytes_read = 0;
+        int passedFD = -1;
+        while(m_isActive && (bytes_read = m_readSocket->receive(m_reactorBuffer, &passedFD)) > 0) { processPacket(m_reactorBuffer, bytes_read, passedFD); }
+    }
+
+    void NetworkIPC::processPacket(unsigned char* buffer, int bytes_read, int passedFD /*= -1*/)
+    {
+        bool destroyPacket = true;
+
+        // build packet and process it, a passed descriptor goes wherever the packet goes
+        UnixPacket* up = new UnixPacket(buffer, bytes_read);
+        up->fd = passedFD;
+        if(!m_isConnected && up->op_code == OP_KeepAlive)
+        {
+           Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkIPC::processPacket()", "Initial OP_KeepAlive, setting connected to true.");
+            m_isConnected = true;
+            m_unixPackets->push(up);
+            destroyPacket = false;
+        }
+        else if(m_isConnected)
+        {
+            switch(up->op_code)
+            {
+                case OP_KeepAlive:
+                {
+                    // primary (left) sends it in, secondary (right) replies
+                    if(!m_isPrimary) { sendSimple(OP_KeepAlive, 0); }
+                    else { m_unixPackets->push(up); destroyPacket = false; }
+                    break;
+                }
+                case OP_IPCData:
+                {
+                    if(m_uniqueID == 0) { m_uniqueID = up->senderID; }
+                    else { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkIPC::processPacket()", "OP_IPCData received, but unique ID ({}) already set!", m_uniqueID); }
+                    break;
+                }
+                default:
+                {
+                    m_unixPackets->push(up);
+                    if(m_cv) { m_cv->notify_one(); }
+                    destroyPacket = false;
+                    break;
+                }
+            }
+        }
+
+
+        // cleanup
+        if(destroyPacket) { safeDelete(up); }
+    }
+
     /// Network (Process A) -> Process B
     void NetworkIPC::addDatagram(Datagram** dg)
     {
@@ -234,7 +269,7 @@ namespace CGameEngine
                     sendSimple(OP_KeepAlive);
                    Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkIPC::completePair()", "Secondary (right) side completed as readSocket connected.");
                     m_uniqueID = 0; // resetting as the primary (left) side will provide this
-                    m_thread = new std::thread(startLoop, this);
+                    startReading();
                 }
                 else
                 {
@@ -287,6 +322,23 @@ namespace CGameEngine
         safeDelete(d);
     }
 
+    /// Process A -> Process B, with a descriptor
+    bool NetworkIPC::handOff(int fd, uint16_t opCode, uint32_t senderID, const unsigned char* data, uint16_t dataLength)
+    {
+        if(!m_isActive || !m_isConnected || !m_writeSocket)
+        {
+           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkIPC::handOff()", "isActive is [{}], isConnected is [{}] and/or no writeSocket ({}).", m_isActive, m_isConnected, (void*)m_writeSocket);
+            return false;
+        }
+        else if(!m_isPrimary) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkIPC::handOff()", "Only the primary (left) side hands descriptors off."); return false; }
+        else if(fd < 0) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkIPC::handOff()", "No descriptor to hand off!"); return false; }
+        else if(dataLength > UNIX_PACKET_DATA_SIZE) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkIPC::handOff()", "Passed data is too large! Received {} bytes, max is {}.", dataLength, UNIX_PACKET_DATA_SIZE); return false; }
+
+        UnixPacket up(opCode, 0, senderID, dataLength, (unsigned char*)data);
+        up.serializeOut();
+        return m_writeSocket->sendData(up.buffer, up.pSize, fd);
+    }
+
     bool NetworkIPC::isReadConnected()
     {
         if(m_isActive && m_readSocket && m_readSocket->getFD() != -1) { return true; }
@@ -10,6 +10,10 @@
     Process A  <------>  Process B
     (primary)           (secondary)
 
+    handOff() sends a descriptor along with a packet (SCM_RIGHTS), the secondary finds it in the
+    UnixPacket's fd and takes it with takeFD(), an untaken one is closed with the packet. Used by
+    NetworkServer::handOff() to give a child process a client's connected socket.
+
     Ref:
         ancillary messaging : https://linux.die.net/man/3/cmsg
             Part 2 : https://stackoverflow.com/questions/28003921/sending-file-descriptor-by-linux-socket/
@@ -34,10 +38,12 @@ namespace CGameEngine
             void completePair();
             void sendSimple(uint16_t opCode, uint32_t sender = 0); // basic OPCode responses
             void send(uint16_t opCode, uint32_t senderID, unsigned char** data, uint16_t dataLength, uint64_t arrival = 0); // Process B -> Network (Process A)
+            bool handOff(int fd, uint16_t opCode, uint32_t senderID, const unsigned char* data, uint16_t dataLength); // Process A -> Process B, fd is duplicated into B, the caller still closes its own
             void stop() { m_isActive = false; }
             void setDisconnected() { m_isConnected = false; } // used when either side "dies"
 
             const bool& isConnected() const { return m_isConnected; }
+            const bool usesReactor() const { return m_reactor != nullptr; } // read side runs on a shared Reactor rather than m_thread
             bool isReadConnected();
             bool isWriteConnected();
             const uint32_t& getUniqueID() const { return m_uniqueID; }
@@ -48,6 +54,10 @@ namespace CGameEngine
 
         private:
             void generateID();
+            void startReading(); // mainLoop() thread, or a handler on the shared Reactor
+            void detachReactor(); // no handler runs once this returns
+            void drainSocket(); // reactor handler, until the read socket is dry
+            void processPacket(unsigned char* buffer, int bytes_read, int passedFD = -1);
             bool m_isActive = false;
             bool m_isConnected = false; // both sides connected
             bool m_isPrimary = false; // left side
@@ -58,6 +68,9 @@ namespace CGameEngine
             UnixSocket* m_writeSocket = nullptr;
             Network* m_net = nullptr; // primary side only!!
             std::thread* m_thread = nullptr;
+            Reactor* m_reactor = nullptr; // replaces m_thread when set
+            unsigned char* m_reactorBuffer = nullptr; // only touched by the reactor handler
+            bool m_reactorAttached = false;
             std::condition_variable* m_cv = nullptr;
 
             // this is the outbound queue on Process A (primary)
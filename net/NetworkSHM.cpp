@@ -0,0 +1,390 @@
+#include "net/NetworkSHM.h"
+#include "common/CRC32.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h> // syscall(), gethostname(), access()
+#include <climits>
+
+namespace CGameEngine
+{
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words have to be plain 32 bit integers");
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ring indices are shared between processes, they have to be lock free");
+    static_assert((SHM_RING_SIZE & (SHM_RING_SIZE - 1)) == 0, "SHM_RING_SIZE must be a power of two");
+
+    namespace
+    {
+        const uint32_t controlSize = (sizeof(ShmControl) + 63) & ~63u;
+        inline uint32_t recordSize(uint32_t length) { return (sizeof(ShmRecord) + length + 7) & ~7u; }
+
+        void futexWait(std::atomic<uint32_t>* word, uint32_t expected, uint32_t waitMS)
+        {
+            struct timespec ts;
+            ts.tv_sec = waitMS / 1000;
+            ts.tv_nsec = (waitMS % 1000) * 1000000;
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0); // EAGAIN if the word already moved on
+        }
+
+        void futexWake(std::atomic<uint32_t>* word)
+        {
+            word->fetch_add(1, std::memory_order_release);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+    }
+
+    /// ShmRing ///////////////////////////////////////////////////////////////
+
+    void ShmRing::attach(ShmRingHeader* header, unsigned char* buffer, uint32_t capacity)
+    {
+        m_header = header;
+        m_buffer = buffer;
+        m_capacity = capacity;
+        m_mask = capacity - 1;
+        m_headCache = m_header->head.load(std::memory_order_acquire);
+        m_tailCache = m_header->tail.load(std::memory_order_acquire);
+    }
+
+    /// a record never straddles the end, the tail of the buffer is skipped instead
+    uint32_t ShmRing::needed(const uint64_t& tail, uint32_t length) const
+    {
+        uint32_t need = recordSize(length);
+        uint32_t contiguous = m_capacity - (tail & m_mask);
+        return (contiguous < need) ? contiguous + need : need;
+    }
+
+    bool ShmRing::push(uint16_t opCode, uint32_t senderID, uint64_t timestamp, const unsigned char* data, uint32_t length)
+    {
+        uint32_t need = recordSize(length);
+        if(!m_header || need > m_capacity / 2) { return false; }
+
+        uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+        uint32_t skip = needed(tail, length) - need;
+        if(!fits(tail, skip + need))
+        {
+            m_headCache = m_header->head.load(std::memory_order_acquire);
+            if(!fits(tail, skip + need)) { return false; }
+        }
+
+        if(skip >= sizeof(ShmRecord))
+        {
+            ShmRecord* pad = reinterpret_cast<ShmRecord*>(m_buffer + (tail & m_mask));
+            pad->size = skip;
+            pad->flags = ShmRecordFlags::Wrap;
+        }
+        tail += skip;
+
+        ShmRecord* r = reinterpret_cast<ShmRecord*>(m_buffer + (tail & m_mask));
+        r->size = need;
+        r->op_code = opCode;
+        r->flags = ShmRecordFlags::NONE;
+        r->senderID = senderID;
+        r->dataLength = length;
+        r->timestamp = timestamp;
+        if(length > 0) { memcpy(reinterpret_cast<unsigned char*>(r) + sizeof(ShmRecord), data, length); }
+        m_header->tail.store(tail + need, std::memory_order_release);
+
+        // pairs with the consumer's store to readerSleeping before its last look at tail
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_header->readerSleeping.load(std::memory_order_relaxed)) { futexWake(&m_header->dataSeq); m_wakeups.fetch_add(1, std::memory_order_relaxed); }
+        return true;
+    }
+
+    UnixPacket* ShmRing::pop()
+    {
+        if(!m_header) { return nullptr; }
+
+        uint64_t head = m_header->head.load(std::memory_order_relaxed);
+        while(true)
+        {
+            if(head == m_tailCache)
+            {
+                m_tailCache = m_header->tail.load(std::memory_order_acquire);
+                if(head == m_tailCache) { return nullptr; }
+            }
+
+            // skipped tail of the buffer, the producer always follows it with a record
+            uint32_t contiguous = m_capacity - (head & m_mask);
+            const ShmRecord* r = reinterpret_cast<const ShmRecord*>(m_buffer + (head & m_mask));
+            if(contiguous < sizeof(ShmRecord) || (r->flags & ShmRecordFlags::Wrap)) { head += contiguous; continue; }
+
+            UnixPacket* up = new UnixPacket(r->op_code, r->timestamp, r->senderID, r->dataLength, const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(r) + sizeof(ShmRecord)));
+            m_header->head.store(head + r->size, std::memory_order_release);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_header->writerSleeping.load(std::memory_order_relaxed)) { futexWake(&m_header->spaceSeq); m_wakeups.fetch_add(1, std::memory_order_relaxed); }
+            return up;
+        }
+    }
+
+    void ShmRing::waitReadable(uint32_t waitMS)
+    {
+        if(!m_header) { return; }
+
+        uint32_t seq = m_header->dataSeq.load(std::memory_order_acquire);
+        m_header->readerSleeping.store(1, std::memory_order_seq_cst);
+        m_tailCache = m_header->tail.load(std::memory_order_seq_cst);
+        if(m_tailCache == m_header->head.load(std::memory_order_relaxed)) { futexWait(&m_header->dataSeq, seq, waitMS); }
+        m_header->readerSleeping.store(0, std::memory_order_relaxed);
+    }
+
+    bool ShmRing::waitWritable(uint32_t length, uint32_t waitMS)
+    {
+        if(!m_header || recordSize(length) > m_capacity / 2) { return false; }
+
+        uint64_t deadline = Time::getInstance().steadyMS() + waitMS;
+        while(true)
+        {
+            // the consumer only wakes us when it sees writerSleeping after moving head
+            uint32_t seq = m_header->spaceSeq.load(std::memory_order_acquire);
+            m_header->writerSleeping.fetch_add(1, std::memory_order_seq_cst);
+            uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+            bool room = (tail + needed(tail, length) - m_header->head.load(std::memory_order_seq_cst) <= m_capacity);
+            uint64_t now = Time::getInstance().steadyMS();
+            if(!room && now < deadline) { futexWait(&m_header->spaceSeq, seq, (uint32_t)(deadline - now)); }
+            m_header->writerSleeping.fetch_sub(1, std::memory_order_relaxed);
+
+            if(room) { return true; }
+            else if(Time::getInstance().steadyMS() >= deadline) { return false; }
+        }
+    }
+
+    void ShmRing::wakeReader()
+    {
+        if(m_header) { futexWake(&m_header->dataSeq); }
+    }
+
+    void ShmRing::wakeWriters()
+    {
+        if(m_header) { futexWake(&m_header->spaceSeq); }
+    }
+
+    /// NetworkSHM ////////////////////////////////////////////////////////////
+
+    /// create primary (left) side
+    NetworkSHM::NetworkSHM(std::string name, Network* net, SafeQueue<UnixPacket*>* packetQueue)
+        : m_isPrimary(true), m_name(name), m_net(net), m_unixPackets(packetQueue)
+    {
+        m_path = SHM_PATH_PREFIX + m_name;
+        m_file = new MemoryMappedFile(m_path, 64 + controlSize + 2 * SHM_RING_SIZE); // 64: getData() is only 4 byte aligned
+        m_file->zeroFill(); // a stale file of the same name may still hold indices
+
+        uintptr_t base = (reinterpret_cast<uintptr_t>(m_file->getData()) + 63) & ~(uintptr_t)63;
+        m_control = reinterpret_cast<ShmControl*>(base);
+        unsigned char* buffers = reinterpret_cast<unsigned char*>(base) + controlSize;
+
+        // unique ID from host and name, the secondary reads it from the control block
+        char host[128] = { 0 };
+        gethostname(host, sizeof(host) - 1);
+        std::string tmp = std::string(host) + m_name;
+        m_uniqueID = CRC32::create(tmp.c_str(), tmp.length());
+
+        m_control->capacity = SHM_RING_SIZE;
+        m_control->uniqueID = m_uniqueID;
+        m_outbound.attach(&m_control->rings[0], buffers, SHM_RING_SIZE);
+        m_inbound.attach(&m_control->rings[1], buffers + SHM_RING_SIZE, SHM_RING_SIZE);
+        m_control->magic.store(SHM_RING_MAGIC, std::memory_order_release);
+
+        m_isActive = true;
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkSHM::NetworkSHM(str)", "Shared rings created [id {}, path {}, {} bytes each]", m_uniqueID, m_path, SHM_RING_SIZE);
+        start();
+    }
+
+    /// map secondary (right) side
+    NetworkSHM::NetworkSHM(std::string name, SafeQueue<UnixPacket*>* packetQueue)
+        : m_name(name), m_unixPackets(packetQueue)
+    {
+        m_path = SHM_PATH_PREFIX + m_name;
+        if(!map()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::NetworkSHM(string, SafeQueue)", "Primary side [{}] is not up yet, call completePair() to retry.", m_path); }
+    }
+
+    NetworkSHM::~NetworkSHM()
+    {
+        while(!shutdownRings())
+        {
+           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::~NetworkSHM()", "Waiting on shutdownRings() to complete.");
+        }
+
+        if(m_thread)
+        {
+            m_thread->join();
+            safeDelete(m_thread);
+        }
+
+        // primary removes the file, a mapped secondary keeps its pages until it unmaps
+        m_control = nullptr;
+        safeDelete(m_file);
+        m_net = nullptr;
+    }
+
+    bool NetworkSHM::shutdownRings()
+    {
+        stop();
+        m_isConnected = false;
+        while(!m_unixPackets->empty()) { safeDelete(m_unixPackets->front()); m_unixPackets->pop(); }
+       Logger::getInstance().Log(Logs::DEBUG, "NetworkSHM::shutdownRings()", "Completed Successfully!");
+        return true;
+    }
+
+    void NetworkSHM::mainLoop()
+    {
+        while(m_isActive)
+        {
+            UnixPacket* up = m_inbound.pop();
+            if(!up) { m_inbound.waitReadable(SHM_WAIT_MS); continue; }
+            processPacket(up);
+        }
+
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkSHM::mainLoop()", "Exiting mainLoop().");
+    }
+
+    /// Network (Process A) -> Process B
+    void NetworkSHM::addDatagram(Datagram** dg)
+    {
+        if(!m_isActive) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::addDatagram()", "isActive is false."); return; } // closing
+        else if(!dg || !(*dg)) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::addDatagram()", "Passed Datagram pointer or pointer to pointer was null!"); return; }
+
+        // take ownership
+        Datagram* d = *dg;
+        *dg = nullptr;
+
+        if(d->dataLength < 0 || d->dataLength > UNIX_PACKET_DATA_SIZE) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::addDatagram()", "Datagram is too large! Received {} bytes, max is {}.", d->dataLength, UNIX_PACKET_DATA_SIZE); }
+        else { push(d->op_code, d->senderUniqID, d->timestamp, d->data, d->dataLength); }
+        safeDelete(d);
+    }
+
+    void NetworkSHM::completePair()
+    {
+        if(m_isPrimary) { m_isConnected = (m_control->attached.load(std::memory_order_acquire) != 0); return; }
+        else if(m_file) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::completePair()", "[{}] is already mapped, cannot process completePair().", m_path); return; }
+        map();
+    }
+
+    void NetworkSHM::sendSimple(uint16_t opCode, uint32_t sender /*= 0*/)
+    {
+        if(!m_isActive)
+        {
+           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::sendSimple()", "isActive is false. OP_Code [{}]", opCode);
+            return;
+        }
+        push(opCode, sender, 0, nullptr, 0);
+    }
+
+    /// Process B -> Network (Process A)
+    void NetworkSHM::send(uint16_t opCode, uint32_t senderID, unsigned char** data, uint16_t dataLength, uint64_t arrival /*= 0*/)
+    {
+        if(!m_isActive)
+        {
+           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::send()", "isActive is false.");
+            return;
+        }
+        else if(!data || !(*data)) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::send()", "Passed data pointer was null!"); return; }
+        else if(dataLength > UNIX_PACKET_DATA_SIZE) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::send()", "Passed data is too large! Received {} bytes, max is {}.", dataLength, UNIX_PACKET_DATA_SIZE); return; }
+
+        // take ownership
+        unsigned char* d = *data;
+        *data = nullptr;
+
+        push(opCode, senderID, arrival, d, dataLength);
+        safeDeleteArray(d);
+    }
+
+    void NetworkSHM::stop()
+    {
+        m_isActive = false;
+        m_inbound.wakeReader();
+        m_outbound.wakeWriters();
+    }
+
+    /// NetworkSHM private functions //////////////////////////////////////////
+
+    bool NetworkSHM::map()
+    {
+        if(access(m_path.c_str(), F_OK) != 0) { return false; }
+
+        m_file = new MemoryMappedFile(m_path, MappingMode::ReadWrite);
+        uintptr_t base = (reinterpret_cast<uintptr_t>(m_file->getData()) + 63) & ~(uintptr_t)63;
+        m_control = reinterpret_cast<ShmControl*>(base);
+        if(m_control->magic.load(std::memory_order_acquire) != SHM_RING_MAGIC || m_control->capacity != SHM_RING_SIZE)
+        {
+           Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkSHM::map()", "[{}] is not a ring file of this build (capacity {}, expected {}).", m_path, m_control->capacity, SHM_RING_SIZE);
+            m_control = nullptr;
+            safeDelete(m_file);
+            return false;
+        }
+
+        unsigned char* buffers = reinterpret_cast<unsigned char*>(base) + controlSize;
+        m_outbound.attach(&m_control->rings[1], buffers + SHM_RING_SIZE, SHM_RING_SIZE);
+        m_inbound.attach(&m_control->rings[0], buffers, SHM_RING_SIZE);
+        m_uniqueID = m_control->uniqueID;
+        m_control->attached.store(1, std::memory_order_release);
+
+        m_isActive = true;
+        m_isConnected = true;
+       Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkSHM::map()", "Secondary (right) side mapped [{}].", m_path);
+        sendSimple(OP_KeepAlive);
+        start();
+        return true;
+    }
+
+    void NetworkSHM::start()
+    {
+        if(!m_thread) { m_thread = new std::thread(startLoop, this); }
+    }
+
+    bool NetworkSHM::push(uint16_t opCode, uint32_t senderID, uint64_t timestamp, const unsigned char* data, uint32_t length)
+    {
+        // a peer that is not (or no longer) there will not drain the ring, do not wait for it
+        uint64_t deadline = Time::getInstance().steadyMS() + ((m_isActive && m_isConnected) ? SHM_FULL_WAIT_MS : 0);
+        while(true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_pushMutex);
+                if(m_outbound.push(opCode, senderID, timestamp, data, length)) { return true; }
+            }
+
+            // sleep without the lock, other producers may get their records in first
+            uint64_t now = Time::getInstance().steadyMS();
+            if(now >= deadline || !m_isActive || !m_outbound.waitWritable(length, (uint32_t)(deadline - now))) { break; }
+        }
+
+        m_drops.fetch_add(1, std::memory_order_relaxed);
+       Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSHM::push()", "Ring [{}] is full{}, OP_Code [{}] dropped.", m_path, (m_isConnected) ? "" : " and the peer is not connected", opCode);
+        return false;
+    }
+
+    void NetworkSHM::processPacket(UnixPacket* up)
+    {
+        bool destroyPacket = true;
+
+        if(!m_isConnected && up->op_code == OP_KeepAlive)
+        {
+           Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkSHM::processPacket()", "Initial OP_KeepAlive, setting connected to true.");
+            m_isConnected = true;
+            m_unixPackets->push(up);
+            destroyPacket = false;
+        }
+        else if(m_isConnected)
+        {
+            switch(up->op_code)
+            {
+                case OP_KeepAlive:
+                {
+                    // primary (left) sends it in, secondary (right) replies
+                    if(!m_isPrimary) { sendSimple(OP_KeepAlive, 0); }
+                    else { m_unixPackets->push(up); destroyPacket = false; }
+                    break;
+                }
+                default:
+                {
+                    m_unixPackets->push(up);
+                    if(m_cv) { m_cv->notify_one(); }
+                    destroyPacket = false;
+                    break;
+                }
+            }
+        }
+
+        // cleanup
+        if(destroyPacket) { safeDelete(up); }
+    }
+}
@@ -0,0 +1,163 @@
+#ifndef NETWORKSHM_H_INCLUDED
+#define NETWORKSHM_H_INCLUDED
+
+#include "net/Network.h"
+#include "net/UnixPacket.h"
+#include "srv/MemoryMappedFile.h"
+#include <atomic>
+#include <mutex>
+
+/*
+    Process A  <------>  Process B
+    (primary)           (secondary)
+
+    Drop-in for NetworkIPC when both processes share a host: the primary creates one memory mapped
+    file holding a ring per direction, the secondary maps the same file. Sending is a memcpy of a
+    small record header and the payload into the ring, receiving a memcpy out into the UnixPacket
+    the queue hands over, nothing is serialized and no socket is touched.
+        - each ring is single producer, single consumer, head and tail on their own cache lines
+          with a process local cached copy of the other side's index (see SPSCRing)
+        - records are 8 byte aligned, one that would run past the end of the buffer is written at
+          the start after a wrap marker
+        - a consumer with nothing to read sleeps on a futex in the ring header, a producer only
+          makes the wake syscall when the consumer said it is sleeping, so a busy consumer costs
+          no syscalls at all
+        - a full ring puts the producer to sleep on the other futex for up to SHM_FULL_WAIT_MS,
+          after that the record is dropped and counted. It sleeps outside the push lock, and only
+          while the peer is connected, nobody is going to drain the ring of a dead or absent one
+    The futexes are process shared (no FUTEX_PRIVATE_FLAG) since the words live in the mapping.
+    addDatagram()/send() may be called from several threads, pushes are serialized by a
+    process local mutex.
+
+    Ref:
+        http://man7.org/linux/man-pages/man2/futex.2.html
+            futex : wait on / wake a 32 bit word, works across processes in shared memory
+        http://man7.org/linux/man-pages/man7/shm_overview.7.html
+            /dev/shm : tmpfs, the mapping never reaches a disk
+*/
+
+#define SHM_PATH_PREFIX "/dev/shm/cge_" // + name
+#define SHM_RING_SIZE (4 * 1024 * 1024) // bytes per direction, power of two
+#define SHM_RING_MAGIC 0x43474552 // written last by the primary, the secondary will not map a half built file
+#define SHM_WAIT_MS 100 // sleeping reader re-checks isActive() at least this often
+#define SHM_FULL_WAIT_MS 1000 // a producer facing a full ring gives up after this
+
+namespace ShmRecordFlags { enum FORMS { NONE = 0, Wrap = 1 }; }
+
+namespace CGameEngine
+{
+    /// one record in a ring, payload follows
+    struct ShmRecord
+    {
+        uint32_t size = 0; // header + payload, 8 byte aligned
+        uint16_t op_code = 0;
+        uint16_t flags = 0; // ShmRecordFlags
+        uint32_t senderID = 0;
+        uint32_t dataLength = 0;
+        uint64_t timestamp = 0;
+    };
+
+    /// one direction, lives in the mapping
+    struct ShmRingHeader
+    {
+        alignas(64) std::atomic<uint64_t> head; // written by the consumer
+        std::atomic<uint32_t> readerSleeping;
+        std::atomic<uint32_t> spaceSeq; // futex, bumped by the consumer for a sleeping producer
+        alignas(64) std::atomic<uint64_t> tail; // written by the producer
+        std::atomic<uint32_t> writerSleeping; // count, several producer threads may wait for space
+        std::atomic<uint32_t> dataSeq; // futex, bumped by the producer for a sleeping consumer
+    };
+
+    /// start of the mapping, both rings' buffers follow
+    struct ShmControl
+    {
+        std::atomic<uint32_t> magic;
+        uint32_t capacity; // per ring
+        uint32_t uniqueID; // primary's, the secondary takes it over
+        std::atomic<uint32_t> attached; // secondary has mapped the file
+        ShmRingHeader rings[2]; // [0] primary -> secondary, [1] secondary -> primary
+    };
+
+    /// process local view of one ring direction
+    class ShmRing
+    {
+        public:
+            ShmRing() {}
+            void attach(ShmRingHeader* header, unsigned char* buffer, uint32_t capacity);
+            bool push(uint16_t opCode, uint32_t senderID, uint64_t timestamp, const unsigned char* data, uint32_t length); // producer only (callers serialize), false if full or too large
+            bool waitWritable(uint32_t length, uint32_t waitMS); // any producer thread, no lock needed, false if there was still no room after waitMS
+            UnixPacket* pop(); // consumer only, nullptr if empty
+            void waitReadable(uint32_t waitMS); // consumer only, returns early once something is pushed
+            void wakeReader(); // any thread, shutting down
+            void wakeWriters(); // any thread, shutting down
+            const uint64_t getWakeups() const { return m_wakeups.load(std::memory_order_relaxed); }
+
+        private:
+            bool fits(const uint64_t& tail, uint32_t bytes) const { return (tail + bytes - m_headCache) <= m_capacity; }
+            uint32_t needed(const uint64_t& tail, uint32_t length) const; // record plus the skipped end of the buffer, if it has to wrap
+
+            ShmRingHeader* m_header = nullptr;
+            unsigned char* m_buffer = nullptr;
+            uint32_t m_capacity = 0;
+            uint32_t m_mask = 0;
+            uint64_t m_headCache = 0; // producer's view of head
+            uint64_t m_tailCache = 0; // consumer's view of tail
+            std::atomic<uint64_t> m_wakeups { 0 }; // futex wake syscalls issued from this side
+    };
+
+    class NetworkSHM
+    {
+        public:
+            NetworkSHM(std::string name, Network* net, SafeQueue<UnixPacket*>* packetQueue); // create primary (left) side
+            NetworkSHM(std::string name, SafeQueue<UnixPacket*>* packetQueue); // map secondary (right) side
+            virtual ~NetworkSHM();
+            NetworkSHM(const NetworkSHM& n) = delete;
+            NetworkSHM& operator=(const NetworkSHM& n) = delete;
+            bool shutdownRings();
+            void mainLoop();
+            void addDatagram(Datagram** dg); // takes the Datagram, Network (Process A) -> Process B
+            void addEventCV(std::condition_variable& cv) { m_cv = &cv; }
+            void completePair(); // secondary retries mapping a primary that was not up yet
+            void sendSimple(uint16_t opCode, uint32_t sender = 0); // basic OPCode responses
+            void send(uint16_t opCode, uint32_t senderID, unsigned char** data, uint16_t dataLength, uint64_t arrival = 0); // takes data, Process B -> Network (Process A)
+            void stop();
+            void setDisconnected() { m_isConnected = false; } // used when either side "dies"
+
+            const bool& isConnected() const { return m_isConnected; }
+            const bool& isActive() const { return m_isActive; }
+            const uint32_t& getUniqueID() const { return m_uniqueID; }
+            const std::string& getName() const { return m_name; }
+            const uint64_t getDrops() const { return m_drops.load(std::memory_order_relaxed); } // records lost to a full ring
+            const uint64_t getWakeups() const { return m_outbound.getWakeups() + m_inbound.getWakeups(); } // futex wakes this side had to issue
+
+            // thread starter
+            static void startLoop(NetworkSHM* n) { n->mainLoop(); }
+
+        private:
+            bool map(); // secondary side
+            void start();
+            bool push(uint16_t opCode, uint32_t senderID, uint64_t timestamp, const unsigned char* data, uint32_t length);
+            void processPacket(UnixPacket* up);
+
+            bool m_isActive = false;
+            bool m_isConnected = false; // both sides mapped
+            bool m_isPrimary = false; // left side
+            uint32_t m_uniqueID = 0;
+            std::string m_name = "";
+            std::string m_path = "";
+            MemoryMappedFile* m_file = nullptr;
+            ShmControl* m_control = nullptr; // inside m_file
+            ShmRing m_outbound;
+            ShmRing m_inbound;
+            std::mutex m_pushMutex; // m_outbound has one producer, never held while waiting for space
+            std::atomic<uint64_t> m_drops { 0 };
+            Network* m_net = nullptr; // primary side only!!
+            std::thread* m_thread = nullptr;
+            std::condition_variable* m_cv = nullptr;
+
+            // inbound packets, on Process A (primary) and Process B (secondary) alike
+            SafeQueue<UnixPacket*>* m_unixPackets = nullptr;
+    };
+}
+
+#endif // NETWORKSHM_H_INCLUDED
@@ -1,11 +1,12 @@
 #include "NetworkServer.h"
+#include "net/NetworkServerPool.h"
 
 #include "net/Network.h"
 #include "net/NetworkPeer.h"
+#include "net/NetworkIPC.h"
 
 #include "srv/Time.h"
 #include "common/CRC32.h"
-#include "common/Timer.h"
 #include "common/util.h"
 #include <cmath>
 
@@ -13,13 +14,16 @@ namespace CGameEngine
 {
     /// Network ///////////////////////////////////////////////////////////////
 
-    NetworkServer::NetworkServer(SoftwareVersion* swv, uint16_t port, SafeQueue<Datagram*>* dbbuff, std::string hostname /*= ""*/) : Network(swv, port, dbbuff, hostname)
+    static_assert(sizeof(ConnectionHandoff_Struct::channelLast) == sizeof(ChannelSequences::last), "ConnectionHandoff_Struct has to carry every DeliveryMode");
+
+    NetworkServer::NetworkServer(SoftwareVersion* swv, uint16_t port, SafeQueue<Datagram*>* dbbuff, std::string hostname /*= ""*/, NetworkServerPool* pool /*= nullptr*/, uint16_t shard /*= 0*/, bool handoffs /*= false*/)
+        : Network(swv, port, dbbuff, hostname, (pool != nullptr || handoffs)), m_pool(pool), m_shard(shard)
     {
         if(!m_isActive) { Logger::getInstance().Log(Logs::FATAL, Logs::Network, "NetworkServer::NetworkServer()", "NetworkServer failed to start using Network() base constructor!"); }
         else
         {
             m_sendThread = new std::thread(startSendLoop, this); // send processing
-            m_listenThread = new std::thread(startListenLoop, this); // network (tcp/udp) listen thread
+            startListening(); // listen thread, or the shared Reactor
             m_updateThread = new std::thread(startUpdateLoop, this); // all network traffic update loop
             m_networkType = NetworkType::Server;
 
@@ -27,6 +31,62 @@ namespace CGameEngine
         }
     }
 
+    NetworkServer::NetworkServer(SoftwareVersion* swv, UnixPacket* handoff, SafeQueue<Datagram*>* dgbuff)
+    {
+        int fd = (handoff) ? handoff->takeFD() : -1;
+        if(fd == -1 || handoff->op_code != OP_ConnectionHandoff || handoff->dataLength < sizeof(ConnectionHandoff_Struct))
+        {
+            if(fd != -1) { close(fd); }
+            Logger::getInstance().Log(Logs::FATAL, Logs::Network, "NetworkServer::NetworkServer(handoff)", "Packet does not carry a handed off connection!");
+            return;
+        }
+
+        ConnectionHandoff_Struct hs;
+        memcpy(&hs, handoff->data, sizeof(hs));
+        hs.identifier[sizeof(hs.identifier)-1] = '\0';
+
+        m_version = swv;
+        m_datagramBuffer = dgbuff;
+        m_networkType = NetworkType::Server;
+        m_uniqueID = hs.serverID; // the client knows us by the handing server's ID
+        m_seqID.store(hs.nextSeqID, std::memory_order_relaxed);
+        m_identifier = std::string(hs.identifier);
+
+        // the connected socket is this server's only socket
+        m_socket = new NetSocket();
+        if(!m_socket->adopt(fd)) { close(fd); Logger::getInstance().Log(Logs::FATAL, Logs::Network, "NetworkServer::NetworkServer(handoff)", "Could not take over fd [{}]!", fd); return; }
+        m_socketPairs[fd] = std::make_pair(m_socket, m_datagramBuffer);
+
+        sockaddr_storage local, peer;
+        socklen_t localLength = sizeof(local), peerLength = sizeof(peer);
+        memset(&local, 0, sizeof(local));
+        memset(&peer, 0, sizeof(peer));
+        if(getsockname(fd, (struct sockaddr*)&local, &localLength) == -1 || getpeername(fd, (struct sockaddr*)&peer, &peerLength) == -1)
+        {
+            Logger::getInstance().Log(Logs::FATAL, Logs::Network, "NetworkServer::NetworkServer(handoff)", "fd [{}] is not a connected socket!", fd);
+            return;
+        }
+        m_srcPort = ntohs(((struct sockaddr_in*)&local)->sin_port);
+        generateAddress("", m_srcPort, &m_srcAddress);
+
+        // pick the conversation up where the handing server left it
+        std::string ipStr = getIPString(&peer);
+        NetConnection* nc = new NetConnection(this, &peer, ipStr, hs.clientID, m_datagramBuffer);
+        nc->resumeChannels(hs.nextOrdered, hs.lastSequenced);
+        ChannelSequences channels;
+        memcpy(channels.last, hs.channelLast, sizeof(channels.last));
+        setChannels(nc->getKey(), channels);
+        m_netConnections.insert(nc->getKey(), nc);
+
+        m_isActive = true;
+        m_netListening = true; // accepted already
+        m_sendThread = new std::thread(startSendLoop, this); // send processing
+        startListening(); // listen thread, or the shared Reactor
+        m_updateThread = new std::thread(startUpdateLoop, this); // all network traffic update loop
+
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkServer::NetworkServer(handoff)", "Took over connection [{}] for {} on port {}.", hs.clientID, ipStr, m_srcPort);
+    }
+
     NetworkServer::~NetworkServer()
     {
         while(!shutdownSockets())
@@ -37,10 +97,11 @@ namespace CGameEngine
 
     bool NetworkServer::shutdownSockets()
     {
-        m_isActive = false;
-        m_netListening = false;
-        m_sendQueue.clear();
-        while(!m_packetBuffer.empty()) { m_packetBuffer.front().destroy(); m_packetBuffer.pop(); }
+        joinThreads(); // the queues are single consumer and the update thread runs the connections' timers
+        OutboundPacket op;
+        while(m_sendQueue.pop(op)) { SendBuffer::release(op.data); }
+        PacketPair pp;
+        while(m_packetBuffer.pop(pp)) { pp.destroy(); }
 
         // clear net connections
         for(auto& it : m_netConnections) { safeDelete(it.second); }
@@ -50,69 +111,90 @@ namespace CGameEngine
         return true;
     }
 
+    bool NetworkServer::handOff(const sockaddr_storage* client, NetworkIPC* ipc)
+    {
+        if(!client || !ipc) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::handOff()", "Passed client or NetworkIPC pointer was null!"); return false; }
+        else if(!m_reusePort) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::handOff()", "Port {} is not shared (SO_REUSEPORT), start the server with handoffs.", m_srcPort); return false; }
+
+        PendingHandoff h;
+        copyAddress(&h.client, client);
+        h.ipc = ipc;
+        {
+            std::lock_guard<std::mutex> lock(m_handoffMutex);
+            m_handoffs.push_back(h);
+            m_handoffPending = true;
+        }
+        m_updateCV.notify_one();
+        return true;
+    }
+
     /// \TODO: Evaluate breaking out processing into separate function
     void NetworkServer::updateLoop()
     {
-        std::queue<std::string> toBeClosed;
-        std::unordered_map<std::string, NetConnection*>::iterator nit = m_netConnections.begin();
-        std::unordered_map<uint32_t, StoredSequence*>::iterator sit = m_storedSequences.begin();
+        std::vector<PacketPair> batch(NET_UPDATE_BATCH);
         std::mutex ulmutex;
         std::unique_lock<std::mutex> updateLock(ulmutex);
 
-        Timer connUpdate = Timer("connUpdate", 500); // MS
-
         while(m_isActive)
         {
-            // lock to wait for data
-            if(m_updateCV.wait_until(updateLock, std::chrono::_V2::steady_clock::now() + HEARTBEAT_INTERVAL) == std::cv_status::timeout)
+            // sleep until data arrives or the next timer is due, whichever comes first
+            if(m_packetBuffer.empty() && !m_handoffPending)
             {
-                int pkts = m_packetBuffer.size();
-                while(pkts > 0)
+                std::chrono::milliseconds wait = timeUntilTimers(Time::getInstance().steadyMS());
+                if(wait.count() > 0) { m_updateCV.wait_for(updateLock, wait); }
+            }
+            Time::getInstance().tick(); // connections read cachedMS() for this pass
+            if(m_handoffPending) { processHandoffs(); }
+
+            // drain the receive queue, one batch at a time
+            size_t pkts = 0;
+            while((pkts = m_packetBuffer.popBatch(batch.data(), batch.size())) > 0)
+            {
+                for(size_t i = 0; i < pkts; i++)
                 {
-                    // packet exists, grab first one and it's sender
-                    PacketPair* pp = &m_packetBuffer.front();
-                    Packet* p = pp->pkt;
+                    // grab the next packet and it's sender
+                    PacketPair* pp = &batch[i];
+                    const PacketView& p = pp->view;
                     sockaddr_storage* sender = &pp->sas;
-                    uint32_t pktCRC = 0;
 
                     // try-catch bad or missing data
-                    if(!p || !sender) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::updateLoop()", "Broken PacketPair!"); /*p = nullptr; sender = nullptr;*/}
+                    if(!pp->buffer || !p.isDecoded()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::updateLoop()", "Broken PacketPair!"); }
                     else
                     {
                         // check identifier
-                        bool broken = true;
-                        try { broken = memcmp(p->identifier, m_identifier.c_str(), IDENT_SIZE); }
-                        catch (...) { broken = true; }
+                        bool broken = !p.matchesIdentifier(m_identifier);
 
                         if(broken)
                         {
-                           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::updateLoop()", "Packet did NOT meet identifier! [{}] ({} remaining)", m_identifier, pkts);
+                           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::updateLoop()", "Packet did NOT meet identifier! [{}] ({} remaining)", m_identifier, pkts-i);
                         }
                         else
                         {
                             NetConnection* nc = nullptr;
-                            std::string ipStr = getIPString(sender);
-                            std::unordered_map<std::string, NetConnection*>::iterator it = m_netConnections.find(ipStr);
+                            ConnectionKey key(sender);
+                            ConnectionMap::iterator it = m_netConnections.find(key);
 
                             // handle these first as they are important
-                            if(p->op_code == m_reqConnOP)
+                            if(p.op_code == m_reqConnOP)
                             {
-                                std::unordered_map<std::string, uint32_t>::iterator deadIt = m_closedConnections.find(ipStr); // see if it is recently dead
+                                ClosedConnectionMap::iterator deadIt = m_closedConnections.find(key); // see if it is recently dead
+                                std::string ipStr = getIPString(sender); // only formatted for new, refused or duplicate requests
                                 if(it == m_netConnections.end() && deadIt == m_closedConnections.end()) // not found, requesting access
                                 {
                                    Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkServer::updateLoop()", "Creating new connection for {} [Count: {}], sending 'accepted' reply.", ipStr, m_netConnections.size());
 
                                     // generate unique identifier for internal use
                                     uint32_t sentID = 0;
-                                    try { ConnectionRequest_Struct* csr = (ConnectionRequest_Struct*)p->data; sentID = csr->uniqID; }
+                                    try { const ConnectionRequest_Struct* csr = (const ConnectionRequest_Struct*)p.data; sentID = csr->uniqID; }
                                     catch (...) { }
                                     nc = new NetConnection(this, sender, ipStr, sentID, m_datagramBuffer); // create the connection
                                     if(nc)
                                     {
                                        Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkServer::updateLoop()", "\033[1mConnection [{}] being sent 'accepted' reply.\033[0m", nc->getUniqueID());
-                                        m_netConnections.insert(std::make_pair(ipStr, nc)); // add connection to connection map
+                                        m_netConnections.insert(key, nc); // add connection to connection map
+                                        if(m_pool) { m_pool->addRoute(key, m_shard); } // replies from other threads go out through this shard
                                         sendSimple(nc->getSource(), m_acceptConnOP); // let connecting client know we're receiving and accepting
-                                        nc->addPacket(&p); // add ConnectionAccepted packet for initial datagram hand-off
+                                        nc->addPacket(*pp); // add ConnectionAccepted packet for initial datagram hand-off
                                     }
                                 }
                                 else if(it == m_netConnections.end() && deadIt != m_closedConnections.end())
@@ -122,49 +204,51 @@ namespace CGameEngine
                                 }
                                 else
                                 {
-                                    /// \TODO: Some kind of logging to catch this
-                                   Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::updateLoop()", "Connection for {} *ALREADY* exists. [Count: {}]", ipStr, m_netConnections.size());
+                                    // our 'accepted' reply was lost, the client asks until it hears one
+                                   Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::updateLoop()", "Connection for {} *ALREADY* exists, repeating 'accepted' reply. [Count: {}]", ipStr, m_netConnections.size());
+                                    sendSimple(sender, m_acceptConnOP);
                                 }
                             }
                             // normal traffic
                             else if(it != m_netConnections.end())
                             {
-                                switch(p->op_code)
+                                switch(p.op_code)
                                 {
                                     case OP_RetransmissionAck:
                                     {
                                         /// \TODO: Destroy sequence within connection
-                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "Received retransmissions ACK! seqID [{}], pktNum [{}]", p->seqIdent, p->pktNum);
-                                        //it->second->receiveRetryAck(p->seqIdent, p->pktNum);
-                                        it->second->addPacket(&p);
+                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "Received retransmissions ACK! seqID [{}], pktNum [{}]", p.seqIdent, p.pktNum);
+                                        //it->second->receiveRetryAck(p.seqIdent, p.pktNum);
+                                        it->second->addPacket(*pp);
                                         break;
                                     }
                                     case OP_RetransmissionImpossible:
                                     {
                                         /// \TODO: Destroy sequence within connection
-                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "Received retransmissions impossible! seqID [{}], pktNum [{}]", p->seqIdent, p->pktNum);
-                                        it->second->addPacket(&p);
+                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "Received retransmissions impossible! seqID [{}], pktNum [{}]", p.seqIdent, p.pktNum);
+                                        it->second->addPacket(*pp);
                                         break;
                                     }
                                     case OP_ConnectionDisconnect:
                                     {
-                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "Closing connection for {} [New Count: {}]", ipStr, m_netConnections.size()-1);
+                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "Closing connection for {} [New Count: {}]", it->second->getIPAddr(), m_netConnections.size()-1);
                                         Datagram* d = new Datagram(OP_ConnectionDisconnect, it->second->getUniqueID());
                                         m_datagramBuffer->push(d);
                                         it->second->setClosed(true);
-                                        m_closedConnections.insert(ipStr, Time::getInstance().now()+5);
+                                        m_closedConnections.insert(key, Time::getInstance().now()+5);
+                                        scheduleTimer(Time::getInstance().cachedMS() + NET_CLOSED_CONNECTION_MS, NetTimer(NetTimerType::ClosedConnections));
                                         break;
                                     }
                                     case OP_Ack: // sequence has completed or destroyed, let sender know
                                     {
-                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "Received ACK for seqID [{}].", p->seqIdent);
-                                        it->second->addPacket(&p);
+                                       Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "Received ACK for seqID [{}].", p.seqIdent);
+                                        it->second->addPacket(*pp);
                                         break;
                                     }
                                     default: // normal packets
                                     {
-                                        //Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "'default' case hit, OP [{}]", p->op_code);
-                                        it->second->addPacket(&p); // add packet to connection
+                                        //Logger::getInstance().Log(Logs::DEBUG, "NetworkServer::updateLoop()", "'default' case hit, OP [{}]", p.op_code);
+                                        it->second->addPacket(*pp); // add packet to connection
                                         break;
                                     }
                                 }
@@ -172,7 +256,7 @@ namespace CGameEngine
                             else
                             {
                                 // error?
-                               Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::updateLoop()", "'else' statement in updateLoop with OPCode [{}], this is bad. IP [{}]", p->op_code, ipStr);
+                               Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::updateLoop()", "'else' statement in updateLoop with OPCode [{}], this is bad. IP [{}]", p.op_code, getIPString(sender));
                             }
 
                             // cleanup
@@ -180,72 +264,52 @@ namespace CGameEngine
                         }
                     }
 
-                    /// \TODO: Find out if this is a memory leak or not
-                    safeDelete(p);
-                    p = nullptr;
+                    // release the receive buffer, unless a connection kept it
+                    pp->destroy();
                     sender = nullptr;
-                    m_packetBuffer.pop();
-                    pkts--;
                 }
+            }
 
-                // timer to prevent wasteful CPU usage
-                if(connUpdate.isExpired())
-                {
-                    uint64_t timestamp = Time::getInstance().nowMS();
-
-                    // check for closed connections
-                    for(std::unordered_map<std::string, NetConnection*>::iterator nit = m_netConnections.begin(); nit != m_netConnections.end(); ++nit)
-                    {
-                        bool destroy = nit->second->update(timestamp);
-                        if(destroy) { toBeClosed.push(nit->first); }
-                    }
-
-                    // delete netConnection object, remove from uo_map
-                    while(toBeClosed.size() > 0)
-                    {
-                       Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkServer::updateLoop()", "Closing connection [{}]", toBeClosed.front());
-                        safeDelete(m_netConnections.at(toBeClosed.front()));
-                        m_netConnections.erase(toBeClosed.front());
-                        toBeClosed.pop();
-                    }
-
-                    // remove aged-out stored packet sequences
-                    std::queue<uint32_t> expiredToRemove;
-                    uint64_t time = Time::getInstance().nowMS();
-                    for(std::unordered_map<uint32_t, StoredSequence*>::iterator sit = m_storedSequences.begin(); sit != m_storedSequences.end(); ++sit)
-                    {
-                        if(sit->second->isExpired(time)) { expiredToRemove.push(sit->first); }
-                    }
+            // connection, sequence and retry deadlines, only the ones due are touched
+            runTimers(Time::getInstance().tick() / 1000000);
+        }
 
-                    while(expiredToRemove.size() > 0)
-                    {
-                        safeDelete(m_storedSequences.at(expiredToRemove.front()));
-                        m_storedSequences.erase(expiredToRemove.front());
-                        expiredToRemove.pop();
-                    }
+        // release lock
+        updateLock.unlock();
 
-                    // remove connections from 'recently disconnected'
-                    std::queue<std::string> closedToRemove;
-                    for(auto itr = m_closedConnections.begin(); itr != m_closedConnections.end(); ++itr)
-                    {
-                        if(itr->second < timestamp) { closedToRemove.push(itr->first); }
-                    }
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkServer::updateLoop()", "Exiting updateLoop().");
+    }
 
-                    while(closedToRemove.size() > 0)
-                    {
-                        m_closedConnections.erase(closedToRemove.front());
-                        closedToRemove.pop();
-                    }
+    /// Network-wide timers
+    void NetworkServer::networkTimer(const NetTimer& t, const uint64_t& /*timestamp*/) // closed connections are kept in wall clock seconds
+    {
+        if(t.type == NetTimerType::HandoffRetry) { m_handoffPending = true; return; } // processHandoffs() runs next
+        else if(t.type != NetTimerType::ClosedConnections) { return; }
 
-                    connUpdate.restart();
-                }
-            }
+        // remove connections from 'recently disconnected' (stored in seconds)
+        std::queue<ConnectionKey> closedToRemove;
+        uint32_t now = Time::getInstance().now();
+        for(auto itr = m_closedConnections.begin(); itr != m_closedConnections.end(); ++itr)
+        {
+            if(itr->second < now) { closedToRemove.push(itr->first); }
         }
 
-        // release lock
-        updateLock.unlock();
+        while(closedToRemove.size() > 0)
+        {
+            m_closedConnections.erase(closedToRemove.front());
+            closedToRemove.pop();
+        }
+    }
 
-       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkServer::updateLoop()", "Exiting updateLoop().");
+    /// delete netConnection object, remove from uo_map
+    void NetworkServer::connectionExpired(Connection* conn)
+    {
+        NetConnection* nc = static_cast<NetConnection*>(conn);
+        ConnectionKey key = nc->getKey();
+       Logger::getInstance().Log(Logs::VERBOSE, Logs::Network, "NetworkServer::connectionExpired()", "Closing connection [{}]", nc->getIPAddr());
+        safeDelete(nc);
+        m_netConnections.erase(key);
+        if(m_pool) { m_pool->removeRoute(key, m_shard); }
     }
 
 /*  void NetworkServer::addPeer(NetworkPeer* peer)
@@ -267,10 +331,69 @@ namespace CGameEngine
     {
         if(!nc) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkServer::changeBuffer()", "NetworkConnection ptr was null!"); }
         else if(!np) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "NetworkServer::changeBuffer()", "NetworkPeer ptr was null!"); }
-        else { nc->setDatagramBuffer(np->getSendDGQueue()); }
+        else { nc->setDatagramBuffer(np.getSendDGQueue()); }
     }*/
 
     /// NetworkServer private functions below ///////////////////////////////////////
+
+    void NetworkServer::processHandoffs()
+    {
+        std::vector<PendingHandoff> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_handoffMutex);
+            pending.swap(m_handoffs);
+            m_handoffPending = false;
+        }
+
+        for(unsigned int i = 0; i < pending.size(); i++) { handOffConnection(pending[i]); }
+    }
+
+    bool NetworkServer::handOffConnection(PendingHandoff& h)
+    {
+        ConnectionKey key(&h.client);
+        ConnectionMap::iterator it = m_netConnections.find(key);
+        if(it == m_netConnections.end()) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::handOffConnection()", "No connection for {}, nothing handed off.", getIPString(&h.client)); return false; }
+        NetConnection* nc = it->second;
+
+        // the client's OP_Acks go to the child once the socket moves, our resends would never stop, wait until they are in
+        uint64_t now = Time::getInstance().steadyMS();
+        if(h.firstMS == 0) { h.firstMS = now; }
+        if(hasUnacked(key))
+        {
+            if(now - h.firstMS >= NET_HANDOFF_MAX_WAIT_MS) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::handOffConnection()", "Connection [{}] still has unacked reliable sends after {} ms, it stays here.", nc->getUniqueID(), NET_HANDOFF_MAX_WAIT_MS); return false; }
+            {
+                std::lock_guard<std::mutex> lock(m_handoffMutex);
+                m_handoffs.push_back(h);
+            }
+            scheduleTimer(now + NET_HANDOFF_RETRY_MS, NetTimer(NetTimerType::HandoffRetry));
+            return false;
+        }
+
+        // from here on the kernel routes the client to this socket rather than m_socket
+        int fd = NetSocket::openConnected(m_srcAddress, &h.client);
+        if(fd == -1) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::handOffConnection()", "Connection [{}] stays here.", nc->getUniqueID()); return false; }
+
+        ConnectionHandoff_Struct hs;
+        memcpy(hs.identifier, m_identifier.c_str(), std::min(m_identifier.length(), sizeof(hs.identifier)-1));
+        hs.clientID = nc->getUniqueID();
+        hs.serverID = m_uniqueID;
+        hs.nextSeqID = m_seqID.load(std::memory_order_relaxed);
+        hs.nextOrdered = nc->getNextOrdered();
+        hs.lastSequenced = nc->getLastSequenced();
+        ChannelSequences channels = getChannels(key);
+        memcpy(hs.channelLast, channels.last, sizeof(hs.channelLast));
+
+        // the child holds its own copy once sent, no shutdown() on ours, that would end the child's as well
+        bool sent = h.ipc->handOff(fd, OP_ConnectionHandoff, m_uniqueID, (const unsigned char*)&hs, sizeof(hs));
+        close(fd);
+        if(!sent) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServer::handOffConnection()", "Could not send connection [{}] over [{}], it stays here.", hs.clientID, h.ipc->getSocketName()); return false; }
+
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkServer::handOffConnection()", "Handed connection [{}] for {} off over [{}].", hs.clientID, nc->getIPAddr(), h.ipc->getSocketName());
+        safeDelete(nc); // also resets its channels
+        m_netConnections.erase(key);
+        if(m_pool) { m_pool->removeRoute(key, m_shard); }
+        return true;
+    }
 }
 
 
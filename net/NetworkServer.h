@@ -3,22 +3,48 @@
 
 #include "net/Network.h"
 #include "net/UnixSocket.h"
+#include "net/ConnectionKey.h"
+#include "common/OpenAddressMap.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*
+    Connection handoff: a server started with handoffs (or in a NetworkServerPool) binds its port
+    with SO_REUSEPORT, handOff() then gives an accepted client to a child process:
+        - updateLoop() opens a UDP socket on the same port connected to the client, the kernel
+          sends that client's datagrams to it rather than the listener from then on (Linux 5.2+)
+        - the socket goes to the child over NetworkIPC as SCM_RIGHTS with a ConnectionHandoff_Struct
+          (IDs, identifier, message numbers), the client's connection is dropped here
+        - the child builds a NetworkServer from that packet and talks to the client directly, the
+          client does not notice anything
+    Datagrams in flight or held back (reliable-ordered gaps) at that moment are not carried over,
+    hand off at a quiet point, right after the connection was accepted for instance.
+*/
 
 namespace CGameEngine
 {
 //    class NetworkPeer;
+    class NetworkServerPool;
+    class NetworkIPC;
+    struct UnixPacket;
+    typedef OpenAddressMap<ConnectionKey, NetConnection*, ConnectionKeyHash> ConnectionMap;
+    typedef OpenAddressMap<ConnectionKey, uint32_t, ConnectionKeyHash> ClosedConnectionMap;
 
     class NetworkServer : public Network
     {
         public:
             NetworkServer() {}
-            NetworkServer(SoftwareVersion* swv, uint16_t port, SafeQueue<Datagram*>* dgbuff, std::string hostname = "");
+            NetworkServer(SoftwareVersion* swv, uint16_t port, SafeQueue<Datagram*>* dgbuff, std::string hostname = "", NetworkServerPool* pool = nullptr, uint16_t shard = 0, bool handoffs = false);
+            NetworkServer(SoftwareVersion* swv, UnixPacket* handoff, SafeQueue<Datagram*>* dgbuff); // child process, serves the one client an OP_ConnectionHandoff packet carries
             ~NetworkServer();
             //void listenLoop() override;
             void updateLoop() override;
             bool shutdownSockets() override;
-            bool isPacketValid(Packet* p, sockaddr_storage* sender = nullptr) override { return (/*!p->isDamaged() &&*/ p->matchesVersion(m_version)); }
-            const unsigned int getConnectionCount() const { return m_netConnections.size(); }
+            bool isPacketValid(const PacketView& p, sockaddr_storage* sender = nullptr) override { return (/*!p.isDamaged() &&*/ p.matchesVersion(m_version)); }
+            const unsigned int getConnectionCount() const override { return m_netConnections.size(); } // any thread
+            const uint16_t& getShardIndex() const { return m_shard; } // 0 unless started by a NetworkServerPool
+            bool handOff(const sockaddr_storage* client, NetworkIPC* ipc); // any thread, queued for updateLoop(), false if the port is not shared
 //            void addPeer(NetworkPeer* peer);
 //            void changeBuffer(NetConnection* nc, NetworkPeer* np);
 
@@ -30,12 +56,31 @@ namespace CGameEngine
             void setDenyConnectionOPCode(const uint16_t& opCode) { m_denyConnOP = opCode; }
 
         protected:
-            SafeUnorderedMap<std::string, NetConnection*> m_netConnections; // clients
+            void connectionExpired(Connection* conn) override;
+            void networkTimer(const NetTimer& t, const uint64_t& timestamp) override;
+            ConnectionMap m_netConnections; // clients by source address + port, updateLoop() only
 //            SafeUnorderedMap<uint32_t, NetworkPeer*> m_internalConnections; // zones, services, etc
-            SafeUnorderedMap<std::string, uint32_t> m_closedConnections; // IPStr and time to remove
+            ClosedConnectionMap m_closedConnections; // source and time to remove (seconds), updateLoop() only
             uint16_t m_reqConnOP = OP_ConnectionRequest;
             uint16_t m_acceptConnOP = OP_ConnectionAccepted;
             uint16_t m_denyConnOP = OP_ConnectionDisconnect;
+            NetworkServerPool* m_pool = nullptr; // owning pool when sharded, told which shard each client landed on
+            uint16_t m_shard = 0;
+
+        private:
+            struct PendingHandoff
+            {
+                sockaddr_storage client;
+                NetworkIPC* ipc = nullptr;
+                uint64_t firstMS = 0; // first attempt, steady clock
+            };
+
+            void processHandoffs(); // updateLoop() only
+            bool handOffConnection(PendingHandoff& h); // false if it was not handed off (now or, while waiting on OP_Acks, yet)
+
+            std::mutex m_handoffMutex;
+            std::vector<PendingHandoff> m_handoffs; // under m_handoffMutex
+            std::atomic<bool> m_handoffPending { false };
     };
 }
 
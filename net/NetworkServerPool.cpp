@@ -0,0 +1,176 @@
+#include "net/NetworkServerPool.h"
+
+namespace CGameEngine
+{
+    /// NetworkServerPool /////////////////////////////////////////////////////
+
+    NetworkServerPool::NetworkServerPool(SoftwareVersion* swv, uint16_t port, uint16_t shards, SafeQueue<Datagram*>* dgbuff, std::string hostname /*= ""*/)
+        : m_datagramBuffer(dgbuff)
+    {
+        if(shards == 0) { shards = 1; }
+        else if(shards > NET_MAX_SHARDS) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServerPool::NetworkServerPool()", "Shard count [{}] clamped to [{}].", shards, NET_MAX_SHARDS); shards = NET_MAX_SHARDS; }
+
+        /// \NOTE: Ephemeral ports would hand every shard a different port
+        if(port == 0 && shards > 1) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServerPool::NetworkServerPool()", "Sharding needs a fixed port, starting a single shard."); shards = 1; }
+
+        m_routes.reserve(1024);
+
+        // every socket has to be bound before clients arrive, adding one later re-hashes existing clients onto other shards
+        uint32_t uniqueID = 0;
+        for(uint16_t i = 0; i < shards; i++)
+        {
+            SafeQueue<Datagram*>* buffer = m_datagramBuffer;
+            if(!buffer) { buffer = new SafeQueue<Datagram*>(); m_shardBuffers.push_back(buffer); }
+
+            NetworkServer* shard = new NetworkServer(swv, port, buffer, hostname, this, i);
+            if(i == 0) { uniqueID = shard->getUniqueID(); }
+            else { shard->setUniqueID(uniqueID); } // one server as far as clients are concerned
+            m_shards.push_back(shard);
+        }
+
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "NetworkServerPool::NetworkServerPool()", "Started [{}] shards on port [{}], {} datagram buffer(s).", m_shards.size(), port, (m_datagramBuffer) ? "shared" : "per-shard");
+    }
+
+    NetworkServerPool::~NetworkServerPool()
+    {
+        stop();
+        for(unsigned int i = 0; i < m_shards.size(); i++) { safeDelete(m_shards[i]); }
+        m_shards.clear();
+
+        // shards are gone, nothing else pushes into their buffers
+        for(unsigned int i = 0; i < m_shardBuffers.size(); i++)
+        {
+            while(!m_shardBuffers[i]->empty()) { Datagram* d = m_shardBuffers[i]->front(); m_shardBuffers[i]->pop(); safeDelete(d); }
+            safeDelete(m_shardBuffers[i]);
+        }
+        m_shardBuffers.clear();
+
+        std::lock_guard<std::mutex> lock(m_routeMutex);
+        m_routes.clear();
+    }
+
+    void NetworkServerPool::send(sockaddr_storage* addr, uint16_t opCode, unsigned char** data, uint32_t dataLength, uint8_t delivery /*= DeliveryMode::ReliableUnordered*/)
+    {
+        NetworkServer* shard = getShard(addr);
+        if(!shard)
+        {
+           Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkServerPool::send()", "No shard holds a connection for [{}], sending from shard 0.", getIPString(addr));
+            shard = m_shards[0];
+        }
+        shard->send(addr, opCode, data, dataLength, delivery);
+    }
+
+    void NetworkServerPool::sendSimple(sockaddr_storage* addr, uint16_t opCode)
+    {
+        NetworkServer* shard = getShard(addr);
+        (shard ? shard : m_shards[0])->sendSimple(addr, opCode); // no stored sequence, any socket on the port will do
+    }
+
+    void NetworkServerPool::setAccepting(bool val /*= true*/)
+    {
+        m_netListening = val;
+        for(unsigned int i = 0; i < m_shards.size(); i++) { m_shards[i]->setAccepting(val); }
+    }
+
+    void NetworkServerPool::setTitle(std::string str)
+    {
+        for(unsigned int i = 0; i < m_shards.size(); i++) { m_shards[i]->setTitle(str + "#" + std::to_string(i)); }
+    }
+
+    void NetworkServerPool::setRequestConnectionOPCode(const uint16_t& opCode)
+    {
+        for(unsigned int i = 0; i < m_shards.size(); i++) { m_shards[i]->setRequestConnectionOPCode(opCode); }
+    }
+
+    void NetworkServerPool::setAcceptConnectionOPCode(const uint16_t& opCode)
+    {
+        for(unsigned int i = 0; i < m_shards.size(); i++) { m_shards[i]->setAcceptConnectionOPCode(opCode); }
+    }
+
+    void NetworkServerPool::setDenyConnectionOPCode(const uint16_t& opCode)
+    {
+        for(unsigned int i = 0; i < m_shards.size(); i++) { m_shards[i]->setDenyConnectionOPCode(opCode); }
+    }
+
+    void NetworkServerPool::stop()
+    {
+        m_netListening = false;
+        for(unsigned int i = 0; i < m_shards.size(); i++) { m_shards[i]->stop(); }
+    }
+
+    const bool NetworkServerPool::isActive() const
+    {
+        if(m_shards.empty()) { return false; }
+        for(unsigned int i = 0; i < m_shards.size(); i++) { if(!m_shards[i]->isActive()) { return false; } }
+        return true;
+    }
+
+    NetworkServer* NetworkServerPool::getShard(const sockaddr_storage* addr)
+    {
+        ConnectionKey key(addr);
+        std::lock_guard<std::mutex> lock(m_routeMutex);
+        ShardRouteMap::iterator it = m_routes.find(key);
+        return (it != m_routes.end()) ? m_shards[it->second] : nullptr;
+    }
+
+    SafeQueue<Datagram*>* NetworkServerPool::getDatagramBuffer(uint16_t idx /*= 0*/)
+    {
+        if(m_datagramBuffer) { return m_datagramBuffer; }
+        return (idx < m_shardBuffers.size()) ? m_shardBuffers[idx] : nullptr;
+    }
+
+    const unsigned int NetworkServerPool::getConnectionCount() const
+    {
+        unsigned int retVal = 0;
+        for(unsigned int i = 0; i < m_shards.size(); i++) { retVal += m_shards[i]->getConnectionCount(); }
+        return retVal;
+    }
+
+    const uint64_t NetworkServerPool::getReceiveQueueDrops() const
+    {
+        uint64_t retVal = 0;
+        for(unsigned int i = 0; i < m_shards.size(); i++) { retVal += m_shards[i]->getReceiveQueueDrops(); }
+        return retVal;
+    }
+
+    const uint64_t NetworkServerPool::getSendQueueStalls() const
+    {
+        uint64_t retVal = 0;
+        for(unsigned int i = 0; i < m_shards.size(); i++) { retVal += m_shards[i]->getSendQueueStalls(); }
+        return retVal;
+    }
+
+    ReceiveWindowStats NetworkServerPool::getReceiveWindowStats() const
+    {
+        ReceiveWindowStats retVal;
+        for(unsigned int i = 0; i < m_shards.size(); i++)
+        {
+            ReceiveWindowStats s = m_shards[i]->getReceiveWindowStats();
+            retVal.limit += s.limit;
+            retVal.queued += s.queued;
+            retVal.bytes += s.bytes;
+            retVal.peakBytes += s.peakBytes; // per shard peaks, an upper bound
+            retVal.dropped += s.dropped;
+            retVal.overrun += s.overrun;
+        }
+        return retVal;
+    }
+
+    void NetworkServerPool::addRoute(const ConnectionKey& key, uint16_t shard)
+    {
+        std::lock_guard<std::mutex> lock(m_routeMutex);
+        if(!m_routes.insert(key, shard))
+        {
+            // client reconnected from the same address and the kernel moved it (a shard socket closed)
+            ShardRouteMap::iterator it = m_routes.find(key);
+            it->second = shard;
+        }
+    }
+
+    void NetworkServerPool::removeRoute(const ConnectionKey& key, uint16_t shard)
+    {
+        std::lock_guard<std::mutex> lock(m_routeMutex);
+        ShardRouteMap::iterator it = m_routes.find(key);
+        if(it != m_routes.end() && it->second == shard) { m_routes.erase(it); } // leave it if another shard took the client over
+    }
+}
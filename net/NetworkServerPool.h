@@ -0,0 +1,70 @@
+#ifndef NETWORKSERVERPOOL_H
+#define NETWORKSERVERPOOL_H
+
+#include "net/NetworkServer.h"
+#include <mutex>
+#include <vector>
+
+/*
+    Every shard is a complete NetworkServer (listen, update and send thread, connection table,
+    receive ring and send queue) bound to the same port with SO_REUSEPORT. The kernel picks the
+    shard for each datagram by hashing its 4-tuple, so a client's traffic always reaches the same
+    shard and shards never share connection state. The pool only keeps a client -> shard route
+    table so that sends from user threads leave through the shard holding the connection (its
+    stored sequences answer the client's retry requests).
+
+    Ref:
+        https://lwn.net/Articles/542629/
+            SO_REUSEPORT : multiple sockets on one port, load distributed by the kernel
+*/
+
+#define NET_MAX_SHARDS 64
+
+namespace CGameEngine
+{
+    typedef OpenAddressMap<ConnectionKey, uint16_t, ConnectionKeyHash> ShardRouteMap;
+
+    class NetworkServerPool
+    {
+        public:
+            /// dgbuff receives the Datagrams of every shard, pass nullptr to give each shard its own queue
+            NetworkServerPool(SoftwareVersion* swv, uint16_t port, uint16_t shards, SafeQueue<Datagram*>* dgbuff, std::string hostname = "");
+            ~NetworkServerPool();
+            NetworkServerPool(const NetworkServerPool& nsp) = delete;
+            NetworkServerPool& operator=(const NetworkServerPool& nsp) = delete;
+
+            void send(sockaddr_storage* addr, uint16_t opCode, unsigned char** data, uint32_t dataLength, uint8_t delivery = DeliveryMode::ReliableUnordered);
+            void sendSimple(sockaddr_storage* addr, uint16_t opCode);
+            void setAccepting(bool val = true);
+            void setTitle(std::string str);
+            void setRequestConnectionOPCode(const uint16_t& opCode);
+            void setAcceptConnectionOPCode(const uint16_t& opCode);
+            void setDenyConnectionOPCode(const uint16_t& opCode);
+            void stop();
+
+            const bool isActive() const; // every shard is functioning
+            const bool isAccepting() const { return m_netListening; }
+            const uint16_t getShardCount() const { return (uint16_t)m_shards.size(); }
+            NetworkServer* getShard(uint16_t idx) { return (idx < m_shards.size()) ? m_shards[idx] : nullptr; }
+            NetworkServer* getShard(const sockaddr_storage* addr); // shard owning the client, nullptr if unknown
+            SafeQueue<Datagram*>* getDatagramBuffer(uint16_t idx = 0); // shared queue, or the shard's own
+            const unsigned int getConnectionCount() const; // all shards, any thread
+            const uint64_t getReceiveQueueDrops() const; // all shards
+            const uint64_t getSendQueueStalls() const; // all shards
+            ReceiveWindowStats getReceiveWindowStats() const; // all shards, each has its own global window
+
+            // called by the shards' update threads
+            void addRoute(const ConnectionKey& key, uint16_t shard);
+            void removeRoute(const ConnectionKey& key, uint16_t shard);
+
+        private:
+            bool m_netListening = false;
+            std::vector<NetworkServer*> m_shards;
+            std::vector<SafeQueue<Datagram*>*> m_shardBuffers; // owned, only used without a shared buffer
+            SafeQueue<Datagram*>* m_datagramBuffer = nullptr; // shared buffer, not owned
+            mutable std::mutex m_routeMutex;
+            ShardRouteMap m_routes;
+    };
+}
+
+#endif // NETWORKSERVERPOOL_H
@@ -0,0 +1,361 @@
+#include "net/NetworkSimulator.h"
+#include "net/Packet.h" // PACKET_MAX_SIZE
+#include "common/MemoryPool.h"
+#include "srv/Time.h"
+#include <algorithm> // min, max
+#include <chrono>
+#include <cstring> // memcpy
+#include <thread> // sleep_for
+
+#if PLATFORM == PLATFORM_LINUX
+    #include <sys/eventfd.h>
+    #include <unistd.h> // read(), write(), close()
+#endif
+
+namespace CGameEngine
+{
+    /// SimSocket /////////////////////////////////////////////////////////////
+
+    SimSocket::SimSocket(NetworkSimulator* sim, uint16_t port) : m_port(port)
+    {
+        m_type = SocketType::NetSocket;
+        if(!sim || !sim->attach(this, m_port)) { return; }
+        m_simulator.store(sim, std::memory_order_release);
+
+        #if PLATFORM == PLATFORM_LINUX
+            m_fd = eventfd(0, EFD_NONBLOCK);
+            if(m_fd == -1) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "SimSocket::SimSocket()", "eventfd() failed, errno [{}].", errno); closeSocket(); }
+        #else
+            Logger::getInstance().Log(Logs::CRIT, Logs::Network, "SimSocket::SimSocket()", "The simulator needs eventfd(), Linux only.");
+            closeSocket();
+        #endif
+    }
+
+    SimSocket::~SimSocket()
+    {
+        closeSocket(); // NetSocket's destructor only sees its own closeSocket()
+    }
+
+    void SimSocket::closeSocket()
+    {
+        NetworkSimulator* sim = m_simulator.exchange(nullptr, std::memory_order_acq_rel);
+        if(sim) { sim->detach(this); } // no more pushes after this
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(size_t i = 0; i < m_inbox.size(); i++) { poolRelease(m_inbox[i].data); }
+        m_inbox.clear();
+
+        #if PLATFORM == PLATFORM_LINUX
+            if(m_fd != -1) { close(m_fd); }
+        #endif
+        m_fd = -1;
+    }
+
+    bool SimSocket::sendData(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size)
+    {
+        NetworkSimulator* sim = m_simulator.load(std::memory_order_acquire);
+        if(!sim || !destination || !packet_data || packet_size == 0) { return false; }
+        sim->transmit(m_port, destination, packet_data, packet_size);
+        return true;
+    }
+
+    int SimSocket::sendBatch(SendBatch& batch, uint16_t count, uint16_t offset /*= 0*/)
+    {
+        if(count == 0 || offset+count > batch.size) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "SimSocket::sendBatch()" ,"Generic error"); return -1; }
+
+        int sent = 0;
+        for(uint16_t i = offset; i < offset+count; i++)
+        {
+            if(!sendData(batch.destinations[i], batch.data[i], batch.lengths[i])) { break; }
+            sent++;
+        }
+        return (sent > 0) ? sent : -1;
+    }
+
+    bool SimSocket::broadcastSend(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size)
+    {
+        return sendData(destination, packet_data, packet_size);
+    }
+
+    int SimSocket::receive(struct sockaddr_storage* sender, unsigned char* buffer, int /*fd = -1*/)
+    {
+        if(!sender || !buffer) { return -1; }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_inbox.empty()) { return -1; }
+
+        Arrival& a = m_inbox.front();
+        int bytes = (int)std::min(a.size, (uint32_t)PACKET_MAX_SIZE);
+        memcpy(buffer, a.data, bytes);
+        memcpy(sender, &a.sender, sizeof(struct sockaddr_storage));
+        poolRelease(a.data);
+        m_inbox.pop_front();
+
+        // drained, clear readiness
+        #if PLATFORM == PLATFORM_LINUX
+            if(m_inbox.empty() && m_fd != -1) { uint64_t value = 0; if(read(m_fd, &value, sizeof(value)) < 0) {} }
+        #endif
+        return bytes;
+    }
+
+    int SimSocket::receiveBatch(ReceiveRing& ring, int /*fd = -1*/)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int count = 0;
+        while(count < ring.size && !m_inbox.empty())
+        {
+            Arrival& a = m_inbox.front();
+            ring.lengths[count] = (int)std::min(a.size, ring.slotSize); // truncated like a short recvmmsg() buffer
+            memcpy(ring.buffers[count], a.data, ring.lengths[count]);
+            memcpy(&ring.senders[count], &a.sender, sizeof(struct sockaddr_storage));
+            poolRelease(a.data);
+            m_inbox.pop_front();
+            count++;
+        }
+
+        #if PLATFORM == PLATFORM_LINUX
+            if(m_inbox.empty() && m_fd != -1) { uint64_t value = 0; if(read(m_fd, &value, sizeof(value)) < 0) {} }
+        #endif
+        return (count > 0) ? count : -1;
+    }
+
+    /// SimSocket private functions ///////////////////////////////////////////
+
+    void SimSocket::push(const sockaddr_storage& sender, unsigned char* data, uint32_t size)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_fd == -1) { poolRelease(data); return; }
+
+        Arrival a;
+        memcpy(&a.sender, &sender, sizeof(struct sockaddr_storage));
+        a.data = data;
+        a.size = size;
+        m_inbox.push_back(a);
+
+        // readable until receive()/receiveBatch() empties the inbox
+        #if PLATFORM == PLATFORM_LINUX
+            if(m_inbox.size() == 1) { uint64_t one = 1; if(write(m_fd, &one, sizeof(one)) < 0) {} }
+        #endif
+    }
+
+    void SimSocket::detached()
+    {
+        m_simulator.store(nullptr, std::memory_order_release); // inbox stays readable, sends fail
+    }
+
+    /// NetworkSimulator //////////////////////////////////////////////////////
+
+    std::atomic<NetworkSimulator*> NetworkSimulator::s_active { nullptr };
+
+    NetworkSimulator::NetworkSimulator(uint64_t seed /*= 1*/) : m_seed(seed)
+    {
+        // starts at wall clock time, so nowMS() stays plausible for anything that logs or compares it
+        m_startUS = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        m_clockUS.store(m_startUS, std::memory_order_release);
+    }
+
+    NetworkSimulator::~NetworkSimulator()
+    {
+        uninstall();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(std::unordered_map<uint16_t, SimSocket*>::iterator it = m_sockets.begin(); it != m_sockets.end(); ++it) { it->second->detached(); }
+        m_sockets.clear();
+        while(!m_inFlight.empty())
+        {
+            unsigned char* data = m_inFlight.top().data;
+            poolRelease(data);
+            m_inFlight.pop();
+        }
+    }
+
+    void NetworkSimulator::install()
+    {
+        NetworkSimulator* prev = s_active.exchange(this, std::memory_order_acq_rel);
+        if(prev && prev != this) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSimulator::install()", "Replacing another installed simulator, its Networks keep their sockets."); }
+        Time::getInstance().setVirtualClock(&m_clockUS);
+    }
+
+    void NetworkSimulator::uninstall()
+    {
+        NetworkSimulator* self = this;
+        if(s_active.compare_exchange_strong(self, nullptr, std::memory_order_acq_rel)) { Time::getInstance().setVirtualClock(nullptr); }
+    }
+
+    SimSocket* NetworkSimulator::createSocket(uint16_t port)
+    {
+        return new SimSocket(this, port);
+    }
+
+    void NetworkSimulator::setConditions(const LinkConditions& conditions)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_defaults = conditions;
+        for(std::unordered_map<uint32_t, Link>::iterator it = m_links.begin(); it != m_links.end(); ++it) { it->second.conditions = conditions; }
+    }
+
+    void NetworkSimulator::setConditions(uint16_t srcPort, uint16_t dstPort, const LinkConditions& conditions)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        getLink(srcPort, dstPort).conditions = conditions;
+    }
+
+    void NetworkSimulator::advance(uint64_t us)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t target = nowUS() + us;
+        while(!m_inFlight.empty() && m_inFlight.top().dueUS <= target)
+        {
+            InFlight f = m_inFlight.top();
+            m_inFlight.pop();
+
+            // readers see each arrival at its own time, never a jump past it
+            if(f.dueUS > nowUS()) { m_clockUS.store(f.dueUS, std::memory_order_release); }
+            deliver(f);
+        }
+        m_clockUS.store(target, std::memory_order_release);
+    }
+
+    void NetworkSimulator::run(uint64_t us, double speed /*= 1.0*/, uint64_t stepUS /*= SIM_RUN_STEP_US*/)
+    {
+        if(stepUS == 0) { stepUS = SIM_RUN_STEP_US; }
+        for(uint64_t elapsed = 0; elapsed < us; elapsed += stepUS)
+        {
+            uint64_t step = std::min(stepUS, us - elapsed);
+            advance(step);
+            if(speed > 0.0) { std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)(step / speed))); } // 0 runs flat out
+        }
+    }
+
+    const uint64_t NetworkSimulator::nextDeliveryUS() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return (m_inFlight.empty()) ? UINT64_MAX : m_inFlight.top().dueUS;
+    }
+
+    SimulatorStats NetworkSimulator::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SimulatorStats retVal = m_stats;
+        retVal.timeUS = nowUS() - m_startUS;
+        retVal.inFlight = m_inFlight.size();
+        return retVal;
+    }
+
+    /// NetworkSimulator private functions ////////////////////////////////////
+
+    bool NetworkSimulator::attach(SimSocket* socket, uint16_t& port)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(port == 0)
+        {
+            for(uint32_t tries = 0; tries <= 0xFFFF - SIM_EPHEMERAL_PORT && m_sockets.count(m_nextEphemeral) > 0; tries++)
+            {
+                m_nextEphemeral = (m_nextEphemeral == 0xFFFF) ? SIM_EPHEMERAL_PORT : m_nextEphemeral + 1;
+            }
+            port = m_nextEphemeral;
+            m_nextEphemeral = (m_nextEphemeral == 0xFFFF) ? SIM_EPHEMERAL_PORT : m_nextEphemeral + 1;
+        }
+
+        if(!m_sockets.insert(std::make_pair(port, socket)).second) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "NetworkSimulator::attach()", "Port [{}] is already bound.", port); return false; }
+        return true;
+    }
+
+    void NetworkSimulator::detach(SimSocket* socket)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::unordered_map<uint16_t, SimSocket*>::iterator it = m_sockets.find(socket->getPort());
+        if(it != m_sockets.end() && it->second == socket) { m_sockets.erase(it); }
+    }
+
+    void NetworkSimulator::transmit(uint16_t srcPort, const sockaddr_storage* destination, const unsigned char* data, uint32_t size)
+    {
+        // the receiver sees the address it was sent to, with the sender's port
+        sockaddr_storage sender;
+        memcpy(&sender, destination, sizeof(struct sockaddr_storage));
+        if(sender.ss_family == AF_INET) { ((struct sockaddr_in*)&sender)->sin_port = htons(srcPort); }
+        else if(sender.ss_family == AF_INET6) { ((struct sockaddr_in6*)&sender)->sin6_port = htons(srcPort); }
+        uint16_t dstPort = getPort(destination);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.sent++;
+        m_stats.bytesSent += size;
+
+        // every draw comes from the link's own generator, in send order
+        Link& link = getLink(srcPort, dstPort);
+        const LinkConditions& c = link.conditions;
+        if(c.loss > 0.0 && random(link.rng) < c.loss) { m_stats.lost++; return; }
+
+        uint64_t now = nowUS();
+        uint64_t departUS = now;
+        if(c.bandwidth > 0)
+        {
+            departUS = std::max(now, link.busyUntilUS) + (uint64_t)size * 1000000 / c.bandwidth;
+            link.busyUntilUS = departUS;
+        }
+
+        uint64_t dueUS = departUS + c.latencyUS;
+        if(c.jitterUS > 0) { dueUS += (uint64_t)(random(link.rng) * c.jitterUS); }
+        if(c.reorder > 0.0 && random(link.rng) < c.reorder) { dueUS += c.reorderUS; m_stats.reordered++; } // does not hold back the ones behind it
+        else { dueUS = std::max(dueUS, link.lastDueUS); link.lastDueUS = dueUS; }
+        schedule(dstPort, sender, data, size, dueUS);
+
+        if(c.duplicate > 0.0 && random(link.rng) < c.duplicate)
+        {
+            m_stats.duplicated++;
+            uint64_t copyUS = departUS + c.latencyUS + ((c.jitterUS > 0) ? (uint64_t)(random(link.rng) * c.jitterUS) : 0);
+            schedule(dstPort, sender, data, size, copyUS);
+        }
+    }
+
+    NetworkSimulator::Link& NetworkSimulator::getLink(uint16_t srcPort, uint16_t dstPort)
+    {
+        uint32_t key = ((uint32_t)srcPort << 16) | dstPort;
+        std::unordered_map<uint32_t, Link>::iterator it = m_links.find(key);
+        if(it != m_links.end()) { return it->second; }
+
+        // splitmix64 of seed and ports, xorshift needs a non-zero state
+        Link link;
+        link.conditions = m_defaults;
+        uint64_t z = m_seed + (uint64_t)key * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        link.rng = (z ^ (z >> 31)) | 1;
+        return m_links.insert(std::make_pair(key, link)).first->second;
+    }
+
+    void NetworkSimulator::schedule(uint16_t dstPort, const sockaddr_storage& sender, const unsigned char* data, uint32_t size, uint64_t dueUS)
+    {
+        InFlight f;
+        f.dueUS = dueUS;
+        f.order = m_order++;
+        f.dstPort = dstPort;
+        memcpy(&f.sender, &sender, sizeof(struct sockaddr_storage));
+        f.data = poolBuffer(size);
+        f.size = size;
+        memcpy(f.data, data, size);
+
+        if(dueUS <= nowUS()) { deliver(f); } // nothing in the way, no need to wait for advance()
+        else { m_inFlight.push(f); }
+    }
+
+    void NetworkSimulator::deliver(InFlight& f)
+    {
+        std::unordered_map<uint16_t, SimSocket*>::iterator it = m_sockets.find(f.dstPort);
+        if(it == m_sockets.end()) { m_stats.unroutable++; poolRelease(f.data); return; }
+
+        m_stats.delivered++;
+        m_stats.bytesDelivered += f.size;
+        it->second->push(f.sender, f.data, f.size);
+        f.data = nullptr;
+    }
+
+    double NetworkSimulator::random(uint64_t& state)
+    {
+        // xorshift64*, top 53 bits
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (double)((state * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+    }
+}
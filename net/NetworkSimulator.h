@@ -0,0 +1,185 @@
+#ifndef NETWORKSIMULATOR_H_INCLUDED
+#define NETWORKSIMULATOR_H_INCLUDED
+
+#include "common/types.h"
+#include "net/NetSocket.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/*
+    In-process loopback network for measuring the reliability layer without two hosts. While a
+    simulator is installed:
+        - every Network constructed gets a SimSocket instead of a kernel socket, addressed by port
+          alone (any host), a datagram sent to port N lands in the SimSocket bound to N with the
+          sender's port stamped into a copy of the destination address
+        - Time::now()/nowMS()/steady*() read the simulator's virtual clock, which only moves when
+          advance() or run() is called
+        - each direction of each port pair is a link with its own LinkConditions (latency, jitter,
+          bandwidth, loss, duplication, reordering) and its own PRNG seeded from the simulator's
+          seed and the ports, so a link makes the same decisions for the same sequence of datagrams
+    Datagrams due at or before the current virtual time are delivered from inside send(), anything
+    later waits in a queue for advance(). A SimSocket signals its eventfd whenever its inbox is not
+    empty, which is all Network's poll() loops need.
+
+    Only the link is deterministic, Network still runs its own threads and those wait in real time
+    (poll, condition variables). run() paces virtual time against real time so timers are not
+    starved, raise 'speed' only when timeouts are not what is being measured.
+
+    Typical harness, server on 7000 with N clients:
+        NetworkSimulator sim(seed);
+        LinkConditions wan; wan.latencyUS = 40000; wan.jitterUS = 5000; wan.loss = 0.01;
+        sim.setConditions(wan);
+        sim.install();
+        NetworkServer server(&swv, 7000, &serverQueue);
+        NetworkClient client(&swv, 7001, &clientQueue, "127.0.0.1", 7000); // ...N times, one port each
+        sim.run(seconds * 1000000);
+    Throughput is getStats().bytesDelivered over the virtual time, goodput the payload bytes the
+    users received, completion latency NetHistogram::DeliveryLatencyUS and the retransmit ratio
+    NetCounter::FragmentsResent / NetCounter::PacketsSent, both from Network::getStatsSnapshot().
+
+    The simulator must outlive every Network created while it was installed.
+
+    Ref:
+        https://man7.org/linux/man-pages/man8/tc-netem.8.html
+            netem, the same knobs on a real interface
+        https://man7.org/linux/man-pages/man2/eventfd.2.html
+            eventfd : pollable counter standing in for a socket's readiness
+*/
+
+#define SIM_EPHEMERAL_PORT 49152 // first port handed to Networks bound to port 0
+#define SIM_REORDER_US 5000 // default hold back of a reordered datagram
+#define SIM_RUN_STEP_US 1000 // virtual time per run() step
+
+namespace CGameEngine
+{
+    class NetworkSimulator;
+
+    /// what one direction of a link does to a datagram, probabilities are per datagram
+    struct LinkConditions
+    {
+        uint64_t latencyUS = 0; // one way
+        uint64_t jitterUS = 0; // uniform in [0, jitterUS) on top of the latency, order is kept unless reordered
+        uint64_t bandwidth = 0; // bytes per second, 0 is unlimited
+        double loss = 0.0;
+        double duplicate = 0.0; // the copy arrives with its own jitter
+        double reorder = 0.0; // held back by reorderUS, later datagrams pass it
+        uint64_t reorderUS = SIM_REORDER_US;
+    };
+
+    /// plain snapshot of the simulator's counters, safe to hand out to other threads
+    struct SimulatorStats
+    {
+        uint64_t timeUS = 0; // virtual time elapsed since construction
+        uint64_t sent = 0; // datagrams handed to a SimSocket
+        uint64_t bytesSent = 0;
+        uint64_t delivered = 0; // datagrams put in an inbox, duplicates included
+        uint64_t bytesDelivered = 0;
+        uint64_t lost = 0;
+        uint64_t duplicated = 0;
+        uint64_t reordered = 0;
+        uint64_t unroutable = 0; // no SimSocket on the destination port
+        uint64_t inFlight = 0; // queued for a later virtual time
+        const float lossRate() const { return (sent > 0) ? (float)lost / (float)sent : 0.0f; }
+    };
+
+    /// NetSocket stand-in bound to a simulator port, getFD() is an eventfd readable while the inbox holds datagrams
+    class SimSocket : public NetSocket
+    {
+        public:
+            SimSocket(NetworkSimulator* sim, uint16_t port);
+            ~SimSocket();
+
+            void closeSocket() override;
+            bool sendData(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size) override;
+            int sendBatch(SendBatch& batch, uint16_t count, uint16_t offset = 0) override;
+            bool broadcastSend(const sockaddr_storage* destination, unsigned char* packet_data, uint32_t packet_size) override; // plain send, the simulator has no subnet
+            int receive(struct sockaddr_storage* sender, unsigned char* buffer, int fd = -1) override;
+            int receiveBatch(ReceiveRing& ring, int fd = -1) override;
+
+            const uint16_t& getPort() const { return m_port; }
+
+        private:
+            friend class NetworkSimulator;
+            struct Arrival { sockaddr_storage sender; unsigned char* data; uint32_t size; }; // data is a pool buffer
+            void push(const sockaddr_storage& sender, unsigned char* data, uint32_t size); // simulator's lock held, takes data
+            void detached(); // simulator is going away
+
+            std::mutex m_mutex; // m_inbox, lock after the simulator's
+            std::deque<Arrival> m_inbox;
+            std::atomic<NetworkSimulator*> m_simulator { nullptr }; // cleared by closeSocket() or the simulator's destructor
+            uint16_t m_port = 0;
+    };
+
+    class NetworkSimulator
+    {
+        public:
+            NetworkSimulator(uint64_t seed = 1);
+            ~NetworkSimulator();
+            NetworkSimulator(const NetworkSimulator& ns) = delete;
+            NetworkSimulator& operator=(const NetworkSimulator& ns) = delete;
+
+            void install(); // Networks constructed from now on use it, Time reads the virtual clock
+            void uninstall(); // back to kernel sockets and the system clocks, existing SimSockets keep working
+            static NetworkSimulator* getActive() { return s_active.load(std::memory_order_acquire); }
+
+            SimSocket* createSocket(uint16_t port); // 0 picks an ephemeral port, isOpen() is false if the port is taken
+            void setConditions(const LinkConditions& conditions); // every link, existing ones included
+            void setConditions(uint16_t srcPort, uint16_t dstPort, const LinkConditions& conditions); // one direction
+            void advance(uint64_t us); // move the virtual clock, delivering everything that comes due on the way
+            void run(uint64_t us, double speed = 1.0, uint64_t stepUS = SIM_RUN_STEP_US); // advance() in steps, sleeping stepUS / speed of real time between them
+            const uint64_t nowUS() const { return m_clockUS.load(std::memory_order_acquire); } // what Time::steadyUS() reports while installed
+            const uint64_t nextDeliveryUS() const; // virtual time of the earliest queued datagram, UINT64_MAX if none
+            SimulatorStats getStats() const;
+
+        private:
+            friend class SimSocket;
+
+            /// one direction between two ports
+            struct Link
+            {
+                LinkConditions conditions;
+                uint64_t rng = 0;
+                uint64_t lastDueUS = 0; // keeps jitter from reordering
+                uint64_t busyUntilUS = 0; // bandwidth, when the last datagram finished serializing
+            };
+
+            struct InFlight
+            {
+                uint64_t dueUS = 0;
+                uint64_t order = 0; // ties in dueUS deliver in send order
+                uint16_t dstPort = 0;
+                sockaddr_storage sender;
+                unsigned char* data = nullptr; // pool buffer
+                uint32_t size = 0;
+                bool operator>(const InFlight& f) const { return (dueUS != f.dueUS) ? dueUS > f.dueUS : order > f.order; }
+            };
+
+            bool attach(SimSocket* socket, uint16_t& port); // SimSocket's constructor
+            void detach(SimSocket* socket); // SimSocket::closeSocket()
+            void transmit(uint16_t srcPort, const sockaddr_storage* destination, const unsigned char* data, uint32_t size);
+            Link& getLink(uint16_t srcPort, uint16_t dstPort); // m_mutex held
+            void schedule(uint16_t dstPort, const sockaddr_storage& sender, const unsigned char* data, uint32_t size, uint64_t dueUS); // m_mutex held
+            void deliver(InFlight& f); // m_mutex held
+            static double random(uint64_t& state); // [0, 1)
+
+            static std::atomic<NetworkSimulator*> s_active;
+
+            mutable std::mutex m_mutex;
+            std::atomic<uint64_t> m_clockUS { 0 }; // epoch microseconds, Time's virtual clock
+            uint64_t m_startUS = 0;
+            uint64_t m_seed = 1;
+            uint64_t m_order = 0;
+            uint16_t m_nextEphemeral = SIM_EPHEMERAL_PORT;
+            LinkConditions m_defaults;
+            std::unordered_map<uint32_t, Link> m_links; // src port << 16 | dst port
+            std::unordered_map<uint16_t, SimSocket*> m_sockets;
+            std::priority_queue<InFlight, std::vector<InFlight>, std::greater<InFlight> > m_inFlight;
+            SimulatorStats m_stats; // counters only, time and queue depth are filled in by getStats()
+    };
+}
+
+#endif // NETWORKSIMULATOR_H_INCLUDED
@@ -4,7 +4,7 @@
 namespace CGameEngine
 {
     Packet::Packet(uint16_t pSize/*= PACKET_DATA_SIZE*/) :
-        identifier(new unsigned char[IDENT_SIZE]), data(new unsigned char[pSize])
+        identifier(poolBuffer(IDENT_SIZE)), data(poolBuffer(pSize))
     {
         memset(identifier, 0, IDENT_SIZE);
         memset(data, 0, pSize);
@@ -16,7 +16,7 @@ namespace CGameEngine
         if(len > PACKET_MAX_SIZE || len < PACKET_MIN_RCV_SIZE) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Packet::Packet(uchar*, int)", "Invalid packet length! [{}]", len); return; } // invalid!
         else
         {
-            identifier = new unsigned char[IDENT_SIZE];
+            identifier = poolBuffer(IDENT_SIZE);
             memset(identifier, 0, IDENT_SIZE);
             serializeIn();
             //Logger::getInstance().Log(Logs::DEBUG, "Packet::Packet(uchar*, int)", "arrival [{}], creation [{}] (diff {})", arrival, timestamp, (arrival-timestamp));
@@ -34,9 +34,9 @@ namespace CGameEngine
 
     // constructor likely from Network::send()
     Packet::Packet(std::string& ident, SoftwareVersion* swv, uint16_t opcode, const uint64_t& timeStamp, uint32_t seqid, uint32_t pktnum, uint32_t pkttotal,
-            uint32_t wholeCRC, uint16_t datalength, uint32_t totallength, unsigned char* d) :
-                identifier(new unsigned char [IDENT_SIZE]), op_code(opcode), timestamp(timeStamp), seqIdent(seqid), pktNum(pktnum), pktTotal(pkttotal),
-                totalCRC(wholeCRC), dataLength(datalength), totalLength(totallength), data(new unsigned char[dataLength])
+            uint32_t wholeCRC, uint16_t datalength, uint32_t totallength, unsigned char* d, uint8_t deliverymode /*= DeliveryMode::Unreliable*/, uint32_t channelseq /*= 0*/) :
+                identifier(poolBuffer(IDENT_SIZE)), op_code(opcode), timestamp(timeStamp), seqIdent(seqid), pktNum(pktnum), pktTotal(pkttotal),
+                totalCRC(wholeCRC), dataLength(datalength), totalLength(totallength), delivery(deliverymode), channelSeq(channelseq), data(poolBuffer(dataLength))
     {
         if(dataLength+PACKET_HEADER_SIZE > PACKET_MAX_SIZE) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Packet::Packet(full)", "Invalid packet length! [{}]", dataLength); return; }
         else
@@ -48,7 +48,7 @@ namespace CGameEngine
             {
                 memset(identifier, 0, IDENT_SIZE);
                 memset(data, 0, dataLength);
-                memcpy(identifier, ident.c_str(), IDENT_SIZE);
+                memcpy(identifier, ident.c_str(), std::min(ident.length(), (size_t)IDENT_SIZE)); // zero padded
                 memcpy(data, d, dataLength);
             }
             catch (...)
@@ -62,8 +62,8 @@ namespace CGameEngine
     // destructor
     Packet::~Packet() noexcept
     {
-        safeDeleteArray(identifier);
-        safeDeleteArray(data);
+        poolRelease(identifier);
+        poolRelease(data);
     }
 
     /// \TODO: Will this fail as it does not account for the RawPacket beneath, or does it even need to?
@@ -87,6 +87,8 @@ namespace CGameEngine
         psize+=sizeof(totalCRC);
         psize+=sizeof(dataLength);
         psize+=sizeof(totalLength);
+        psize+=sizeof(delivery);
+        psize+=sizeof(channelSeq);
         return psize;
     }
 
@@ -143,20 +145,22 @@ namespace CGameEngine
         totalCRC = readUInt32();
         dataLength = readUInt16();
         totalLength = readUInt32();
-        safeDeleteArray(data);
-        data = new unsigned char[dataLength];
+        delivery = readUInt8();
+        channelSeq = readUInt32();
+        poolRelease(data);
+        data = poolBuffer(dataLength);
         readUCharArr(data, dataLength);
 
         pSize = getSize();
-        safeDeleteArray(buffer);
+        poolRelease(buffer);
     }
 
     void Packet::serializeOut()
     {
-        safeDeleteArray(buffer);
+        poolRelease(buffer);
         writePos = 0; // reset
         pSize = getSize();
-        buffer = new unsigned char[pSize];
+        buffer = poolBuffer(pSize);
         memset(buffer, 0, pSize);
 
         writeUCharArr(identifier, IDENT_SIZE);
@@ -171,11 +175,31 @@ namespace CGameEngine
         writeUInt32(totalCRC);
         writeUInt16(dataLength);
         writeUInt32(totalLength);
+        writeUInt8(delivery);
+        writeUInt32(channelSeq);
         writeUCharArr(data, dataLength);
 
         trimBuffer();
     }
 
+    void Packet::writeHeader(unsigned char* out, const unsigned char* ident, const uint8_t* swver, uint16_t opcode, const uint64_t& timeStamp, uint32_t seqid, uint32_t pktnum,
+            uint32_t pkttotal, uint32_t wholeCRC, uint16_t datalength, uint32_t totallength, uint8_t deliverymode, uint32_t channelseq)
+    {
+        unsigned char* pos = out;
+        memcpy(pos, ident, IDENT_SIZE); pos += IDENT_SIZE;
+        memcpy(pos, swver, 3); pos += 3;
+        memcpy(pos, &opcode, sizeof(opcode)); pos += sizeof(opcode);
+        memcpy(pos, &timeStamp, sizeof(timeStamp)); pos += sizeof(timeStamp);
+        memcpy(pos, &seqid, sizeof(seqid)); pos += sizeof(seqid);
+        memcpy(pos, &pktnum, sizeof(pktnum)); pos += sizeof(pktnum);
+        memcpy(pos, &pkttotal, sizeof(pkttotal)); pos += sizeof(pkttotal);
+        memcpy(pos, &wholeCRC, sizeof(wholeCRC)); pos += sizeof(wholeCRC);
+        memcpy(pos, &datalength, sizeof(datalength)); pos += sizeof(datalength);
+        memcpy(pos, &totallength, sizeof(totallength)); pos += sizeof(totallength);
+        memcpy(pos, &deliverymode, sizeof(deliverymode)); pos += sizeof(deliverymode);
+        memcpy(pos, &channelseq, sizeof(channelseq));
+    }
+
     void copy(Packet& dst, const Packet& src)
     {
         if(&dst != &src)
@@ -191,6 +215,8 @@ namespace CGameEngine
             dst.totalCRC = src.totalCRC;
             dst.dataLength = src.dataLength;
             dst.totalLength = src.totalLength;
+            dst.delivery = src.delivery;
+            dst.channelSeq = src.channelSeq;
             copy(src.data, src.data+src.dataLength, dst.data);
         }
     }
@@ -204,8 +230,8 @@ namespace CGameEngine
             using std::swap;
 
             // by swapping the members of two objects, the two objects are effectively swapped
-            safeDeleteArray(dst.identifier);
-            safeDeleteArray(dst.data);
+            poolRelease(dst.identifier);
+            poolRelease(dst.data);
             swap(dst.identifier, src.identifier);
             swap(dst.op_code, src.op_code);
             swap(dst.timestamp, src.timestamp);
@@ -215,6 +241,8 @@ namespace CGameEngine
             swap(dst.totalCRC, src.totalCRC);
             swap(dst.dataLength, src.dataLength);
             swap(dst.totalLength, src.totalLength);
+            swap(dst.delivery, src.delivery);
+            swap(dst.channelSeq, src.channelSeq);
             swap(dst.data, src.data);
         }
     }
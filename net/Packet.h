@@ -2,15 +2,23 @@
 #define PACKET_H_INCLUDED
 
 #define PACKET_MAX_SIZE 1000
-#define PACKET_HEADER_SIZE 39
-#define PACKET_MIN_RCV_SIZE 40 /// \TODO: is this actually correct or should it be header size +1)?
+#define PACKET_HEADER_SIZE 44
+#define PACKET_MIN_RCV_SIZE 45 /// \TODO: is this actually correct or should it be header size +1)?
 #define IDENT_SIZE 4
 #define PACKET_DATA_SIZE (PACKET_MAX_SIZE - PACKET_HEADER_SIZE)
+#define NET_MAX_MESSAGE (1024 * 1024) // largest message send() takes, a first fragment announcing more is discarded
 
 #include "common/types.h"
 #include "net/RawPacket.h"
 #include <string.h>
 
+/// how a message is delivered, picked per Network::send(), every mode numbers its messages separately per connection
+///     ReliableUnordered   - stored, repaired by NACK/SACK and resent until acknowledged, delivered as it completes
+///     ReliableOrdered     - as above, held back until every earlier message of the mode was delivered
+///     Unreliable          - nothing stored, acknowledged or requested again, incomplete messages just expire
+///     UnreliableSequenced - as Unreliable, and anything older than the newest delivered message is dropped
+namespace DeliveryMode { enum FORMS { ReliableUnordered, ReliableOrdered, Unreliable, UnreliableSequenced, END }; }
+
 /*
     References:
         https://en.wikipedia.org/wiki/ANSI_escape_code
@@ -33,13 +41,15 @@ namespace CGameEngine
         uint32_t totalCRC = 0; // holds crc32 value of whole of data
         uint16_t dataLength = 0; // holds the length of the data buffer
         uint32_t totalLength = 0; // total length of data across packets
+        uint8_t delivery = 0; // DeliveryMode
+        uint32_t channelSeq = 0; // message number within the delivery mode, per connection
         unsigned char* data = nullptr; // actual data
 
         Packet(uint16_t pSize = PACKET_DATA_SIZE); // "default" ctor
         Packet(unsigned char* d, uint32_t len, const uint64_t& arrival); // ctor from raw data
         Packet(RawPacket& rp); // ctor from raw packet
         Packet(std::string& ident, SoftwareVersion* swv, uint16_t opcode, const uint64_t& timeStamp, uint32_t seqid, uint32_t pktnum, uint32_t pkttotal,
-            uint32_t wholeCRC, uint16_t datalength, uint32_t totallength, unsigned char* d); // ctor likely from Network::send()
+            uint32_t wholeCRC, uint16_t datalength, uint32_t totallength, unsigned char* d, uint8_t deliverymode = DeliveryMode::Unreliable, uint32_t channelseq = 0); // ctor likely from Network::send(), builtins are never stored so default to unreliable
         Packet(const Packet& p) : Packet(p.dataLength) { copy(*this, p); } // copy ctor
         Packet(Packet&& p) noexcept : Packet(p.dataLength)  { swap(*this, p); } // move ctor
         Packet& operator=(const Packet& p) { copy(*this, p); return *this; } // copy assignment
@@ -52,6 +62,8 @@ namespace CGameEngine
         const bool matchesVersion(SoftwareVersion* swv);
         void serializeIn();
         void serializeOut();
+        static void writeHeader(unsigned char* out, const unsigned char* ident, const uint8_t* swver, uint16_t opcode, const uint64_t& timeStamp, uint32_t seqid, uint32_t pktnum,
+            uint32_t pkttotal, uint32_t wholeCRC, uint16_t datalength, uint32_t totallength, uint8_t deliverymode, uint32_t channelseq); // PACKET_HEADER_SIZE bytes, as serializeOut() lays them out
 
         friend void copy(Packet& dst, const Packet& src);
         friend void swap(Packet& dst, Packet& src);
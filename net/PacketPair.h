@@ -3,22 +3,24 @@
 
 #include "common/types.h"
 #include <sys/socket.h> // sockaddr_storage
-#include "net/Packet.h"
+#include "net/PacketView.h"
 
 
 namespace CGameEngine
 {
+    /// received datagram (pool) buffer, its decoded header and sender. Copies are shallow, destroy() releases the buffer
     struct PacketPair
     {
-            PacketPair(Packet** p, struct sockaddr_storage s) : sas()
+            PacketPair(unsigned char** buf, uint32_t len, const uint64_t& arrival, struct sockaddr_storage& s) : sas()
             {
                 // dead end
-                if(*p == nullptr) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "PacketPair::PacketPair()", "No packet passed!"); return; }
+                if(!buf || *buf == nullptr) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "PacketPair::PacketPair()", "No buffer passed!"); return; }
 
                 // take ownership
-                pkt = (*p); *p = nullptr;
+                buffer = (*buf); *buf = nullptr;
+                length = len;
+                view.decode(buffer, length, arrival);
                 memcpy(&sas, &s, sizeof(struct sockaddr_storage));
-                if(!pkt) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "PacketPair::PacketPair()", "We were created without a packet!"); }
             }
             PacketPair() {} // default ctor
             ~PacketPair() noexcept {}
@@ -27,7 +29,8 @@ namespace CGameEngine
             PacketPair& operator=(const PacketPair& p) { copy(*this, p); return *this; } // copy assignment
             PacketPair& operator=(PacketPair&& p) noexcept { swap(*this, p); return *this; } // move assignment
 
-            void destroy() noexcept { safeDelete(pkt); }
+            void destroy() noexcept { poolRelease(buffer); view = PacketView(); }
+            void release() noexcept { buffer = nullptr; } // ownership handed elsewhere, view stays readable
 
             friend void copy(PacketPair& dst, const PacketPair& src) // nothrow
             {
@@ -35,7 +38,9 @@ namespace CGameEngine
                 {
                     // enable ADL (not necessary in our case, but good practice)
                     using std::copy;
-                    dst.pkt = src.pkt;
+                    dst.buffer = src.buffer;
+                    dst.length = src.length;
+                    dst.view = src.view;
                     memcpy(&dst.sas, &src.sas, sizeof(struct sockaddr_storage));
                 }
             }
@@ -45,14 +50,18 @@ namespace CGameEngine
                 {
                     // enable ADL (not necessary in our case, but good practice)
                     using std::swap;
-                    swap(dst.pkt, src.pkt);
+                    swap(dst.buffer, src.buffer);
+                    swap(dst.length, src.length);
+                    swap(dst.view, src.view);
                     swap(dst.sas, src.sas);
-                    src.pkt = nullptr;
+                    src.buffer = nullptr;
                 }
             }
 
             // resources
-            Packet* pkt = nullptr;
+            unsigned char* buffer = nullptr; // owned receive buffer, view points into it
+            uint32_t length = 0;
+            PacketView view;
             struct sockaddr_storage sas;
     };
 }
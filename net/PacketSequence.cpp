@@ -12,10 +12,11 @@ namespace CGameEngine
         m_parentConn = parentConn;
         m_originTimestamp = arrivalTimestamp;
 
-        int minLatency = (m_parentConn->m_latency >= 20) ? m_parentConn->m_latency : 20;
+        int oneWay = (int)(m_parentConn->m_srttUS.load(std::memory_order_relaxed) / 2000); // half the smoothed RTT, in MS
+        int minLatency = (oneWay >= 20) ? oneWay : 20;
         uint64_t timeToCompletion = minLatency * m_numberPackets;
-        m_retryThreshold = m_originTimestamp + (timeToCompletion * 0.2f);
-        m_hardExpiration = m_originTimestamp + (timeToCompletion * 1.2f);
+        m_retryThreshold = m_originTimestamp + (timeToCompletion / 5); // 20%, integer math, a float cannot hold an epoch in MS
+        m_hardExpiration = m_originTimestamp + (timeToCompletion * 6 / 5); // 120%
        Logger::getInstance().Log(Logs::INFO, Logs::Network,
                 "PacketSequence::PacketSequence()", "seqID [{}], numPackets [{}], origin [{}], ttC [{}], retryThreshold [{}], hardExpiration [{}]",
                 m_seqID, m_numberPackets, m_originTimestamp, timeToCompletion, m_retryThreshold, m_hardExpiration);
@@ -23,8 +24,8 @@ namespace CGameEngine
 
     PacketSequence::~PacketSequence()
     {
-        for(int i = 0; i < m_packets.size(); i++) { safeDelete(m_packets[i]); }
-        m_packets.clear();
+        releaseWindow();
+        poolRelease(m_data);
         m_missing.clear();
         m_parentConn = nullptr;
     }
@@ -35,104 +36,169 @@ namespace CGameEngine
         {
             dst.m_seqID = src.m_seqID;
             dst.m_numberPackets = src.m_numberPackets;
+            dst.m_originTimestamp = src.m_originTimestamp;
             dst.m_hardExpiration = src.m_hardExpiration;
             dst.m_retryThreshold = src.m_retryThreshold;
-            dst.m_packets.setVector(src.m_packets);
+            dst.m_lastArrivalUS = src.m_lastArrivalUS;
+            dst.m_timer = src.m_timer;
+            dst.m_totalLength = src.m_totalLength;
+            dst.m_sentTimestamp = src.m_sentTimestamp;
+            dst.m_totalCRC = src.m_totalCRC;
+            dst.m_opCode = src.m_opCode;
+            dst.m_delivery = src.m_delivery;
+            dst.m_channelSeq = src.m_channelSeq;
+            dst.m_received = src.m_received;
+            dst.m_sackRequested = src.m_sackRequested;
+            dst.m_receivedCount = src.m_receivedCount;
+            dst.m_crc = src.m_crc;
+            dst.m_crcFragments = src.m_crcFragments;
+            dst.m_sackCount = src.m_sackCount;
+            dst.m_isReliable = src.m_isReliable;
             dst.m_parentConn = src.m_parentConn;
+
+            // the buffer (and what it holds of the receive window) is the one thing that can not be shared
+            dst.releaseWindow();
+            poolRelease(dst.m_data);
+            if(src.m_data) { dst.m_data = poolBuffer(src.m_totalLength); memcpy(dst.m_data, src.m_data, src.m_totalLength); }
+        }
+    }
+
+    void swap(PacketSequence& dst, PacketSequence& src)
+    {
+        if(&dst != &src)
+        {
+            using std::swap;
+            swap(dst.m_hasCustomTimeout, src.m_hasCustomTimeout);
+            swap(dst.m_isReliable, src.m_isReliable);
+            swap(dst.m_numberPackets, src.m_numberPackets);
+            swap(dst.m_seqID, src.m_seqID);
+            swap(dst.m_originTimestamp, src.m_originTimestamp);
+            swap(dst.m_lastArrivalUS, src.m_lastArrivalUS);
+            swap(dst.m_hardExpiration, src.m_hardExpiration);
+            swap(dst.m_retryThreshold, src.m_retryThreshold);
+            swap(dst.m_retryTimeout, src.m_retryTimeout);
+            swap(dst.m_timer, src.m_timer);
+            swap(dst.m_data, src.m_data);
+            swap(dst.m_window, src.m_window);
+            swap(dst.m_totalLength, src.m_totalLength);
+            swap(dst.m_sentTimestamp, src.m_sentTimestamp);
+            swap(dst.m_totalCRC, src.m_totalCRC);
+            swap(dst.m_opCode, src.m_opCode);
+            swap(dst.m_delivery, src.m_delivery);
+            swap(dst.m_channelSeq, src.m_channelSeq);
+            swap(dst.m_received, src.m_received);
+            swap(dst.m_sackRequested, src.m_sackRequested);
+            swap(dst.m_receivedCount, src.m_receivedCount);
+            swap(dst.m_crc, src.m_crc);
+            swap(dst.m_crcFragments, src.m_crcFragments);
+            swap(dst.m_sackCount, src.m_sackCount);
+            swap(dst.m_parentConn, src.m_parentConn);
+            swap(dst.m_missing, src.m_missing);
         }
     }
 
     bool PacketSequence::update(const uint64_t& time)
     {
-        if(m_hardExpiration < time && m_hardExpiration != -1 && !m_parentConn->m_isLagging)
+        if(!isComplete() && m_hardExpiration < time && m_hardExpiration != -1 && !m_parentConn->m_isLagging) // a late last fragment still completes it
         {
 			Logger::getInstance().Log(Logs::DEBUG, "PacketSequence::update()",
                     "seqID [{}] is closing. hardExpiration [{}] vs time [{}], numReceived [{}] vs \
-                    total [{}], is parentConn lagging [{}]", m_seqID, m_hardExpiration, time, m_packets.size(), m_numberPackets);
+                    total [{}], is parentConn lagging [{}]", m_seqID, m_hardExpiration, time, m_receivedCount, m_numberPackets);
+            if(m_parentConn)
+            {
+                m_parentConn->count(NetCounter::SequencesExpired);
+                if(m_parentConn->m_network) { m_parentConn->m_network->getNetStats().trace(NetTrace::SequenceExpired, m_opCode, m_seqID, m_receivedCount, m_totalLength); }
+            }
             return true;
         }
-        else if(m_packets.size() <= 1 || !m_parentConn) { return false; }
+        else if(!m_parentConn) { return false; } // a lone fragment is asked about too, it may be the sender's probe for a sequence that expired here
 
         // pull down current timeout
         m_retryTimeout = m_parentConn->m_retryTimeout;
 
-        // this sequence has all of it's packets
-        if(m_packets.size() == m_numberPackets)
+        // this sequence has all of it's packets, already in place
+        if(isComplete())
         {
-           Logger::getInstance().Log(Logs::DEBUG, "PacketSequence::update()", "Assembling entire sequence [seqID {}]", m_seqID);
-            Packet* p = m_packets[0];
-            int pos = 0;
-            int length = p->totalLength;
-
-            std::sort(m_packets.begin(), m_packets.end(), pktCompare);
-
-            unsigned char* data = new unsigned char[length];
-            memset(data, 0, length);
-
-            // assemble data
-            for(unsigned int d = 0; d < m_packets.size(); d++)
-            {
-                //std::cout<<"\033[1mPacketSequence::update\033[0m - Assembling pktNum ["<<(m_packets[d]->pktNum + 1)<<"] of ["<<m_packets[d]->pktTotal<<"] \tPos ["<<pos<<"] of ["<<length<<"] (size "<<m_packets[d]->dataLength<<") (pos should be "<<PACKET_DATA_SIZE*d<<")\n";
-                memcpy(data+pos, m_packets[d]->data, m_packets[d]->dataLength);
-                pos += m_packets[d]->dataLength;
-            }
-           Logger::getInstance().Log(Logs::DEBUG, "PacketSequence::update()", "Assembled! Pos [{}] of [{}]", pos, length);
-
-            // crc check it
-            uint32_t crc = CRC32::create(data, length);
+            // the CRC has been following the contiguous prefix, by now that is everything
+            uint32_t crc = CRC32::cleanup(m_crc);
+           Logger::getInstance().Log(Logs::DEBUG, "PacketSequence::update()", "Assembled seqID [{}], [{}] bytes", m_seqID, m_totalLength);
 
             // if crc check passes
-            if(crc == p->totalCRC)
+            Network* net = m_parentConn->m_network;
+            if(crc == m_totalCRC)
             {
+                m_parentConn->count(NetCounter::SequencesCompleted);
+                if(net)
+                {
+                    net->getNetStats().record(NetHistogram::SequenceAssemblyMS, (time > m_originTimestamp) ? time - m_originTimestamp : 0);
+                    net->getNetStats().trace(NetTrace::SequenceCompleted, m_opCode, m_seqID, m_numberPackets, m_totalLength);
+                }
+                releaseWindow(); // the Datagram is charged on its own when handed over
                 if(m_parentConn->getConnectionType() == ConnectionType::NET)
                 {
-                    Datagram* d = new Datagram(p->op_code, m_parentConn->getUniqueID(), data, p->dataLength, m_originTimestamp, (NetConnection*)m_parentConn);
-                    if(d) { m_parentConn->m_buffer->push(d); }
+                    Datagram* d = new Datagram(m_opCode, m_parentConn->getUniqueID(), &m_data, m_totalLength, m_sentTimestamp, (NetConnection*)m_parentConn); // takes the assembled buffer
+                    if(d) { m_parentConn->deliver(d, m_delivery, m_channelSeq, m_lastArrivalUS); }
                 }
             }
             else
             {
-                std::string order = " (order:";
-                for(unsigned int i = 0; i < m_packets.size(); i++) { order+= " " + std::to_string(m_packets[i]->pktNum); }
-                order+= ")";
-               Logger::getInstance().Log(Logs::WARN, Logs::Network, "PacketSequence::update()", "CRC does not match! Damaged Packet Sequence ({})! Expected [{}], received [{}]! {}", m_seqID, crc, p->totalCRC, order);
+                m_parentConn->count(NetCounter::SequencesFailed);
+                if(net) { net->getNetStats().trace(NetTrace::SequenceFailed, m_opCode, m_seqID, m_numberPackets, m_totalLength); }
+               Logger::getInstance().Log(Logs::WARN, Logs::Network, "PacketSequence::update()", "CRC does not match! Damaged Packet Sequence ({})! Expected [{}], received [{}]!", m_seqID, crc, m_totalCRC);
             }
 
-            // cleanup
-            safeDeleteArray(data);
+            // cleanup (if the Datagram did not take it)
+            poolRelease(m_data);
 
             // destroy the packet sequence
-           Logger::getInstance().Log(Logs::INFO, Logs::Network, "PacketSequence::update()", "seqID [{}] is closing. m_numberPackets = m_packets.size() [{} = {}]", m_seqID, m_numberPackets, m_packets.size());
-            if(m_parentConn->m_connType == ConnectionType::NET) { static_cast<NetConnection*>(m_parentConn)->sendACK(m_seqID); }
+           Logger::getInstance().Log(Logs::INFO, Logs::Network, "PacketSequence::update()", "seqID [{}] is closing. m_numberPackets = m_receivedCount [{} = {}]", m_seqID, m_numberPackets, m_receivedCount);
+            if(m_isReliable && m_parentConn->m_connType == ConnectionType::NET) { static_cast<NetConnection*>(m_parentConn)->sendACK(m_seqID); } // nothing is stored for unreliable sends
             return true;
         }
-        else if(m_retryThreshold < time)
+        else if(!m_isReliable) { return false; } // wait for the rest or the hard expiration, never ask
+        else if(m_retryThreshold < time && m_parentConn->m_network && m_parentConn->m_network->isSelectiveAck())
         {
-            std::vector<int> missing;
-
-            // REF: https://stackoverflow.com/questions/379383/finding-gaps-in-sequence-of-numbers
-            std::sort(m_packets.begin(), m_packets.end(), pktCompare);
-
-            // iterator through to find missing numbers
-            int offset = 0;
-            for(unsigned int i = 0; i < m_packets.size(); i++)
+            // one bitmap of what arrived, the sender resends every hole at once
+            // holes already asked for within the last RTO are still on their way, they are left out (like m_missing on the retry request path)
+            int increment = m_parentConn->m_retryTimeout; // one RTO for the holes to come back
+            SelectiveAck_Struct sack;
+            if(fillSelectiveAck(sack, time, increment))
             {
-                Packet* p = m_packets[i];
-                if(p->pktNum != i+offset)
+                m_hardExpiration = std::max(m_hardExpiration, time + 2 * increment); // room to ask once more
+                bool again = false;
+                for(uint32_t i = 0; i < sack.count; i++)
                 {
-                   Logger::getInstance().Log(Logs::DEBUG, "PacketSequence::update()", "Seeing [{}], expected [{}] (retry [{}] vs time [{}], offset [{}])", p->pktNum, (i+offset), m_retryThreshold, time, offset);
-                    missing.push_back(i);
-                    offset++;
+                    if(sack.has(i)) { continue; }
+                    if(m_sackRequested[sack.base + i] != 0) { again = true; }
+                    m_sackRequested[sack.base + i] = time;
                 }
+                m_sackCount++;
+               Logger::getInstance().Log(Logs::DEBUG, "PacketSequence::update()", "Sending SACK #{} for seqID [{}], base [{}], count [{}]", m_sackCount, m_seqID, sack.base, sack.count);
+                m_parentConn->m_network->sendSelectiveAck(&m_parentConn->m_source, m_seqID, sack);
+                m_parentConn->count(NetCounter::SelectiveAcksSent);
+
+                // a hole asked for twice, same as a second retry request pass
+                if(again) { m_parentConn->markLagging(time); }
+            }
+            m_retryThreshold = time + increment; // by then what was asked for is due again
+        }
+        else if(m_retryThreshold < time) // one retry request per missing fragment
+        {
+            // holes are read straight off the bitmap, everything below the CRC prefix has arrived
+            std::vector<int> missing;
+            for(uint32_t i = m_crcFragments; i < m_received.size(); i++)
+            {
+                if(!m_received[i]) { missing.push_back(i); }
             }
 
             // actually processing new retry requests
             if(missing.size() > 0)
             {
-                // increment retry threshold
-                int increment = (m_parentConn->m_latency * 2.2f);
+                // increment retry threshold by one RTO
+                int increment = m_parentConn->m_retryTimeout;
                Logger::getInstance().Log(Logs::DEBUG, "PacketSequence::update()", "Increasing threshold by [{}] to [{}] (was {}).", increment, (m_retryThreshold+increment), m_retryThreshold);
                 m_retryThreshold += increment;
+                m_hardExpiration = std::max(m_hardExpiration, m_retryThreshold + increment); // and room to ask once more
 
                 // request retry if new
                 for(unsigned int i = 0; i < missing.size(); i++)
@@ -157,50 +223,162 @@ namespace CGameEngine
         return false;
     }
 
-    void PacketSequence::addPacket(Packet** p, const uint64_t& arrivalTimestamp)
+    bool PacketSequence::addPacket(const PacketPair& pp, const uint64_t& arrivalTimestamp)
     {
-        // add to vector
-        m_packets.push_back(*p);
+        // a resent fragment may cross the original, counting it twice would 'complete' a sequence with holes
+        const PacketView& p = pp.view;
+        if(!accept(p)) { return false; }
+        if(m_received[p.pktNum]) { return false; }
+        m_received[p.pktNum] = true;
+        m_receivedCount++;
+        m_isReliable = p.isReliable();
+
+        // straight into place, the receive buffer is the caller's to release
+        if(p.dataLength > 0) { memcpy(m_data + (size_t)p.pktNum * PACKET_DATA_SIZE, p.data, p.dataLength); }
+        if(p.pktNum == m_crcFragments) { advanceCRC(); } // while it is still in cache
+        if(p.arrivalUS > m_lastArrivalUS) { m_lastArrivalUS = p.arrivalUS; }
 
         // if "earlier" packet arrives, update sequence stats
         if(arrivalTimestamp < m_originTimestamp)
         {
-            uint64_t diff = arrivalTimestamp - m_originTimestamp;
+            uint64_t diff = m_originTimestamp - arrivalTimestamp;
             m_originTimestamp = arrivalTimestamp;
             m_retryThreshold -= diff;
             m_hardExpiration -= diff;
         }
+        return true;
+    }
 
-        // take ownership
-        *p = nullptr;
+    bool PacketSequence::fillSelectiveAck(SelectiveAck_Struct& sack, const uint64_t& time, uint32_t timeout) const
+    {
+        // a hole is due if it was never asked for, or its resend had a full RTO to show up
+        uint32_t total = std::min((uint32_t)m_received.size(), (uint32_t)m_sackRequested.size());
+        auto due = [&](uint32_t i) { return !m_received[i] && (m_sackRequested[i] == 0 || m_sackRequested[i] + timeout <= time); };
+
+        // everything below base has arrived or is on its way
+        uint32_t base = 0;
+        while(base < total && !due(base)) { base++; }
+        if(base >= total) { return false; }
+
+        // cover as much as fits in one packet, trimmed to the last due hole
+        uint32_t end = std::min(total, base + SACK_MAX_FRAGMENTS);
+        while(end > base && !due(end - 1)) { end--; }
+
+        // the sender resends every clear bit, so holes still in flight are reported as arrived
+        sack.base = base;
+        sack.count = end - base;
+        memset(sack.bitmap, 0, sizeof(sack.bitmap));
+        for(uint32_t i = base; i < end; i++)
+        {
+            if(!due(i)) { sack.set(i - base); }
+        }
+        return true;
     }
 
 
-    /// StoredSequence public functions ///////////////////////////////////////
+    /// PacketSequence private functions ///////////////////////////////////////
 
-    StoredSequence::StoredSequence(uint32_t seq_ID, int numPackets, const uint64_t& timestamp, std::queue<Packet*> pktQ) : m_seqID(seq_ID), m_numberPackets(numPackets), m_originTimestamp(timestamp)
+    bool PacketSequence::accept(const PacketView& p)
     {
-        m_expiration = m_originTimestamp + 3000; // +3 sec
-        //m_packets.reserve(m_numberPackets);
+        if(m_numberPackets <= 0 || p.pktNum >= (uint32_t)m_numberPackets) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "PacketSequence::accept()", "pktNum [{}] outside of seqID [{}] ([{}] packets), discarding.", p.pktNum, m_seqID, m_numberPackets); return false; }
 
-       Logger::getInstance().Log(Logs::INFO, Logs::Network, "StoredSequence::StoredSequence()", "Creating for [{}], [{}] packets, timestamp [{}], expiration [{}]", m_seqID, m_numberPackets, m_originTimestamp, m_expiration);
+        // first fragment in, whichever it is
+        if(!m_data)
+        {
+            // every fragment but the last is full, older senders may add an empty one on an exact multiple
+            uint64_t capacity = (uint64_t)m_numberPackets * PACKET_DATA_SIZE;
+            if(p.totalLength == 0 || p.totalLength > NET_MAX_MESSAGE || p.totalLength > capacity || p.totalLength + PACKET_DATA_SIZE < capacity)
+            {
+               Logger::getInstance().Log(Logs::WARN, Logs::Network, "PacketSequence::accept()", "totalLength [{}] does not fit [{}] packets (max [{}] bytes) for seqID [{}], discarding.", p.totalLength, m_numberPackets, NET_MAX_MESSAGE, m_seqID);
+                return false;
+            }
 
-        // copy from queue to vec
-        while(pktQ.size() > 0)
+            // charged before it is allocated, a peer can not make us hold more than its window
+            std::shared_ptr<ReceiveWindow> window = (m_parentConn) ? m_parentConn->m_window : nullptr;
+            if(window && !window->reserve(p.totalLength))
+            {
+                Logger::getInstance().Log(Logs::DEBUG, "PacketSequence::accept()", "No receive window left for [{}] bytes of seqID [{}], discarding pkt# [{}].", p.totalLength, m_seqID, p.pktNum);
+                return false;
+            }
+            m_window = window;
+            m_totalLength = p.totalLength;
+            m_sentTimestamp = p.timestamp;
+            m_totalCRC = p.totalCRC;
+            m_opCode = p.op_code;
+            m_delivery = p.delivery;
+            m_channelSeq = p.channelSeq;
+            m_data = poolBuffer(m_totalLength);
+            m_received.assign(m_numberPackets, false);
+            m_sackRequested.assign(m_numberPackets, 0);
+        }
+        else if(p.totalLength != m_totalLength || p.totalCRC != m_totalCRC) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "PacketSequence::accept()", "pktNum [{}] disagrees with seqID [{}] on its length or CRC, discarding.", p.pktNum, m_seqID); return false; }
+
+        // each fragment has exactly one place
+        uint64_t offset = (uint64_t)p.pktNum * PACKET_DATA_SIZE;
+        if(offset + p.dataLength > m_totalLength) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "PacketSequence::accept()", "pktNum [{}] overruns totalLength [{}], discarding.", p.pktNum, m_totalLength); return false; }
+        return true;
+    }
+
+    void PacketSequence::releaseWindow()
+    {
+        if(m_window) { m_window->unreserve(m_totalLength); }
+        m_window = nullptr;
+    }
+
+    void PacketSequence::advanceCRC()
+    {
+        while(m_crcFragments < m_received.size() && m_received[m_crcFragments])
         {
-            m_packets.push_back(pktQ.front());
-            pktQ.pop();
+            uint32_t offset = m_crcFragments * PACKET_DATA_SIZE;
+            uint32_t length = std::min((uint32_t)PACKET_DATA_SIZE, m_totalLength - std::min(offset, m_totalLength));
+            m_crc = CRC32::parse(m_data + offset, length, m_crc);
+            m_crcFragments++;
         }
     }
 
+
+    /// StoredSequence public functions ///////////////////////////////////////
+
+    StoredSequence::StoredSequence(uint32_t seq_ID, int numPackets, const uint64_t& timestamp, const sockaddr_storage* destination /*= nullptr*/) : m_seqID(seq_ID), m_numberPackets(numPackets), m_originTimestamp(timestamp)
+    {
+        copyAddress(&m_destination, destination);
+        m_expiration = m_originTimestamp + NET_STORED_SEQUENCE_MS; // pushed back by Network::expireStored() until it actually leaves
+        m_fragments.reserve(m_numberPackets);
+
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "StoredSequence::StoredSequence()", "Creating for [{}], [{}] packets, timestamp [{}], expiration [{}]", m_seqID, m_numberPackets, m_originTimestamp, m_expiration);
+    }
+
     StoredSequence::~StoredSequence()
     {
-       Logger::getInstance().Log(Logs::INFO, Logs::Network, "StoredSequence::~StoredSequence()", "SeqID [{}] is being destroyed! ({} packets)", m_seqID, m_packets.size());
-        while(m_packets.size() > 0)
+       Logger::getInstance().Log(Logs::INFO, Logs::Network, "StoredSequence::~StoredSequence()", "SeqID [{}] is being destroyed! ({} packets)", m_seqID, m_fragments.size());
+        for(size_t i = 0; i < m_fragments.size(); i++) { SendBuffer::release(m_fragments[i].buffer); } // queued copies keep their own reference
+        m_fragments.clear();
+    }
+
+    void StoredSequence::addFragment(unsigned char* buffer, uint32_t size)
+    {
+        StoredFragment f;
+        f.buffer = buffer;
+        f.size = size;
+        m_fragments.push_back(f);
+    }
+
+    /// latest time sendLoop() put one of our fragments on the wire, 'now' and 'sentMS' are steady milliseconds
+    bool StoredSequence::lastTransmit(const uint64_t& now, uint64_t& sentMS) const
+    {
+        uint32_t newest = 0; // age in ms of the newest stamp
+        bool stamped = false;
+        for(size_t i = 0; i < m_fragments.size(); i++)
         {
-            safeDelete(m_packets.back());
-            m_packets.pop_back();
+            if(SendBuffer::isShared(m_fragments[i].buffer)) { return false; }
+            uint32_t s = SendBuffer::sentStamp(m_fragments[i].buffer);
+            if(s == 0) { continue; } // coalesced, it went out inside another buffer
+            uint32_t age = (uint32_t)now - s; // stamps wrap every ~49 days
+            if(!stamped || age < newest) { newest = age; stamped = true; }
         }
+
+        sentMS = (stamped) ? now - newest : m_originTimestamp;
+        return true;
     }
 
     void copy(StoredSequence& dst, const StoredSequence& src)
@@ -211,7 +389,12 @@ namespace CGameEngine
             dst.m_numberPackets = src.m_numberPackets;
             dst.m_originTimestamp = src.m_originTimestamp;
             dst.m_expiration = src.m_expiration;
-            dst.m_packets.setVector(src.m_packets);
+            dst.m_destination = src.m_destination;
+            dst.m_acked.store(src.m_acked.load());
+            dst.m_resendMS = src.m_resendMS;
+            for(size_t i = 0; i < dst.m_fragments.size(); i++) { SendBuffer::release(dst.m_fragments[i].buffer); }
+            dst.m_fragments = src.m_fragments;
+            for(size_t i = 0; i < dst.m_fragments.size(); i++) { SendBuffer::retain(dst.m_fragments[i].buffer); }
         }
     }
 
@@ -223,7 +406,10 @@ namespace CGameEngine
             std::swap(dst.m_numberPackets, src.m_numberPackets);
             std::swap(dst.m_originTimestamp, src.m_originTimestamp);
             std::swap(dst.m_expiration, src.m_expiration);
-            std::swap(dst.m_packets, src.m_packets);
+            std::swap(dst.m_destination, src.m_destination);
+            dst.m_acked.store(src.m_acked.exchange(dst.m_acked.load()));
+            std::swap(dst.m_resendMS, src.m_resendMS);
+            std::swap(dst.m_fragments, src.m_fragments);
         }
     }
 }
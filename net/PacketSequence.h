@@ -3,8 +3,16 @@
 
 #include "common/types.h"
 #include "net/Packet.h"
+#include "net/PacketPair.h"
+#include "net/NetTimer.h"
+#include "net/SendBuffer.h"
+#include "net/ReceiveWindow.h"
+#include "net/Builtin_Structs.h"
 #include "common/SafeVector.h"
+#include <atomic>
 #include <queue>
+#include <vector>
+#include <algorithm> // min
 
 namespace CGameEngine
 {
@@ -12,38 +20,77 @@ namespace CGameEngine
     class Packet;
 
     /// \NOTE: PacketSequence is created with the ARRIVAL timestamp, not origin's timestamp
+    /// \NOTE: Fragments are copied into one buffer as they arrive (pktNum * PACKET_DATA_SIZE), the receive buffers go straight back to the pool
     class PacketSequence
     {
         public:
             PacketSequence(uint32_t seq_ID, int numPackets, const uint64_t& arrivalTimestamp, Connection* parentConn);
             ~PacketSequence();
             friend void copy(PacketSequence& dst, const PacketSequence& src);
+            friend void swap(PacketSequence& dst, PacketSequence& src);
             PacketSequence(const PacketSequence& ps) { copy(*this, ps); }
+            PacketSequence(PacketSequence&& ps) noexcept { swap(*this, ps); }
             PacketSequence& operator=(const PacketSequence& ps) { copy(*this, ps); return *this; }
+            PacketSequence& operator=(PacketSequence&& ps) noexcept { swap(*this, ps); return *this; }
             bool update(const uint64_t& time);
-            void addPacket(Packet** p, const uint64_t& arrivalTimestamp);
+            bool addPacket(const PacketPair& pp, const uint64_t& arrivalTimestamp); // false for a duplicate or malformed fragment, the caller keeps pp
+            bool fillSelectiveAck(SelectiveAck_Struct& sack, const uint64_t& time, uint32_t timeout) const; // false when no hole is due, a hole asked for under 'timeout' ago is still on its way
+            const uint32_t& getSeqID() const { return m_seqID; }
+            const bool isReliable() const { return m_isReliable; }
+            const bool isComplete() const { return (m_numberPackets > 0 && m_receivedCount == (uint32_t)m_numberPackets); }
+            const uint64_t getNextDeadline() const { return std::min(m_retryThreshold, m_hardExpiration); } // when update() next has work to do
+            TimerID& getTimer() { return m_timer; } // SequenceDeadline timer, owned by the parent Connection
 
         private:
+            bool accept(const PacketView& p); // first fragment sizes the buffer, later ones have to agree with it
+            void advanceCRC(); // run the CRC over whatever is now contiguous from m_crcFragments on
+            void releaseWindow(); // give m_data's reservation back to the receive window
+
             bool m_hasCustomTimeout = false;
+            bool m_isReliable = true; // unreliable sequences never ask for retransmissions, they just expire
             int m_numberPackets = 0;
             uint32_t m_seqID = 0;
             uint64_t m_originTimestamp = 0; // time of creation
-            uint32_t m_hardExpiration = 0; // time to forcefully close the packet sequence
-            uint32_t m_retryThreshold = 0; // time to start checking for missed (time val)
+            uint64_t m_lastArrivalUS = 0; // Time::steadyUS() of the newest fragment, for latency accounting
+            uint64_t m_hardExpiration = 0; // time to forcefully close the packet sequence
+            uint64_t m_retryThreshold = 0; // time to start checking for missed (time val)
             uint32_t m_retryTimeout = 0; // time to wait for reply (MS)
-            SafeVector<Packet*> m_packets;
+            TimerID m_timer = 0;
+
+            // reassembly, header fields are taken from the first fragment to arrive
+            unsigned char* m_data = nullptr; // pool buffer of m_totalLength, handed to the Datagram on completion
+            std::shared_ptr<ReceiveWindow> m_window; // holds m_totalLength of it while m_data is ours, not carried by copies
+            uint32_t m_totalLength = 0;
+            uint64_t m_sentTimestamp = 0; // sender's Time::nowMS(), the Datagram's timestamp (m_originTimestamp is our steady clock)
+            uint32_t m_totalCRC = 0;
+            uint16_t m_opCode = 0;
+            uint8_t m_delivery = 0;
+            uint32_t m_channelSeq = 0;
+            std::vector<bool> m_received; // by pktNum, sized to m_numberPackets by the first fragment
+            std::vector<uint64_t> m_sackRequested; // by pktNum, when a SACK last asked for it (0 never)
+            uint32_t m_receivedCount = 0;
+            uint32_t m_crc = 0xFFFFFFFF; // raw CRC register over fragments [0, m_crcFragments)
+            uint32_t m_crcFragments = 0;
+
             SafeVector<int> m_missing;
+            uint32_t m_sackCount = 0; // SACKs sent for this sequence
             Connection* m_parentConn = nullptr;
-            static bool pktCompare(Packet* a, Packet* b) { return (a->pktNum < b->pktNum); }
 
             // min packets per second
             const int MIN_PPS = 40;
     };
 
-    class StoredSequence
+    /// one serialized fragment of a sent message, a SendBuffer reference
+    struct StoredFragment
+    {
+        unsigned char* buffer = nullptr;
+        uint32_t size = 0;
+    };
+
+    class StoredSequence : public PoolAllocated
     {
         public:
-            StoredSequence(uint32_t seq_ID, int numPackets, const uint64_t& timestamp, std::queue<Packet*> pktQ);
+            StoredSequence(uint32_t seq_ID, int numPackets, const uint64_t& timestamp, const sockaddr_storage* destination = nullptr);
             ~StoredSequence();
             StoredSequence(const StoredSequence& ss) { copy(*this, ss); } // copy ctor
             StoredSequence(StoredSequence&& p) noexcept { swap(*this, p); } // move ctor
@@ -54,15 +101,28 @@ namespace CGameEngine
             friend void swap(StoredSequence& dst, StoredSequence& src);
 
             bool isExpired(uint64_t time) { return (m_expiration <= time); }
+            const uint64_t& getExpiration() const { return m_expiration; }
+            void setExpiration(const uint64_t& val) { m_expiration = val; } // updateLoop() only
+            const uint64_t& getOriginTimestamp() const { return m_originTimestamp; }
             const uint32_t getSeqID() const { return m_seqID; }
-            Packet* getPacketByNumber(unsigned int val) { return (val < m_packets.size()) ? m_packets[val] : nullptr; }
+            const int& getNumberPackets() const { return m_numberPackets; }
+            const sockaddr_storage* getDestination() const { return &m_destination; }
+            const StoredFragment* getFragment(unsigned int val) const { return (val < m_fragments.size()) ? &m_fragments[val] : nullptr; }
+            void addFragment(unsigned char* buffer, uint32_t size); // takes a SendBuffer reference, before the sequence is shared
+            void setAcked() { m_acked.store(true, std::memory_order_relaxed); } // listenLoop(), the peer has the whole message
+            const bool isAcked() const { return m_acked.load(std::memory_order_relaxed); }
+            uint32_t& getResendInterval() { return m_resendMS; } // updateLoop() only
+            bool lastTransmit(const uint64_t& now, uint64_t& sentMS) const; // false while any fragment is still queued or paced
 
         private:
+            std::atomic<bool> m_acked { false };
+            uint32_t m_resendMS = 0; // reliable only, next wait for an OP_Ack before resending
             uint32_t m_seqID = 0;
             int m_numberPackets = 0;
             uint64_t m_originTimestamp = 0;
             uint64_t m_expiration = 0;
-            SafeVector<Packet*> m_packets;
+            sockaddr_storage m_destination; // retransmissions go here, not to a receive buffer's sender
+            std::vector<StoredFragment> m_fragments; // by pktNum, read-only once stored in Network
     };
 }
 
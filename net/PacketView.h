@@ -0,0 +1,99 @@
+#ifndef PACKETVIEW_H_INCLUDED
+#define PACKETVIEW_H_INCLUDED
+
+#include "common/types.h"
+#include "net/Packet.h"
+#include <string.h>
+#include <algorithm> // min
+
+/*
+    PacketView decodes the wire header of a Packet in place, without taking a copy
+    of the receive buffer. identifier and data point INTO that buffer, so a view is
+    only valid for as long as the buffer it was decoded from.
+
+    Wire layout (PACKET_HEADER_SIZE bytes, then data):
+        identifier[4] | swver[3] | op_code 2 | timestamp 8 | seqIdent 4 | pktNum 4 |
+        pktTotal 4 | totalCRC 4 | dataLength 2 | totalLength 4 | delivery 1 | channelSeq 4 |
+        data[dataLength]
+*/
+
+namespace CGameEngine
+{
+    struct PacketView
+    {
+        const unsigned char* identifier = nullptr; // IDENT_SIZE bytes, within buffer
+        uint8_t softwareVersion[3] = { 0, 0, 0 };
+        uint16_t op_code = 0;
+        uint64_t timestamp = 0; // creation time
+        uint32_t seqIdent = 0;
+        uint32_t pktNum = 0;
+        uint32_t pktTotal = 0;
+        uint32_t totalCRC = 0;
+        uint16_t dataLength = 0;
+        uint32_t totalLength = 0;
+        uint8_t delivery = 0; // DeliveryMode
+        uint32_t channelSeq = 0;
+        const unsigned char* data = nullptr; // dataLength bytes, within buffer
+        uint64_t arrivalTime = 0;
+        uint64_t arrivalUS = 0; // Time::steadyUS() when received, for latency accounting
+
+        PacketView() {}
+        PacketView(const unsigned char* buf, uint32_t len, const uint64_t& arrival) { decode(buf, len, arrival); }
+
+        /// returns false if the buffer cannot hold the header and the data it claims
+        bool decode(const unsigned char* buf, uint32_t len, const uint64_t& arrival)
+        {
+            identifier = nullptr;
+            data = nullptr;
+            arrivalTime = arrival;
+            if(!buf || len < PACKET_HEADER_SIZE || len > PACKET_MAX_SIZE) { return false; }
+
+            const unsigned char* pos = buf;
+            identifier = pos; pos += IDENT_SIZE;
+            memcpy(softwareVersion, pos, sizeof(softwareVersion)); pos += sizeof(softwareVersion);
+            memcpy(&op_code, pos, sizeof(op_code)); pos += sizeof(op_code);
+            memcpy(&timestamp, pos, sizeof(timestamp)); pos += sizeof(timestamp);
+            memcpy(&seqIdent, pos, sizeof(seqIdent)); pos += sizeof(seqIdent);
+            memcpy(&pktNum, pos, sizeof(pktNum)); pos += sizeof(pktNum);
+            memcpy(&pktTotal, pos, sizeof(pktTotal)); pos += sizeof(pktTotal);
+            memcpy(&totalCRC, pos, sizeof(totalCRC)); pos += sizeof(totalCRC);
+            memcpy(&dataLength, pos, sizeof(dataLength)); pos += sizeof(dataLength);
+            memcpy(&totalLength, pos, sizeof(totalLength)); pos += sizeof(totalLength);
+            memcpy(&delivery, pos, sizeof(delivery)); pos += sizeof(delivery);
+            memcpy(&channelSeq, pos, sizeof(channelSeq)); pos += sizeof(channelSeq);
+
+            // truncated datagram
+            if(dataLength > len - PACKET_HEADER_SIZE) { identifier = nullptr; return false; }
+            data = pos;
+            return true;
+        }
+
+        const bool isDecoded() const { return (identifier != nullptr); }
+        const bool isReliable() const { return (delivery == DeliveryMode::ReliableUnordered || delivery == DeliveryMode::ReliableOrdered); }
+
+        const bool isDamaged() const
+        {
+            if(!isDecoded() || (pktNum > pktTotal && pktTotal != 0) || dataLength > PACKET_DATA_SIZE || totalLength < dataLength || delivery >= DeliveryMode::END)
+            {
+                Logger::getInstance().Log(Logs::WARN, Logs::Network, "PacketView::isDamaged()", "Packet is damaged. dataLength [{}], totalLength [{}], pktNum [{}], pktTotal [{}]", dataLength, totalLength, pktNum, pktTotal);
+                return true;
+            }
+            return false;
+        }
+
+        const bool matchesVersion(SoftwareVersion* swv) const
+        {
+            return (isDecoded() && swv->sw_major == softwareVersion[0] && swv->sw_minor == softwareVersion[1] && swv->sw_patch == softwareVersion[2]);
+        }
+
+        const bool matchesIdentifier(const std::string& ident) const
+        {
+            // zero padded the way the sender wrote it, a short (or unset) title must not read past the string
+            unsigned char padded[IDENT_SIZE] = { 0 };
+            memcpy(padded, ident.c_str(), std::min(ident.length(), (size_t)IDENT_SIZE));
+            return (isDecoded() && memcmp(identifier, padded, IDENT_SIZE) == 0);
+        }
+    };
+}
+
+#endif // PACKETVIEW_H_INCLUDED
@@ -3,6 +3,7 @@
 
 //#include "cereal/types/common.hpp"
 //#include "cereal/archives/binary.hpp"
+#include "common/MemoryPool.h"
 #include <sstream>
 #include <assert.h>
 #include <string.h>
@@ -19,7 +20,8 @@
 
 namespace CGameEngine
 {
-    class RawPacket
+    /// buffer is MemoryPool owned, release with poolRelease()
+    class RawPacket : public PoolAllocated
     {
         public:
             unsigned char* buffer = nullptr;
@@ -49,7 +51,7 @@ namespace CGameEngine
             void writeUChar(const unsigned char val) { assert(writePos + sizeof(unsigned char) <= pSize); *((unsigned char*)(buffer+writePos)) = val; writePos += sizeof(unsigned char); }
             void writeUCharArr(const unsigned char* ptr, uint32_t len) { assert(writePos + len <= pSize); memcpy(buffer+writePos, ptr, len); writePos += len; }
 
-            RawPacket(uint32_t len) : buffer(new unsigned char[len]), pSize(len) { memset(buffer, 0, pSize); } // initialization ctor
+            RawPacket(uint32_t len) : buffer(poolBuffer(len)), pSize(len) { memset(buffer, 0, pSize); } // initialization ctor
             RawPacket(const RawPacket& p) : RawPacket(p.pSize) { copy(*this, p); } // copy ctor
             RawPacket(RawPacket&& p) noexcept : RawPacket(p.pSize)  { swap(*this, p); } // move ctor
             RawPacket& operator=(const RawPacket& p) { copy(*this, p); return *this; } // copy assignment
@@ -72,7 +74,7 @@ namespace CGameEngine
                 if(&dst != &src)
                 {
                     using std::swap;
-                    if(dst.buffer) { delete[] dst.buffer; dst.buffer = nullptr; }
+                    poolRelease(dst.buffer);
                     swap(dst.buffer, src.buffer);
                     swap(dst.pSize, src.pSize);
                     swap(dst.readPos, src.readPos);
@@ -87,7 +89,7 @@ namespace CGameEngine
                 // build buffer, if possible
                 if(pSize)
                 {
-                    buffer = new unsigned char[pSize];
+                    buffer = poolBuffer(pSize);
                     memset(buffer, 0, pSize);
 
                     // copy passed data
@@ -97,18 +99,18 @@ namespace CGameEngine
 
             virtual ~RawPacket()
             {
-                if(buffer) { delete[] buffer; buffer = nullptr; }
+                poolRelease(buffer);
             }
 
             /// Remove excess whitespace or null characters
             void trimBuffer()
             {
-                unsigned char* tmp = new unsigned char[writePos];
-                memset(tmp, 0, writePos);
+                // only worth a copy if the data fits a smaller pool block
+                if(writePos == pSize) { return; }
+                unsigned char* tmp = poolBuffer(writePos);
                 memcpy(tmp, buffer, writePos);
-                safeDeleteArray(buffer);
                 std::swap(tmp, buffer);
-                safeDeleteArray(tmp);
+                poolRelease(tmp);
                 pSize = writePos;
             }
     };
@@ -0,0 +1,283 @@
+#include "net/Reactor.h"
+
+#if PLATFORM == PLATFORM_LINUX
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/timerfd.h>
+    #include <unistd.h> // read(), write(), close()
+    #include <cerrno>
+#endif
+
+namespace CGameEngine
+{
+    namespace { thread_local const void* runningHandler = nullptr; } // registration whose handler this thread is in
+
+    /// Reactor ///////////////////////////////////////////////////////////////
+
+    std::atomic<Reactor*> Reactor::s_shared { nullptr };
+
+    Reactor::Reactor(uint16_t threads /*= 1*/)
+    {
+        if(threads == 0) { threads = 1; }
+        else if(threads > REACTOR_MAX_THREADS) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Reactor::Reactor()", "Thread count [{}] clamped to [{}].", threads, REACTOR_MAX_THREADS); threads = REACTOR_MAX_THREADS; }
+
+        #if PLATFORM == PLATFORM_LINUX
+            m_epollFD = epoll_create1(EPOLL_CLOEXEC);
+            m_wakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if(m_epollFD == -1 || m_wakeFD == -1) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Reactor::Reactor()", "epoll_create1() / eventfd() failed, errno [{}].", errno); return; }
+
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.u64 = UINT64_MAX;
+            if(epoll_ctl(m_epollFD, EPOLL_CTL_ADD, m_wakeFD, &ev) == -1) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Reactor::Reactor()", "Could not register the wake-up fd, errno [{}].", errno); return; }
+
+            m_isActive = true;
+            for(uint16_t i = 0; i < threads; i++) { m_threads.push_back(new std::thread(startLoop, this)); }
+           Logger::getInstance().Log(Logs::INFO, Logs::Network, "Reactor::Reactor()", "Started [{}] I/O thread(s).", threads);
+        #else
+            Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Reactor::Reactor()", "epoll is Linux only, nothing will be dispatched.");
+        #endif
+    }
+
+    Reactor::~Reactor()
+    {
+        stop();
+        if(getShared() == this) { setShared(nullptr); }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        #if PLATFORM == PLATFORM_LINUX
+            for(std::unordered_map<int, std::shared_ptr<Registration> >::iterator it = m_registrations.begin(); it != m_registrations.end(); ++it)
+            {
+                if(it->second->owned) { close(it->first); }
+            }
+            if(m_wakeFD != -1) { close(m_wakeFD); }
+            if(m_epollFD != -1) { close(m_epollFD); }
+        #endif
+        m_registrations.clear();
+        m_wakeFD = -1;
+        m_epollFD = -1;
+    }
+
+    bool Reactor::add(int fd, uint32_t events, Handler handler)
+    {
+        return registerFD(fd, events, handler, false);
+    }
+
+    bool Reactor::modify(int fd, uint32_t events)
+    {
+        #if PLATFORM == PLATFORM_LINUX
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::unordered_map<int, std::shared_ptr<Registration> >::iterator it = m_registrations.find(fd);
+            if(it == m_registrations.end()) { return false; }
+
+            Registration& reg = *it->second;
+            reg.events = toEpoll(events);
+            struct epoll_event ev;
+            ev.events = reg.events;
+            ev.data.u64 = ((uint64_t)reg.generation << 32) | (uint32_t)fd;
+            return (epoll_ctl(m_epollFD, EPOLL_CTL_MOD, fd, &ev) == 0);
+        #else
+            return false;
+        #endif
+    }
+
+    bool Reactor::remove(int fd)
+    {
+        std::shared_ptr<Registration> reg;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::unordered_map<int, std::shared_ptr<Registration> >::iterator it = m_registrations.find(fd);
+            if(it == m_registrations.end()) { return false; }
+            reg = it->second;
+            reg->removed = true;
+            m_registrations.erase(it);
+            #if PLATFORM == PLATFORM_LINUX
+                epoll_ctl(m_epollFD, EPOLL_CTL_DEL, fd, nullptr);
+            #endif
+        }
+
+        // a handler removing itself would wait on its own lock
+        if(runningHandler != reg.get()) { std::lock_guard<std::mutex> wait(reg->running); }
+
+        #if PLATFORM == PLATFORM_LINUX
+            if(reg->owned) { close(fd); }
+        #endif
+        return true;
+    }
+
+    int Reactor::addTimer(uint64_t intervalMS, Handler handler)
+    {
+        #if PLATFORM == PLATFORM_LINUX
+            int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if(fd == -1) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Reactor::addTimer()", "timerfd_create() failed, errno [{}].", errno); return -1; }
+            if(intervalMS == 0) { intervalMS = 1; } // all zeroes disarms a timerfd
+
+            struct itimerspec spec;
+            spec.it_interval.tv_sec = intervalMS / 1000;
+            spec.it_interval.tv_nsec = (intervalMS % 1000) * 1000000;
+            spec.it_value = spec.it_interval;
+            timerfd_settime(fd, 0, &spec, nullptr);
+
+            // expirations are counted, one call covers all of them
+            Handler wrapped = [fd, handler](uint32_t events) { uint64_t expirations = 0; while(read(fd, &expirations, sizeof(expirations)) > 0) {} handler(events); };
+            if(!registerFD(fd, ReactorEvent::Readable, wrapped, true)) { close(fd); return -1; }
+            return fd;
+        #else
+            return -1;
+        #endif
+    }
+
+    int Reactor::addEvent(Handler handler)
+    {
+        #if PLATFORM == PLATFORM_LINUX
+            int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if(fd == -1) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Reactor::addEvent()", "eventfd() failed, errno [{}].", errno); return -1; }
+
+            Handler wrapped = [fd, handler](uint32_t events) { uint64_t count = 0; while(read(fd, &count, sizeof(count)) > 0) {} handler(events); };
+            if(!registerFD(fd, ReactorEvent::Readable, wrapped, true)) { close(fd); return -1; }
+            return fd;
+        #else
+            return -1;
+        #endif
+    }
+
+    void Reactor::signal(int eventFD)
+    {
+        #if PLATFORM == PLATFORM_LINUX
+            uint64_t one = 1;
+            if(eventFD != -1 && write(eventFD, &one, sizeof(one)) < 0) {} // EAGAIN only at a full counter, already readable then
+        #endif
+    }
+
+    void Reactor::stop()
+    {
+        if(m_isActive.exchange(false))
+        {
+            #if PLATFORM == PLATFORM_LINUX
+                uint64_t one = 1;
+                if(write(m_wakeFD, &one, sizeof(one)) < 0) {}
+            #endif
+        }
+
+        for(unsigned int i = 0; i < m_threads.size(); i++)
+        {
+            if(m_threads[i]->get_id() == std::this_thread::get_id()) { m_threads[i]->detach(); } // stopped by one of its own handlers
+            else { m_threads[i]->join(); }
+            safeDelete(m_threads[i]);
+        }
+        m_threads.clear();
+    }
+
+    ReactorStats Reactor::snapshot() const
+    {
+        ReactorStats retVal;
+        retVal.wakeups = m_wakeups.load(std::memory_order_relaxed);
+        retVal.dispatched = m_dispatched.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        retVal.registered = m_registrations.size();
+        retVal.threads = m_threads.size();
+        return retVal;
+    }
+
+    /// Reactor private functions /////////////////////////////////////////////
+
+    bool Reactor::registerFD(int fd, uint32_t events, Handler handler, bool owned)
+    {
+        if(fd < 0 || !handler) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Reactor::registerFD()", "Invalid fd [{}] or missing handler.", fd); return false; }
+
+        #if PLATFORM == PLATFORM_LINUX
+            std::shared_ptr<Registration> reg = std::make_shared<Registration>();
+            reg->fd = fd;
+            reg->events = toEpoll(events);
+            reg->owned = owned;
+            reg->handler = handler;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_registrations.count(fd) > 0) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Reactor::registerFD()", "fd [{}] is already registered.", fd); return false; }
+            reg->generation = ++m_generation;
+
+            struct epoll_event ev;
+            ev.events = reg->events;
+            ev.data.u64 = ((uint64_t)reg->generation << 32) | (uint32_t)fd;
+            if(epoll_ctl(m_epollFD, EPOLL_CTL_ADD, fd, &ev) == -1) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "Reactor::registerFD()", "epoll_ctl() failed for fd [{}], errno [{}].", fd, errno); return false; }
+            m_registrations[fd] = reg;
+            return true;
+        #else
+            return false;
+        #endif
+    }
+
+    void Reactor::loop()
+    {
+        #if PLATFORM == PLATFORM_LINUX
+            struct epoll_event events[REACTOR_MAX_EVENTS];
+            while(m_isActive)
+            {
+                int count = epoll_wait(m_epollFD, events, REACTOR_MAX_EVENTS, REACTOR_WAIT_MS);
+                if(count < 0)
+                {
+                    if(errno == EINTR) { continue; }
+                    Logger::getInstance().Log(Logs::CRIT, Logs::Network, "Reactor::loop()", "epoll_wait() failed, errno [{}]. Stopping loop", errno);
+                    break;
+                }
+                else if(count == 0) { continue; }
+
+                m_wakeups.fetch_add(1, std::memory_order_relaxed);
+                for(int i = 0; i < count && m_isActive; i++)
+                {
+                    if(events[i].data.u64 == UINT64_MAX) { continue; } // stop()
+                    dispatch(events[i].data.u64, events[i].events);
+                }
+            }
+        #endif
+    }
+
+    void Reactor::dispatch(uint64_t key, uint32_t epollEvents)
+    {
+        #if PLATFORM == PLATFORM_LINUX
+            int fd = (int)(key & 0xFFFFFFFF);
+            uint32_t generation = (uint32_t)(key >> 32);
+
+            std::shared_ptr<Registration> reg;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                std::unordered_map<int, std::shared_ptr<Registration> >::iterator it = m_registrations.find(fd);
+                if(it == m_registrations.end() || it->second->generation != generation) { return; } // removed, or fd reused since
+                reg = it->second;
+            }
+
+            uint32_t events = ReactorEvent::NONE;
+            if(epollEvents & (EPOLLIN | EPOLLPRI)) { events |= ReactorEvent::Readable; }
+            if(epollEvents & EPOLLOUT) { events |= ReactorEvent::Writable; }
+            if(epollEvents & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) { events |= ReactorEvent::Closed; }
+
+            {
+                std::lock_guard<std::mutex> running(reg->running);
+                if(reg->removed) { return; }
+                runningHandler = reg.get();
+                reg->handler(events);
+                runningHandler = nullptr;
+            }
+            m_dispatched.fetch_add(1, std::memory_order_relaxed);
+
+            // one shot, anything that arrived while the handler ran fires again right away
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(reg->removed) { return; }
+            struct epoll_event ev;
+            ev.events = reg->events;
+            ev.data.u64 = key;
+            epoll_ctl(m_epollFD, EPOLL_CTL_MOD, fd, &ev);
+        #endif
+    }
+
+    uint32_t Reactor::toEpoll(uint32_t events)
+    {
+        uint32_t retVal = 0;
+        #if PLATFORM == PLATFORM_LINUX
+            retVal = EPOLLET | EPOLLONESHOT;
+            if(events & ReactorEvent::Readable) { retVal |= EPOLLIN; }
+            if(events & ReactorEvent::Writable) { retVal |= EPOLLOUT; }
+        #endif
+        return retVal;
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef REACTOR_H_INCLUDED
+#define REACTOR_H_INCLUDED
+
+#include "common/types.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+    Shared I/O threads for everything that would otherwise sit in its own one element poll(): UDP
+    sockets (Network), Unix sockets (NetworkIPC), eventfds and timerfds. One epoll set, any
+    number of threads waiting on it:
+        - registrations are edge triggered and one shot, a handler runs on one thread at a time
+          and has to drain its fd (read until EAGAIN), the fd is re-armed once it returns
+        - remove() takes a fd out and waits for a running handler to finish, so the owner can
+          free whatever the handler touches right after (also safe from inside the handler)
+        - addTimer() / addEvent() create the timerfd / eventfd themselves, their counters are read
+          before the handler runs and remove() closes them
+    Networks and NetworkIPCs constructed while a Reactor is shared (setShared()) hand their
+    receive side to it instead of starting a listen thread. Network still runs its own send and
+    update threads, those wait on condition variables rather than fds.
+
+    Ref:
+        http://man7.org/linux/man-pages/man7/epoll.7.html
+            epoll : edge triggered, EPOLLONESHOT for several threads on one set
+        http://man7.org/linux/man-pages/man2/timerfd_create.2.html
+            timerfd : timer expirations delivered through a fd
+        http://man7.org/linux/man-pages/man2/eventfd.2.html
+            eventfd : wake-up counter
+*/
+
+#define REACTOR_MAX_EVENTS 64 // per epoll_wait()
+#define REACTOR_WAIT_MS 1000 // stop() wakes every thread, this only bounds a missed wake-up
+#define REACTOR_MAX_THREADS 16
+
+namespace ReactorEvent { enum FORMS { NONE = 0, Readable = 1, Writable = 2, Closed = 4 }; } // bit flags
+
+namespace CGameEngine
+{
+    /// plain snapshot of the reactor's counters, safe to hand out to other threads
+    struct ReactorStats
+    {
+        uint64_t wakeups = 0; // epoll_wait() calls that returned events
+        uint64_t dispatched = 0; // handler calls
+        uint32_t registered = 0; // fds currently held
+        uint16_t threads = 0;
+        const float average() const { return (wakeups > 0) ? (float)dispatched / (float)wakeups : 0.0f; }
+    };
+
+    class Reactor
+    {
+        public:
+            typedef std::function<void(uint32_t events)> Handler; // ReactorEvent flags
+
+            Reactor(uint16_t threads = 1);
+            ~Reactor(); // stop()s, fds still registered are dropped (owned ones closed)
+            Reactor(const Reactor& r) = delete;
+            Reactor& operator=(const Reactor& r) = delete;
+
+            bool add(int fd, uint32_t events, Handler handler); // ReactorEvent flags, the caller keeps the fd
+            bool modify(int fd, uint32_t events);
+            bool remove(int fd); // no handler for fd runs once this returns
+            int addTimer(uint64_t intervalMS, Handler handler); // periodic timerfd, -1 on failure
+            int addEvent(Handler handler); // eventfd woken by signal(), -1 on failure
+            static void signal(int eventFD);
+            void stop(); // joins the threads
+            const bool isActive() const { return m_isActive.load(std::memory_order_acquire); }
+            ReactorStats snapshot() const;
+
+            // Networks / NetworkIPCs constructed while set use it, nullptr to go back to a thread each
+            static void setShared(Reactor* r) { s_shared.store(r, std::memory_order_release); }
+            static Reactor* getShared() { return s_shared.load(std::memory_order_acquire); }
+
+        private:
+            struct Registration
+            {
+                int fd = -1;
+                uint32_t generation = 0; // fd numbers are reused, stale epoll events are told apart by this
+                uint32_t events = 0; // epoll flags
+                bool owned = false; // timerfd / eventfd, closed by remove()
+                bool removed = false; // m_mutex held
+                Handler handler;
+                std::mutex running; // held while the handler runs
+            };
+
+            bool registerFD(int fd, uint32_t events, Handler handler, bool owned);
+            void loop();
+            void dispatch(uint64_t key, uint32_t epollEvents);
+            static uint32_t toEpoll(uint32_t events);
+            static void startLoop(Reactor* r) { r->loop(); }
+
+            static std::atomic<Reactor*> s_shared;
+
+            int m_epollFD = -1;
+            int m_wakeFD = -1; // level triggered, stays readable once stop() writes it so every thread sees it
+            std::atomic<bool> m_isActive { false };
+            std::vector<std::thread*> m_threads;
+            mutable std::mutex m_mutex; // m_registrations, epoll_ctl()
+            std::unordered_map<int, std::shared_ptr<Registration> > m_registrations; // by fd
+            uint32_t m_generation = 0;
+            std::atomic<uint64_t> m_wakeups { 0 };
+            std::atomic<uint64_t> m_dispatched { 0 };
+    };
+}
+
+#endif // REACTOR_H_INCLUDED
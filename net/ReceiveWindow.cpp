@@ -0,0 +1,86 @@
+#include "net/ReceiveWindow.h"
+#include <algorithm> // min
+
+namespace CGameEngine
+{
+    /// ReceiveWindow /////////////////////////////////////////////////////////
+
+    bool ReceiveWindow::admit(uint32_t bytes, bool droppable)
+    {
+        // soft limits, two threads may both squeeze in past the edge
+        bool full = (m_bytes.load(std::memory_order_relaxed) + bytes > getLimit());
+        if(m_parent && m_parent->m_bytes.load(std::memory_order_relaxed) + bytes > m_parent->getLimit()) { full = true; }
+        if(full && droppable)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            if(m_parent) { m_parent->m_dropped.fetch_add(1, std::memory_order_relaxed); }
+            return false;
+        }
+        else if(full)
+        {
+            m_overrun.fetch_add(1, std::memory_order_relaxed);
+            if(m_parent) { m_parent->m_overrun.fetch_add(1, std::memory_order_relaxed); }
+        }
+
+        charge(bytes);
+        if(m_parent) { m_parent->charge(bytes); }
+        return true;
+    }
+
+    void ReceiveWindow::credit(uint32_t bytes)
+    {
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        m_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        if(m_parent) { m_parent->credit(bytes); }
+    }
+
+    bool ReceiveWindow::reserve(uint32_t bytes)
+    {
+        // unlike admit() there is no overrun, the sender's next fragment simply tries again
+        if(available() < bytes) { return false; }
+        addBytes(bytes);
+        if(m_parent) { m_parent->addBytes(bytes); }
+        return true;
+    }
+
+    void ReceiveWindow::unreserve(uint32_t bytes)
+    {
+        m_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        if(m_parent) { m_parent->unreserve(bytes); }
+    }
+
+    const uint64_t ReceiveWindow::available() const
+    {
+        uint64_t limit = getLimit();
+        uint64_t bytes = m_bytes.load(std::memory_order_relaxed);
+        uint64_t retVal = (bytes < limit) ? limit - bytes : 0;
+        return (m_parent) ? std::min(retVal, m_parent->available()) : retVal;
+    }
+
+    ReceiveWindowStats ReceiveWindow::snapshot() const
+    {
+        ReceiveWindowStats retVal;
+        retVal.limit = getLimit();
+        retVal.queued = m_queued.load(std::memory_order_relaxed);
+        retVal.bytes = m_bytes.load(std::memory_order_relaxed);
+        retVal.peakBytes = m_peakBytes.load(std::memory_order_relaxed);
+        retVal.dropped = m_dropped.load(std::memory_order_relaxed);
+        retVal.overrun = m_overrun.load(std::memory_order_relaxed);
+        return retVal;
+    }
+
+    /// ReceiveWindow private functions ///////////////////////////////////////
+
+    void ReceiveWindow::charge(uint32_t bytes)
+    {
+        m_queued.fetch_add(1, std::memory_order_relaxed);
+        addBytes(bytes);
+    }
+
+    void ReceiveWindow::addBytes(uint32_t bytes)
+    {
+        uint64_t now = m_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        uint64_t peak = m_peakBytes.load(std::memory_order_relaxed);
+        while(now > peak && !m_peakBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+    }
+}
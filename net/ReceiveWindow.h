@@ -0,0 +1,77 @@
+#ifndef RECEIVEWINDOW_H_INCLUDED
+#define RECEIVEWINDOW_H_INCLUDED
+
+#include "common/types.h"
+#include <atomic>
+#include <memory>
+
+/*
+    Bounds what has been handed to the user's Datagram queue but not yet deleted. Each Datagram a
+    connection hands over is charged its payload plus sizeof(Datagram) against the connection's
+    window and Network's global one, the Datagram's destructor credits both back:
+        - once either window is full, unreliable messages are dropped (unless turned off), reliable
+          ones are always handed over, their sender has already forgotten them
+        - the free space of the fuller of the two is advertised to the peer in OP_WindowUpdate, its
+          CongestionControl caps the pacing rate at one window per RTT and stops at 0, sending a
+          single probe packet every CC_WINDOW_PROBE_US in case a reopening update was lost
+    Windows only bound memory if the peer paces (Network::setPacing()), which is the default.
+    Partly reassembled sequences reserve their whole buffer up front, before it is allocated, and
+    give it back once the Datagram takes over (or the sequence dies). They are not counted as queued.
+
+    Ref:
+        https://tools.ietf.org/html/rfc9293#section-3.8.6
+            TCP Window Management (advertised window, zero window probes)
+*/
+
+#define NET_RECV_WINDOW_CONNECTION (4 * 1024 * 1024) // bytes per connection
+#define NET_RECV_WINDOW_GLOBAL (64 * 1024 * 1024) // bytes per Network
+#define NET_WINDOW_UPDATE_MS 20 // how often a shrunk window is re-checked, the user returns credit without telling anyone
+#define NET_WINDOW_REFRESH_MS 200 // a shrunk window is re-advertised at least this often, in case an update was lost
+#define NET_WINDOW_UNADVERTISED UINT64_MAX
+
+namespace CGameEngine
+{
+    /// plain snapshot of one window, safe to hand out to other threads
+    struct ReceiveWindowStats
+    {
+        uint64_t limit = 0; // bytes
+        uint64_t queued = 0; // datagrams handed over and not yet deleted
+        uint64_t bytes = 0; // what they are charged
+        uint64_t peakBytes = 0;
+        uint64_t dropped = 0; // unreliable datagrams dropped on a full window
+        uint64_t overrun = 0; // reliable datagrams handed over on a full window
+        const uint64_t available() const { return (bytes < limit) ? limit - bytes : 0; }
+    };
+
+    /// charged by the connection handing Datagrams over, credited by whichever thread deletes them
+    class ReceiveWindow
+    {
+        public:
+            ReceiveWindow(uint64_t limit, std::shared_ptr<ReceiveWindow> parent = nullptr) : m_parent(parent), m_limit(limit) {}
+            ReceiveWindow(const ReceiveWindow& rw) = delete;
+            ReceiveWindow& operator=(const ReceiveWindow& rw) = delete;
+
+            bool admit(uint32_t bytes, bool droppable); // false if droppable and a window is full, nothing is charged then
+            void credit(uint32_t bytes); // any thread
+            bool reserve(uint32_t bytes); // a reassembly buffer, all or nothing, false (nothing charged) if either window lacks the room
+            void unreserve(uint32_t bytes); // any thread
+            void setLimit(uint64_t limit) { m_limit.store(limit, std::memory_order_relaxed); }
+            const uint64_t getLimit() const { return m_limit.load(std::memory_order_relaxed); }
+            const uint64_t available() const; // this window's or the parent's free space, whichever is smaller
+            ReceiveWindowStats snapshot() const;
+
+        private:
+            void charge(uint32_t bytes);
+            void addBytes(uint32_t bytes);
+
+            std::shared_ptr<ReceiveWindow> m_parent; // Network's global window, null for that one
+            std::atomic<uint64_t> m_limit { 0 };
+            std::atomic<uint64_t> m_queued { 0 };
+            std::atomic<uint64_t> m_bytes { 0 };
+            std::atomic<uint64_t> m_peakBytes { 0 };
+            std::atomic<uint64_t> m_dropped { 0 };
+            std::atomic<uint64_t> m_overrun { 0 };
+    };
+}
+
+#endif // RECEIVEWINDOW_H_INCLUDED
@@ -0,0 +1,70 @@
+#ifndef SENDBUFFER_H_INCLUDED
+#define SENDBUFFER_H_INCLUDED
+
+#include "common/MemoryPool.h"
+#include <atomic>
+#include <new> // placement new
+#include <stdint.h>
+
+/*
+    A serialized packet in a pool block, behind a reference count. Network::send() writes the
+    header and the caller's payload straight into one per fragment, then the send queue and the
+    StoredSequence kept for retransmissions each hold a reference. Whoever drops the last one
+    returns the block to the pool, so a sequence can expire while its fragments are still queued.
+
+    Block layout: refcount (4 bytes) | transmit stamp (4 bytes) | packet, callers only ever see the
+    packet. sendLoop() stamps the low 32 bits of its steady millisecond clock once the packet has
+    left, so the resend timer runs from the wire and not from when send() queued it.
+    A full PACKET_MAX_SIZE packet plus the count still fits MemoryPool's 1KB class.
+*/
+
+#define SEND_BUFFER_HEADER 8
+
+namespace CGameEngine
+{
+    struct SendBuffer
+    {
+        /// new buffer holding one reference
+        static unsigned char* acquire(uint32_t size)
+        {
+            unsigned char* block = poolBuffer(SEND_BUFFER_HEADER + size);
+            new (block) std::atomic<uint32_t>(1);
+            new (block + 4) std::atomic<uint32_t>(0);
+            return block + SEND_BUFFER_HEADER;
+        }
+
+        /// another holder, returns data for convenience
+        static unsigned char* retain(unsigned char* data)
+        {
+            if(data) { refs(data).fetch_add(1, std::memory_order_relaxed); }
+            return data;
+        }
+
+        /// someone besides the caller still holds it, for a stored fragment that means it is queued or paced
+        static bool isShared(const unsigned char* data) { return (data && refs(data).load(std::memory_order_acquire) > 1); }
+
+        /// sendLoop() only, just before dropping its reference
+        static void stampSent(unsigned char* data, uint32_t ms) { if(data) { stamp(data).store((ms == 0) ? 1 : ms, std::memory_order_release); } }
+
+        /// last stampSent() value, 0 if it never went out on its own
+        static uint32_t sentStamp(const unsigned char* data) { return (data) ? stamp(data).load(std::memory_order_acquire) : 0; }
+
+        /// drop the caller's reference, zeroes data
+        static void release(unsigned char*& data)
+        {
+            if(!data) { return; }
+            if(refs(data).fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                unsigned char* block = data - SEND_BUFFER_HEADER;
+                poolRelease(block);
+            }
+            data = nullptr;
+        }
+
+        private:
+            static std::atomic<uint32_t>& refs(const unsigned char* data) { return *reinterpret_cast<std::atomic<uint32_t>*>(const_cast<unsigned char*>(data) - SEND_BUFFER_HEADER); }
+            static std::atomic<uint32_t>& stamp(const unsigned char* data) { return *reinterpret_cast<std::atomic<uint32_t>*>(const_cast<unsigned char*>(data) - SEND_BUFFER_HEADER + 4); }
+    };
+}
+
+#endif // SENDBUFFER_H_INCLUDED
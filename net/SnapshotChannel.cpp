@@ -0,0 +1,216 @@
+#include "net/SnapshotChannel.h"
+#include "net/Network.h"
+#include "net/Connection.h" // NetConnection
+
+namespace CGameEngine
+{
+    /// SnapshotChannel ///////////////////////////////////////////////////////
+
+    SnapshotChannel::SnapshotChannel(Network* net, uint16_t opCode, uint32_t stateSize) : m_network(net), m_opCode(opCode), m_stateSize(stateSize)
+    {
+        if(m_stateSize == 0) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "SnapshotChannel::SnapshotChannel()", "State size of 0 for OPCode [{}], nothing will be sent.", m_opCode); }
+        m_scratch.resize(sizeof(SnapshotHeader_Struct) + m_stateSize);
+        if(m_network) { m_network->addSnapshotChannel(this); }
+    }
+
+    SnapshotChannel::~SnapshotChannel()
+    {
+        if(m_network) { m_network->removeSnapshotChannel(this); } // no acks are delivered past this point
+        m_network = nullptr;
+    }
+
+    uint32_t SnapshotChannel::send(sockaddr_storage* addr, const void* state)
+    {
+        if(!addr || !state || !m_network || m_stateSize == 0) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "SnapshotChannel::send()", "Missing address, state or network. Ignoring send() call."); return 0; }
+
+        const unsigned char* current = (const unsigned char*)state;
+        unsigned char* buffer = nullptr;
+        uint32_t length = 0;
+        SnapshotHeader_Struct header;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            History& h = getHistory(m_sent, ConnectionKey(addr));
+            header.id = ++h.latest;
+            if(header.id == 0) { header.id = ++h.latest; } // 0 means 'no snapshot'
+
+            // the acknowledged baseline must still be held, and not share a slot with the new snapshot
+            if(h.has(h.acked) && header.id - h.acked < NET_SNAPSHOT_HISTORY) { header.baseline = h.acked; }
+
+            // a delta has to beat the full state to be worth it
+            uint32_t deltaLength = 0;
+            unsigned char* body = &m_scratch[sizeof(SnapshotHeader_Struct)];
+            if(header.baseline == 0 || !encodeDelta(h.slot(header.baseline, m_stateSize), current, m_stateSize, body, m_stateSize - 1, deltaLength))
+            {
+                header.baseline = 0;
+                deltaLength = m_stateSize;
+                memcpy(body, current, m_stateSize);
+            }
+            memcpy(&m_scratch[0], &header, sizeof(SnapshotHeader_Struct));
+
+            // keep what was sent, a later ack makes it the baseline
+            memcpy(h.slot(header.id, m_stateSize), current, m_stateSize);
+            h.ids[header.id % NET_SNAPSHOT_HISTORY] = header.id;
+
+            length = sizeof(SnapshotHeader_Struct) + deltaLength;
+            buffer = new unsigned char[length];
+            memcpy(buffer, &m_scratch[0], length);
+
+            if(header.baseline == 0) { m_stats.fullSent++; }
+            else { m_stats.deltaSent++; }
+            m_stats.bytesSent += length;
+            m_stats.stateBytes += sizeof(SnapshotHeader_Struct) + m_stateSize;
+        }
+
+        // outside the lock, send() can wait on a full send queue. Loss is handled by falling back to older baselines, never by retransmitting
+        m_network->send(addr, m_opCode, &buffer, length, DeliveryMode::Unreliable);
+        return header.id;
+    }
+
+    bool SnapshotChannel::receive(Datagram* d)
+    {
+        if(!d || d->op_code != m_opCode || !d->data || d->dataLength < (int)sizeof(SnapshotHeader_Struct)) { return false; }
+        if(!d->netCon) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "SnapshotChannel::receive()", "Snapshot without a source connection, dropping it."); return false; }
+
+        SnapshotHeader_Struct header;
+        memcpy(&header, d->data, sizeof(SnapshotHeader_Struct));
+        const unsigned char* body = d->data + sizeof(SnapshotHeader_Struct);
+        uint32_t bodyLength = d->dataLength - sizeof(SnapshotHeader_Struct);
+        sockaddr_storage* source = d->netCon->getSource();
+
+        bool deliver = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.received++;
+            if(header.id == 0 || header.id == header.baseline || (header.baseline != 0 && header.id - header.baseline >= NET_SNAPSHOT_HISTORY))
+            {
+                Logger::getInstance().Log(Logs::WARN, Logs::Network, "SnapshotChannel::receive()", "Malformed snapshot header, id [{}], baseline [{}].", header.id, header.baseline);
+                return false;
+            }
+
+            History& h = getHistory(m_received, ConnectionKey(source));
+            unsigned char* slot = h.slot(header.id, m_stateSize);
+            uint32_t& slotID = h.ids[header.id % NET_SNAPSHOT_HISTORY];
+            if(header.baseline == 0)
+            {
+                if(bodyLength != m_stateSize) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "SnapshotChannel::receive()", "Full snapshot of [{}] bytes, expected [{}].", bodyLength, m_stateSize); return false; }
+                memcpy(slot, body, m_stateSize);
+            }
+            else
+            {
+                // baseline was overwritten or never arrived, the sender falls back to a full snapshot once our acks stop moving
+                if(!h.has(header.baseline)) { m_stats.undecodable++; return false; }
+                slotID = 0;
+                memcpy(slot, h.slot(header.baseline, m_stateSize), m_stateSize);
+                if(!applyDelta(slot, m_stateSize, body, bodyLength)) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "SnapshotChannel::receive()", "Delta for snapshot [{}] overruns the state, dropping it.", header.id); return false; }
+            }
+            slotID = header.id;
+
+            // still a valid baseline, but the user already has something newer
+            if(header.id <= h.latest) { m_stats.stale++; deliver = false; }
+            else { h.latest = header.id; }
+
+            // full state replaces the payload
+            if(deliver)
+            {
+                if(d->dataLength != (int)m_stateSize) { poolRelease(d->data); d->data = poolBuffer(m_stateSize); }
+                memcpy(d->data, slot, m_stateSize);
+                d->dataLength = m_stateSize;
+            }
+        }
+
+        SnapshotAck_Struct ack;
+        ack.snapshotID = header.id;
+        ack.opCode = m_opCode;
+        if(m_network) { m_network->sendBuiltinData(source, OP_Ack, &ack, sizeof(SnapshotAck_Struct)); }
+        return deliver;
+    }
+
+    void SnapshotChannel::onAck(const sockaddr_storage* addr, uint32_t snapshotID)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::unordered_map<ConnectionKey, History, ConnectionKeyHash>::iterator it = m_sent.find(ConnectionKey(addr));
+        if(it == m_sent.end()) { return; }
+
+        // acks arrive out of order, only ever move forward
+        History& h = it->second;
+        if(h.has(snapshotID) && snapshotID > h.acked) { h.acked = snapshotID; m_stats.acked++; }
+    }
+
+    void SnapshotChannel::removeConnection(const sockaddr_storage* addr)
+    {
+        ConnectionKey key(addr);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sent.erase(key);
+        m_received.erase(key);
+    }
+
+    bool SnapshotChannel::encodeDelta(const unsigned char* baseline, const unsigned char* state, uint32_t size, unsigned char* out, uint32_t outSize, uint32_t& outLength)
+    {
+        outLength = 0;
+        uint32_t i = 0;
+        while(i < size)
+        {
+            // unchanged bytes
+            uint32_t skip = 0;
+            while(i < size && baseline[i] == state[i]) { i++; skip++; }
+            if(i == size) { break; }
+
+            // skips longer than a run header can hold become empty runs
+            while(skip > NET_SNAPSHOT_MAX_RUN)
+            {
+                if(outLength + 4 > outSize) { return false; }
+                uint16_t s = NET_SNAPSHOT_MAX_RUN, l = 0;
+                memcpy(out + outLength, &s, 2); memcpy(out + outLength + 2, &l, 2);
+                outLength += 4;
+                skip -= NET_SNAPSHOT_MAX_RUN;
+            }
+
+            // changed bytes, swallowing gaps too short to pay for another header
+            uint32_t start = i;
+            while(i < size && i - start < NET_SNAPSHOT_MAX_RUN)
+            {
+                if(baseline[i] != state[i]) { i++; continue; }
+                uint32_t j = i;
+                while(j < size && j - i < NET_SNAPSHOT_MIN_GAP && baseline[j] == state[j]) { j++; }
+                if(j < size && j - i < NET_SNAPSHOT_MIN_GAP && j - start < NET_SNAPSHOT_MAX_RUN) { i = j; }
+                else { break; }
+            }
+
+            uint16_t runLength = (uint16_t)(i - start);
+            uint16_t runSkip = (uint16_t)skip;
+            if(outLength + 4 + runLength > outSize) { return false; }
+            memcpy(out + outLength, &runSkip, 2); memcpy(out + outLength + 2, &runLength, 2);
+            outLength += 4;
+            for(uint32_t k = start; k < i; k++) { out[outLength++] = baseline[k] ^ state[k]; }
+        }
+        return true;
+    }
+
+    bool SnapshotChannel::applyDelta(unsigned char* state, uint32_t size, const unsigned char* delta, uint32_t deltaLength)
+    {
+        uint32_t pos = 0;
+        uint32_t offset = 0;
+        while(pos < deltaLength)
+        {
+            if(pos + 4 > deltaLength) { return false; }
+            uint16_t skip = 0, runLength = 0;
+            memcpy(&skip, delta + pos, 2); memcpy(&runLength, delta + pos + 2, 2);
+            pos += 4;
+            offset += skip;
+            if(offset + runLength > size || pos + runLength > deltaLength) { return false; }
+            for(uint16_t k = 0; k < runLength; k++) { state[offset + k] ^= delta[pos + k]; }
+            offset += runLength;
+            pos += runLength;
+        }
+        return true;
+    }
+
+    /// SnapshotChannel private functions /////////////////////////////////////
+
+    SnapshotChannel::History& SnapshotChannel::getHistory(std::unordered_map<ConnectionKey, History, ConnectionKeyHash>& map, const ConnectionKey& key)
+    {
+        History& h = map[key];
+        if(h.states.empty()) { h.states.resize((size_t)NET_SNAPSHOT_HISTORY * m_stateSize); }
+        return h;
+    }
+}
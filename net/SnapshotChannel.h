@@ -0,0 +1,103 @@
+#ifndef SNAPSHOTCHANNEL_H_INCLUDED
+#define SNAPSHOTCHANNEL_H_INCLUDED
+
+#include "common/types.h"
+#include "net/ConnectionKey.h"
+#include "net/Datagram.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*
+    Replicates a fixed size state struct (world/entity snapshot) to each connection every tick,
+    sending only what changed since the newest snapshot that connection has acknowledged:
+        - the state is XORed against that baseline, unchanged bytes become 0
+        - the XOR is written as runs of [skip 2][length 2][length bytes], short gaps are folded
+          into the surrounding run since a run header costs 4 bytes
+        - a full snapshot is sent when there is no usable baseline (nothing acknowledged yet, or
+          the acknowledged one has been pushed out of the last NET_SNAPSHOT_HISTORY snapshots by
+          loss) or when the delta would not be smaller
+    The receiving side keeps the same history, rebuilds the full state in place inside the user's
+    Datagram and acknowledges it with an OP_Ack carrying a SnapshotAck_Struct. Network picks those
+    up in its listen thread and hands them to the channel registered for the opCode.
+
+    Snapshots go out DeliveryMode::Unreliable, a lost one is simply superseded by the next.
+
+    Payload: SnapshotHeader_Struct | state (baseline 0) or delta runs
+
+    Ref:
+        https://fabiensanglard.net/quake3/network.php
+            Quake 3 networking model, deltas against the last acknowledged snapshot
+        https://gafferongames.com/post/snapshot_compression/
+            Snapshot Compression
+*/
+
+#define NET_SNAPSHOT_HISTORY 32 // snapshots kept per connection, 1.6s at 20 Hz
+#define NET_SNAPSHOT_MIN_GAP 4 // zero gaps shorter than a run header stay inside the run
+#define NET_SNAPSHOT_MAX_RUN 0xFFFF
+
+namespace CGameEngine
+{
+    class Network;
+
+    /// counters for one channel, all connections
+    struct SnapshotStats
+    {
+        uint64_t fullSent = 0;
+        uint64_t deltaSent = 0;
+        uint64_t bytesSent = 0; // payload bytes handed to Network::send()
+        uint64_t stateBytes = 0; // what sending every snapshot in full would have cost
+        uint64_t acked = 0;
+        uint64_t received = 0;
+        uint64_t undecodable = 0; // delta arrived for a baseline that is no longer held
+        uint64_t stale = 0; // older than a snapshot already delivered
+        const float ratio() const { return (stateBytes > 0) ? (float)bytesSent / (float)stateBytes : 1.0f; }
+    };
+
+    class SnapshotChannel
+    {
+        public:
+            SnapshotChannel(Network* net, uint16_t opCode, uint32_t stateSize); // registers with net for the acks
+            ~SnapshotChannel();
+            SnapshotChannel(const SnapshotChannel& sc) = delete;
+            SnapshotChannel& operator=(const SnapshotChannel& sc) = delete;
+
+            uint32_t send(sockaddr_storage* addr, const void* state); // returns the snapshot ID, 0 if nothing was sent
+            bool receive(Datagram* d); // true if d now holds the full state, false if it should be dropped
+            void onAck(const sockaddr_storage* addr, uint32_t snapshotID); // Network's listen thread
+            void removeConnection(const sockaddr_storage* addr); // forget a disconnected peer's history
+
+            const uint16_t& getOPCode() const { return m_opCode; }
+            const uint32_t& getStateSize() const { return m_stateSize; }
+            SnapshotStats getStats() const { std::lock_guard<std::mutex> lock(m_mutex); return m_stats; }
+
+            // encoding, exposed for tools
+            static bool encodeDelta(const unsigned char* baseline, const unsigned char* state, uint32_t size, unsigned char* out, uint32_t outSize, uint32_t& outLength); // false if it does not fit in outSize
+            static bool applyDelta(unsigned char* state, uint32_t size, const unsigned char* delta, uint32_t deltaLength); // state holds the baseline on entry
+
+        private:
+            /// one side of a connection, snapshot IDs are slot id % NET_SNAPSHOT_HISTORY
+            struct History
+            {
+                uint32_t latest = 0; // newest sent / delivered
+                uint32_t acked = 0; // newest acknowledged by the peer, sender only
+                uint32_t ids[NET_SNAPSHOT_HISTORY] = { 0 };
+                std::vector<unsigned char> states;
+                unsigned char* slot(uint32_t id, uint32_t size) { return &states[(id % NET_SNAPSHOT_HISTORY) * size]; }
+                const bool has(uint32_t id) const { return (id != 0 && ids[id % NET_SNAPSHOT_HISTORY] == id); }
+            };
+
+            History& getHistory(std::unordered_map<ConnectionKey, History, ConnectionKeyHash>& map, const ConnectionKey& key); // m_mutex held
+
+            Network* m_network = nullptr;
+            uint16_t m_opCode = 0;
+            uint32_t m_stateSize = 0;
+            mutable std::mutex m_mutex;
+            std::unordered_map<ConnectionKey, History, ConnectionKeyHash> m_sent; // per destination
+            std::unordered_map<ConnectionKey, History, ConnectionKeyHash> m_received; // per source
+            std::vector<unsigned char> m_scratch; // delta encoding, m_mutex held
+            SnapshotStats m_stats;
+    };
+}
+
+#endif // SNAPSHOTCHANNEL_H_INCLUDED
@@ -1,10 +1,14 @@
 #include "UnixPacket.h"
 
+#if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_LINUX
+    #include <unistd.h> // close()
+#endif
+
 
 namespace CGameEngine
 {
     UnixPacket::UnixPacket(uint16_t psize /*= UNIX_PACKET_DATA_SIZE*/)
-        : dataLength(psize), data(new unsigned char[psize])
+        : dataLength(psize), data(poolBuffer(psize))
     {
         memset(data, 0, dataLength);
     }
@@ -20,7 +24,7 @@ namespace CGameEngine
     }
 
     UnixPacket::UnixPacket(uint16_t opCode, const uint64_t& arrival, const uint32_t sender, const uint16_t len, unsigned char* d)
-        : op_code(opCode), timestamp(arrival), senderID(sender), dataLength(len), data(new unsigned char[len])
+        : op_code(opCode), timestamp(arrival), senderID(sender), dataLength(len), data(poolBuffer(len))
     {
         if(dataLength+UNIX_PACKET_HEADER_SIZE > UNIX_PACKET_MAX_SIZE) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "UnixPacket::UnixPacket(full)", "Invalid packet length, received {} though the max is {}!", dataLength, UNIX_PACKET_MAX_SIZE); return; }
 
@@ -38,7 +42,10 @@ namespace CGameEngine
 
     UnixPacket::~UnixPacket() noexcept
     {
-        safeDeleteArray(data);
+        poolRelease(data);
+        #if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_LINUX
+            if(fd != -1) { close(fd); } // nobody took it
+        #endif
     }
 
     const int UnixPacket::getHeaderSize() const
@@ -67,20 +74,21 @@ namespace CGameEngine
         timestamp = readUInt64();
         senderID = readUInt32();
         dataLength = readUInt16();
-        data = new unsigned char[dataLength];
+        poolRelease(data);
+        data = poolBuffer(dataLength);
         readUCharArr(data, dataLength);
 
         pSize = getSize();
-        safeDeleteArray(buffer);
+        poolRelease(buffer);
     }
 
     void UnixPacket::serializeOut()
     {
         // reset buffer and writePos
-        safeDeleteArray(buffer);
+        poolRelease(buffer);
         writePos = 0;
         pSize = getSize();
-        buffer = new unsigned char[pSize];
+        buffer = poolBuffer(pSize);
         memset(buffer, 0, pSize);
 
         writeUInt16(op_code);
@@ -113,12 +121,13 @@ namespace CGameEngine
             using std::swap;
 
             // by swapping the members of two objects, the two objects are effectively swapped
-            safeDeleteArray(dst.data);
+            poolRelease(dst.data);
             swap(dst.op_code, src.op_code);
             swap(dst.timestamp, src.timestamp);
             swap(dst.senderID, src.senderID);
             swap(dst.dataLength, src.dataLength);
             swap(dst.data, src.data);
+            swap(dst.fd, src.fd);
         }
     }
 }
@@ -17,6 +17,7 @@ namespace CGameEngine
         uint32_t senderID = 0; // sender's uniq ID
         uint16_t dataLength = 0;
         unsigned char* data = nullptr;
+        int fd = -1; // descriptor passed along with the packet (SCM_RIGHTS), local to this process, never serialized
 
         UnixPacket(uint16_t pSize = UNIX_PACKET_DATA_SIZE); // default ctor
         UnixPacket(unsigned char* d, uint32_t len);
@@ -31,6 +32,7 @@ namespace CGameEngine
         const int getSize() const;
         void serializeIn();
         void serializeOut();
+        int takeFD() { int retVal = fd; fd = -1; return retVal; } // caller closes it, otherwise the destructor does
 
         friend void copy(UnixPacket& dst, const UnixPacket& src);
         friend void swap(UnixPacket& dst, UnixPacket& src);
@@ -1,5 +1,6 @@
 #include "UnixSocket.h"
 #include "net/UnixPacket.h"
+#include <cerrno>
 
 
 namespace CGameEngine
@@ -24,6 +25,86 @@ namespace CGameEngine
         }
     }
 
+    bool UnixSocket::sendData(unsigned char* packet_data, uint32_t packet_size, int passFD)
+    {
+        // check for faults
+        if(m_fd == -1) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "UnixSocket::sendData(fd)", "No fd set!"); return false; }
+        else if(passFD < 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "UnixSocket::sendData(fd)", "No descriptor to pass!"); return false; }
+        else if(!packet_data) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "UnixSocket::sendData(fd)", "packet_data pointer is null!"); return false; }
+        else if(packet_size == 0 || packet_size > UNIX_PACKET_MAX_SIZE) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "UnixSocket::sendData(fd)", "packet_size is incorrect! Tried {}, but max is {}.", packet_size, UNIX_PACKET_MAX_SIZE); return false; }
+
+        struct iovec iov;
+        iov.iov_base = packet_data;
+        iov.iov_len = packet_size;
+
+        // control buffer has to be aligned for cmsghdr
+        union { struct cmsghdr align; char buf[CMSG_SPACE(sizeof(int))]; } control;
+        memset(&control, 0, sizeof(control));
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &m_remoteAddr;
+        msg.msg_namelen = sizeof(m_remoteAddr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &passFD, sizeof(int));
+
+        int sent = sendmsg(m_fd, &msg, 0); // write out
+        if(sent <= 0) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "UnixSocket::sendData(fd)", "Failed sendmsg() to m_fd ({}), errno [{}]!", m_fd, errno); return false; }
+        else if(sent != (int)packet_size) { Logger::getInstance().Log(Logs::CRIT, Logs::Network, "UnixSocket::sendData(fd)", "Failed to sendmsg() full packet. Sent only {} of {}!", sent, packet_size); return false; }
+        else // success
+        {
+            memset(packet_data, 0, packet_size); // cleanup
+            return true;
+        }
+    }
+
+    int UnixSocket::receive(unsigned char* packet_data, int* passedFD)
+    {
+        if(!passedFD) { return receive(packet_data); }
+        *passedFD = -1;
+        if(m_fd == -1)
+        {
+           Logger::getInstance().Log(Logs::CRIT, Logs::Network, "UnixSocket::receive(fd)", "No fd set!");
+            return -1;
+        }
+
+        struct iovec iov;
+        iov.iov_base = packet_data;
+        iov.iov_len = UNIX_PACKET_MAX_SIZE;
+
+        union { struct cmsghdr align; char buf[CMSG_SPACE(sizeof(int))]; } control;
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        // read data in, a passed descriptor must not leak into exec()'d children
+        int bytes = recvmsg(m_fd, &msg, MSG_CMSG_CLOEXEC);
+        if(bytes < 0) { return bytes; }
+        if(msg.msg_flags & MSG_CTRUNC) { Logger::getInstance().Log(Logs::WARN, Logs::Network, "UnixSocket::receive(fd)", "Ancillary data truncated, more than one descriptor was sent."); }
+
+        for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len >= CMSG_LEN(sizeof(int)))
+            {
+                memcpy(passedFD, CMSG_DATA(cmsg), sizeof(int));
+                break;
+            }
+        }
+
+        return bytes;
+    }
+
     int UnixSocket::receive(unsigned char* packet_data)
     {
         if(m_fd == -1)
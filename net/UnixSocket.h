@@ -6,8 +6,16 @@
 /// \TODO: Handle remote end disconnecting
 
 /*
+    A file descriptor can ride along with a datagram (sendData() with passFD, receive() with
+    passedFD), the kernel installs a duplicate in the receiving process. Both processes hold the
+    same open socket afterwards, each closes its own copy.
+
     Ref:
         https://dvdhrm.wordpress.com/2015/06/20/from-af_unix-to-kdbus/
+        http://man7.org/linux/man-pages/man7/unix.7.html
+            SCM_RIGHTS : ancillary data carrying file descriptors
+        http://man7.org/linux/man-pages/man3/cmsg.3.html
+            CMSG_* : building / walking the ancillary buffer
 
 */
 
@@ -22,7 +30,9 @@ namespace CGameEngine
             void closeSocket();
             void setRemoteAddr(std::string& sockName);
             bool sendData(unsigned char* packet_data, uint32_t packet_size);
+            bool sendData(unsigned char* packet_data, uint32_t packet_size, int passFD); // passFD travels as SCM_RIGHTS, the caller keeps its own
             int receive(unsigned char* buffer);
+            int receive(unsigned char* buffer, int* passedFD); // *passedFD is -1 unless a descriptor came along (close-on-exec)
             const bool isConnected() const { return true; }
             const std::string& getSocketName() const { return m_sockName; }
 
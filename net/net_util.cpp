@@ -37,6 +37,47 @@ bool isSameSource(sockaddr_storage* sas, addrinfo* addr)
     return true;
 }
 
+// strict ordering of family, address and port (<0, 0, >0), used to group traffic by destination
+int compareAddress(const sockaddr_storage* a, const sockaddr_storage* b)
+{
+    if(a == b) { return 0; }
+    else if(!a || !b) { return (!a) ? -1 : 1; }
+    else if(a->ss_family != b->ss_family) { return (a->ss_family < b->ss_family) ? -1 : 1; }
+
+    int retVal = 0;
+    if(a->ss_family == AF_INET)
+    {
+        const sockaddr_in* ai = (const struct sockaddr_in*)a;
+        const sockaddr_in* bi = (const struct sockaddr_in*)b;
+        retVal = memcmp(&ai->sin_addr, &bi->sin_addr, sizeof(in_addr));
+        if(retVal == 0) { retVal = memcmp(&ai->sin_port, &bi->sin_port, sizeof(in_port_t)); }
+    }
+    else
+    {
+        const sockaddr_in6* ai = (const struct sockaddr_in6*)a;
+        const sockaddr_in6* bi = (const struct sockaddr_in6*)b;
+        retVal = memcmp(&ai->sin6_addr, &bi->sin6_addr, sizeof(in6_addr));
+        if(retVal == 0) { retVal = memcmp(&ai->sin6_port, &bi->sin6_port, sizeof(in_port_t)); }
+    }
+
+    return retVal;
+}
+
+void copyAddress(sockaddr_storage* dst, const sockaddr_storage* src)
+{
+    if(!dst) { return; }
+    memset(dst, 0, sizeof(sockaddr_storage));
+    if(!src) { return; }
+
+    switch(src->ss_family)
+    {
+        case AF_INET: { memcpy(dst, src, sizeof(sockaddr_in)); break; }
+        case AF_INET6: { memcpy(dst, src, sizeof(sockaddr_in6)); break; }
+        case AF_UNIX: { memcpy(dst, src, sizeof(sockaddr_un)); break; }
+        default: { dst->ss_family = src->ss_family; break; }
+    }
+}
+
 uint16_t getPort(const sockaddr_storage* ss)
 {
     // catch for failure
@@ -139,7 +180,7 @@ std::string getIPString(const sockaddr_storage* ss)
         {
             struct sockaddr_in6* sai6 = (struct sockaddr_in6*)ss;
             str.resize(INET6_ADDRSTRLEN+1, '\0');
-            inet_ntop(AF_INET, &sai6->sin6_addr, &str[0], INET6_ADDRSTRLEN);
+            inet_ntop(AF_INET6, &sai6->sin6_addr, &str[0], INET6_ADDRSTRLEN);
             str += ":" + std::to_string(ntohs(sai6->sin6_port));
             break;
         }
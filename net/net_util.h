@@ -20,6 +20,8 @@
 #endif
 
 bool isSameSource(sockaddr_storage* sas, addrinfo* addr);
+int compareAddress(const sockaddr_storage* a, const sockaddr_storage* b);
+void copyAddress(sockaddr_storage* dst, const sockaddr_storage* src); // src may be a cast addrinfo::ai_addr, only its family's bytes are read
 uint16_t getPort(const sockaddr_storage* ss);
 uint16_t getPort(const addrinfo* ad);
 uint16_t getPort(const std::string& IPString, uint16_t& port);
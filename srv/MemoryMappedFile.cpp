@@ -81,7 +81,7 @@ namespace CGameEngine
 
     /// \WRITING data
     MemoryMappedFile::MemoryMappedFile(std::string& writeFilePath, uint32_t fileSize)
-        : m_path(writeFilePath), m_readOnly(false)
+        : m_path(writeFilePath), m_readOnly(false), m_owner(true)
     {
         // open fd
         m_fd = open(writeFilePath.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
@@ -94,6 +94,7 @@ namespace CGameEngine
         // finally, create the shared file
         m_shared = reinterpret_cast<ShareStruct*>(mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0));
         if(m_shared == MAP_FAILED) { Logger::getInstance().Log(Logs::FATAL, Logs::MemoryMapping, "MemoryMappedFile::MemoryMappedFile(string, uint32_t)", "Failed to map file for fd '{}' and path '{}'!", m_fd, writeFilePath); }
+        m_shared->totalSize = fileSize;
     }
 
     /// \READING data
@@ -114,14 +115,29 @@ namespace CGameEngine
         if(m_shared == MAP_FAILED) { Logger::getInstance().Log(Logs::FATAL, Logs::MemoryMapping, "MemoryMappedFile::MemoryMappedFile(string)", "Failed to map file for fd '{}' and path '{}'!", m_fd, readFilePath); }
     }
 
+    /// \SHARING data, both sides write when ReadWrite
+    MemoryMappedFile::MemoryMappedFile(std::string& sharedFilePath, MappingMode::FORMS mode)
+        : m_path(sharedFilePath), m_readOnly(mode != MappingMode::ReadWrite)
+    {
+        bool readWrite = !m_readOnly;
+        m_fd = open(sharedFilePath.c_str(), (readWrite ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        if(m_fd == -1) { Logger::getInstance().Log(Logs::FATAL, Logs::MemoryMapping, "MemoryMappedFile::MemoryMappedFile(string, MappingMode)", "Failed to open fd for path '{}'!", sharedFilePath); }
+
+        struct stat sb;
+        if(fstat(m_fd, &sb) < 0) { Logger::getInstance().Log(Logs::FATAL, Logs::MemoryMapping, "MemoryMappedFile::MemoryMappedFile(string, MappingMode)", "Failed to stat file for fd '{}' and path '{}'!", m_fd, sharedFilePath); }
+        m_size = sb.st_size;
+
+        m_shared = reinterpret_cast<ShareStruct*>(mmap(nullptr, m_size, PROT_READ | (readWrite ? PROT_WRITE : 0), MAP_SHARED, m_fd, 0));
+        if(m_shared == MAP_FAILED) { Logger::getInstance().Log(Logs::FATAL, Logs::MemoryMapping, "MemoryMappedFile::MemoryMappedFile(string, MappingMode)", "Failed to map file for fd '{}' and path '{}'!", m_fd, sharedFilePath); }
+    }
+
     MemoryMappedFile::~MemoryMappedFile()
     {
-    	// only allow 'writers' to delete
-    	if(!m_readOnly)
-    	{
-			if(m_shared) { munmap(reinterpret_cast<void*>(m_shared), m_size); } // unmapping the memory from the file
-        	if(m_path != "") { remove(m_path.c_str()); } // deleting the actual file
-        }
+        if(m_shared && m_shared != MAP_FAILED) { munmap(reinterpret_cast<void*>(m_shared), m_size); } // unmapping the memory from the file
+        m_shared = nullptr;
+
+    	// only allow the creator to delete
+    	if(m_owner && m_path != "") { remove(m_path.c_str()); } // deleting the actual file
 
 		// close out file descriptor, if exists
         if(m_fd > 0)
@@ -137,8 +153,7 @@ namespace CGameEngine
     void MemoryMappedFile::zeroFill()
     {
 		if(m_readOnly) { return; } // can't let 'readers' make changes
-        memset(reinterpret_cast<void*>(m_shared), 0, sizeof(ShareStruct));
-        memset(m_shared->data, 0, m_shared->totalSize);
+        memset(m_shared->data, 0, m_shared->totalSize); // totalSize is kept, everything after it is cleared
     }
 
     bool MemoryMappedFile::sync()
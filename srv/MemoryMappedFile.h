@@ -15,6 +15,8 @@
 		http://www.goldsborough.me/c/c++/linker/2016/03/30/19-34-25-internal_and_external_linkage_in_c++/
 */
 
+namespace MappingMode { enum FORMS { ReadOnly, ReadWrite }; }
+
 namespace CGameEngine
 {
     /// \TODO: Should those be initialized on declaration?
@@ -50,6 +52,7 @@ namespace CGameEngine
         public:
             MemoryMappedFile(std::string& writeFilePath, uint32_t fileSize); // create initial file (new)
             MemoryMappedFile(std::string& readFilePath); // read mapped memory file
+            MemoryMappedFile(std::string& sharedFilePath, MappingMode::FORMS mode); // map an existing file, ReadWrite for structures both sides write (NetworkSHM rings)
             virtual ~MemoryMappedFile();
             void zeroFill();
             bool sync();
@@ -67,6 +70,7 @@ namespace CGameEngine
             int m_fd = -1;
             std::string m_path = "";
             bool m_readOnly = true;
+            bool m_owner = false; // created the file, removes it on destruction
             size_t m_size = 0;
     };
 }
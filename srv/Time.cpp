@@ -19,14 +19,39 @@ namespace CGameEngine
 
     const uint32_t Time::now() const
     {
+        const std::atomic<uint64_t>* virtualUS = m_virtualUS.load(std::memory_order_acquire);
+        if(virtualUS) { return (uint32_t)(virtualUS->load(std::memory_order_relaxed) / 1000000); }
         return (uint32_t)std::chrono::duration_cast<std::chrono::seconds>(m_clock::now().time_since_epoch()).count();
     }
 
     const uint64_t Time::nowMS() const
     {
+        const std::atomic<uint64_t>* virtualUS = m_virtualUS.load(std::memory_order_acquire);
+        if(virtualUS) { return virtualUS->load(std::memory_order_relaxed) / 1000; }
         return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(m_clock::now().time_since_epoch()).count();
     }
 
+    const uint64_t Time::steadyNS() const
+    {
+        const std::atomic<uint64_t>* virtualUS = m_virtualUS.load(std::memory_order_acquire);
+        if(virtualUS) { return virtualUS->load(std::memory_order_relaxed) * 1000; }
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    namespace { thread_local uint64_t cachedSample = 0; } // per thread, 0 until its first tick()
+
+    uint64_t Time::tick()
+    {
+        cachedSample = steadyNS();
+        return cachedSample;
+    }
+
+    const uint64_t Time::cachedNS() const
+    {
+        if(cachedSample == 0) { cachedSample = steadyNS(); }
+        return cachedSample;
+    }
+
     const timepoint Time::nowTP() const
     {
         return m_clock::now();
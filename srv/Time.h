@@ -2,6 +2,7 @@
 #define TIME_H
 
 #include "common/types.h"
+#include <atomic>
 #include <chrono>
 #include <string>
 
@@ -10,7 +11,12 @@
         http://en.cppreference.com/w/cpp/chrono/duration/duration_cast
         http://www.informit.com/articles/article.aspx?p=1881386&seqNum=2
         http://en.cppreference.com/w/cpp/chrono
+        http://man7.org/linux/man-pages/man2/clock_gettime.2.html
+            CLOCK_MONOTONIC (steady_clock) : not affected by NTP steps or settimeofday()
 
+    now()/nowMS() are wall clock time, for timestamps that leave the process. Deadlines, timeouts
+    and latencies use the steady* functions, loops that read the time for every item they handle
+    tick() once per iteration and read the cached* functions instead, a thread local load.
 */
 
 using m_clock = std::chrono::system_clock;
@@ -29,14 +35,26 @@ namespace CGameEngine
             timepoint futureTP(uint64_t& MS);
             const uint32_t now() const;
             const uint64_t nowMS() const;
+            const uint64_t steadyNS() const; // monotonic, only meaningful as a difference
+            const uint64_t steadyUS() const { return steadyNS() / 1000; }
+            const uint64_t steadyMS() const { return steadyNS() / 1000000; }
+            uint64_t tick(); // refresh the calling thread's cached steadyNS(), returns it
+            const uint64_t cachedNS() const; // calling thread's last tick(), ticks once if it never has
+            const uint64_t cachedUS() const { return cachedNS() / 1000; }
+            const uint64_t cachedMS() const { return cachedNS() / 1000000; }
             const timepoint nowTP() const;
             std::string getTimestamp(bool precise = false);
+            void setVirtualClock(const std::atomic<uint64_t>* clockUS) { m_virtualUS.store(clockUS, std::memory_order_release); } // simulation, now()/nowMS()/steady*() read clockUS (epoch microseconds) until reset with nullptr
+            const bool isVirtual() const { return (m_virtualUS.load(std::memory_order_acquire) != nullptr); }
 
         protected:
             Time() {}
             virtual ~Time() {}
             Time(const Time&) = delete;
             Time operator&(const Time&) = delete;
+
+        private:
+            std::atomic<const std::atomic<uint64_t>*> m_virtualUS { nullptr }; // NetworkSimulator's clock while installed
     };
 }
 